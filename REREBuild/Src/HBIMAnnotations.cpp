@@ -0,0 +1,955 @@
+// *****************************************************************************
+// File:			HBIMAnnotations.cpp
+// Description:		labelme 标注索引：后台轮询图片文件夹、顺序读取 JSON、
+//					按标注类型求面积、标注名 → 照片 → 构件 统计
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMAnnotations.hpp"
+#include "HBIMCommon.hpp"
+#include "HBIMEventLoop.hpp"
+#include "HBIMGlobalIdIndex.hpp"
+#include "HBIMImageStore.hpp"
+#include "HBIMNotifications.hpp"
+#include "HBIMProject.hpp"
+#include "DGModule.hpp"
+#include "Polygon2D.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#if defined(GS_MAC)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+	static const unsigned kMaxWorkers = 8;
+	static const int kPollSeconds = 5;
+	static const int kMaxJsonDepth = 64;
+	static const USize kMaxReportedLabels = 12;
+	static const char* kTableFileName = "HBIM_Annotations.csv";
+	static const char* kOrphanFolderName = "_orphans";		// 与 HBIMImageReconciler 一致
+	static const char* kPhotoExtensions[] = { ".jpg", ".jpeg", ".png", ".JPG", ".JPEG", ".PNG" };
+	static const double kPi = 3.14159265358979323846;		// M_PI 不是标准 C++，MSVC 需额外定义宏
+
+	// ---- 顺序读取 JSON ----------------------------------------------------------------
+
+	// 只向前移动的 JSON 读取器，直接在映射的文件内容上工作。
+	// 不需要的值只扫描过去不复制；labelme 文件的大部分是 base64 的 imageData，跳过它只是一次 memchr
+	class JsonReader {
+	public:
+		JsonReader(const char* begin, const char* end) : p(begin), end(end) {}
+
+		bool Failed() const { return failed; }
+
+		bool BeginObject() { return Expect('{'); }
+		bool BeginArray() { return Expect('['); }
+
+		// 读取对象的下一个键；对象结束或出错时返回 false
+		bool NextKey(std::string& key) {
+			if (!NextItem('}'))
+				return false;
+			if (!ReadString(&key) || !Expect(':'))
+				return false;
+			return true;
+		}
+
+		// 数组还有下一个元素时返回 true
+		bool NextElement() { return NextItem(']'); }
+
+		bool PeekNull() {
+			SkipSpace();
+			return p < end && *p == 'n';
+		}
+
+		// out 为 nullptr 时只跳过
+		bool ReadString(std::string* out) {
+			SkipSpace();
+			if (p >= end || *p != '"')
+				return Fail();
+			++p;
+			if (out != nullptr)
+				out->clear();
+			while (true) {
+				const char* quote = static_cast<const char*>(std::memchr(p, '"', static_cast<size_t>(end - p)));
+				if (quote == nullptr)
+					return Fail();
+				const char* slash = static_cast<const char*>(std::memchr(p, '\\', static_cast<size_t>(quote - p)));
+				if (slash == nullptr) {
+					if (out != nullptr)
+						out->append(p, quote);
+					p = quote + 1;
+					return true;
+				}
+				if (out != nullptr)
+					out->append(p, slash);
+				p = slash + 1;
+				if (p >= end)
+					return Fail();
+				const char escaped = *p++;
+				if (escaped == 'u') {
+					UInt32 code = 0;
+					if (!ReadHex4(code))
+						return Fail();
+					// 代理对
+					if (code >= 0xD800 && code < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+						p += 2;
+						UInt32 low = 0;
+						if (!ReadHex4(low))
+							return Fail();
+						code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+					}
+					if (out != nullptr)
+						AppendUtf8(*out, code);
+					continue;
+				}
+				if (out == nullptr)
+					continue;
+				switch (escaped) {
+					case 'n': out->push_back('\n'); break;
+					case 't': out->push_back('\t'); break;
+					case 'r': out->push_back('\r'); break;
+					case 'b': out->push_back('\b'); break;
+					case 'f': out->push_back('\f'); break;
+					default:  out->push_back(escaped); break;		// \" \\ \/
+				}
+			}
+		}
+
+		// 文件内容不以 0 结尾，不能用 strtod
+		bool ReadNumber(double& out) {
+			SkipSpace();
+			bool negative = false;
+			if (p < end && (*p == '-' || *p == '+'))
+				negative = *p++ == '-';
+			if (p >= end || !(IsDigit(*p) || *p == '.'))
+				return Fail();
+			double value = 0.0;
+			while (p < end && IsDigit(*p))
+				value = value * 10.0 + (*p++ - '0');
+			if (p < end && *p == '.') {
+				++p;
+				double scale = 0.1;
+				while (p < end && IsDigit(*p)) {
+					value += (*p++ - '0') * scale;
+					scale *= 0.1;
+				}
+			}
+			if (p < end && (*p == 'e' || *p == 'E')) {
+				++p;
+				bool negativeExponent = false;
+				if (p < end && (*p == '-' || *p == '+'))
+					negativeExponent = *p++ == '-';
+				int exponent = 0;
+				while (p < end && IsDigit(*p))
+					exponent = std::min(exponent * 10 + (*p++ - '0'), 400);
+				value *= std::pow(10.0, negativeExponent ? -exponent : exponent);
+			}
+			out = negative ? -value : value;
+			return true;
+		}
+
+		bool Skip() { return SkipValue(0); }
+
+	private:
+		const char* p;
+		const char* end;
+		bool failed = false;
+
+		static bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+		bool Fail() {
+			failed = true;
+			return false;
+		}
+
+		void SkipSpace() {
+			while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+				++p;
+		}
+
+		bool Expect(char c) {
+			SkipSpace();
+			if (failed || p >= end || *p != c)
+				return Fail();
+			++p;
+			return true;
+		}
+
+		// 逗号可省略；遇到 close 时消费它并返回 false
+		bool NextItem(char close) {
+			if (failed)
+				return false;
+			SkipSpace();
+			if (p < end && *p == ',') {
+				++p;
+				SkipSpace();
+			}
+			if (p >= end)
+				return Fail();
+			if (*p == close) {
+				++p;
+				return false;
+			}
+			return true;
+		}
+
+		bool ReadHex4(UInt32& out) {
+			if (end - p < 4)
+				return false;
+			out = 0;
+			for (int i = 0; i < 4; ++i) {
+				const char c = *p++;
+				out <<= 4;
+				if (c >= '0' && c <= '9')
+					out |= static_cast<UInt32>(c - '0');
+				else if (c >= 'a' && c <= 'f')
+					out |= static_cast<UInt32>(c - 'a' + 10);
+				else if (c >= 'A' && c <= 'F')
+					out |= static_cast<UInt32>(c - 'A' + 10);
+				else
+					return false;
+			}
+			return true;
+		}
+
+		static void AppendUtf8(std::string& out, UInt32 code) {
+			if (code < 0x80) {
+				out.push_back(static_cast<char>(code));
+			} else if (code < 0x800) {
+				out.push_back(static_cast<char>(0xC0 | (code >> 6)));
+				out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+			} else if (code < 0x10000) {
+				out.push_back(static_cast<char>(0xE0 | (code >> 12)));
+				out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+				out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+			} else {
+				out.push_back(static_cast<char>(0xF0 | (code >> 18)));
+				out.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+				out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+				out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+			}
+		}
+
+		bool SkipLiteral(const char* literal) {
+			const size_t length = std::strlen(literal);
+			if (static_cast<size_t>(end - p) < length || std::memcmp(p, literal, length) != 0)
+				return Fail();
+			p += length;
+			return true;
+		}
+
+		bool SkipValue(int depth) {
+			if (depth > kMaxJsonDepth)
+				return Fail();
+			SkipSpace();
+			if (p >= end)
+				return Fail();
+			switch (*p) {
+				case '"':
+					return ReadString(nullptr);
+				case '{':
+					++p;
+					while (NextItem('}')) {
+						if (!ReadString(nullptr) || !Expect(':') || !SkipValue(depth + 1))
+							return false;
+					}
+					return !failed;
+				case '[':
+					++p;
+					while (NextItem(']')) {
+						if (!SkipValue(depth + 1))
+							return false;
+					}
+					return !failed;
+				case 't':
+					return SkipLiteral("true");
+				case 'f':
+					return SkipLiteral("false");
+				case 'n':
+					return SkipLiteral("null");
+				default: {
+					double ignored;
+					return ReadNumber(ignored);
+				}
+			}
+		}
+	};
+
+	// ---- 标注文件 ----------------------------------------------------------------
+
+	struct ShapeRecord {
+		std::string label;
+		std::string shapeType;
+		double area = 0.0;
+		std::vector<API_Coord> points;
+	};
+
+	struct SidecarRecord {
+		std::string sidecarPath;		// 相对项目目录
+		std::string photoPath;			// 相对项目目录，与图片链接中的路径一致
+		UInt32 imageWidth = 0;
+		UInt32 imageHeight = 0;
+		UInt64 fileSize = 0;
+		Int64 modTime = 0;
+		UInt64 revision = 0;			// 主线程合并时赋值
+		std::vector<ShapeRecord> shapes;
+	};
+
+	struct Job {
+		std::filesystem::path fullPath;
+		std::string sidecarPath;
+		UInt64 fileSize = 0;
+		Int64 modTime = 0;
+	};
+
+	// 手工描画的多边形常有自交，经 Polygon2D 规整后求面积，避免有向面积正负抵消
+	static double PolygonArea(const std::vector<API_Coord>& points) {
+		GS::Array<Point2D> coords;
+		for (const API_Coord& point : points)
+			coords.Push(Point2D(point.x, point.y));
+		try {
+			return Geometry::Polygon2D::Create(coords, 0).CalcArea();
+		} catch (...) {
+			double twiceArea = 0.0;
+			for (size_t i = 0, j = points.size() - 1; i < points.size(); j = i++)
+				twiceArea += points[j].x * points[i].y - points[i].x * points[j].y;
+			return std::fabs(0.5 * twiceArea);
+		}
+	}
+
+	static double ShapeArea(const ShapeRecord& shape) {
+		const std::vector<API_Coord>& pts = shape.points;
+		if (shape.shapeType == "rectangle" && pts.size() >= 2)
+			return std::fabs((pts[1].x - pts[0].x) * (pts[1].y - pts[0].y));
+		if (shape.shapeType == "circle" && pts.size() >= 2) {
+			const double dx = pts[1].x - pts[0].x;
+			const double dy = pts[1].y - pts[0].y;
+			return kPi * (dx * dx + dy * dy);
+		}
+		// 早期 labelme 没有 shape_type，一律为多边形
+		if ((shape.shapeType == "polygon" || shape.shapeType.empty()) && pts.size() >= 3)
+			return PolygonArea(pts);
+		return 0.0;
+	}
+
+	static bool ReadOptionalString(JsonReader& reader, std::string& out) {
+		if (reader.PeekNull()) {
+			out.clear();
+			return reader.Skip();
+		}
+		return reader.ReadString(&out);
+	}
+
+	static bool ReadPoints(JsonReader& reader, std::vector<API_Coord>& outPoints) {
+		if (!reader.BeginArray())
+			return false;
+		while (reader.NextElement()) {
+			API_Coord point = {};
+			if (!reader.BeginArray() || !reader.NextElement() || !reader.ReadNumber(point.x) ||
+				!reader.NextElement() || !reader.ReadNumber(point.y))
+				return false;
+			while (reader.NextElement()) {
+				if (!reader.Skip())
+					return false;
+			}
+			outPoints.push_back(point);
+		}
+		return !reader.Failed();
+	}
+
+	static bool ReadShape(JsonReader& reader, ShapeRecord& outShape) {
+		if (!reader.BeginObject())
+			return false;
+		std::string key;
+		while (reader.NextKey(key)) {
+			bool ok = true;
+			if (key == "label")
+				ok = ReadOptionalString(reader, outShape.label);
+			else if (key == "shape_type")
+				ok = ReadOptionalString(reader, outShape.shapeType);
+			else if (key == "points")
+				ok = ReadPoints(reader, outShape.points);
+			else
+				ok = reader.Skip();
+			if (!ok)
+				return false;
+		}
+		return !reader.Failed();
+	}
+
+	static bool ParseSidecar(const char* data, size_t size, SidecarRecord& record, std::string& outImagePath) {
+		JsonReader reader(data, data + size);
+		if (!reader.BeginObject())
+			return false;
+		std::string key;
+		while (reader.NextKey(key)) {
+			bool ok = true;
+			double number = 0.0;
+			if (key == "shapes") {
+				ok = reader.BeginArray();
+				while (ok && reader.NextElement()) {
+					ShapeRecord shape;
+					ok = ReadShape(reader, shape);
+					if (ok)
+						record.shapes.push_back(std::move(shape));
+				}
+				ok = ok && !reader.Failed();
+			} else if (key == "imagePath") {
+				ok = ReadOptionalString(reader, outImagePath);
+			} else if (key == "imageWidth" && !reader.PeekNull()) {
+				ok = reader.ReadNumber(number);
+				record.imageWidth = static_cast<UInt32>(std::max(0.0, number));
+			} else if (key == "imageHeight" && !reader.PeekNull()) {
+				ok = reader.ReadNumber(number);
+				record.imageHeight = static_cast<UInt32>(std::max(0.0, number));
+			} else {
+				ok = reader.Skip();
+			}
+			if (!ok)
+				return false;
+		}
+		return !reader.Failed();
+	}
+
+	// 标注文件中的 imagePath 相对标注文件所在文件夹；缺少时按同名图片查找
+	static std::string ResolvePhotoPath(const std::filesystem::path& sidecarFullPath, std::string imagePath,
+										const std::filesystem::path& imageRoot, const std::string& imageFolderName) {
+		std::filesystem::path photoFullPath;
+		if (!imagePath.empty()) {
+			std::replace(imagePath.begin(), imagePath.end(), '\\', '/');
+			photoFullPath = (sidecarFullPath.parent_path() / std::filesystem::path(imagePath)).lexically_normal();
+		} else {
+			std::error_code ec;
+			for (const char* extension : kPhotoExtensions) {
+				std::filesystem::path candidate = sidecarFullPath;
+				candidate.replace_extension(extension);
+				if (std::filesystem::exists(candidate, ec)) {
+					photoFullPath = candidate;
+					break;
+				}
+			}
+			if (photoFullPath.empty())
+				return std::string();
+		}
+		return imageFolderName + "/" + photoFullPath.lexically_relative(imageRoot).generic_string();
+	}
+
+	static bool ReadSidecar(const Job& job, const std::filesystem::path& imageRoot, const std::string& imageFolderName, SidecarRecord& record) {
+		record.sidecarPath = job.sidecarPath;
+		record.fileSize = job.fileSize;
+		record.modTime = job.modTime;
+		if (job.fileSize == 0)
+			return false;
+
+		std::string imagePath;
+#if defined(GS_MAC)
+		int fd = open(job.fullPath.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+		void* mapped = mmap(nullptr, static_cast<size_t>(job.fileSize), PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (mapped == MAP_FAILED)
+			return false;
+
+		const bool parsed = ParseSidecar(static_cast<const char*>(mapped), static_cast<size_t>(job.fileSize), record, imagePath);
+		munmap(mapped, static_cast<size_t>(job.fileSize));
+#else
+		std::ifstream in(job.fullPath, std::ios::binary);
+		if (!in.is_open())
+			return false;
+		std::vector<char> buffer(static_cast<size_t>(job.fileSize));
+		in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+		const bool parsed = static_cast<size_t>(in.gcount()) == buffer.size() && ParseSidecar(buffer.data(), buffer.size(), record, imagePath);
+#endif
+		if (!parsed) {
+			record.shapes.clear();
+			return false;
+		}
+		for (ShapeRecord& shape : record.shapes)
+			shape.area = ShapeArea(shape);
+		record.photoPath = ResolvePhotoPath(job.fullPath, imagePath, imageRoot, imageFolderName);
+		return !record.photoPath.empty();
+	}
+
+	// ---- 后台扫描 ----------------------------------------------------------------
+
+	struct Stamp {
+		UInt64 fileSize = 0;
+		Int64 modTime = 0;
+	};
+
+	// 一次扫描的变化：新增或修改的标注文件、已删除的标注文件
+	struct Delta {
+		std::vector<SidecarRecord> updated;
+		std::vector<std::string> removed;
+		size_t failed = 0;
+		double seconds = 0.0;
+	};
+
+	static std::thread s_watcher;
+	static std::mutex s_watchMutex;
+	static std::condition_variable s_watchWake;
+	static std::atomic<bool> s_stopWatching(false);
+
+	static bool IsSidecarFile(const std::filesystem::path& path) {
+		std::string ext = path.extension().string();
+		std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return ext == ".json" && path.filename().string().rfind('.', 0) != 0;
+	}
+
+	// 工作线程按原子计数领取任务；停止请求时尽快返回（结果不再使用）
+	static std::vector<SidecarRecord> ReadAllSidecars(const std::vector<Job>& jobs, const std::filesystem::path& imageRoot,
+													  const std::string& imageFolderName, std::vector<bool>& outOk) {
+		std::vector<SidecarRecord> records(jobs.size());
+		outOk.assign(jobs.size(), false);
+		std::vector<char> ok(jobs.size(), 0);
+		std::atomic<size_t> next(0);
+		auto work = [&]() {
+			for (size_t i = next++; i < jobs.size() && !s_stopWatching; i = next++)
+				ok[i] = ReadSidecar(jobs[i], imageRoot, imageFolderName, records[i]) ? 1 : 0;
+		};
+		const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+		const size_t workers = std::min<size_t>(std::min(hardware, kMaxWorkers), jobs.size());
+		std::vector<std::thread> threads;
+		for (size_t i = 1; i < workers; ++i)
+			threads.emplace_back(work);
+		work();
+		for (std::thread& thread : threads)
+			thread.join();
+		for (size_t i = 0; i < ok.size(); ++i)
+			outOk[i] = ok[i] != 0;
+		return records;
+	}
+
+	static void ApplyDelta(UInt32 generation, Delta& delta);
+
+	// 轮询图片文件夹：只比较大小与修改时间，变化的标注文件并行读取后交回主线程
+	static void WatchLoop(std::filesystem::path imageRoot, std::string imageFolderName, UInt32 generation) {
+		std::unordered_map<std::string, Stamp> known;
+		bool first = true;
+		while (!s_stopWatching) {
+			auto start = std::chrono::steady_clock::now();
+			std::unordered_set<std::string> seen;
+			std::vector<Job> jobs;
+			std::error_code ec;
+			for (std::filesystem::recursive_directory_iterator it(imageRoot, std::filesystem::directory_options::skip_permission_denied, ec), end;
+				 !ec && it != end && !s_stopWatching; it.increment(ec)) {
+				const std::filesystem::path& path = it->path();
+				std::error_code fileEc;
+				if (it->is_directory(fileEc)) {
+					// 瓦片缓存、派生图等隐藏文件夹与孤立图片文件夹中没有标注
+					const std::string name = path.filename().string();
+					if (name.rfind('.', 0) == 0 || name == kOrphanFolderName)
+						it.disable_recursion_pending();
+					continue;
+				}
+				if (!it->is_regular_file(fileEc) || !IsSidecarFile(path))
+					continue;
+				Job job;
+				job.modTime = static_cast<Int64>(std::filesystem::last_write_time(path, fileEc).time_since_epoch().count());
+				if (fileEc)
+					continue;
+				job.fileSize = static_cast<UInt64>(std::filesystem::file_size(path, fileEc));
+				if (fileEc)
+					continue;
+				job.fullPath = path;
+				job.sidecarPath = imageFolderName + "/" + path.lexically_relative(imageRoot).generic_string();
+				seen.insert(job.sidecarPath);
+				auto found = known.find(job.sidecarPath);
+				if (found != known.end() && found->second.fileSize == job.fileSize && found->second.modTime == job.modTime)
+					continue;
+				jobs.push_back(std::move(job));
+			}
+
+			auto delta = std::make_shared<Delta>();
+			for (auto it = known.begin(); it != known.end();) {
+				if (seen.count(it->first) == 0) {
+					delta->removed.push_back(it->first);
+					it = known.erase(it);
+				} else {
+					++it;
+				}
+			}
+
+			std::vector<bool> ok;
+			std::vector<SidecarRecord> records = ReadAllSidecars(jobs, imageRoot, imageFolderName, ok);
+			if (s_stopWatching)
+				return;
+			for (size_t i = 0; i < records.size(); ++i) {
+				// 读取失败（多半是 labelme 正在写入）也记下时间戳，文件再次变化时重读；旧记录随之移除
+				known[jobs[i].sidecarPath] = { jobs[i].fileSize, jobs[i].modTime };
+				if (ok[i]) {
+					delta->updated.push_back(std::move(records[i]));
+				} else {
+					delta->removed.push_back(jobs[i].sidecarPath);
+					++delta->failed;
+				}
+			}
+			delta->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			if (first || !delta->updated.empty() || !delta->removed.empty())
+				HBIMEventLoop::Post([generation, delta]() { ApplyDelta(generation, *delta); });
+			first = false;
+
+			std::unique_lock<std::mutex> lock(s_watchMutex);
+			s_watchWake.wait_for(lock, std::chrono::seconds(kPollSeconds), []() { return s_stopWatching.load(); });
+		}
+	}
+
+	// ---- 主线程索引 ----------------------------------------------------------------
+
+	// 只在主线程访问
+	static std::unordered_map<std::string, SidecarRecord> s_sidecars;					// 标注文件 → 记录
+	static std::unordered_map<std::string, std::string> s_photoSidecars;				// 照片 → 标注文件
+	static std::unordered_map<std::string, std::unordered_set<std::string>> s_labelSidecars;	// 标注名 → 标注文件
+	static std::filesystem::path s_watchRoot;
+	static UInt32 s_generation = 0;
+	static UInt64 s_nextRevision = 0;
+	static bool s_ready = false;
+	static std::function<void()> s_changeListener;
+
+	static void RemoveSidecar(const std::string& sidecarPath) {
+		auto found = s_sidecars.find(sidecarPath);
+		if (found == s_sidecars.end())
+			return;
+		for (const ShapeRecord& shape : found->second.shapes) {
+			auto labelIt = s_labelSidecars.find(shape.label);
+			if (labelIt == s_labelSidecars.end())
+				continue;
+			labelIt->second.erase(sidecarPath);
+			if (labelIt->second.empty())
+				s_labelSidecars.erase(labelIt);
+		}
+		auto photoIt = s_photoSidecars.find(found->second.photoPath);
+		if (photoIt != s_photoSidecars.end() && photoIt->second == sidecarPath)
+			s_photoSidecars.erase(photoIt);
+		s_sidecars.erase(found);
+	}
+
+	static void AddSidecar(SidecarRecord&& record) {
+		const std::string sidecarPath = record.sidecarPath;
+		record.revision = ++s_nextRevision;
+		for (const ShapeRecord& shape : record.shapes)
+			s_labelSidecars[shape.label].insert(sidecarPath);
+		s_photoSidecars[record.photoPath] = sidecarPath;
+		s_sidecars[sidecarPath] = std::move(record);
+	}
+
+	static void ApplyDelta(UInt32 generation, Delta& delta) {
+		if (generation != s_generation)
+			return;
+		for (const std::string& sidecarPath : delta.removed)
+			RemoveSidecar(sidecarPath);
+		for (SidecarRecord& record : delta.updated) {
+			RemoveSidecar(record.sidecarPath);
+			AddSidecar(std::move(record));
+		}
+		const bool changed = !delta.updated.empty() || !delta.removed.empty();
+		s_ready = true;
+		ACAPI_WriteReport("HBIMAnnotations: 读取标注文件 %d 个（失败 %d），移除 %d 个，共 %d 个，耗时 %.3f 秒", false,
+						  static_cast<int>(delta.updated.size()), static_cast<int>(delta.failed),
+						  static_cast<int>(delta.removed.size() - delta.failed), static_cast<int>(s_sidecars.size()), delta.seconds);
+		if (changed && s_changeListener)
+			s_changeListener();
+	}
+
+	static void StopWatching() {
+		{
+			std::lock_guard<std::mutex> lock(s_watchMutex);
+			s_stopWatching = true;
+		}
+		s_watchWake.notify_all();
+		if (s_watcher.joinable())
+			s_watcher.join();
+		s_stopWatching = false;
+	}
+
+	static void Reset() {
+		StopWatching();
+		++s_generation;
+		s_watchRoot.clear();
+		s_sidecars.clear();
+		s_photoSidecars.clear();
+		s_labelSidecars.clear();
+		s_ready = false;
+	}
+
+	// 图片文件夹变化（打开、另存为）时重新开始扫描；未保存项目不扫描
+	static void EnsureWatching() {
+		const HBIMProject::Context& context = HBIMProject::GetContext();
+		if (!context.isSaved) {
+			if (!s_watchRoot.empty())
+				Reset();
+			return;
+		}
+		if (s_watchRoot == context.imageRoot && s_watcher.joinable())
+			return;
+		Reset();
+		s_watchRoot = context.imageRoot;
+		s_watcher = std::thread(WatchLoop, context.imageRoot, std::string(context.imageFolderName.ToCStr().Get()), s_generation);
+	}
+
+	static void OnProjectEvent(API_NotifyEventID notifID) {
+		switch (notifID) {
+			case APINotify_New:
+			case APINotify_NewAndReset:
+			case APINotify_Open:
+			case APINotify_Save:
+				// 项目路径在事件处理完后才更新，下一轮事件循环中再比较图片文件夹
+				HBIMEventLoop::Post([]() { EnsureWatching(); });
+				break;
+			case APINotify_Close:
+			case APINotify_Quit:
+				Reset();
+				break;
+			default:
+				break;
+		}
+	}
+
+	// ---- 统计 ----------------------------------------------------------------
+
+	static GS::UniString ToUniString(const std::string& text) {
+		return GS::UniString(text.c_str(), CC_UTF8);
+	}
+
+	// 标注名 → 构件统计
+	using LabelElements = std::unordered_map<std::string, GS::HashTable<API_Guid, HBIMAnnotations::ElementStats>>;
+
+	// 一个标注文件的照片归到链接它的构件：照片 → 构件 由 HBIMImageStore 的索引回答，不读取全部图片链接
+	static void AddSidecarStats(const SidecarRecord& record, const std::unordered_set<std::string>* onlyLabel, LabelElements& outStats) {
+		// 同一张照片中同名标注先合并，照片数按张计
+		std::unordered_map<std::string, std::pair<UInt32, double>> perLabel;
+		for (const ShapeRecord& shape : record.shapes) {
+			if (onlyLabel != nullptr && onlyLabel->count(shape.label) == 0)
+				continue;
+			auto& entry = perLabel[shape.label];
+			entry.first += 1;
+			entry.second += shape.area;
+		}
+		if (perLabel.empty())
+			return;
+
+		GS::Array<API_Guid> elemGuids;
+		HBIMImageStore::GetPhotoElements(GS::UniString(record.photoPath.c_str()), elemGuids);
+		const double imageArea = static_cast<double>(record.imageWidth) * record.imageHeight;
+		for (const API_Guid& elemGuid : elemGuids) {
+			for (const auto& entry : perLabel) {
+				GS::HashTable<API_Guid, HBIMAnnotations::ElementStats>& elements = outStats[entry.first];
+				if (!elements.ContainsKey(elemGuid)) {
+					HBIMAnnotations::ElementStats initial;
+					initial.elemGuid = elemGuid;
+					elements.Add(elemGuid, initial);
+				}
+				HBIMAnnotations::ElementStats& stats = elements.Get(elemGuid);
+				stats.photoCount += 1;
+				stats.shapeCount += entry.second.first;
+				stats.area += entry.second.second;
+				if (imageArea > 0.0)
+					stats.maxCoverage = std::max(stats.maxCoverage, entry.second.second / imageArea);
+			}
+		}
+	}
+
+	// onlyLabel 非空时只访问含该标注的标注文件（标注名 → 标注文件 → 照片 → 构件）
+	static void CollectElementStats(const std::string* onlyLabel, LabelElements& outStats) {
+		outStats.clear();
+		if (onlyLabel == nullptr) {
+			for (const auto& sidecar : s_sidecars)
+				AddSidecarStats(sidecar.second, nullptr, outStats);
+			return;
+		}
+		auto labelIt = s_labelSidecars.find(*onlyLabel);
+		if (labelIt == s_labelSidecars.end())
+			return;
+		const std::unordered_set<std::string> labels = { *onlyLabel };
+		for (const std::string& sidecarPath : labelIt->second)
+			AddSidecarStats(s_sidecars.at(sidecarPath), &labels, outStats);
+	}
+
+	static bool WriteTable(const std::filesystem::path& tablePath, const LabelElements& stats) {
+		return HBIM::WriteCsvTable(tablePath, "标注,GlobalId,照片数,标注数,面积(像素²),最大画面占比",
+			[&](std::ostream& out) {
+				for (const auto& label : stats) {
+					for (auto it = label.second.EnumerateValues(); it != nullptr; ++it) {
+						const HBIMAnnotations::ElementStats& row = *it;
+						out << HBIM::CsvField(ToUniString(label.first)) << ','
+							<< HBIM::CsvField(HBIMGlobalIdIndex::GetGlobalId(row.elemGuid)) << ','
+							<< row.photoCount << ',' << row.shapeCount << ','
+							<< GS::UniString::Printf("%.1f", row.area).ToCStr().Get() << ','
+							<< GS::UniString::Printf("%.4f", row.maxCoverage).ToCStr().Get() << '\n';
+					}
+				}
+			}
+		);
+	}
+
+}
+
+namespace HBIMAnnotations {
+
+void Initialize() {
+	HBIMNotifications::AddProjectListener(OnProjectEvent);
+}
+
+void Shutdown() {
+	Reset();
+}
+
+bool IsReady() {
+	EnsureWatching();
+	return s_ready;
+}
+
+bool GetPhotoAnnotations(const GS::UniString& relativePhotoPath, PhotoAnnotations& outAnnotations) {
+	auto photoIt = s_photoSidecars.find(relativePhotoPath.ToCStr().Get());
+	if (photoIt == s_photoSidecars.end())
+		return false;
+	const SidecarRecord& record = s_sidecars.at(photoIt->second);
+	outAnnotations = PhotoAnnotations();
+	outAnnotations.sidecarPath = ToUniString(record.sidecarPath);
+	outAnnotations.revision = record.revision;
+	outAnnotations.imageWidth = record.imageWidth;
+	outAnnotations.imageHeight = record.imageHeight;
+	for (const ShapeRecord& shapeRecord : record.shapes) {
+		Shape shape;
+		shape.label = ToUniString(shapeRecord.label);
+		shape.shapeType = ToUniString(shapeRecord.shapeType);
+		shape.area = shapeRecord.area;
+		for (const API_Coord& point : shapeRecord.points)
+			shape.points.Push(point);
+		outAnnotations.shapes.Push(shape);
+	}
+	return true;
+}
+
+UInt64 GetRevision(const GS::UniString& relativePhotoPath) {
+	auto photoIt = s_photoSidecars.find(relativePhotoPath.ToCStr().Get());
+	return photoIt != s_photoSidecars.end() ? s_sidecars.at(photoIt->second).revision : 0;
+}
+
+void SetChangeListener(const std::function<void()>& listener) {
+	s_changeListener = listener;
+}
+
+void GetLabelStats(GS::Array<LabelStats>& outStats) {
+	outStats.Clear();
+	std::vector<LabelStats> ranked;
+	for (const auto& label : s_labelSidecars) {
+		LabelStats stats;
+		stats.label = ToUniString(label.first);
+		stats.photoCount = static_cast<UInt32>(label.second.size());
+		for (const std::string& sidecarPath : label.second) {
+			for (const ShapeRecord& shape : s_sidecars.at(sidecarPath).shapes) {
+				if (shape.label != label.first)
+					continue;
+				stats.shapeCount += 1;
+				stats.area += shape.area;
+			}
+		}
+		ranked.push_back(stats);
+	}
+	std::sort(ranked.begin(), ranked.end(), [](const LabelStats& a, const LabelStats& b) { return a.photoCount > b.photoCount; });
+	for (const LabelStats& stats : ranked)
+		outStats.Push(stats);
+}
+
+void QueryLabel(const GS::UniString& label, GS::Array<ElementStats>& outElements) {
+	outElements.Clear();
+	const std::string onlyLabel = label.ToCStr().Get();
+	LabelElements stats;
+	CollectElementStats(&onlyLabel, stats);
+	std::vector<ElementStats> ranked;
+	for (const auto& entry : stats) {
+		for (auto it = entry.second.EnumerateValues(); it != nullptr; ++it)
+			ranked.push_back(*it);
+	}
+	std::sort(ranked.begin(), ranked.end(), [](const ElementStats& a, const ElementStats& b) { return a.area > b.area; });
+	for (const ElementStats& element : ranked)
+		outElements.Push(element);
+}
+
+void RunStatisticsCommand() {
+	const HBIMProject::Context& context = HBIMProject::GetContext();
+	if (!context.isSaved) {
+		DG::InformationAlert("labelme标注统计", "项目未保存，没有图片文件夹。", "确定");
+		return;
+	}
+	if (!IsReady()) {
+		DG::InformationAlert("labelme标注统计", "正在后台读取图片文件夹中的标注文件，请稍后再试。", "确定");
+		return;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	GS::Array<LabelStats> labels;
+	GetLabelStats(labels);
+	if (labels.IsEmpty()) {
+		DG::InformationAlert("labelme标注统计", "图片文件夹中没有 labelme 标注文件。", "确定");
+		return;
+	}
+	LabelElements elementStats;
+	CollectElementStats(nullptr, elementStats);
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	const std::filesystem::path tablePath = context.projectDir / kTableFileName;
+	const bool tableWritten = WriteTable(tablePath, elementStats);
+	if (!tableWritten)
+		ACAPI_WriteReport("HBIMAnnotations: 写入表格失败: %s", true, tablePath.string().c_str());
+
+	GS::HashSet<API_Guid> annotatedElements;
+	GS::UniString msg = GS::UniString::Printf("标注文件 %u 个，标注名 %u 种，统计耗时 %.3f 秒。\n\n",
+											  static_cast<unsigned>(s_sidecars.size()), static_cast<unsigned>(labels.GetSize()), seconds);
+	for (UIndex i = 0; i < labels.GetSize(); ++i) {
+		const LabelStats& label = labels[i];
+		auto found = elementStats.find(label.label.ToCStr().Get());
+		const UInt32 elementCount = found != elementStats.end() ? found->second.GetSize() : 0;
+		if (found != elementStats.end()) {
+			for (auto it = found->second.EnumerateKeys(); it != nullptr; ++it)
+				annotatedElements.Add(*it);
+		}
+		if (i < kMaxReportedLabels) {
+			msg.Append(GS::UniString::Printf("%T：%u 个构件，%u 张照片，%u 处，面积 %.0f 像素²\n",
+											 label.label.ToPrintf(), elementCount, label.photoCount, label.shapeCount, label.area));
+		}
+	}
+	if (labels.GetSize() > kMaxReportedLabels)
+		msg.Append(GS::UniString::Printf("……另有 %u 种标注\n", static_cast<unsigned>(labels.GetSize() - kMaxReportedLabels)));
+	if (tableWritten) {
+		msg.Append("\n明细表: ");
+		msg.Append(GS::UniString(tablePath.string().c_str(), CC_UTF8));
+	} else {
+		msg.Append("\n明细表写入失败");
+	}
+
+	if (annotatedElements.IsEmpty()) {
+		DG::InformationAlert("labelme标注统计", msg, "确定");
+		return;
+	}
+	DG::AlertResponse response = DG::InformationAlert("labelme标注统计", msg, "选中有标注的构件", "关闭");
+	if (response != DG::Accept)
+		return;
+	GS::Array<API_Neig> selNeigs;
+	for (const API_Guid& elemGuid : annotatedElements)
+		selNeigs.Push(API_Neig(elemGuid));
+	ACAPI_Selection_DeselectAll();
+	ACAPI_Selection_Select(selNeigs, true);
+}
+
+}
@@ -0,0 +1,74 @@
+#ifndef HBIMANNOTATIONS_HPP
+#define HBIMANNOTATIONS_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+
+#include <functional>
+
+// labelme 标注（图片旁的同名 .json）索引。
+// 后台线程定期扫描图片文件夹，只重新读取大小或修改时间变化的标注文件；读取时顺序扫描 JSON，
+// 跳过内嵌的 imageData，不建立文档树。每个标注按类型求面积（多边形经 Geometry::Polygon2D 规整），
+// 结果在主线程合并为 标注名 → 照片 → 构件 的索引，统计查询只访问内存。
+namespace HBIMAnnotations {
+
+	struct Shape {
+		GS::UniString label;
+		GS::UniString shapeType;		// polygon / rectangle / circle / line / linestrip / point
+		double area = 0.0;				// 像素²；线、点为 0
+		GS::Array<API_Coord> points;	// 图片像素坐标（原点在左上角，y 向下）
+	};
+
+	struct PhotoAnnotations {
+		GS::UniString sidecarPath;		// 相对项目目录
+		UInt64 revision = 0;			// 标注文件每次重新读取后递增
+		UInt32 imageWidth = 0;
+		UInt32 imageHeight = 0;
+		GS::Array<Shape> shapes;
+	};
+
+	struct LabelStats {
+		GS::UniString label;
+		UInt32 photoCount = 0;
+		UInt32 shapeCount = 0;
+		double area = 0.0;
+	};
+
+	struct ElementStats {
+		API_Guid elemGuid = APINULLGuid;
+		UInt32 photoCount = 0;
+		UInt32 shapeCount = 0;
+		double area = 0.0;				// 各照片中该标注面积之和（像素²）
+		double maxCoverage = 0.0;		// 单张照片中标注面积占画面的最大比例
+	};
+
+	// 在 Initialize 中调用（需在 HBIMNotifications::Initialize 之后）
+	void Initialize();
+
+	// 在 FreeData 中调用：停止后台扫描线程
+	void Shutdown();
+
+	// 第一次扫描已完成（主线程）
+	bool IsReady();
+
+	// 一张图片（相对项目目录）的标注，只访问内存索引（主线程）
+	bool GetPhotoAnnotations(const GS::UniString& relativePhotoPath, PhotoAnnotations& outAnnotations);
+
+	// 一张图片标注的版本，没有标注为 0；只比较版本时不必复制标注（主线程）
+	UInt64 GetRevision(const GS::UniString& relativePhotoPath);
+
+	// 索引有变化时在主线程调用；传入空函数取消
+	void SetChangeListener(const std::function<void()>& listener);
+
+	// 各标注名的照片数、标注数与面积（主线程）
+	void GetLabelStats(GS::Array<LabelStats>& outStats);
+
+	// 带有某一标注的构件及其面积统计（主线程）；按图片链接把照片归到构件
+	void QueryLabel(const GS::UniString& label, GS::Array<ElementStats>& outElements);
+
+	// 菜单入口：按标注名统计构件，写出表格并可选中有标注的构件
+	void RunStatisticsCommand();
+
+}
+
+#endif
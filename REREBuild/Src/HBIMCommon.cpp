@@ -0,0 +1,847 @@
+// *****************************************************************************
+// File:			HBIMCommon.cpp
+// Description:		HBIM属性/图片属性的查找、创建与读写，以及IFC信息读取等公共函数
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMCommon.hpp"
+#include "APIdefs_Properties.h"
+
+#include <fstream>
+
+// IFC API头文件
+#include "ACAPI/IFCObjectAccessor.hpp"
+#include "ACAPI/IFCObjectID.hpp"
+#include "ACAPI/IFCPropertyAccessor.hpp"
+#include "ACAPI/IFCProperty.hpp"
+
+namespace HBIM {
+	// HBIM属性常量
+	const GS::UniString kHBIMGroupName = "HBIM属性信息";
+	const GS::UniString kHBIMIdName = "HBIM构件编号";
+	const GS::UniString kHBIMDescName = "HBIM构件说明";
+	const GS::UniString kHBIMStatusName = "HBIM完成状态";
+	const GS::UniString kHBIMDeviationRmsName = "HBIM扫描偏差RMS";
+	const GS::UniString kHBIMDeviationMaxName = "HBIM扫描最大偏差";
+	// 早期版本以文字（mm）写入的偏差属性，改为长度属性后删除
+	static const GS::UniString kLegacyDeviationNames[] = { "HBIM扫描偏差RMS(mm)", "HBIM扫描最大偏差(mm)" };
+	
+	// HBIM图片常量
+	const GS::UniString kHBIMImageGroupName = "HBIM构件图片";
+	const GS::UniString kHBIMImageLinksName = "HBIM图片链接";
+	
+	GS::UniString NormalizeUniString(const GS::UniString& str) {
+		GS::UniString result;
+		for (UInt32 i = 0; i < str.GetLength(); ++i) {
+			GS::uchar_t ch = str.GetChar(i);
+			if (ch != ' ' && ch != '\t' && ch != '\n' && ch != '\r' && ch != 0xA0) {
+				result.Append(ch);
+			}
+		}
+		return result;
+	}
+	
+	// 清理字符串用于文件路径（移除非法字符）
+	GS::UniString SanitizeForFilePath(const GS::UniString& str) {
+		GS::UniString result;
+		for (UInt32 i = 0; i < str.GetLength(); ++i) {
+			GS::uchar_t ch = str.GetChar(i);
+			// 允许：字母、数字、下划线、连字符、点
+			if ((ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z') || 
+				(ch >= '0' && ch <= '9') || ch == '_' || ch == '-' || ch == '.') {
+				result.Append(ch);
+			} else {
+				// 替换其他字符为下划线
+				result.Append('_');
+			}
+		}
+		return result;
+	}
+	
+	// Forward declaration
+	static void CollectClassificationItemsRecursive(const API_Guid& itemGuid, GS::Array<API_Guid>& outGuids);
+	
+	// Helper function to get IFC type from element
+	GS::UniString GetIFCTypeForElement(const API_Guid& elementGuid)
+	{
+		GS::UniString ifcType = "未知";
+		
+		try {
+			IFCAPI::ObjectAccessor objectAccessor = IFCAPI::GetObjectAccessor();
+			
+			API_Elem_Head elemHead{};
+			elemHead.guid = elementGuid;
+			
+			GSErrCode err = ACAPI_Element_GetHeader(&elemHead);
+			if (err != NoError)
+				return ifcType;
+			
+			auto objectIDResult = objectAccessor.CreateElementObjectID(elemHead);
+			if (objectIDResult.IsErr())
+				return ifcType;
+			
+			IFCAPI::ObjectID objectID = objectIDResult.Unwrap();
+			auto ifcTypeResult = objectAccessor.GetIFCType(objectID);
+			
+			if (ifcTypeResult.IsOk()) {
+				ifcType = ifcTypeResult.Unwrap();
+			}
+		} catch (...) {
+			// Handle exception
+		}
+		
+		return ifcType;
+	}
+	
+	// Helper function to get GlobalId from element
+	GS::UniString GetGlobalIdForElement(const API_Guid& elementGuid)
+	{
+		GS::UniString globalId = "未找到";
+		
+		try {
+			IFCAPI::ObjectAccessor objectAccessor = IFCAPI::GetObjectAccessor();
+			
+			API_Elem_Head elemHead{};
+			elemHead.guid = elementGuid;
+			
+			GSErrCode err = ACAPI_Element_GetHeader(&elemHead);
+			if (err != NoError)
+				return globalId;
+			
+			auto objectIDResult = objectAccessor.CreateElementObjectID(elemHead);
+			if (objectIDResult.IsErr())
+				return globalId;
+			
+			IFCAPI::ObjectID objectID = objectIDResult.Unwrap();
+			IFCAPI::PropertyAccessor propertyAccessor(objectID);
+			
+			auto attributesResult = propertyAccessor.GetAttributes();
+			if (attributesResult.IsOk()) {
+				std::vector<IFCAPI::Attribute> attributes = attributesResult.Unwrap();
+				for (const IFCAPI::Attribute& attribute : attributes) {
+					if (attribute.GetName().IsEqual("GlobalId", GS::CaseInsensitive)) {
+						auto value = attribute.GetValue();
+						if (value.has_value()) {
+							globalId = value.value();
+						}
+						break;
+					}
+				}
+			}
+		} catch (...) {
+			// Handle exception
+		}
+		
+		return globalId;
+	}
+	
+	// 收集所有分类项，使属性对所有元素可用
+	static GSErrCode GetAllClassificationItems(GS::Array<API_Guid>& outAllItems)
+	{
+		outAllItems.Clear();
+		GS::Array<API_ClassificationSystem> systems;
+		GSErrCode err = ACAPI_Classification_GetClassificationSystems(systems);
+		if (err != NoError) return err;
+		
+		for (UInt32 i = 0; i < systems.GetSize(); ++i) {
+			GS::Array<API_ClassificationItem> rootItems;
+			if (ACAPI_Classification_GetClassificationSystemRootItems(systems[i].guid, rootItems) == NoError) {
+				for (UInt32 j = 0; j < rootItems.GetSize(); ++j) {
+					CollectClassificationItemsRecursive(rootItems[j].guid, outAllItems);
+				}
+			}
+		}
+		return NoError;
+	}
+	
+	// 递归收集分类项
+	static void CollectClassificationItemsRecursive(const API_Guid& itemGuid, GS::Array<API_Guid>& outGuids)
+	{
+		outGuids.Push(itemGuid);
+		GS::Array<API_ClassificationItem> children;
+		if (ACAPI_Classification_GetClassificationItemChildren(itemGuid, children) == NoError) {
+			for (UInt32 i = 0; i < children.GetSize(); ++i) {
+				CollectClassificationItemsRecursive(children[i].guid, outGuids);
+			}
+		}
+	}
+	
+	// 创建或获取HBIM属性组
+	static GSErrCode FindOrCreateHBIMGroup(API_PropertyGroup& outGroup)
+	{
+		GS::Array<API_PropertyGroup> groups;
+		GSErrCode err = ACAPI_Property_GetPropertyGroups(groups);
+		if (err != NoError) {
+			ACAPI_WriteReport("FindOrCreateHBIMGroup: GetPropertyGroups 失败: %s", true, GS::UniString::Printf("Error %d", err).ToCStr().Get());
+			return err;
+		}
+		
+		// ACAPI_WriteReport("FindOrCreateHBIMGroup: 找到 %d 个属性组", false, (int)groups.GetSize());
+		
+		// 记录所有属性组名称用于调试
+		for (UInt32 i = 0; i < groups.GetSize(); ++i) {
+			// ACAPI_WriteReport("  属性组[%d]: %s", false, (int)i, groups[i].name.ToCStr().Get());
+		}
+		
+		for (UInt32 i = 0; i < groups.GetSize(); ++i) {
+			if (groups[i].name == kHBIMGroupName) {
+				ACAPI_WriteReport("FindOrCreateHBIMGroup: 找到现有属性组: %s", false, kHBIMGroupName.ToCStr().Get());
+				outGroup = groups[i];
+				return NoError;
+			}
+		}
+		
+	ACAPI_WriteReport("FindOrCreateHBIMGroup: 未找到属性组 '%s'，创建新组", false, kHBIMGroupName.ToCStr().Get());
+	outGroup = {};
+	outGroup.guid = APINULLGuid;
+	outGroup.name = kHBIMGroupName;
+	outGroup.description = "HBIM构件编号和说明";
+	err = ACAPI_Property_CreatePropertyGroup(outGroup);
+	if (err != NoError) {
+		ACAPI_WriteReport("FindOrCreateHBIMGroup: CreatePropertyGroup 失败: %s (错误码: %d)", true, GS::UniString::Printf("Error %d", err).ToCStr().Get(), err);
+		ACAPI_WriteReport("  尝试创建属性组: 名称='%s', 描述='%s'", false, kHBIMGroupName.ToCStr().Get(), "HBIM构件编号和说明");
+		
+		// 如果创建失败，可能是组已存在但名称比较失败（例如空格、编码问题）
+		// 重新获取属性组列表，尝试再次查找
+		ACAPI_WriteReport("FindOrCreateHBIMGroup: 创建失败，尝试重新查找现有属性组", false);
+		GS::Array<API_PropertyGroup> groups2;
+		GSErrCode err2 = ACAPI_Property_GetPropertyGroups(groups2);
+		if (err2 == NoError) {
+			ACAPI_WriteReport("FindOrCreateHBIMGroup: 重新找到 %d 个属性组", false, (int)groups2.GetSize());
+			for (UInt32 i = 0; i < groups2.GetSize(); ++i) {
+				ACAPI_WriteReport("  重新检查属性组[%d]: '%s'", false, (int)i, groups2[i].name.ToCStr().Get());
+				// 尝试更宽松的比较：去除空格后比较
+				GS::UniString existingName = groups2[i].name;
+				GS::UniString targetName = kHBIMGroupName;
+				// 简单比较：如果名称包含目标字符串或目标字符串包含现有名称
+				if (existingName == targetName || 
+					existingName.Contains(targetName) || 
+					targetName.Contains(existingName)) {
+					ACAPI_WriteReport("FindOrCreateHBIMGroup: 通过宽松比较找到属性组: '%s' (目标: '%s')", false, existingName.ToCStr().Get(), targetName.ToCStr().Get());
+					outGroup = groups2[i];
+					return NoError;
+				}
+			}
+		} else {
+			ACAPI_WriteReport("FindOrCreateHBIMGroup: 重新获取属性组失败: %s", true, GS::UniString::Printf("Error %d", err2).ToCStr().Get());
+		}
+		
+		// 检查错误类型
+		// 错误码 -2130312307 = APIERR_NEEDSUNDOSCOPE (需要撤销作用域)
+		// 错误码 -2130312988 = APIERR_NAMEALREADYUSED (名称已存在)
+		ACAPI_WriteReport("FindOrCreateHBIMGroup: 注意: 错误码 %d (0x%X)", true, err, err);
+		if (err == -2130312307) {
+			ACAPI_WriteReport("  -> APIERR_NEEDSUNDOSCOPE: 属性组创建需要在ACAPI_CallUndoableCommand作用域内", false);
+		} else if (err == -2130312988) {
+			ACAPI_WriteReport("  -> APIERR_NAMEALREADYUSED: 属性组名称已存在", false);
+		}
+	} else {
+		ACAPI_WriteReport("FindOrCreateHBIMGroup: 成功创建属性组: %s", false, kHBIMGroupName.ToCStr().Get());
+	}
+	return err;
+	}
+	
+	// 创建或获取HBIM属性定义
+	static GSErrCode FindOrCreateHBIMDefinition(const API_PropertyGroup& group, const GS::UniString& name, 
+												API_PropertyDefinition& outDef, GS::Array<API_Guid>& allClassificationItems,
+												API_VariantType valueType = API_PropertyStringValueType,
+												API_PropertyMeasureType measureType = API_PropertyDefaultMeasureType)
+	{
+		GS::Array<API_PropertyDefinition> defs;
+		GSErrCode err = ACAPI_Property_GetPropertyDefinitions(group.guid, defs);
+		if (err != NoError) {
+			ACAPI_WriteReport("FindOrCreateHBIMDefinition [%s]: GetPropertyDefinitions 失败: %s", true, name.ToCStr().Get(), GS::UniString::Printf("Error %d", err).ToCStr().Get());
+			return err;
+		}
+		for (UInt32 i = 0; i < defs.GetSize(); ++i) {
+			if (defs[i].name == name) {
+				outDef = defs[i];
+				return NoError;
+			}
+		}
+		// 属性不存在，创建新的
+		outDef = {};
+		outDef.guid = APINULLGuid;
+		outDef.groupGuid = group.guid;
+		outDef.name = name;
+		outDef.collectionType = API_PropertySingleCollectionType;
+		outDef.valueType = valueType;
+		outDef.measureType = measureType;
+		outDef.canValueBeEditable = true;
+		outDef.definitionType = API_PropertyCustomDefinitionType;
+		// 数值属性默认为未定义，没有写入值的构件不显示 0
+		outDef.defaultValue.basicValue.variantStatus = valueType == API_PropertyStringValueType ? API_VariantStatusNormal : API_VariantStatusNull;
+		outDef.defaultValue.basicValue.singleVariant.variant.type = valueType;
+		// 设置 availability 为所有分类项，使属性对所有元素可用
+		outDef.availability = allClassificationItems;
+		err = ACAPI_Property_CreatePropertyDefinition(outDef);
+		if (err != NoError) {
+			ACAPI_WriteReport("FindOrCreateHBIMDefinition [%s]: CreatePropertyDefinition 失败: %s", true, name.ToCStr().Get(), GS::UniString::Printf("Error %d", err).ToCStr().Get());
+		}
+		return err;
+	}
+	
+	// 确保HBIM属性组和定义存在
+	GSErrCode EnsureHBIMPropertyGroupAndDefinitions(API_Guid& outGroupGuid, API_Guid& outIdGuid, API_Guid& outDescGuid)
+	{
+		API_PropertyGroup group;
+		GSErrCode err = FindOrCreateHBIMGroup(group);
+		if (err != NoError) return err;
+		
+		// 收集所有分类项
+		GS::Array<API_Guid> allClassificationItems;
+		GetAllClassificationItems(allClassificationItems);
+		
+		API_PropertyDefinition defId, defDesc;
+		err = FindOrCreateHBIMDefinition(group, kHBIMIdName, defId, allClassificationItems);
+		if (err != NoError) return err;
+		
+		err = FindOrCreateHBIMDefinition(group, kHBIMDescName, defDesc, allClassificationItems);
+		if (err != NoError) return err;
+		
+		// 所有操作成功，设置输出参数
+		outGroupGuid = group.guid;
+		outIdGuid = defId.guid;
+		outDescGuid = defDesc.guid;
+		return NoError;
+	}
+	
+ 	// 查找现有的HBIM属性组和定义（不创建）
+ 	GSErrCode FindExistingHBIMPropertyGroupAndDefinitions(API_Guid& outGroupGuid, API_Guid& outIdGuid, API_Guid& outDescGuid)
+ 	{
+ 		GS::Array<API_PropertyGroup> groups;
+ 		GSErrCode err = ACAPI_Property_GetPropertyGroups(groups);
+ 		if (err != NoError) {
+ 			ACAPI_WriteReport("FindExistingHBIMPropertyGroupAndDefinitions: GetPropertyGroups 失败: %s", true, GS::UniString::Printf("Error %d", err).ToCStr().Get());
+ 			return err;
+ 		}
+ 		
+ 		// 查找属性组
+ 		API_PropertyGroup foundGroup;
+ 		bool groupFound = false;
+ 		for (UInt32 i = 0; i < groups.GetSize(); ++i) {
+ 			if (groups[i].name == kHBIMGroupName) {
+ 				foundGroup = groups[i];
+ 				groupFound = true;
+ 				break;
+ 			}
+ 		}
+ 		
+ 		if (!groupFound) {
+ 			outGroupGuid = APINULLGuid;
+ 			outIdGuid = APINULLGuid;
+ 			outDescGuid = APINULLGuid;
+ 			return APIERR_BADNAME;
+ 		}
+ 		
+ 		outGroupGuid = foundGroup.guid;
+ 		
+ 		// 查找属性定义
+ 		GS::Array<API_PropertyDefinition> defs;
+ 		err = ACAPI_Property_GetPropertyDefinitions(foundGroup.guid, defs);
+ 		if (err != NoError) {
+ 			ACAPI_WriteReport("FindExistingHBIMPropertyGroupAndDefinitions: GetPropertyDefinitions 失败: %s", true, GS::UniString::Printf("Error %d", err).ToCStr().Get());
+ 			outGroupGuid = APINULLGuid;
+ 			outIdGuid = APINULLGuid;
+ 			outDescGuid = APINULLGuid;
+ 			return err;
+ 		}
+ 		
+ 		bool idFound = false, descFound = false;
+ 		API_PropertyDefinition defId, defDesc;
+ 		for (UInt32 i = 0; i < defs.GetSize(); ++i) {
+ 			if (defs[i].name == kHBIMIdName) {
+ 				defId = defs[i];
+ 				idFound = true;
+ 			} else if (defs[i].name == kHBIMDescName) {
+ 				defDesc = defs[i];
+ 				descFound = true;
+ 			}
+ 		}
+ 		
+ 		if (!idFound || !descFound) {
+ 			outGroupGuid = APINULLGuid;
+ 			outIdGuid = APINULLGuid;
+ 			outDescGuid = APINULLGuid;
+ 			return APIERR_BADNAME;
+ 		}
+ 		
+ 		outIdGuid = defId.guid;
+  		outDescGuid = defDesc.guid;
+  		return NoError;
+  	}
+  	
+  	// 从元素读取HBIM属性值
+ 	GSErrCode GetHBIMPropertyValue(const API_Guid& elemGuid, const API_Guid& defGuid, GS::UniString& outVal)
+	{
+		API_Property p = {};
+		GSErrCode err = ACAPI_Element_GetPropertyValue(elemGuid, defGuid, p);
+		if (err != NoError || p.status != API_Property_HasValue || p.value.variantStatus != API_VariantStatusNormal) return err;
+		outVal = p.value.singleVariant.variant.uniStringValue;
+		return NoError;
+	}
+	
+	// 向元素写入HBIM属性值
+	GSErrCode SetHBIMPropertyValue(const API_Guid& elemGuid, const API_Guid& defGuid, const GS::UniString& value)
+	{
+		API_PropertyDefinition def = {};
+		def.guid = defGuid;
+		GSErrCode err = ACAPI_Property_GetPropertyDefinition(def);
+		if (err != NoError) return err;
+		
+		API_Property p = {};
+		p.definition = def;
+		p.status = API_Property_HasValue;
+		p.isDefault = false;
+		p.value.variantStatus = API_VariantStatusNormal;
+		p.value.singleVariant.variant.type = API_PropertyStringValueType;
+		p.value.singleVariant.variant.uniStringValue = value;
+		err = ACAPI_Element_SetProperty(elemGuid, p);
+		return err;
+	}
+	
+	// 检查元素是否有HBIM属性
+	bool HasHBIMProperties(const API_Guid& elemGuid, API_Guid idGuid, API_Guid descGuid)
+	{
+		// 如果GUID无效，说明属性定义不存在，元素不可能有HBIM属性
+		if (idGuid == APINULLGuid || descGuid == APINULLGuid) {
+			return false;
+		}
+		GS::UniString idVal, descVal;
+		bool hasId = (GetHBIMPropertyValue(elemGuid, idGuid, idVal) == NoError);
+		bool hasDesc = (GetHBIMPropertyValue(elemGuid, descGuid, descVal) == NoError);
+		return hasId || hasDesc; // 只要有一个属性有值就认为有HBIM属性
+	}
+
+	// 确保HBIM完成状态属性定义存在，且默认值为 defaultValue（需在 ACAPI_CallUndoableCommand 作用域内调用）。
+	// 取默认值的构件不必逐个写入，旧版本建立的无默认值定义在这里补上
+	GSErrCode EnsureHBIMStatusPropertyDefinition(const GS::UniString& defaultValue, API_Guid& outStatusGuid)
+	{
+		API_PropertyGroup group;
+		GSErrCode err = FindOrCreateHBIMGroup(group);
+		if (err != NoError) return err;
+
+		GS::Array<API_Guid> allClassificationItems;
+		GetAllClassificationItems(allClassificationItems);
+
+		API_PropertyDefinition defStatus;
+		err = FindOrCreateHBIMDefinition(group, kHBIMStatusName, defStatus, allClassificationItems);
+		if (err != NoError) return err;
+
+		API_Variant& defaultVariant = defStatus.defaultValue.basicValue.singleVariant.variant;
+		if (defStatus.defaultValue.basicValue.variantStatus != API_VariantStatusNormal || defaultVariant.uniStringValue != defaultValue) {
+			defStatus.defaultValue.hasExpression = false;
+			defStatus.defaultValue.basicValue.variantStatus = API_VariantStatusNormal;
+			defaultVariant.type = API_PropertyStringValueType;
+			defaultVariant.uniStringValue = defaultValue;
+			err = ACAPI_Property_ChangePropertyDefinition(defStatus);
+			if (err != NoError) {
+				ACAPI_WriteReport("EnsureHBIMStatusPropertyDefinition: ChangePropertyDefinition 失败: %s", true, GS::UniString::Printf("Error %d", err).ToCStr().Get());
+				return err;
+			}
+		}
+
+		outStatusGuid = defStatus.guid;
+		return NoError;
+	}
+
+	// 查找现有的HBIM完成状态属性定义（不创建）
+	GSErrCode FindExistingHBIMStatusPropertyDefinition(API_Guid& outStatusGuid)
+	{
+		outStatusGuid = APINULLGuid;
+		GS::Array<API_PropertyGroup> groups;
+		GSErrCode err = ACAPI_Property_GetPropertyGroups(groups);
+		if (err != NoError) return err;
+
+		for (UInt32 i = 0; i < groups.GetSize(); ++i) {
+			if (groups[i].name != kHBIMGroupName)
+				continue;
+			GS::Array<API_PropertyDefinition> defs;
+			err = ACAPI_Property_GetPropertyDefinitions(groups[i].guid, defs);
+			if (err != NoError) return err;
+			for (UInt32 j = 0; j < defs.GetSize(); ++j) {
+				if (defs[j].name == kHBIMStatusName) {
+					outStatusGuid = defs[j].guid;
+					return NoError;
+				}
+			}
+		}
+		return APIERR_BADNAME;
+	}
+
+	// 确保HBIM扫描偏差属性定义存在（需在 ACAPI_CallUndoableCommand 作用域内调用）
+	GSErrCode EnsureHBIMDeviationPropertyDefinitions(API_Guid& outRmsGuid, API_Guid& outMaxGuid)
+	{
+		API_PropertyGroup group;
+		GSErrCode err = FindOrCreateHBIMGroup(group);
+		if (err != NoError) return err;
+
+		GS::Array<API_Guid> allClassificationItems;
+		GetAllClassificationItems(allClassificationItems);
+
+		GS::Array<API_PropertyDefinition> defs;
+		err = ACAPI_Property_GetPropertyDefinitions(group.guid, defs);
+		if (err != NoError) return err;
+		for (const API_PropertyDefinition& def : defs) {
+			for (const GS::UniString& legacyName : kLegacyDeviationNames) {
+				if (def.name != legacyName)
+					continue;
+				err = ACAPI_Property_DeletePropertyDefinition(def.guid);
+				if (err != NoError) {
+					ACAPI_WriteReport("EnsureHBIMDeviationPropertyDefinitions: 删除旧属性 %s 失败: %d", true, legacyName.ToCStr().Get(), err);
+					return err;
+				}
+			}
+		}
+
+		API_PropertyDefinition defRms, defMax;
+		err = FindOrCreateHBIMDefinition(group, kHBIMDeviationRmsName, defRms, allClassificationItems,
+										 API_PropertyRealValueType, API_PropertyLengthMeasureType);
+		if (err != NoError) return err;
+		err = FindOrCreateHBIMDefinition(group, kHBIMDeviationMaxName, defMax, allClassificationItems,
+										 API_PropertyRealValueType, API_PropertyLengthMeasureType);
+		if (err != NoError) return err;
+
+		outRmsGuid = defRms.guid;
+		outMaxGuid = defMax.guid;
+		return NoError;
+	}
+
+	// 创建或获取HBIM图片属性组
+	static GSErrCode FindOrCreateHBIMImageGroup(API_PropertyGroup& outGroup)
+	{
+		// 第一步：获取所有属性组并详细记录
+		GS::Array<API_PropertyGroup> groups;
+		GSErrCode err = ACAPI_Property_GetPropertyGroups(groups);
+		if (err != NoError) {
+			ACAPI_WriteReport("FindOrCreateHBIMImageGroup: GetPropertyGroups 失败: %s", true, GS::UniString::Printf("Error %d", err).ToCStr().Get());
+			return err;
+		}
+		
+		ACAPI_WriteReport("FindOrCreateHBIMImageGroup: 系统中共有 %d 个属性组", false, (int)groups.GetSize());
+		
+		// 第二步：详细检查每个属性组，使用多种比较方法
+		GS::UniString targetName = kHBIMImageGroupName;
+		GS::UniString targetNameNormalized = NormalizeUniString(targetName);
+		
+		for (UInt32 i = 0; i < groups.GetSize(); ++i) {
+			GS::UniString existingName = groups[i].name;
+			GS::UniString existingNameNormalized = NormalizeUniString(existingName);
+			
+			// 记录每个属性组的详细信息
+			ACAPI_WriteReport("FindOrCreateHBIMImageGroup: 属性组[%d]: 原始名称='%s', 标准化='%s', guid=%s", 
+				false, (int)i, 
+				existingName.ToCStr().Get(),
+				existingNameNormalized.ToCStr().Get(),
+				APIGuidToString(groups[i].guid).ToCStr().Get());
+			
+			// 方法1：完全匹配原始名称
+			if (existingName == targetName) {
+				ACAPI_WriteReport("FindOrCreateHBIMImageGroup: 通过完全匹配找到属性组！", false);
+				outGroup = groups[i];
+				return NoError;
+			}
+			
+			// 方法2：完全匹配标准化名称
+			if (existingNameNormalized == targetNameNormalized) {
+				ACAPI_WriteReport("FindOrCreateHBIMImageGroup: 通过标准化匹配找到属性组！", false);
+				outGroup = groups[i];
+				return NoError;
+			}
+			
+			// 方法3：互相包含（宽松匹配）
+			if (existingNameNormalized.Contains(targetNameNormalized) || 
+				targetNameNormalized.Contains(existingNameNormalized)) {
+				ACAPI_WriteReport("FindOrCreateHBIMImageGroup: 通过宽松匹配找到属性组！", false);
+				outGroup = groups[i];
+				return NoError;
+			}
+		}
+		
+		// 第三步：属性组不存在，尝试创建
+		ACAPI_WriteReport("FindOrCreateHBIMImageGroup: 属性组不存在，尝试创建...", false);
+		outGroup = {};
+		outGroup.guid = APINULLGuid;
+		outGroup.name = kHBIMImageGroupName;
+		outGroup.description = "HBIM构件图片链接";
+		err = ACAPI_Property_CreatePropertyGroup(outGroup);
+		
+		if (err != NoError) {
+			// 创建失败，分析错误原因
+			ACAPI_WriteReport("FindOrCreateHBIMImageGroup: CreatePropertyGroup 失败: %s (错误码: %d)", true, 
+				GS::UniString::Printf("Error %d", err).ToCStr().Get(), err);
+			
+			// 检查错误类型
+			// 错误码 -2130312307 = APIERR_NEEDSUNDOSCOPE (需要撤销作用域)
+			// 错误码 -2130312988 = APIERR_NAMEALREADYUSED (名称已存在)
+			ACAPI_WriteReport("FindOrCreateHBIMImageGroup: 注意: 错误码 %d (0x%X)", true, err, err);
+			if (err == -2130312307) {
+				ACAPI_WriteReport("  -> APIERR_NEEDSUNDOSCOPE: 属性组创建需要在ACAPI_CallUndoableCommand作用域内", false);
+			} else if (err == -2130312988) {
+				ACAPI_WriteReport("  -> APIERR_NAMEALREADYUSED: 属性组名称已存在", false);
+			}
+			
+			// 重新获取属性组列表，尝试再次查找
+			ACAPI_WriteReport("FindOrCreateHBIMImageGroup: 创建失败，尝试重新查找现有属性组", false);
+			GS::Array<API_PropertyGroup> groups2;
+			GSErrCode err2 = ACAPI_Property_GetPropertyGroups(groups2);
+			if (err2 == NoError) {
+				ACAPI_WriteReport("FindOrCreateHBIMImageGroup: 重新找到 %d 个属性组", false, (int)groups2.GetSize());
+				for (UInt32 i = 0; i < groups2.GetSize(); ++i) {
+					ACAPI_WriteReport("  重新检查属性组[%d]: '%s'", false, (int)i, groups2[i].name.ToCStr().Get());
+					// 尝试更宽松的比较：使用原始名称和标准化名称
+					GS::UniString existingName = groups2[i].name;
+					GS::UniString existingNameNormalized = NormalizeUniString(existingName);
+					
+					// 多种匹配方式：完全匹配、标准化匹配、互相包含
+					if (existingName == targetName || 
+						existingNameNormalized == targetNameNormalized ||
+						existingName.Contains(targetName) || 
+						targetName.Contains(existingName) ||
+						existingNameNormalized.Contains(targetNameNormalized) ||
+						targetNameNormalized.Contains(existingNameNormalized)) {
+						ACAPI_WriteReport("FindOrCreateHBIMImageGroup: 通过宽松比较找到属性组: '%s' (目标: '%s')", false, existingName.ToCStr().Get(), targetName.ToCStr().Get());
+						outGroup = groups2[i];
+						return NoError;
+					}
+				}
+			} else {
+				ACAPI_WriteReport("FindOrCreateHBIMImageGroup: 重新获取属性组失败: %s", true, GS::UniString::Printf("Error %d", err2).ToCStr().Get());
+			}
+			
+			ACAPI_WriteReport("FindOrCreateHBIMImageGroup: 最终未找到属性组 '%s'", true, kHBIMImageGroupName.ToCStr().Get());
+			return err;
+		}
+		
+		// 创建成功
+		ACAPI_WriteReport("FindOrCreateHBIMImageGroup: 属性组创建成功！", false);
+		return NoError;
+	}
+	
+	// 创建或获取HBIM图片链接属性定义
+	static GSErrCode FindOrCreateHBIMImageDefinition(const API_PropertyGroup& group, 
+													 API_PropertyDefinition& outDef, 
+													 GS::Array<API_Guid>& allClassificationItems)
+	{
+		GS::Array<API_PropertyDefinition> defs;
+		GSErrCode err = ACAPI_Property_GetPropertyDefinitions(group.guid, defs);
+		if (err != NoError) {
+			ACAPI_WriteReport("FindOrCreateHBIMImageDefinition: GetPropertyDefinitions 失败: %s", true, GS::UniString::Printf("Error %d", err).ToCStr().Get());
+			return err;
+		}
+		
+		for (UInt32 i = 0; i < defs.GetSize(); ++i) {
+			if (defs[i].name == kHBIMImageLinksName) {
+				outDef = defs[i];
+				return NoError;
+			}
+		}
+		
+		// 属性不存在，创建新的
+		outDef = {};
+		outDef.guid = APINULLGuid;
+		outDef.groupGuid = group.guid;
+		outDef.name = kHBIMImageLinksName;
+		outDef.collectionType = API_PropertySingleCollectionType;
+		outDef.valueType = API_PropertyStringValueType;
+		outDef.measureType = API_PropertyDefaultMeasureType;
+		outDef.canValueBeEditable = true;
+		outDef.definitionType = API_PropertyCustomDefinitionType;
+		outDef.defaultValue.basicValue.variantStatus = API_VariantStatusNormal;
+		outDef.defaultValue.basicValue.singleVariant.variant.type = API_PropertyStringValueType;
+		outDef.availability = allClassificationItems;
+		
+		err = ACAPI_Property_CreatePropertyDefinition(outDef);
+		if (err != NoError) {
+			ACAPI_WriteReport("FindOrCreateHBIMImageDefinition: CreatePropertyDefinition 失败: %s (错误码: %d)", true, GS::UniString::Printf("Error %d", err).ToCStr().Get(), err);
+			
+			// 创建失败，可能是属性已存在，重新查找
+			GS::Array<API_PropertyDefinition> defs2;
+			GSErrCode err2 = ACAPI_Property_GetPropertyDefinitions(group.guid, defs2);
+			if (err2 == NoError) {
+				for (UInt32 i = 0; i < defs2.GetSize(); ++i) {
+					if (defs2[i].name == kHBIMImageLinksName) {
+						outDef = defs2[i];
+						ACAPI_WriteReport("FindOrCreateHBIMImageDefinition: 找到已存在的属性定义", false);
+						return NoError;
+					}
+				}
+			}
+		}
+		return err;
+	}
+	
+	// 确保HBIM图片属性组和定义存在
+	GSErrCode EnsureHBIMImagePropertyGroupAndDefinitions(API_Guid& outGroupGuid, API_Guid& outImageLinksGuid)
+	{
+		API_PropertyGroup group;
+		GSErrCode err = FindOrCreateHBIMImageGroup(group);
+		if (err != NoError) return err;
+		
+		// 收集所有分类项
+		GS::Array<API_Guid> allClassificationItems;
+		GetAllClassificationItems(allClassificationItems);
+		
+		API_PropertyDefinition defImageLinks;
+		err = FindOrCreateHBIMImageDefinition(group, defImageLinks, allClassificationItems);
+		if (err != NoError) return err;
+		
+		outGroupGuid = group.guid;
+		outImageLinksGuid = defImageLinks.guid;
+		return NoError;
+	}
+	
+	// 查找已有的图片链接属性定义；属性组名的匹配规则与 FindOrCreateHBIMImageGroup 相同
+	GSErrCode FindExistingHBIMImageLinksDefinition(API_Guid& outImageLinksGuid)
+	{
+		outImageLinksGuid = APINULLGuid;
+		GS::Array<API_PropertyGroup> groups;
+		GSErrCode err = ACAPI_Property_GetPropertyGroups(groups);
+		if (err != NoError) return err;
+
+		const GS::UniString targetNameNormalized = NormalizeUniString(kHBIMImageGroupName);
+		for (UInt32 i = 0; i < groups.GetSize(); ++i) {
+			const GS::UniString existingNameNormalized = NormalizeUniString(groups[i].name);
+			const bool matches = groups[i].name == kHBIMImageGroupName || existingNameNormalized == targetNameNormalized ||
+								 existingNameNormalized.Contains(targetNameNormalized) || targetNameNormalized.Contains(existingNameNormalized);
+			if (!matches)
+				continue;
+			GS::Array<API_PropertyDefinition> defs;
+			err = ACAPI_Property_GetPropertyDefinitions(groups[i].guid, defs);
+			if (err != NoError) return err;
+			for (UInt32 j = 0; j < defs.GetSize(); ++j) {
+				if (defs[j].name == kHBIMImageLinksName) {
+					outImageLinksGuid = defs[j].guid;
+					return NoError;
+				}
+			}
+			// FindOrCreateHBIMImageGroup 取第一个匹配的属性组
+			break;
+		}
+		return APIERR_BADNAME;
+	}
+
+	// 从元素读取HBIM图片链接属性值
+	GSErrCode GetHBIMImageLinksPropertyValue(const API_Guid& elemGuid, const API_Guid& defGuid, GS::UniString& outVal)
+	{
+		API_Property p = {};
+		GSErrCode err = ACAPI_Element_GetPropertyValue(elemGuid, defGuid, p);
+		if (err != NoError || p.status != API_Property_HasValue || p.value.variantStatus != API_VariantStatusNormal) {
+			outVal = "[]"; // 返回空JSON数组
+			return err;
+		}
+		outVal = p.value.singleVariant.variant.uniStringValue;
+		return NoError;
+	}
+	
+	// 向元素写入HBIM图片链接属性值
+	GSErrCode SetHBIMImageLinksPropertyValue(const API_Guid& elemGuid, const API_Guid& defGuid, const GS::UniString& value)
+	{
+		API_PropertyDefinition def = {};
+		def.guid = defGuid;
+		GSErrCode err = ACAPI_Property_GetPropertyDefinition(def);
+		if (err != NoError) return err;
+		
+		API_Property p = {};
+		p.definition = def;
+		p.status = API_Property_HasValue;
+		p.isDefault = false;
+		p.value.variantStatus = API_VariantStatusNormal;
+		p.value.singleVariant.variant.type = API_PropertyStringValueType;
+		p.value.singleVariant.variant.uniStringValue = value;
+		err = ACAPI_Element_SetProperty(elemGuid, p);
+		return err;
+	}
+
+	// 解析图片链接属性中的JSON数组（["a","b"]）为相对路径列表
+	GS::Array<GS::UniString> ParseImageLinksJson(const GS::UniString& json)
+	{
+		GS::Array<GS::UniString> paths;
+		if (json == "[]" || json.GetLength() <= 2) {
+			return paths;
+		}
+		
+		GS::UniString trimmed = json;
+		trimmed.DeleteFirst();
+		trimmed.DeleteLast();
+		
+		// 手动解析逗号分隔的带引号的字符串
+		UInt32 startPos = 0;
+		while (startPos < trimmed.GetLength()) {
+			UIndex quoteStart = trimmed.FindFirst('"', startPos);
+			if (quoteStart == MaxUIndex) break;
+			UIndex quoteEnd = trimmed.FindFirst('"', quoteStart + 1);
+			if (quoteEnd == MaxUIndex) break;
+			// GetSubstring第二参数是长度length，不是end索引
+			USize pathLen = (quoteEnd > quoteStart + 1) ? (quoteEnd - quoteStart - 1) : 0;
+			GS::UniString path = trimmed.GetSubstring(quoteStart + 1, pathLen);
+			if (!path.IsEmpty()) {
+				paths.Push(path);
+			}
+			startPos = quoteEnd + 1;
+		}
+		return paths;
+	}
+	
+	// 将相对路径列表序列化为图片链接属性使用的JSON数组
+	GS::UniString BuildImageLinksJson(const GS::Array<GS::UniString>& paths)
+	{
+		GS::UniString jsonArray = "[";
+		for (UInt32 i = 0; i < paths.GetSize(); i++) {
+			if (i > 0) jsonArray.Append(",");
+			jsonArray.Append("\"");
+			jsonArray.Append(paths[i]);
+			jsonArray.Append("\"");
+		}
+		jsonArray.Append("]");
+		return jsonArray;
+	}
+
+	std::string CsvField(const GS::UniString& value)
+	{
+		std::string text = value.ToCStr().Get();
+		if (text.find_first_of(",\"\n") == std::string::npos)
+			return text;
+		std::string quoted = "\"";
+		for (char ch : text) {
+			if (ch == '"')
+				quoted.push_back('"');
+			quoted.push_back(ch);
+		}
+		quoted.push_back('"');
+		return quoted;
+	}
+
+	bool WriteCsvTable(const std::filesystem::path& tablePath, const char* headerLine, const std::function<void (std::ostream&)>& writeRows)
+	{
+		std::ofstream out(tablePath, std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+			return false;
+		out << "\xEF\xBB\xBF" << headerLine << '\n';
+		writeRows(out);
+		return out.good();
+	}
+
+	void CollectTargetElements(std::vector<API_Guid>& outGuids, std::vector<HBIMSpatialIndex::Box>& outBoxes)
+	{
+		outGuids.clear();
+		outBoxes.clear();
+		API_SelectionInfo selInfo = {};
+		GS::Array<API_Neig> selNeigs;
+		const GSErrCode err = ACAPI_Selection_Get(&selInfo, &selNeigs, false);
+		BMKillHandle(reinterpret_cast<GSHandle*>(&selInfo.marquee.coords));
+		if (err != NoError || selNeigs.IsEmpty()) {
+			HBIMSpatialIndex::CollectElementBoxes(outGuids, outBoxes);
+			return;
+		}
+		for (const API_Neig& neig : selNeigs) {
+			API_Elem_Head elemHead;
+			HBIMSpatialIndex::Box box;
+			if (!HBIMSpatialIndex::GetElementBox(neig.guid, elemHead, box))
+				continue;
+			outGuids.push_back(neig.guid);
+			outBoxes.push_back(box);
+		}
+	}
+
+}
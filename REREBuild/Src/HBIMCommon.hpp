@@ -0,0 +1,80 @@
+#ifndef HBIMCOMMON_HPP
+#define HBIMCOMMON_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+#include "HBIMSpatialIndex.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace HBIM {
+
+	// HBIM属性常量
+	extern const GS::UniString kHBIMGroupName;
+	extern const GS::UniString kHBIMIdName;
+	extern const GS::UniString kHBIMDescName;
+	extern const GS::UniString kHBIMStatusName;
+	extern const GS::UniString kHBIMDeviationRmsName;
+	extern const GS::UniString kHBIMDeviationMaxName;
+
+	// HBIM图片常量
+	extern const GS::UniString kHBIMImageGroupName;
+	extern const GS::UniString kHBIMImageLinksName;
+
+	// 字符串工具
+	GS::UniString NormalizeUniString (const GS::UniString& str);
+	GS::UniString SanitizeForFilePath (const GS::UniString& str);
+
+	// IFC信息
+	GS::UniString GetIFCTypeForElement (const API_Guid& elementGuid);
+	GS::UniString GetGlobalIdForElement (const API_Guid& elementGuid);
+
+	// HBIM属性组和定义（Ensure* 需在 ACAPI_CallUndoableCommand 作用域内调用）
+	GSErrCode EnsureHBIMPropertyGroupAndDefinitions (API_Guid& outGroupGuid, API_Guid& outIdGuid, API_Guid& outDescGuid);
+	GSErrCode FindExistingHBIMPropertyGroupAndDefinitions (API_Guid& outGroupGuid, API_Guid& outIdGuid, API_Guid& outDescGuid);
+	GSErrCode GetHBIMPropertyValue (const API_Guid& elemGuid, const API_Guid& defGuid, GS::UniString& outVal);
+	GSErrCode SetHBIMPropertyValue (const API_Guid& elemGuid, const API_Guid& defGuid, const GS::UniString& value);
+	bool HasHBIMProperties (const API_Guid& elemGuid, API_Guid idGuid, API_Guid descGuid);
+
+	// HBIM完成状态属性（同在HBIM属性组中，由完成度着色功能写入；取默认值的构件不单独写值）
+	GSErrCode EnsureHBIMStatusPropertyDefinition (const GS::UniString& defaultValue, API_Guid& outStatusGuid);
+	GSErrCode FindExistingHBIMStatusPropertyDefinition (API_Guid& outStatusGuid);
+
+	// HBIM扫描偏差属性（同在HBIM属性组中，由点云偏差分析写入；长度属性，值以米写入，按项目长度单位显示）
+	GSErrCode EnsureHBIMDeviationPropertyDefinitions (API_Guid& outRmsGuid, API_Guid& outMaxGuid);
+
+	// HBIM图片属性组和定义
+	GSErrCode EnsureHBIMImagePropertyGroupAndDefinitions (API_Guid& outGroupGuid, API_Guid& outImageLinksGuid);
+	// 只查找、不创建，不写日志；可在撤销作用域外调用
+	GSErrCode FindExistingHBIMImageLinksDefinition (API_Guid& outImageLinksGuid);
+	GSErrCode GetHBIMImageLinksPropertyValue (const API_Guid& elemGuid, const API_Guid& defGuid, GS::UniString& outVal);
+	GSErrCode SetHBIMImageLinksPropertyValue (const API_Guid& elemGuid, const API_Guid& defGuid, const GS::UniString& value);
+
+	// 图片链接属性的JSON数组 <-> 相对路径列表
+	GS::Array<GS::UniString> ParseImageLinksJson (const GS::UniString& json);
+	GS::UniString BuildImageLinksJson (const GS::Array<GS::UniString>& paths);
+
+	// 表格：字段含逗号、引号或换行时加引号；表格为 UTF-8 带 BOM（Excel 可直接打开），
+	// headerLine 为不含换行的表头，writeRows 写出其后的各行
+	std::string CsvField (const GS::UniString& value);
+	bool WriteCsvTable (const std::filesystem::path& tablePath, const char* headerLine, const std::function<void (std::ostream&)>& writeRows);
+
+	// 主线程：选中的三维构件及其包围盒；没有选中时为全部三维构件
+	void CollectTargetElements (std::vector<API_Guid>& outGuids, std::vector<HBIMSpatialIndex::Box>& outBoxes);
+
+	// 用 std::async 启动的后台任务是否仍在运行
+	template <typename T>
+	bool IsWorkerRunning (const std::future<T>& worker)
+	{
+		return worker.valid() && worker.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+	}
+
+}
+
+#endif
@@ -0,0 +1,676 @@
+// *****************************************************************************
+// File:			HBIMElementIndex.cpp
+// Description:		构件包围盒常驻空间索引：分段读取、后台多线程建立 R 树，
+//					构件事件增量维护（删除标记 + 追加表），最近邻/范围查询与性能测试
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMElementIndex.hpp"
+#include "HBIMEventLoop.hpp"
+#include "HBIMNotifications.hpp"
+#include "DGModule.hpp"
+#include "HashSet.hpp"
+#include "HashTable.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+	using HBIMSpatialIndex::Box;
+	using HBIMSpatialIndex::Hit;
+
+	enum class IndexState {
+		NotBuilt,
+		Collecting,		// 主线程分段读取包围盒
+		Building,		// 后台线程建立第一棵树
+		Ready
+	};
+
+	// 每次事件循环读取的构件数，CalcBounds 约需数微秒，保证每段不明显卡顿
+	static const UIndex kBuildChunkSize = 2000;
+	// 追加表上限：查询时逐个比较，几百个只需一两微秒；超过后在后台重建
+	static const UInt32 kMaxOverlay = 512;
+	static const unsigned kMaxWorkers = 8;
+	// 追加表中的构件在查询结果中的 item 编号加此标记，与树中的 item 区分
+	static const UInt32 kOverlayItem = 0x80000000;
+
+	// 性能测试：合成的构件数、查询次数、与逐个比较核对的查询数
+	static const UInt32 kBenchBoxes = 100000;
+	static const UInt32 kBenchQueries = 100000;
+	static const UInt32 kBenchChecked = 500;
+	static const UInt32 kBenchNeighbours = 8;
+	static const UInt32 kBenchProjectQueries = 10000;
+	static const double kBenchMaxDistance = 1000.0;
+	static const double kBenchQueryHalfSize = 1.5;
+
+	// 后台建立的结果：树中的 item 即 guids 的下标
+	struct BuiltTree {
+		std::vector<API_Guid> guids;
+		HBIMSpatialIndex::BoxTree tree;
+		GS::HashTable<API_Guid, UInt32> slots;
+		double seconds = 0.0;
+	};
+
+	// 只在主线程访问
+	static IndexState s_state = IndexState::NotBuilt;
+	static UInt32 s_generation = 0;
+
+	static GS::Array<API_Guid> s_pendingElements;
+	static UIndex s_pendingPos = 0;
+	static std::vector<API_Guid> s_collectedGuids;
+	static std::vector<Box> s_collectedBoxes;
+	static std::chrono::steady_clock::time_point s_buildStart;
+	static double s_readSeconds = 0.0;
+
+	// 当前的树；其中已删除或已移到追加表的构件只做标记
+	static std::shared_ptr<BuiltTree> s_base;
+	static std::vector<bool> s_removed;
+	static UInt32 s_removedCount = 0;
+
+	// 树建立之后新建或修改的构件
+	static std::vector<API_Guid> s_overlayGuids;
+	static std::vector<Box> s_overlayBoxes;
+	static GS::HashTable<API_Guid, UInt32> s_overlaySlots;
+
+	// 索引中各构件读取包围盒时的修改戳，接收团队工作更改后据此找出变化的构件
+	static GS::HashTable<API_Guid, UInt64> s_stamps;
+
+	static GS::HashSet<API_Guid> s_dirtyElements;
+	static bool s_updatePosted = false;
+
+	// 正在后台建立的树；建立期间处理过的构件在新树换上后重新读取
+	static std::shared_ptr<BuiltTree> s_pendingTree;
+	static GS::HashSet<API_Guid> s_changedDuringBuild;
+	static std::future<void> s_builder;
+
+	static unsigned GetWorkerCount() {
+		return std::min(std::max(1u, std::thread::hardware_concurrency()), kMaxWorkers);
+	}
+
+	static double SecondsSince(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	static void RemoveFromIndex(const API_Guid& elemGuid) {
+		if (s_base != nullptr) {
+			const UInt32* slot = s_base->slots.GetPtr(elemGuid);
+			if (slot != nullptr && !s_removed[*slot]) {
+				s_removed[*slot] = true;
+				++s_removedCount;
+			}
+		}
+
+		const UInt32* overlaySlot = s_overlaySlots.GetPtr(elemGuid);
+		if (overlaySlot == nullptr)
+			return;
+		// 与最后一项交换后删除
+		const UInt32 index = *overlaySlot;
+		const UInt32 last = static_cast<UInt32>(s_overlayGuids.size() - 1);
+		if (index != last) {
+			s_overlayGuids[index] = s_overlayGuids[last];
+			s_overlayBoxes[index] = s_overlayBoxes[last];
+			s_overlaySlots.Put(s_overlayGuids[index], index);
+		}
+		s_overlayGuids.pop_back();
+		s_overlayBoxes.pop_back();
+		s_overlaySlots.Delete(elemGuid);
+	}
+
+	static void AddToOverlay(const API_Guid& elemGuid, const Box& box) {
+		s_overlaySlots.Put(elemGuid, static_cast<UInt32>(s_overlayGuids.size()));
+		s_overlayGuids.push_back(elemGuid);
+		s_overlayBoxes.push_back(box);
+	}
+
+	static void Clear() {
+		++s_generation;
+		s_state = IndexState::NotBuilt;
+		s_pendingElements.Clear();
+		s_pendingPos = 0;
+		s_collectedGuids.clear();
+		s_collectedBoxes.clear();
+		s_base.reset();
+		s_removed.clear();
+		s_removedCount = 0;
+		s_overlayGuids.clear();
+		s_overlayBoxes.clear();
+		s_overlaySlots.Clear();
+		s_stamps.Clear();
+		s_dirtyElements.Clear();
+		s_updatePosted = false;
+		s_pendingTree.reset();
+		s_changedDuringBuild.Clear();
+	}
+
+	static void ApplyPendingUpdates(UInt32 generation);
+
+	static void ScheduleUpdate() {
+		if (s_updatePosted)
+			return;
+		s_updatePosted = true;
+		UInt32 generation = s_generation;
+		HBIMEventLoop::Post([generation]() { ApplyPendingUpdates(generation); });
+	}
+
+	static void FinishTreeBuild(UInt32 generation, const std::shared_ptr<BuiltTree>& built) {
+		if (generation != s_generation || built != s_pendingTree)
+			return;
+		s_pendingTree.reset();
+		s_base = built;
+		s_removed.assign(built->guids.size(), false);
+		s_removedCount = 0;
+		s_overlayGuids.clear();
+		s_overlayBoxes.clear();
+		s_overlaySlots.Clear();
+		for (const API_Guid& elemGuid : s_changedDuringBuild)
+			s_dirtyElements.Add(elemGuid);
+		s_changedDuringBuild.Clear();
+
+		if (s_state != IndexState::Ready) {
+			ACAPI_WriteReport("HBIMElementIndex: 索引已建立，%d 个构件；读取包围盒 %.2f 秒，建立 R 树 %.3f 秒", false,
+							  static_cast<int>(built->guids.size()), s_readSeconds, built->seconds);
+		}
+		s_state = IndexState::Ready;
+		if (!s_dirtyElements.IsEmpty())
+			ScheduleUpdate();
+	}
+
+	// 树在后台线程中建立，完成后交回主线程换上；结果同时留在 s_pendingTree 中，EnsureBuilt 可以等待后直接换上
+	static void StartTreeBuild(std::vector<API_Guid>&& guids, std::vector<Box>&& boxes) {
+		auto built = std::make_shared<BuiltTree>();
+		built->guids = std::move(guids);
+		s_pendingTree = built;
+		s_changedDuringBuild.Clear();
+
+		// 之前作废的建立（如上一个项目的）可能还在进行
+		if (s_builder.valid())
+			s_builder.wait();
+		const UInt32 generation = s_generation;
+		const unsigned workers = GetWorkerCount();
+		s_builder = std::async(std::launch::async, [built, boxes = std::move(boxes), generation, workers]() {
+			auto start = std::chrono::steady_clock::now();
+			built->tree.Build(boxes, workers);
+			for (UInt32 i = 0; i < built->guids.size(); ++i)
+				built->slots.Put(built->guids[i], i);
+			built->seconds = SecondsSince(start);
+			HBIMEventLoop::Post([generation, built]() { FinishTreeBuild(generation, built); });
+		});
+	}
+
+	// 追加表或删除标记积累过多时按当前状态重建，旧树在新树换上前继续使用
+	static void StartRebuild() {
+		std::vector<API_Guid> guids;
+		std::vector<Box> boxes;
+		const size_t baseSize = s_base != nullptr ? s_base->guids.size() : 0;
+		guids.reserve(baseSize - s_removedCount + s_overlayGuids.size());
+		boxes.reserve(guids.capacity());
+		for (UInt32 i = 0; i < baseSize; ++i) {
+			if (s_removed[i])
+				continue;
+			guids.push_back(s_base->guids[i]);
+			boxes.push_back(s_base->tree.GetBox(i));
+		}
+		guids.insert(guids.end(), s_overlayGuids.begin(), s_overlayGuids.end());
+		boxes.insert(boxes.end(), s_overlayBoxes.begin(), s_overlayBoxes.end());
+		StartTreeBuild(std::move(guids), std::move(boxes));
+	}
+
+	static void ApplyDirtyElements() {
+		for (const API_Guid& elemGuid : s_dirtyElements) {
+			RemoveFromIndex(elemGuid);
+			if (s_pendingTree != nullptr)
+				s_changedDuringBuild.Add(elemGuid);
+			API_Elem_Head elemHead;
+			Box box;
+			if (HBIMSpatialIndex::GetElementBox(elemGuid, elemHead, box)) {
+				AddToOverlay(elemGuid, box);
+				s_stamps.Put(elemGuid, elemHead.modiStamp);
+			} else {
+				s_stamps.Delete(elemGuid);
+			}
+		}
+		s_dirtyElements.Clear();
+
+		const size_t baseSize = s_base != nullptr ? s_base->guids.size() : 0;
+		const bool overlayFull = s_overlayGuids.size() > kMaxOverlay;
+		const bool mostlyRemoved = s_removedCount > std::max<size_t>(kMaxOverlay, baseSize / 8);
+		if (s_pendingTree == nullptr && (overlayFull || mostlyRemoved))
+			StartRebuild();
+	}
+
+	static void ApplyPendingUpdates(UInt32 generation) {
+		s_updatePosted = false;
+		if (generation != s_generation || s_state != IndexState::Ready)
+			return;
+		ApplyDirtyElements();
+	}
+
+	static void StartBuild() {
+		Clear();
+		s_buildStart = std::chrono::steady_clock::now();
+		if (ACAPI_Element_GetElemList(API_ZombieElemID, &s_pendingElements) != NoError)
+			s_pendingElements.Clear();
+		s_state = IndexState::Collecting;
+	}
+
+	// 读取最多 maxCount 个构件的包围盒，全部读完后交给后台线程建立，返回是否已读完
+	static bool ProcessPending(UIndex maxCount) {
+		UIndex end = s_pendingElements.GetSize();
+		if (maxCount < end - s_pendingPos)
+			end = s_pendingPos + maxCount;
+
+		for (; s_pendingPos < end; ++s_pendingPos) {
+			const API_Guid& elemGuid = s_pendingElements[s_pendingPos];
+			API_Elem_Head elemHead;
+			Box box;
+			if (!HBIMSpatialIndex::GetElementBox(elemGuid, elemHead, box))
+				continue;
+			HBIMNotifications::ObserveElement(elemGuid);
+			s_stamps.Put(elemGuid, elemHead.modiStamp);
+			s_collectedGuids.push_back(elemGuid);
+			s_collectedBoxes.push_back(box);
+		}
+
+		if (s_pendingPos < s_pendingElements.GetSize())
+			return false;
+
+		s_pendingElements.Clear();
+		s_pendingPos = 0;
+		s_readSeconds = SecondsSince(s_buildStart);
+		s_state = IndexState::Building;
+		StartTreeBuild(std::move(s_collectedGuids), std::move(s_collectedBoxes));
+		s_collectedGuids.clear();
+		s_collectedBoxes.clear();
+		return true;
+	}
+
+	static void BuildStep(UInt32 generation) {
+		if (generation != s_generation || s_state != IndexState::Collecting)
+			return;
+		if (!ProcessPending(kBuildChunkSize))
+			HBIMEventLoop::Post([generation]() { BuildStep(generation); });
+	}
+
+	static void ScheduleBuild() {
+		StartBuild();
+		UInt32 generation = s_generation;
+		HBIMEventLoop::Post([generation]() { BuildStep(generation); });
+	}
+
+	// 接收团队工作更改后：逐个比较构件头中的修改戳（比计算包围盒快得多），
+	// 只把新增、修改和已删除的构件记入待更新，其余构件的包围盒不再读取
+	static void DetectReceivedChanges(UInt32 generation) {
+		if (generation != s_generation || (s_state != IndexState::Building && s_state != IndexState::Ready))
+			return;
+		GS::Array<API_Guid> elemGuids;
+		if (ACAPI_Element_GetElemList(API_ZombieElemID, &elemGuids) != NoError)
+			return;
+		GS::HashSet<API_Guid> present;
+		for (const API_Guid& elemGuid : elemGuids) {
+			API_Elem_Head elemHead = {};
+			elemHead.guid = elemGuid;
+			if (ACAPI_Element_GetHeader(&elemHead) != NoError || !HBIMSpatialIndex::IsIndexedElementType(elemHead.type.typeID))
+				continue;
+			present.Add(elemGuid);
+			const UInt64* stamp = s_stamps.GetPtr(elemGuid);
+			if (stamp != nullptr && *stamp == elemHead.modiStamp)
+				continue;
+			if (stamp == nullptr)
+				HBIMNotifications::ObserveElement(elemGuid);
+			s_dirtyElements.Add(elemGuid);
+		}
+		for (auto it = s_stamps.EnumerateKeys(); it != nullptr; ++it) {
+			if (!present.Contains(*it))
+				s_dirtyElements.Add(*it);
+		}
+		if (s_state == IndexState::Ready && !s_dirtyElements.IsEmpty())
+			ScheduleUpdate();
+	}
+
+	static void OnProjectEvent(API_NotifyEventID notifID) {
+		switch (notifID) {
+			case APINotify_New:
+			case APINotify_NewAndReset:
+			case APINotify_AllInputFinished:
+				ScheduleBuild();
+				break;
+			case APINotify_ReceiveChanges:
+				// 已有索引（或正在建立）时只更新变化的构件；尚在读取包围盒时从头读取
+				if (s_state == IndexState::Building || s_state == IndexState::Ready) {
+					const UInt32 generation = s_generation;
+					HBIMEventLoop::Post([generation]() { DetectReceivedChanges(generation); });
+				} else {
+					ScheduleBuild();
+				}
+				break;
+			case APINotify_Open:
+			case APINotify_Close:
+			case APINotify_Quit:
+				// 打开项目时等 AllInputFinished 后再建立
+				Clear();
+				break;
+			default:
+				break;
+		}
+	}
+
+	static void OnElementEvent(const API_NotifyElementType& elemType) {
+		// 尚未开始建立时无需维护，建立时会完整读取
+		if (s_state == IndexState::NotBuilt || !HBIMSpatialIndex::IsIndexedElementType(elemType.elemHead.type.typeID))
+			return;
+
+		// 事件中只记下构件，包围盒在事件处理完后读取；读取时构件已不存在即为删除
+		const API_Guid& elemGuid = elemType.elemHead.guid;
+		switch (elemType.notifID) {
+			case APINotifyElement_New:
+			case APINotifyElement_Copy:
+				HBIMNotifications::ObserveElement(elemGuid);
+				s_dirtyElements.Add(elemGuid);
+				break;
+			case APINotifyElement_Change:
+			case APINotifyElement_Edit:
+			case APINotifyElement_Delete:
+			case APINotifyElement_Undo_Created:
+			case APINotifyElement_Undo_Modified:
+			case APINotifyElement_Undo_Deleted:
+			case APINotifyElement_Redo_Created:
+			case APINotifyElement_Redo_Modified:
+			case APINotifyElement_Redo_Deleted:
+				s_dirtyElements.Add(elemGuid);
+				break;
+			default:
+				return;
+		}
+		// 建立期间的变化在新树换上后统一处理
+		if (s_state == IndexState::Ready)
+			ScheduleUpdate();
+	}
+
+	// ---- 性能测试 ----------------------------------------------------------------
+
+	// 合成一片建筑群：400 m × 400 m、20 层，多数为门窗家具大小的小构件，少数为长墙与楼板
+	static std::vector<Box> MakeBenchBoxes() {
+		std::mt19937_64 random(20240501);
+		std::uniform_real_distribution<double> pickPlan(0.0, 400.0);
+		std::uniform_int_distribution<int> pickFloor(0, 19);
+		std::uniform_real_distribution<double> pickSmall(0.2, 1.5);
+		std::uniform_real_distribution<double> pickLong(2.0, 12.0);
+		std::uniform_real_distribution<double> pickKind(0.0, 1.0);
+
+		std::vector<Box> boxes(kBenchBoxes);
+		for (Box& box : boxes) {
+			const double kind = pickKind(random);
+			double sizeX = pickSmall(random), sizeY = pickSmall(random), sizeZ = pickSmall(random) * 2.0;
+			if (kind < 0.15) {
+				// 墙：一个方向长，高一层
+				(pickKind(random) < 0.5 ? sizeX : sizeY) = pickLong(random);
+				sizeZ = 3.0;
+			} else if (kind < 0.2) {
+				// 楼板：平面两个方向都长，很薄
+				sizeX = pickLong(random);
+				sizeY = pickLong(random);
+				sizeZ = 0.2;
+			}
+			box.xMin = pickPlan(random);
+			box.yMin = pickPlan(random);
+			box.zMin = pickFloor(random) * 3.0;
+			box.xMax = box.xMin + sizeX;
+			box.yMax = box.yMin + sizeY;
+			box.zMax = box.zMin + sizeZ;
+		}
+		return boxes;
+	}
+
+	struct BenchQuery {
+		double x = 0.0, y = 0.0, z = 0.0;
+		Box box;
+	};
+
+	static std::vector<BenchQuery> MakeBenchQueries() {
+		std::mt19937_64 random(20240502);
+		std::uniform_real_distribution<double> pickPlan(0.0, 400.0);
+		std::uniform_real_distribution<double> pickHeight(0.0, 60.0);
+		std::vector<BenchQuery> queries(kBenchQueries);
+		for (BenchQuery& query : queries) {
+			query.x = pickPlan(random);
+			query.y = pickPlan(random);
+			query.z = pickHeight(random);
+			query.box.xMin = query.x - kBenchQueryHalfSize;
+			query.box.yMin = query.y - kBenchQueryHalfSize;
+			query.box.zMin = query.z - kBenchQueryHalfSize;
+			query.box.xMax = query.x + kBenchQueryHalfSize;
+			query.box.yMax = query.y + kBenchQueryHalfSize;
+			query.box.zMax = query.z + kBenchQueryHalfSize;
+		}
+		return queries;
+	}
+
+	// 逐个比较核对前 kBenchChecked 个查询：最近邻比较距离序列（距离相同的构件可能互换），范围查询比较个数
+	static UInt32 CountMismatches(const HBIMSpatialIndex::BoxTree& tree, const std::vector<Box>& boxes, const std::vector<bool>& removed,
+								  const std::vector<BenchQuery>& queries) {
+		UInt32 mismatches = 0;
+		std::vector<Hit> hits;
+		std::vector<UInt32> items;
+		std::vector<double> expected;
+		for (UInt32 q = 0; q < kBenchChecked && q < queries.size(); ++q) {
+			const BenchQuery& query = queries[q];
+			expected.clear();
+			size_t expectedIntersecting = 0;
+			for (UInt32 i = 0; i < boxes.size(); ++i) {
+				if (removed[i])
+					continue;
+				const double distance = HBIMSpatialIndex::BoxDistance(boxes[i], query.x, query.y, query.z, false);
+				if (distance <= kBenchMaxDistance)
+					expected.push_back(distance);
+				if (HBIMSpatialIndex::BoxesOverlap(boxes[i], query.box))
+					++expectedIntersecting;
+			}
+			std::sort(expected.begin(), expected.end());
+			expected.resize(std::min<size_t>(expected.size(), kBenchNeighbours));
+
+			tree.Nearest(query.x, query.y, query.z, false, kBenchNeighbours, kBenchMaxDistance, hits, &removed);
+			bool same = hits.size() == expected.size();
+			for (size_t i = 0; same && i < hits.size(); ++i)
+				same = std::abs(hits[i].distance - expected[i]) < 1e-9 && !removed[hits[i].item];
+			tree.Intersecting(query.box, items, &removed);
+			if (!same || items.size() != expectedIntersecting)
+				++mismatches;
+		}
+		return mismatches;
+	}
+
+	// 当前项目索引：以构件包围盒中心附近的点连续查询，测主线程上一次查询的耗时（含追加表合并）
+	static GS::UniString BenchmarkProjectIndex() {
+		auto ensureStart = std::chrono::steady_clock::now();
+		HBIMElementIndex::EnsureBuilt();
+		const double ensureSeconds = SecondsSince(ensureStart);
+		if (s_base == nullptr || s_base->guids.empty())
+			return "当前项目：没有参与空间查询的构件";
+
+		std::mt19937_64 random(20240503);
+		std::uniform_int_distribution<size_t> pickElement(0, s_base->guids.size() - 1);
+		std::uniform_real_distribution<double> pickOffset(-2.0, 2.0);
+		GS::Array<HBIMElementIndex::Neighbour> neighbours;
+		size_t found = 0;
+		auto queryStart = std::chrono::steady_clock::now();
+		for (UInt32 q = 0; q < kBenchProjectQueries; ++q) {
+			const Box& box = s_base->tree.GetBox(static_cast<UInt32>(pickElement(random)));
+			HBIMElementIndex::FindNearest(0.5 * (box.xMin + box.xMax) + pickOffset(random), 0.5 * (box.yMin + box.yMax) + pickOffset(random),
+										  0.5 * (box.zMin + box.zMax), false, kBenchNeighbours, kBenchMaxDistance, neighbours);
+			found += neighbours.GetSize();
+		}
+		const double querySeconds = SecondsSince(queryStart);
+
+		GS::UniString msg = GS::UniString::Printf("当前项目：%u 个构件（追加表 %u 个，删除标记 %u 个），等待索引 %.3f 秒\n",
+												  static_cast<unsigned>(HBIMElementIndex::GetSize()), static_cast<unsigned>(s_overlayGuids.size()),
+												  s_removedCount, ensureSeconds);
+		msg.Append(GS::UniString::Printf("  最近 %u 个构件：%.2f 微秒/次（平均返回 %.1f 个）", kBenchNeighbours,
+										 querySeconds * 1e6 / kBenchProjectQueries, static_cast<double>(found) / kBenchProjectQueries));
+		return msg;
+	}
+
+}
+
+namespace HBIMElementIndex {
+
+void Initialize() {
+	HBIMNotifications::AddProjectListener(OnProjectEvent);
+	HBIMNotifications::AddElementListener(OnElementEvent);
+	// 插件可能在项目已打开后才加载
+	ScheduleBuild();
+}
+
+void Shutdown() {
+	Clear();
+	if (s_builder.valid())
+		s_builder.wait();
+}
+
+void EnsureBuilt() {
+	if (s_state == IndexState::NotBuilt)
+		StartBuild();
+	if (s_state == IndexState::Collecting)
+		ProcessPending(s_pendingElements.GetSize());
+	if (s_state == IndexState::Building) {
+		const std::shared_ptr<BuiltTree> pending = s_pendingTree;
+		s_builder.wait();
+		FinishTreeBuild(s_generation, pending);
+	}
+	if (!s_dirtyElements.IsEmpty())
+		ApplyDirtyElements();
+}
+
+void FindNearest(double x, double y, double z, bool ignoreZ, UInt32 k, double maxDistance, GS::Array<Neighbour>& outNeighbours) {
+	outNeighbours.Clear();
+	EnsureBuilt();
+
+	static std::vector<Hit> hits;
+	hits.clear();
+	if (s_base != nullptr)
+		s_base->tree.Nearest(x, y, z, ignoreZ, k, maxDistance, hits, &s_removed);
+	if (!s_overlayGuids.empty()) {
+		for (UInt32 i = 0; i < s_overlayBoxes.size(); ++i) {
+			const double distance = HBIMSpatialIndex::BoxDistance(s_overlayBoxes[i], x, y, z, ignoreZ);
+			if (distance <= maxDistance)
+				hits.push_back({ i | kOverlayItem, distance });
+		}
+		std::sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) { return a.distance < b.distance; });
+		if (hits.size() > k)
+			hits.resize(k);
+	}
+
+	for (const Hit& hit : hits) {
+		const API_Guid& elemGuid = (hit.item & kOverlayItem) != 0 ? s_overlayGuids[hit.item & ~kOverlayItem] : s_base->guids[hit.item];
+		outNeighbours.Push({ elemGuid, hit.distance });
+	}
+}
+
+void FindIntersecting(const HBIMSpatialIndex::Box& query, GS::Array<API_Guid>& outElements) {
+	outElements.Clear();
+	EnsureBuilt();
+
+	static std::vector<UInt32> items;
+	if (s_base != nullptr) {
+		s_base->tree.Intersecting(query, items, &s_removed);
+		for (UInt32 item : items)
+			outElements.Push(s_base->guids[item]);
+	}
+	for (UInt32 i = 0; i < s_overlayBoxes.size(); ++i) {
+		if (HBIMSpatialIndex::BoxesOverlap(s_overlayBoxes[i], query))
+			outElements.Push(s_overlayGuids[i]);
+	}
+}
+
+bool GetBox(const API_Guid& elemGuid, HBIMSpatialIndex::Box& outBox) {
+	EnsureBuilt();
+
+	const UInt32* overlaySlot = s_overlaySlots.GetPtr(elemGuid);
+	if (overlaySlot != nullptr) {
+		outBox = s_overlayBoxes[*overlaySlot];
+		return true;
+	}
+	if (s_base == nullptr)
+		return false;
+	const UInt32* slot = s_base->slots.GetPtr(elemGuid);
+	if (slot == nullptr || s_removed[*slot])
+		return false;
+	outBox = s_base->tree.GetBox(*slot);
+	return true;
+}
+
+bool IsReady() {
+	return s_state == IndexState::Ready;
+}
+
+USize GetSize() {
+	const size_t baseSize = s_base != nullptr ? s_base->guids.size() : 0;
+	return static_cast<USize>(baseSize - s_removedCount + s_overlayGuids.size());
+}
+
+void RunBenchmarkCommand() {
+	ACAPI_WriteReport("HBIMElementIndex: 开始性能测试", false);
+	const std::vector<Box> boxes = MakeBenchBoxes();
+	const std::vector<BenchQuery> queries = MakeBenchQueries();
+	const unsigned workers = GetWorkerCount();
+
+	HBIMSpatialIndex::BoxTree serialTree;
+	auto serialStart = std::chrono::steady_clock::now();
+	serialTree.Build(boxes);
+	const double serialSeconds = SecondsSince(serialStart);
+
+	HBIMSpatialIndex::BoxTree tree;
+	auto parallelStart = std::chrono::steady_clock::now();
+	tree.Build(boxes, workers);
+	const double parallelSeconds = SecondsSince(parallelStart);
+
+	std::vector<bool> removed(boxes.size(), false);
+	std::vector<Hit> hits;
+	size_t nearestFound = 0;
+	auto nearestStart = std::chrono::steady_clock::now();
+	for (const BenchQuery& query : queries) {
+		tree.Nearest(query.x, query.y, query.z, false, kBenchNeighbours, kBenchMaxDistance, hits);
+		nearestFound += hits.size();
+	}
+	const double nearestSeconds = SecondsSince(nearestStart);
+
+	std::vector<UInt32> items;
+	size_t intersectingFound = 0;
+	auto intersectingStart = std::chrono::steady_clock::now();
+	for (const BenchQuery& query : queries) {
+		tree.Intersecting(query.box, items);
+		intersectingFound += items.size();
+	}
+	const double intersectingSeconds = SecondsSince(intersectingStart);
+	const UInt32 mismatches = CountMismatches(tree, boxes, removed, queries);
+
+	// 每 100 个标记删除 1 个，模拟尚未重建的增量修改
+	for (size_t i = 0; i < removed.size(); i += 100)
+		removed[i] = true;
+	auto removedStart = std::chrono::steady_clock::now();
+	for (const BenchQuery& query : queries)
+		tree.Nearest(query.x, query.y, query.z, false, kBenchNeighbours, kBenchMaxDistance, hits, &removed);
+	const double removedSeconds = SecondsSince(removedStart);
+	const UInt32 removedMismatches = CountMismatches(tree, boxes, removed, queries);
+
+	GS::UniString summary = GS::UniString::Printf("合成构件包围盒：%u 个\n\n", kBenchBoxes);
+	summary.Append(GS::UniString::Printf("建立 R 树：单线程 %.1f 毫秒，%u 线程 %.1f 毫秒\n", serialSeconds * 1e3, workers, parallelSeconds * 1e3));
+	summary.Append(GS::UniString::Printf("最近 %u 个构件：%.2f 微秒/次\n", kBenchNeighbours, nearestSeconds * 1e6 / queries.size()));
+	summary.Append(GS::UniString::Printf("%.0f 米立方范围查询：%.2f 微秒/次（平均 %.1f 个）\n", kBenchQueryHalfSize * 2.0,
+										 intersectingSeconds * 1e6 / queries.size(), static_cast<double>(intersectingFound) / queries.size()));
+	summary.Append(GS::UniString::Printf("含 1%% 删除标记的最近邻：%.2f 微秒/次\n", removedSeconds * 1e6 / queries.size()));
+	summary.Append(GS::UniString::Printf("与逐个比较核对 %u 次查询：不一致 %u 次（含删除标记 %u 次）\n\n", kBenchChecked, mismatches, removedMismatches));
+	summary.Append(BenchmarkProjectIndex());
+
+	ACAPI_WriteReport("HBIMElementIndex: 性能测试（平均返回 %.1f 个最近构件）\n%s", false,
+					  static_cast<double>(nearestFound) / queries.size(), summary.ToCStr().Get());
+	DG::InformationAlert("构件空间索引性能", summary, "确定");
+}
+
+}
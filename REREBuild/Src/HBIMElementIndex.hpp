@@ -0,0 +1,46 @@
+#ifndef HBIMELEMENTINDEX_HPP
+#define HBIMELEMENTINDEX_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+#include "HBIMSpatialIndex.hpp"
+
+// 当前项目全部三维构件包围盒的常驻空间索引，回答"某点附近/某范围内有哪些构件"。
+// 打开/新建项目后在主事件循环中分段读取包围盒，R 树（HBIMSpatialIndex::BoxTree）由后台线程多线程建立；
+// 之后构件的新建/修改/删除只在树中标记删除，新的包围盒放在一张小的追加表中，查询时两边合并，
+// 追加表或删除标记积累到一定数量时在后台按当前状态重建。接收团队工作更改后按修改戳找出变化的构件同样处理。
+// 查询在主线程中通常只需几微秒。
+namespace HBIMElementIndex {
+
+	struct Neighbour {
+		API_Guid elemGuid = APINULLGuid;
+		double distance = 0.0;		// 到构件包围盒的距离（米），点在盒内为 0
+	};
+
+	// 在 Initialize 中调用（需在 HBIMNotifications::Initialize 之后）
+	void Initialize();
+
+	// 在 FreeData 中调用：等待后台建立结束
+	void Shutdown();
+
+	// 立即完成建立并应用尚未处理的构件变化；查询函数会自动调用
+	void EnsureBuilt();
+
+	// 距离点最近的至多 k 个构件，按距离升序；ignoreZ 时只按平面距离
+	void FindNearest(double x, double y, double z, bool ignoreZ, UInt32 k, double maxDistance, GS::Array<Neighbour>& outNeighbours);
+
+	// 包围盒与查询盒相交的全部构件
+	void FindIntersecting(const HBIMSpatialIndex::Box& query, GS::Array<API_Guid>& outElements);
+
+	// 索引中构件的包围盒
+	bool GetBox(const API_Guid& elemGuid, HBIMSpatialIndex::Box& outBox);
+
+	bool IsReady();
+	USize GetSize();
+
+	// 菜单入口：合成 10 万个包围盒测量建立与查询速度并与逐个比较的结果核对，再测当前项目索引的查询速度
+	void RunBenchmarkCommand();
+
+}
+
+#endif
@@ -0,0 +1,137 @@
+// *****************************************************************************
+// File:			HBIMElementMesh.cpp
+// Description:		构件三维网格：临时视景生成模型、ModelerAPI 读取 MeshBody 并拆成三角形
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMElementMesh.hpp"
+#include "HBIMGeometryCache.hpp"
+
+#include "ConvexPolygon.hpp"
+#include "Model.hpp"
+#include "ModelElement.hpp"
+#include "ModelMeshBody.hpp"
+#include "Polygon.hpp"
+#include "Vertex.hpp"
+
+#include <optional>
+
+namespace {
+
+	// 一个构件的全部 MeshBody；ModelerAPI 的序号都从 1 开始
+	static void ReadElementMesh(const ModelerAPI::Element& element, HBIMElementMesh::Mesh& mesh) {
+		const Int32 bodyCount = element.GetTessellatedBodyCount();
+		for (Int32 bodyIndex = 1; bodyIndex <= bodyCount; ++bodyIndex) {
+			ModelerAPI::MeshBody body;
+			element.GetTessellatedBody(bodyIndex, &body);
+
+			const UInt32 base = static_cast<UInt32>(mesh.positions.size() / 3);
+			const Int32 vertexCount = body.GetVertexCount();
+			for (Int32 vertexIndex = 1; vertexIndex <= vertexCount; ++vertexIndex) {
+				ModelerAPI::Vertex vertex;
+				body.GetVertex(vertexIndex, &vertex);
+				mesh.positions.push_back(vertex.x);
+				mesh.positions.push_back(vertex.y);
+				mesh.positions.push_back(vertex.z);
+			}
+
+			const Int32 polygonCount = body.GetPolygonCount();
+			for (Int32 polygonIndex = 1; polygonIndex <= polygonCount; ++polygonIndex) {
+				ModelerAPI::Polygon polygon;
+				body.GetPolygon(polygonIndex, &polygon);
+				const Int32 convexCount = polygon.GetConvexPolygonCount();
+				for (Int32 convexIndex = 1; convexIndex <= convexCount; ++convexIndex) {
+					ModelerAPI::ConvexPolygon convex;
+					polygon.GetConvexPolygon(convexIndex, &convex);
+					const Int32 cornerCount = convex.GetVertexCount();
+					if (cornerCount < 3)
+						continue;
+					const UInt32 first = base + static_cast<UInt32>(convex.GetVertexIndex(1) - 1);
+					for (Int32 corner = 2; corner < cornerCount; ++corner) {
+						mesh.triangles.push_back(first);
+						mesh.triangles.push_back(base + static_cast<UInt32>(convex.GetVertexIndex(corner) - 1));
+						mesh.triangles.push_back(base + static_cast<UInt32>(convex.GetVertexIndex(corner + 1) - 1));
+					}
+				}
+			}
+		}
+	}
+
+}
+
+namespace HBIMElementMesh {
+
+GSErrCode GetMeshes(const GS::Array<API_Guid>& elemGuids, std::vector<Mesh>& outMeshes) {
+	outMeshes.clear();
+	return ForEachMesh(elemGuids, [&](Mesh& mesh) {
+		outMeshes.push_back(std::move(mesh));
+		return true;
+	});
+}
+
+GSErrCode ForEachMesh(const GS::Array<API_Guid>& elemGuids, const std::function<bool(Mesh& mesh)>& visitor) {
+	// 先取缓存中修改戳一致的网格，只为其余构件生成三维模型
+	GS::Array<API_Guid> missingGuids;
+	std::vector<UInt64> missingStamps;
+	for (const API_Guid& elemGuid : elemGuids) {
+		API_Elem_Head elemHead = {};
+		elemHead.guid = elemGuid;
+		if (ACAPI_Element_GetHeader(&elemHead) != NoError)
+			continue;
+		Mesh mesh;
+		if (HBIMGeometryCache::GetMesh(elemGuid, elemHead.modiStamp, mesh)) {
+			if (!mesh.triangles.empty() && !visitor(mesh))
+				return NoError;
+			continue;
+		}
+		missingGuids.Push(elemGuid);
+		missingStamps.push_back(elemHead.modiStamp);
+	}
+	if (missingGuids.IsEmpty())
+		return NoError;
+
+	// 在自己的视景中生成模型，三维窗口的模型不受影响
+	void* sightPtr = nullptr;
+	void* originalSightPtr = nullptr;
+	GSErrCode err = ACAPI_Sight_CreateSight(&sightPtr);
+	if (err != NoError)
+		return err;
+	err = ACAPI_Sight_SelectSight(sightPtr, &originalSightPtr);
+	if (err != NoError) {
+		ACAPI_Sight_DeleteSight(sightPtr);
+		return err;
+	}
+
+	err = ACAPI_ModelAccess_GenerateModelWithSeparateComponents(missingGuids);
+	ModelerAPI::Model model;
+	if (err == NoError)
+		err = ACAPI_Sight_GetSelectedSightModel(model);
+	if (err == NoError) {
+		for (UIndex i = 0; i < missingGuids.GetSize(); ++i) {
+			const API_Guid& elemGuid = missingGuids[i];
+			Mesh mesh;
+			mesh.elemGuid = elemGuid;
+			const std::optional<Int32> elementIndex = model.GetElementIndex(APIGuid2GSGuid(elemGuid));
+			if (elementIndex.has_value()) {
+				try {
+					ModelerAPI::Element element;
+					model.GetElement(*elementIndex, &element);
+					ReadElementMesh(element, mesh);
+				} catch (...) {
+					ACAPI_WriteReport("HBIMElementMesh: 读取构件 %s 的三维模型失败", true, APIGuidToString(elemGuid).ToCStr().Get());
+					continue;
+				}
+			}
+			// 没有三维模型的构件也记入缓存，下次不再生成
+			HBIMGeometryCache::PutMesh(mesh, missingStamps[i]);
+			if (!mesh.triangles.empty() && !visitor(mesh))
+				break;
+		}
+	}
+
+	ACAPI_Sight_SelectSight(originalSightPtr, &sightPtr);
+	ACAPI_Sight_DeleteSight(sightPtr);
+	return err;
+}
+
+}
@@ -0,0 +1,30 @@
+#ifndef HBIMELEMENTMESH_HPP
+#define HBIMELEMENTMESH_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+
+#include <functional>
+#include <vector>
+
+// 构件三维网格：在临时视景中为指定构件生成三维模型（ACAPI_ModelAccess_GenerateModelWithSeparateComponents），
+// 经 ModelerAPI 逐个构件读取 MeshBody，把每个多边形的凸分解按扇形拆成三角形。
+// 坐标为世界坐标（m），不影响三维窗口的视景。修改戳未变的构件直接取自 HBIMGeometryCache，不再生成模型。
+namespace HBIMElementMesh {
+
+	struct Mesh {
+		API_Guid elemGuid = APINULLGuid;
+		std::vector<double> positions;		// 顶点坐标 x y z 依次排列
+		std::vector<UInt32> triangles;		// 每三个为一个三角形（positions 中的顶点序号），按多边形法向逆时针
+	};
+
+	// 主线程：读取构件的三角网格；没有三维模型或没有多边形的构件不出现在结果中
+	GSErrCode GetMeshes(const GS::Array<API_Guid>& elemGuids, std::vector<Mesh>& outMeshes);
+
+	// 主线程：与 GetMeshes 相同，但每读出一个构件即交给 visitor（可移走其中的数据），不在内存中保留全部网格；
+	// 缓存中的构件先于需要生成模型的构件给出。visitor 返回 false 时停止读取
+	GSErrCode ForEachMesh(const GS::Array<API_Guid>& elemGuids, const std::function<bool(Mesh& mesh)>& visitor);
+
+}
+
+#endif
@@ -0,0 +1,108 @@
+// *****************************************************************************
+// File:			HBIMEventLoop.cpp
+// Description:		通过 ACAPI_AddOnAddOnCommunication_CallFromEventLoop 调用自身命令，
+//					在主事件循环中执行排队的任务
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMEventLoop.hpp"
+
+#include <cstdarg>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+
+namespace {
+
+	// 与 RFIX 中 'MDID' 32500 一致
+	static const API_ModulID kOwnMdid = { 625438022, 170868903 };
+	static const GSType kRunTasksCmdID = 'HBEL';
+	static const Int32 kRunTasksCmdVersion = 1;
+
+	static std::mutex s_queueMutex;
+	static std::deque<HBIMEventLoop::Task> s_queue;
+	static bool s_callPending = false;
+	static bool s_running = false;
+
+	static GSErrCode RunQueuedTasks(GSHandle /*params*/, GSPtr /*resultData*/, bool /*silentMode*/) {
+		std::deque<HBIMEventLoop::Task> tasks;
+		{
+			std::lock_guard<std::mutex> lock(s_queueMutex);
+			tasks.swap(s_queue);
+			s_callPending = false;
+		}
+
+		for (HBIMEventLoop::Task& task : tasks) {
+			try {
+				task();
+			} catch (const std::exception& e) {
+				ACAPI_WriteReport("HBIMEventLoop: 任务异常: %s", true, e.what());
+			} catch (...) {
+				ACAPI_WriteReport("HBIMEventLoop: 任务异常", true);
+			}
+		}
+		return NoError;
+	}
+
+}
+
+namespace HBIMEventLoop {
+
+GSErrCode RegisterInterface() {
+	return ACAPI_AddOnAddOnCommunication_RegisterSupportedService(kRunTasksCmdID, kRunTasksCmdVersion);
+}
+
+GSErrCode Initialize() {
+	GSErrCode err = ACAPI_AddOnIntegration_InstallModulCommandHandler(kRunTasksCmdID, kRunTasksCmdVersion, RunQueuedTasks);
+	if (err == NoError) {
+		std::lock_guard<std::mutex> lock(s_queueMutex);
+		s_running = true;
+	}
+	return err;
+}
+
+void Shutdown() {
+	std::lock_guard<std::mutex> lock(s_queueMutex);
+	s_running = false;
+	s_queue.clear();
+}
+
+void Post(Task task) {
+	{
+		std::lock_guard<std::mutex> lock(s_queueMutex);
+		if (!s_running)
+			return;
+		s_queue.push_back(std::move(task));
+		// 队列中已有待处理的调用时不必重复发起
+		if (s_callPending)
+			return;
+		s_callPending = true;
+	}
+
+	GSErrCode err = ACAPI_AddOnAddOnCommunication_CallFromEventLoop(&kOwnMdid, kRunTasksCmdID, kRunTasksCmdVersion, nullptr, true, nullptr);
+	if (err != NoError) {
+		ACAPI_WriteReport("HBIMEventLoop: CallFromEventLoop失败，错误码=%d", true, err);
+		std::lock_guard<std::mutex> lock(s_queueMutex);
+		s_callPending = false;
+	}
+}
+
+void PostReport(bool withDial, const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	va_list sizeArgs;
+	va_copy(sizeArgs, args);
+	const int length = std::vsnprintf(nullptr, 0, format, sizeArgs);
+	va_end(sizeArgs);
+	std::string message(length > 0 ? static_cast<size_t>(length) : 0, '\0');
+	if (length > 0)
+		std::vsnprintf(&message[0], message.size() + 1, format, args);
+	va_end(args);
+
+	Post([message = std::move(message), withDial]() {
+		ACAPI_WriteReport("%s", withDial, message.c_str());
+	});
+}
+
+}
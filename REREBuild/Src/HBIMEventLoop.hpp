@@ -0,0 +1,33 @@
+#ifndef HBIMEVENTLOOP_HPP
+#define HBIMEVENTLOOP_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+
+#include <functional>
+
+// 把任务投递到 Archicad 主事件循环中执行。
+// Archicad API 只能在主线程调用：后台线程完成纯计算/文件IO后用 Post 把结果交回主线程，
+// 主线程上的长任务也可拆成多段、每段结束时 Post 下一段，避免长时间卡住界面。
+namespace HBIMEventLoop {
+
+	using Task = std::function<void()>;
+
+	// 在 RegisterInterface 中调用：注册内部命令
+	GSErrCode RegisterInterface();
+
+	// 在 Initialize 中调用：安装命令处理函数
+	GSErrCode Initialize();
+
+	// 在 FreeData 中调用：丢弃尚未执行的任务
+	void Shutdown();
+
+	// 线程安全；任务按投递顺序在主线程执行
+	void Post(Task task);
+
+	// 线程安全：按 printf 格式在调用线程中生成文字，交回主线程用 ACAPI_WriteReport 写入报告窗口
+	void PostReport(bool withDial, const char* format, ...);
+
+}
+
+#endif
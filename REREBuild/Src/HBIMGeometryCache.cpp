@@ -0,0 +1,395 @@
+// *****************************************************************************
+// File:			HBIMGeometryCache.cpp
+// Description:		构件网格缓存：按GUID与修改戳索引、顶点按列存放、项目目录下的映射文件
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMGeometryCache.hpp"
+#include "HBIMEventLoop.hpp"
+#include "HBIMNotifications.hpp"
+#include "HBIMProject.hpp"
+#include "HashTable.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <vector>
+#include <sys/stat.h>
+
+#if defined(GS_MAC)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+	static const char* kCacheFileName = "HBIM_GeometryCache.bin";
+	static const UInt32 kFileMagic = 0x48424743;		// 'HBGC'
+	static const UInt32 kFileVersion = 1;
+
+	// 文件：文件头、构件表、x 列、y 列、z 列、索引
+	struct FileHeader {
+		UInt32 magic = kFileMagic;
+		UInt32 version = kFileVersion;
+		UInt64 entryCount = 0;
+		UInt64 vertexCount = 0;
+		UInt64 indexCount = 0;
+	};
+	static_assert(sizeof(FileHeader) == 32, "缓存文件头不能有填充");
+
+	struct EntryRecord {
+		API_Guid elemGuid;
+		UInt64 modiStamp;
+		double origin[3];			// 包围盒最小角点，顶点坐标相对此点
+		double extent[3];			// 包围盒尺寸
+		UInt64 firstVertex;
+		UInt64 firstIndex;
+		UInt32 vertexCount;
+		UInt32 indexCount;
+	};
+	static_assert(sizeof(EntryRecord) == 96, "构件表记录不能有填充");
+
+	struct Entry {
+		UInt64 modiStamp = 0;
+		double origin[3] = { 0.0, 0.0, 0.0 };
+		double extent[3] = { 0.0, 0.0, 0.0 };
+		bool mapped = false;		// true：数据在映射的文件中；false：在本次会话新增的数组中
+		UInt64 firstVertex = 0;
+		UInt64 firstIndex = 0;
+		UInt32 vertexCount = 0;
+		UInt32 indexCount = 0;
+	};
+
+	struct Columns {
+		const float* xs = nullptr;
+		const float* ys = nullptr;
+		const float* zs = nullptr;
+		const UInt32* indices = nullptr;
+	};
+
+	// 只在主线程访问
+	static GS::HashTable<API_Guid, Entry> s_entries;
+	static std::vector<float> s_xs, s_ys, s_zs;		// 本次会话新增的网格
+	static std::vector<UInt32> s_indices;
+	static Columns s_mappedColumns;
+	static const std::byte* s_mapped = nullptr;
+	static size_t s_mappedSize = 0;
+	static std::vector<std::byte> s_fileBuffer;			// 不支持 mmap 的平台读入内存
+	static std::filesystem::path s_cachePath;
+	static bool s_loaded = false;
+	static bool s_dirty = false;
+
+	static Columns ColumnsOf(const Entry& entry) {
+		if (entry.mapped)
+			return s_mappedColumns;
+		Columns columns;
+		columns.xs = s_xs.data();
+		columns.ys = s_ys.data();
+		columns.zs = s_zs.data();
+		columns.indices = s_indices.data();
+		return columns;
+	}
+
+	static void Unmap() {
+#if defined(GS_MAC)
+		if (s_mapped != nullptr && s_fileBuffer.empty())
+			munmap(const_cast<std::byte*>(s_mapped), s_mappedSize);
+#endif
+		std::vector<std::byte>().swap(s_fileBuffer);
+		s_mapped = nullptr;
+		s_mappedSize = 0;
+		s_mappedColumns = Columns();
+	}
+
+	// 映射缓存文件并读入构件表；格式不符或不完整时当作没有缓存
+	static bool MapFile(const std::filesystem::path& path) {
+		Unmap();
+#if defined(GS_MAC)
+		int fd = open(path.string().c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+		struct stat st;
+		if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(FileHeader)) {
+			close(fd);
+			return false;
+		}
+		void* mapped = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (mapped == MAP_FAILED)
+			return false;
+		s_mapped = static_cast<const std::byte*>(mapped);
+		s_mappedSize = static_cast<size_t>(st.st_size);
+#else
+		std::ifstream in(path, std::ios::binary | std::ios::ate);
+		if (!in.is_open())
+			return false;
+		s_fileBuffer.resize(static_cast<size_t>(in.tellg()));
+		in.seekg(0);
+		if (s_fileBuffer.size() < sizeof(FileHeader) || !in.read(reinterpret_cast<char*>(s_fileBuffer.data()), s_fileBuffer.size())) {
+			Unmap();
+			return false;
+		}
+		s_mapped = s_fileBuffer.data();
+		s_mappedSize = s_fileBuffer.size();
+#endif
+
+		FileHeader header;
+		std::memcpy(&header, s_mapped, sizeof(header));
+		const UInt64 entriesOffset = sizeof(FileHeader);
+		const UInt64 columnsOffset = entriesOffset + header.entryCount * sizeof(EntryRecord);
+		const UInt64 indicesOffset = columnsOffset + 3 * header.vertexCount * sizeof(float);
+		if (header.magic != kFileMagic || header.version != kFileVersion ||
+			indicesOffset + header.indexCount * sizeof(UInt32) != s_mappedSize) {
+			Unmap();
+			return false;
+		}
+		s_mappedColumns.xs = reinterpret_cast<const float*>(s_mapped + columnsOffset);
+		s_mappedColumns.ys = s_mappedColumns.xs + header.vertexCount;
+		s_mappedColumns.zs = s_mappedColumns.ys + header.vertexCount;
+		s_mappedColumns.indices = reinterpret_cast<const UInt32*>(s_mapped + indicesOffset);
+
+		for (UInt64 i = 0; i < header.entryCount; ++i) {
+			EntryRecord record;
+			std::memcpy(&record, s_mapped + entriesOffset + i * sizeof(EntryRecord), sizeof(record));
+			if (record.firstVertex + record.vertexCount > header.vertexCount || record.firstIndex + record.indexCount > header.indexCount)
+				continue;
+			Entry entry;
+			entry.modiStamp = record.modiStamp;
+			std::copy(std::begin(record.origin), std::end(record.origin), entry.origin);
+			std::copy(std::begin(record.extent), std::end(record.extent), entry.extent);
+			entry.mapped = true;
+			entry.firstVertex = record.firstVertex;
+			entry.firstIndex = record.firstIndex;
+			entry.vertexCount = record.vertexCount;
+			entry.indexCount = record.indexCount;
+			s_entries.Put(record.elemGuid, entry);
+		}
+		return true;
+	}
+
+	static void EnsureLoaded() {
+		if (s_loaded)
+			return;
+		s_loaded = true;
+		const HBIMProject::Context& context = HBIMProject::GetContext();
+		if (!context.isSaved)
+			return;
+		s_cachePath = context.projectDir / kCacheFileName;
+		if (MapFile(s_cachePath))
+			ACAPI_WriteReport("HBIMGeometryCache: 读入 %u 个构件的网格缓存", false, static_cast<UInt32>(s_entries.GetSize()));
+	}
+
+	// 按列依次写出全部构件的同一列
+	template <typename T, typename Get>
+	static bool WriteColumn(std::FILE* file, const std::vector<std::pair<API_Guid, Entry>>& entries, const Get& get) {
+		for (const auto& item : entries) {
+			const Entry& entry = item.second;
+			const T* data = get(entry);
+			if (std::fwrite(data, sizeof(T), entry.vertexCount, file) != entry.vertexCount)
+				return false;
+		}
+		return true;
+	}
+
+	static bool WriteFile(const std::filesystem::path& path, const std::vector<std::pair<API_Guid, Entry>>& entries) {
+		std::FILE* file = std::fopen(path.string().c_str(), "wb");
+		if (file == nullptr)
+			return false;
+		FileHeader header;
+		header.entryCount = entries.size();
+		std::vector<EntryRecord> records;
+		records.reserve(entries.size());
+		for (const auto& item : entries) {
+			const Entry& entry = item.second;
+			EntryRecord record;
+			record.elemGuid = item.first;
+			record.modiStamp = entry.modiStamp;
+			std::copy(std::begin(entry.origin), std::end(entry.origin), record.origin);
+			std::copy(std::begin(entry.extent), std::end(entry.extent), record.extent);
+			record.firstVertex = header.vertexCount;
+			record.firstIndex = header.indexCount;
+			record.vertexCount = entry.vertexCount;
+			record.indexCount = entry.indexCount;
+			header.vertexCount += entry.vertexCount;
+			header.indexCount += entry.indexCount;
+			records.push_back(record);
+		}
+
+		bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+				  std::fwrite(records.data(), sizeof(EntryRecord), records.size(), file) == records.size();
+		ok = ok && WriteColumn<float>(file, entries, [](const Entry& entry) { return ColumnsOf(entry).xs + entry.firstVertex; });
+		ok = ok && WriteColumn<float>(file, entries, [](const Entry& entry) { return ColumnsOf(entry).ys + entry.firstVertex; });
+		ok = ok && WriteColumn<float>(file, entries, [](const Entry& entry) { return ColumnsOf(entry).zs + entry.firstVertex; });
+		for (const auto& item : entries) {
+			const Entry& entry = item.second;
+			ok = ok && std::fwrite(ColumnsOf(entry).indices + entry.firstIndex, sizeof(UInt32), entry.indexCount, file) == entry.indexCount;
+		}
+		return std::fclose(file) == 0 && ok;
+	}
+
+	static void Unload() {
+		HBIMGeometryCache::Flush();
+		Unmap();
+		s_entries.Clear();
+		std::vector<float>().swap(s_xs);
+		std::vector<float>().swap(s_ys);
+		std::vector<float>().swap(s_zs);
+		std::vector<UInt32>().swap(s_indices);
+		s_cachePath.clear();
+		s_loaded = false;
+		s_dirty = false;
+	}
+
+	static void OnProjectEvent(API_NotifyEventID notifID) {
+		switch (notifID) {
+			case APINotify_New:
+			case APINotify_NewAndReset:
+			case APINotify_Open:
+			case APINotify_Close:
+			case APINotify_Quit:
+				Unload();
+				break;
+			case APINotify_Save:
+				// 项目上下文在事件中已作废，回到事件循环后再取保存位置；
+				// 首次保存或另存为到其他目录时把全部网格写到新位置，否则只在有新网格时重写
+				HBIMEventLoop::Post([]() {
+					if (!s_loaded)
+						return;
+					const HBIMProject::Context& context = HBIMProject::GetContext();
+					if (!context.isSaved)
+						return;
+					const std::filesystem::path cachePath = context.projectDir / kCacheFileName;
+					if (cachePath != s_cachePath) {
+						s_cachePath = cachePath;
+						if (!s_entries.IsEmpty())
+							s_dirty = true;
+					}
+					HBIMGeometryCache::Flush();
+				});
+				break;
+			default:
+				break;
+		}
+	}
+
+}
+
+namespace HBIMGeometryCache {
+
+void Initialize() {
+	HBIMNotifications::AddProjectListener(OnProjectEvent);
+}
+
+void Shutdown() {
+	Unload();
+}
+
+bool GetMesh(const API_Guid& elemGuid, UInt64 modiStamp, HBIMElementMesh::Mesh& outMesh) {
+	EnsureLoaded();
+	const Entry* entry = s_entries.GetPtr(elemGuid);
+	if (entry == nullptr || entry->modiStamp != modiStamp)
+		return false;
+	const Columns columns = ColumnsOf(*entry);
+	outMesh.elemGuid = elemGuid;
+	outMesh.positions.resize(static_cast<size_t>(entry->vertexCount) * 3);
+	for (UInt32 i = 0; i < entry->vertexCount; ++i) {
+		outMesh.positions[i * 3] = entry->origin[0] + columns.xs[entry->firstVertex + i];
+		outMesh.positions[i * 3 + 1] = entry->origin[1] + columns.ys[entry->firstVertex + i];
+		outMesh.positions[i * 3 + 2] = entry->origin[2] + columns.zs[entry->firstVertex + i];
+	}
+	outMesh.triangles.assign(columns.indices + entry->firstIndex, columns.indices + entry->firstIndex + entry->indexCount);
+	return true;
+}
+
+bool GetBounds(const API_Guid& elemGuid, UInt64 modiStamp, HBIMSpatialIndex::Box& outBox) {
+	EnsureLoaded();
+	const Entry* entry = s_entries.GetPtr(elemGuid);
+	if (entry == nullptr || entry->modiStamp != modiStamp || entry->vertexCount == 0)
+		return false;
+	outBox.xMin = entry->origin[0];
+	outBox.yMin = entry->origin[1];
+	outBox.zMin = entry->origin[2];
+	outBox.xMax = entry->origin[0] + entry->extent[0];
+	outBox.yMax = entry->origin[1] + entry->extent[1];
+	outBox.zMax = entry->origin[2] + entry->extent[2];
+	return true;
+}
+
+void PutMesh(const HBIMElementMesh::Mesh& mesh, UInt64 modiStamp) {
+	EnsureLoaded();
+	Entry entry;
+	entry.modiStamp = modiStamp;
+	entry.firstVertex = s_xs.size();
+	entry.firstIndex = s_indices.size();
+	entry.vertexCount = static_cast<UInt32>(mesh.positions.size() / 3);
+	entry.indexCount = static_cast<UInt32>(mesh.triangles.size());
+
+	double max[3] = { 0.0, 0.0, 0.0 };
+	for (int axis = 0; axis < 3; ++axis) {
+		entry.origin[axis] = entry.vertexCount > 0 ? std::numeric_limits<double>::max() : 0.0;
+		max[axis] = entry.vertexCount > 0 ? -std::numeric_limits<double>::max() : 0.0;
+	}
+	for (size_t i = 0; i < mesh.positions.size(); ++i) {
+		entry.origin[i % 3] = std::min(entry.origin[i % 3], mesh.positions[i]);
+		max[i % 3] = std::max(max[i % 3], mesh.positions[i]);
+	}
+	for (int axis = 0; axis < 3; ++axis)
+		entry.extent[axis] = max[axis] - entry.origin[axis];
+
+	for (UInt32 i = 0; i < entry.vertexCount; ++i) {
+		s_xs.push_back(static_cast<float>(mesh.positions[i * 3] - entry.origin[0]));
+		s_ys.push_back(static_cast<float>(mesh.positions[i * 3 + 1] - entry.origin[1]));
+		s_zs.push_back(static_cast<float>(mesh.positions[i * 3 + 2] - entry.origin[2]));
+	}
+	s_indices.insert(s_indices.end(), mesh.triangles.begin(), mesh.triangles.end());
+
+	Entry* existing = s_entries.GetPtr(mesh.elemGuid);
+	if (existing != nullptr)
+		*existing = entry;
+	else
+		s_entries.Add(mesh.elemGuid, entry);
+	s_dirty = true;
+}
+
+void Flush() {
+	if (!s_dirty || s_cachePath.empty())
+		return;
+	std::vector<std::pair<API_Guid, Entry>> entries;
+	entries.reserve(s_entries.GetSize());
+	for (auto it = s_entries.EnumeratePairs(); it != nullptr; ++it)
+		entries.emplace_back(it->key, it->value);
+
+	// 先写临时文件再替换：映射（或读入内存）的旧文件内容在替换后仍然有效，
+	// 写入或替换失败时保留内存中的网格，s_dirty 不变，下次 Flush 重试
+	std::filesystem::path tempPath = s_cachePath;
+	tempPath += ".tmp";
+	std::error_code ec;
+	if (!WriteFile(tempPath, entries)) {
+		std::filesystem::remove(tempPath, ec);
+		ACAPI_WriteReport("HBIMGeometryCache: 写入网格缓存失败", true);
+		return;
+	}
+	std::filesystem::rename(tempPath, s_cachePath, ec);
+	if (ec) {
+		ACAPI_WriteReport("HBIMGeometryCache: 替换网格缓存文件失败: %s", true, ec.message().c_str());
+		std::filesystem::remove(tempPath, ec);
+		return;
+	}
+	Unmap();
+	s_entries.Clear();
+	std::vector<float>().swap(s_xs);
+	std::vector<float>().swap(s_ys);
+	std::vector<float>().swap(s_zs);
+	std::vector<UInt32>().swap(s_indices);
+	s_dirty = false;
+	if (!MapFile(s_cachePath))
+		ACAPI_WriteReport("HBIMGeometryCache: 重新映射网格缓存失败", true);
+	else
+		ACAPI_WriteReport("HBIMGeometryCache: 写出 %u 个构件的网格缓存", false, static_cast<UInt32>(s_entries.GetSize()));
+}
+
+}
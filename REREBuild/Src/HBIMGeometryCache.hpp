@@ -0,0 +1,38 @@
+#ifndef HBIMGEOMETRYCACHE_HPP
+#define HBIMGEOMETRYCACHE_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+#include "HBIMElementMesh.hpp"
+#include "HBIMSpatialIndex.hpp"
+
+// 构件三角网格与包围盒的缓存，按构件GUID与修改戳（API_Elem_Head::modiStamp）索引：构件修改后旧网格自动失效。
+// 只修改相连构件（墙体连接、被屋顶裁切的板等）而改变本构件几何时，本构件的修改戳不变，缓存的网格会过期。
+// 顶点按列存放（x、y、z 三个单精度数组，相对各构件包围盒最小角点），索引为一个 UInt32 数组。
+// 已保存的项目在项目目录下的 HBIM_GeometryCache.bin 中持久保存，打开时只读映射，
+// 本次会话新增的网格在内存中，保存项目、关闭项目或退出时与映射中仍有效的网格一起重写文件；
+// 另存为到其他目录时写到新项目目录。
+// 只在主线程使用；HBIMElementMesh::ForEachMesh 先查缓存，只为缓存中没有的构件生成三维模型。
+namespace HBIMGeometryCache {
+
+	// 在 Initialize 中调用（需在 HBIMNotifications::Initialize 之后）
+	void Initialize();
+
+	// 在 FreeData 中调用：写出新增的网格并解除映射
+	void Shutdown();
+
+	// 修改戳一致时取出网格（世界坐标）
+	bool GetMesh(const API_Guid& elemGuid, UInt64 modiStamp, HBIMElementMesh::Mesh& outMesh);
+
+	// 修改戳一致时取出网格的包围盒
+	bool GetBounds(const API_Guid& elemGuid, UInt64 modiStamp, HBIMSpatialIndex::Box& outBox);
+
+	// 存入（或替换）构件的网格
+	void PutMesh(const HBIMElementMesh::Mesh& mesh, UInt64 modiStamp);
+
+	// 有新增网格时重写缓存文件；未保存的项目只保留在内存中。写入失败时网格留在内存中，下次再试
+	void Flush();
+
+}
+
+#endif
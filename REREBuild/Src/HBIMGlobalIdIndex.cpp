@@ -0,0 +1,295 @@
+// *****************************************************************************
+// File:			HBIMGlobalIdIndex.cpp
+// Description:		GlobalId ↔ 构件双向索引：分段建立，构件事件增量维护
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMGlobalIdIndex.hpp"
+#include "HBIMCommon.hpp"
+#include "HBIMEventLoop.hpp"
+#include "HBIMNotifications.hpp"
+#include "HashSet.hpp"
+#include "HashTable.hpp"
+
+#include <chrono>
+
+namespace {
+
+	enum class IndexState {
+		NotBuilt,
+		Building,
+		Ready
+	};
+
+	// 每次事件循环处理的构件数，读取GlobalId约需数十微秒，保证每段不明显卡顿
+	static const UIndex kBuildChunkSize = 2000;
+
+	static GS::HashTable<GS::UniString, API_Guid> s_byGlobalId;
+	static GS::HashTable<API_Guid, GS::UniString> s_byElement;
+	static GS::Array<API_Guid> s_pendingElements;
+	static UIndex s_pendingPos = 0;
+	static IndexState s_state = IndexState::NotBuilt;
+	static UInt32 s_generation = 0;
+	static std::chrono::steady_clock::time_point s_buildStart;
+	// 读取过的构件（含没有GlobalId的）当时的修改戳，接收团队工作更改后据此找出变化的构件
+	static GS::HashTable<API_Guid, UInt64> s_stamps;
+	static bool s_changesReceived = false;		// 建立期间接收了更改，建完后再核对
+
+	static bool IsValidGlobalId(const GS::UniString& globalId) {
+		return !globalId.IsEmpty() && globalId != "未找到";
+	}
+
+	static void RemoveElement(const API_Guid& elemGuid) {
+		s_stamps.Delete(elemGuid);
+		GS::UniString* globalId = s_byElement.GetPtr(elemGuid);
+		if (globalId == nullptr)
+			return;
+
+		// 仅当反向表仍指向该构件时删除（GlobalId重复时以后加入的为准）
+		const API_Guid* indexed = s_byGlobalId.GetPtr(*globalId);
+		if (indexed != nullptr && *indexed == elemGuid)
+			s_byGlobalId.Delete(*globalId);
+		s_byElement.Delete(elemGuid);
+	}
+
+	static void RecordStamp(const API_Guid& elemGuid) {
+		API_Elem_Head elemHead{};
+		elemHead.guid = elemGuid;
+		if (ACAPI_Element_GetHeader(&elemHead) == NoError)
+			s_stamps.Put(elemGuid, elemHead.modiStamp);
+	}
+
+	static GS::UniString IndexElement(const API_Guid& elemGuid, bool attachObserver) {
+		GS::UniString globalId = HBIM::GetGlobalIdForElement(elemGuid);
+		if (!IsValidGlobalId(globalId)) {
+			RecordStamp(elemGuid);
+			return globalId;
+		}
+
+		RemoveElement(elemGuid);
+		s_byGlobalId.Put(globalId, elemGuid);
+		s_byElement.Put(elemGuid, globalId);
+		RecordStamp(elemGuid);
+
+		// 撤销/重做事件中不能修改数据库，此时不挂接观察者
+		if (attachObserver)
+			HBIMNotifications::ObserveElement(elemGuid);
+		return globalId;
+	}
+
+	static void Clear() {
+		++s_generation;
+		s_byGlobalId.Clear();
+		s_byElement.Clear();
+		s_stamps.Clear();
+		s_changesReceived = false;
+		s_pendingElements.Clear();
+		s_pendingPos = 0;
+		s_state = IndexState::NotBuilt;
+	}
+
+	// 接收团队工作更改后：逐个比较构件头中的修改戳（比读取IFC属性快得多），
+	// 只重新读取新增、修改的构件并去掉已删除的构件，不重建整个索引
+	static void DetectReceivedChanges(UInt32 generation) {
+		if (generation != s_generation || s_state != IndexState::Ready)
+			return;
+		s_changesReceived = false;
+		GS::Array<API_Guid> elemGuids;
+		if (ACAPI_Element_GetElemList(API_ZombieElemID, &elemGuids) != NoError)
+			return;
+		GS::HashSet<API_Guid> present;
+		UInt32 updated = 0;
+		for (const API_Guid& elemGuid : elemGuids) {
+			API_Elem_Head elemHead{};
+			elemHead.guid = elemGuid;
+			if (ACAPI_Element_GetHeader(&elemHead) != NoError)
+				continue;
+			present.Add(elemGuid);
+			const UInt64* stamp = s_stamps.GetPtr(elemGuid);
+			if (stamp != nullptr && *stamp == elemHead.modiStamp)
+				continue;
+			IndexElement(elemGuid, true);
+			++updated;
+		}
+		GS::Array<API_Guid> removed;
+		for (auto it = s_stamps.EnumerateKeys(); it != nullptr; ++it) {
+			if (!present.Contains(*it))
+				removed.Push(*it);
+		}
+		for (const API_Guid& elemGuid : removed)
+			RemoveElement(elemGuid);
+		ACAPI_WriteReport("HBIMGlobalIdIndex: 接收更改后更新 %u 个构件，移除 %u 个", false, updated, removed.GetSize());
+	}
+
+	static void ScheduleChangeDetection() {
+		UInt32 generation = s_generation;
+		HBIMEventLoop::Post([generation]() { DetectReceivedChanges(generation); });
+	}
+
+	static void StartBuild() {
+		Clear();
+		s_buildStart = std::chrono::steady_clock::now();
+		if (ACAPI_Element_GetElemList(API_ZombieElemID, &s_pendingElements) != NoError)
+			s_pendingElements.Clear();
+		s_state = IndexState::Building;
+	}
+
+	// 处理最多 maxCount 个待索引构件，返回是否已全部完成
+	static bool ProcessPending(UIndex maxCount) {
+		UIndex end = s_pendingElements.GetSize();
+		if (maxCount < end - s_pendingPos)
+			end = s_pendingPos + maxCount;
+
+		for (; s_pendingPos < end; ++s_pendingPos) {
+			const API_Guid& elemGuid = s_pendingElements[s_pendingPos];
+			// 分段期间已由事件加入的构件不再重复读取
+			if (s_byElement.ContainsKey(elemGuid))
+				continue;
+			IndexElement(elemGuid, true);
+		}
+
+		if (s_pendingPos < s_pendingElements.GetSize())
+			return false;
+
+		s_pendingElements.Clear();
+		s_pendingPos = 0;
+		s_state = IndexState::Ready;
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - s_buildStart).count();
+		ACAPI_WriteReport("HBIMGlobalIdIndex: 索引已建立，%d 个构件，用时 %.2f 秒", false,
+						  static_cast<int>(s_byGlobalId.GetSize()), seconds);
+		if (s_changesReceived)
+			ScheduleChangeDetection();
+		return true;
+	}
+
+	static void BuildStep(UInt32 generation) {
+		if (generation != s_generation || s_state != IndexState::Building)
+			return;
+		if (!ProcessPending(kBuildChunkSize))
+			HBIMEventLoop::Post([generation]() { BuildStep(generation); });
+	}
+
+	static void ScheduleBuild() {
+		StartBuild();
+		UInt32 generation = s_generation;
+		HBIMEventLoop::Post([generation]() { BuildStep(generation); });
+	}
+
+	static void OnProjectEvent(API_NotifyEventID notifID) {
+		switch (notifID) {
+			case APINotify_New:
+			case APINotify_NewAndReset:
+			case APINotify_AllInputFinished:
+				ScheduleBuild();
+				break;
+			case APINotify_ReceiveChanges:
+				// 只更新变化的构件；正在建立时记下，建完后再核对（已读取的构件可能已过期）
+				if (s_state == IndexState::Ready)
+					ScheduleChangeDetection();
+				else if (s_state == IndexState::Building)
+					s_changesReceived = true;
+				break;
+			case APINotify_Open:
+			case APINotify_Close:
+			case APINotify_Quit:
+				// 打开项目时等 AllInputFinished 后再建立
+				Clear();
+				break;
+			default:
+				break;
+		}
+	}
+
+	static void OnElementEvent(const API_NotifyElementType& elemType) {
+		// 尚未开始建立时无需维护，建立时会完整扫描
+		if (s_state == IndexState::NotBuilt)
+			return;
+
+		const API_Guid& elemGuid = elemType.elemHead.guid;
+		switch (elemType.notifID) {
+			case APINotifyElement_New:
+			case APINotifyElement_Copy:
+			case APINotifyElement_Change:
+			case APINotifyElement_Edit:
+			case APINotifyElement_PropertyValueChange:
+				IndexElement(elemGuid, true);
+				break;
+			case APINotifyElement_Undo_Deleted:
+			case APINotifyElement_Redo_Created:
+			case APINotifyElement_Undo_Modified:
+			case APINotifyElement_Redo_Modified:
+				IndexElement(elemGuid, false);
+				break;
+			case APINotifyElement_Delete:
+			case APINotifyElement_Undo_Created:
+			case APINotifyElement_Redo_Deleted:
+				RemoveElement(elemGuid);
+				break;
+			default:
+				break;
+		}
+	}
+
+}
+
+namespace HBIMGlobalIdIndex {
+
+void Initialize() {
+	HBIMNotifications::AddProjectListener(OnProjectEvent);
+	HBIMNotifications::AddElementListener(OnElementEvent);
+	// 插件可能在项目已打开后才加载
+	ScheduleBuild();
+}
+
+void Shutdown() {
+	Clear();
+}
+
+void EnsureBuilt() {
+	if (s_state == IndexState::NotBuilt)
+		StartBuild();
+	if (s_state == IndexState::Building)
+		ProcessPending(s_pendingElements.GetSize());
+}
+
+void Rebuild() {
+	ScheduleBuild();
+}
+
+bool FindElement(const GS::UniString& globalId, API_Guid& outElemGuid) {
+	EnsureBuilt();
+
+	const API_Guid* elemGuid = s_byGlobalId.GetPtr(globalId);
+	if (elemGuid == nullptr)
+		return false;
+
+	// 防御：团队协作接收等情况下可能漏掉删除事件
+	API_Elem_Head elemHead{};
+	elemHead.guid = *elemGuid;
+	if (ACAPI_Element_GetHeader(&elemHead) != NoError) {
+		RemoveElement(elemHead.guid);
+		return false;
+	}
+
+	outElemGuid = *elemGuid;
+	return true;
+}
+
+GS::UniString GetGlobalId(const API_Guid& elemGuid) {
+	const GS::UniString* globalId = s_byElement.GetPtr(elemGuid);
+	if (globalId != nullptr)
+		return *globalId;
+	if (s_state == IndexState::NotBuilt)
+		return HBIM::GetGlobalIdForElement(elemGuid);
+	return IndexElement(elemGuid, true);
+}
+
+bool IsReady() {
+	return s_state == IndexState::Ready;
+}
+
+USize GetSize() {
+	return s_byGlobalId.GetSize();
+}
+
+}
@@ -0,0 +1,37 @@
+#ifndef HBIMGLOBALIDINDEX_HPP
+#define HBIMGLOBALIDINDEX_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+
+// 当前项目的 IFC GlobalId ↔ 构件 API_Guid 双向索引。
+// 打开/新建项目后在主事件循环中分段建立，之后由构件新建/修改/删除事件增量维护；
+// 接收团队工作更改后按修改戳只重新读取变化的构件。
+// 查询为 O(1) 哈希查找。只能在主线程调用。
+namespace HBIMGlobalIdIndex {
+
+	// 在 Initialize 中调用（需在 HBIMNotifications::Initialize 之后）
+	void Initialize();
+
+	// 在 FreeData 中调用
+	void Shutdown();
+
+	// GlobalId → 构件。索引尚未建完时会先同步建完。
+	bool FindElement(const GS::UniString& globalId, API_Guid& outElemGuid);
+
+	// 构件 → GlobalId。未索引的构件直接读取IFC属性并加入索引；
+	// 返回值与 HBIM::GetGlobalIdForElement 一致（无法获取时为"未找到"）
+	GS::UniString GetGlobalId(const API_Guid& elemGuid);
+
+	// 立即完成（或重新）建立索引
+	void EnsureBuilt();
+
+	// 丢弃索引并重新安排分段建立
+	void Rebuild();
+
+	bool IsReady();
+	USize GetSize();
+
+}
+
+#endif
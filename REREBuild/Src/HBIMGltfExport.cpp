@@ -0,0 +1,580 @@
+// *****************************************************************************
+// File:			HBIMGltfExport.cpp
+// Description:		选中构件导出为 GLB：分批并行处理网格、相同网格共用缓冲、流式写出、HBIM属性写入 extras
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMGltfExport.hpp"
+#include "HBIMCommon.hpp"
+#include "HBIMElementMesh.hpp"
+#include "HBIMGlobalIdIndex.hpp"
+#include "HBIMImageDerivatives.hpp"
+#include "HBIMImageStore.hpp"
+#include "HBIMProject.hpp"
+#include "DGModule.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+	static const unsigned kMaxWorkers = 8;
+	// 每次为这么多构件生成三维模型（Archicad 生成的模型占用的内存与此成正比）
+	static const UIndex kBatchElements = 500;
+	// 每批网格的顶点数上限：读出的网格攒到这个数量就并行处理并写出，插件中网格的内存占用与此成正比
+	static const size_t kBatchVertices = 1u << 20;
+	// 相对包围盒角点的顶点坐标取整到 0.1 mm：位置不同的相同构件减去各自角点后的浮点误差被消除，散列才能相同
+	static const double kPositionQuantum = 1e-4;
+	static const char* kExportFileName = "HBIM_Export.glb";
+	static const size_t kCopyBlockBytes = 4u << 20;
+
+	static const UInt32 kGlbMagic = 0x46546C67;			// 'glTF'
+	static const UInt32 kGlbVersion = 2;
+	static const UInt32 kChunkTypeJson = 0x4E4F534A;	// 'JSON'
+	static const UInt32 kChunkTypeBin = 0x004E4942;		// 'BIN\0'
+	static const int kTargetArrayBuffer = 34962;
+	static const int kTargetElementArrayBuffer = 34963;
+	static const int kComponentFloat = 5126;
+	static const int kComponentUInt16 = 5123;
+	static const int kComponentUInt32 = 5125;
+
+	// 一个构件处理后的网格：焊接后的顶点相对 translation（包围盒最小角点），单精度
+	struct PreparedMesh {
+		std::vector<float> positions;
+		std::vector<UInt32> indices;
+		double translation[3] = { 0.0, 0.0, 0.0 };
+		float min[3] = { 0.0f, 0.0f, 0.0f };
+		float max[3] = { 0.0f, 0.0f, 0.0f };
+		UInt64 hash = 0;
+	};
+
+	struct ElementAttributes {
+		GS::UniString globalId;
+		GS::UniString hbimId;
+		GS::UniString hbimDesc;
+		GS::Array<GS::UniString> imageLinks;
+	};
+
+	// 取整后的顶点坐标（kPositionQuantum 的整数倍）
+	struct PositionKey {
+		Int64 x, y, z;
+		bool operator== (const PositionKey& other) const { return x == other.x && y == other.y && z == other.z; }
+	};
+
+	struct PositionKeyHash {
+		size_t operator() (const PositionKey& key) const {
+			UInt64 bits[3];
+			std::memcpy(bits, &key, sizeof(bits));
+			return static_cast<size_t>((bits[0] * 0x9E3779B97F4A7C15ull ^ bits[1]) * 0x9E3779B97F4A7C15ull ^ bits[2]);
+		}
+	};
+
+	static void HashBytes(UInt64& hash, const void* data, size_t bytes) {
+		const unsigned char* p = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < bytes; ++i) {
+			hash ^= p[i];
+			hash *= 1099511628211ull;
+		}
+	}
+
+	// 工作线程：只焊接三角形用到的顶点（ModelerAPI 的各 MeshBody、各凸多边形之间常有坐标相同的顶点），去掉退化三角形。
+	// 顶点按取整后的坐标焊接与散列，写出的单精度坐标也由取整值得到，相同形状的构件得到逐字节相同的缓冲
+	static void PrepareMesh(const HBIMElementMesh::Mesh& mesh, PreparedMesh& out) {
+		const std::vector<double>& positions = mesh.positions;
+		for (int axis = 0; axis < 3; ++axis)
+			out.translation[axis] = std::numeric_limits<double>::max();
+		for (UInt32 corner : mesh.triangles) {
+			for (int axis = 0; axis < 3; ++axis)
+				out.translation[axis] = std::min(out.translation[axis], positions[static_cast<size_t>(corner) * 3 + axis]);
+		}
+
+		std::unordered_map<PositionKey, UInt32, PositionKeyHash> welded;
+		std::vector<UInt32> remap(positions.size() / 3, std::numeric_limits<UInt32>::max());
+		auto weld = [&](UInt32 corner) {
+			if (remap[corner] != std::numeric_limits<UInt32>::max())
+				return remap[corner];
+			const double* p = &positions[static_cast<size_t>(corner) * 3];
+			Int64 q[3];
+			for (int axis = 0; axis < 3; ++axis)
+				q[axis] = std::llround((p[axis] - out.translation[axis]) / kPositionQuantum);
+			const PositionKey key = { q[0], q[1], q[2] };
+			auto inserted = welded.emplace(key, static_cast<UInt32>(out.positions.size() / 3));
+			if (inserted.second) {
+				for (int axis = 0; axis < 3; ++axis)
+					out.positions.push_back(static_cast<float>(q[axis] * kPositionQuantum));
+			}
+			remap[corner] = inserted.first->second;
+			return remap[corner];
+		};
+		for (size_t i = 0; i + 2 < mesh.triangles.size(); i += 3) {
+			const UInt32 a = weld(mesh.triangles[i]), b = weld(mesh.triangles[i + 1]), c = weld(mesh.triangles[i + 2]);
+			if (a == b || b == c || c == a)
+				continue;
+			out.indices.insert(out.indices.end(), { a, b, c });
+		}
+
+		for (int axis = 0; axis < 3; ++axis) {
+			out.min[axis] = std::numeric_limits<float>::max();
+			out.max[axis] = -std::numeric_limits<float>::max();
+		}
+		for (size_t i = 0; i < out.positions.size(); ++i) {
+			out.min[i % 3] = std::min(out.min[i % 3], out.positions[i]);
+			out.max[i % 3] = std::max(out.max[i % 3], out.positions[i]);
+		}
+		out.hash = 14695981039346656037ull;
+		HashBytes(out.hash, out.positions.data(), out.positions.size() * sizeof(float));
+		HashBytes(out.hash, out.indices.data(), out.indices.size() * sizeof(UInt32));
+	}
+
+	template <typename Work>
+	static void RunParallel(size_t itemCount, const Work& work) {
+		const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+		const unsigned workers = static_cast<unsigned>(std::min<size_t>({ hardware, kMaxWorkers, itemCount }));
+		std::atomic<size_t> next(0);
+		auto loop = [&]() {
+			for (size_t i = next++; i < itemCount; i = next++)
+				work(i);
+		};
+		std::vector<std::thread> threads;
+		for (unsigned i = 1; i < workers; ++i)
+			threads.emplace_back(loop);
+		loop();
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+
+	// ---- JSON ----------------------------------------------------------------
+
+	static std::string JsonString(const std::string& text) {
+		std::string out = "\"";
+		for (unsigned char ch : text) {
+			if (ch == '"' || ch == '\\') {
+				out.push_back('\\');
+				out.push_back(static_cast<char>(ch));
+			} else if (ch < 0x20) {
+				char escaped[8];
+				std::snprintf(escaped, sizeof(escaped), "\\u%04x", ch);
+				out.append(escaped);
+			} else {
+				out.push_back(static_cast<char>(ch));
+			}
+		}
+		out.push_back('"');
+		return out;
+	}
+
+	static std::string JsonString(const GS::UniString& text) {
+		return JsonString(std::string(text.ToCStr().Get()));
+	}
+
+	static std::string JsonNumber(double value) {
+		char text[32];
+		std::snprintf(text, sizeof(text), "%.12g", value);
+		return text;
+	}
+
+	static std::string JsonVector(const double values[3]) {
+		return "[" + JsonNumber(values[0]) + "," + JsonNumber(values[1]) + "," + JsonNumber(values[2]) + "]";
+	}
+
+	static void AppendItem(std::string& list, const std::string& item) {
+		if (!list.empty())
+			list.push_back(',');
+		list.append(item);
+	}
+
+	// ---- GLB ----------------------------------------------------------------
+
+	// 临时文件可超过 2 GB，long 在 Windows 上只有 32 位
+	static int SeekFile(std::FILE* file, UInt64 offset, int origin) {
+#if defined(GS_MAC)
+		return fseeko(file, static_cast<off_t>(offset), origin);
+#else
+		return _fseeki64(file, static_cast<__int64>(offset), origin);
+#endif
+	}
+
+	// 顶点与索引缓冲流式写入临时文件，JSON 在内存中拼接（每个构件几百字节），Finish 时拼成 GLB。
+	// 散列相同的网格从临时文件读回已写出的缓冲逐字节比较，不在内存中保留已写出的网格
+	class GltfBuilder {
+	public:
+		~GltfBuilder() {
+			if (bin != nullptr)
+				std::fclose(bin);
+		}
+
+		bool Open(const std::filesystem::path& path) {
+			binPath = path;
+			bin = std::fopen(binPath.string().c_str(), "w+b");
+			return bin != nullptr;
+		}
+
+		bool IsGood() const { return good; }
+		UInt32 GetElementCount() const { return nodeCount; }
+		UInt32 GetMeshCount() const { return meshCount; }
+		UInt32 GetSharedCount() const { return sharedCount; }
+
+		void AddElement(const ElementAttributes& attributes, const std::string& extras, const PreparedMesh& mesh) {
+			if (!good || mesh.indices.empty())
+				return;
+			if (nodeCount == 0) {
+				for (int axis = 0; axis < 3; ++axis)
+					origin[axis] = mesh.translation[axis];
+			}
+			const UInt32 meshIndex = FindOrAddMesh(mesh);
+			double translation[3];
+			for (int axis = 0; axis < 3; ++axis)
+				translation[axis] = mesh.translation[axis] - origin[axis];
+			const GS::UniString& name = attributes.hbimId.IsEmpty() ? attributes.globalId : attributes.hbimId;
+			AppendItem(nodes, "{\"name\":" + JsonString(name) + ",\"mesh\":" + std::to_string(meshIndex) + ",\"translation\":" +
+							  JsonVector(translation) + ",\"extras\":" + extras + "}");
+			++nodeCount;
+		}
+
+		bool Finish(const std::filesystem::path& glbPath, GS::UniString& outError) {
+			const bool closed = std::fclose(bin) == 0;
+			bin = nullptr;
+			if (!good || !closed) {
+				outError = "写入临时文件失败";
+				return false;
+			}
+
+			// glTF 为 Y 轴向上：根节点绕 X 轴转 -90°。构件节点相对第一个构件的位置，避免单精度查看器在远离原点时抖动
+			std::string children;
+			for (UInt32 i = 1; i <= nodeCount; ++i)
+				AppendItem(children, std::to_string(i));
+			const std::string root = "{\"name\":\"HBIM\",\"rotation\":[-0.70710678,0,0,0.70710678],\"children\":[" + children +
+									 "],\"extras\":{\"projectOrigin\":" + JsonVector(origin) + "}}";
+			std::string json = "{\"asset\":{\"version\":\"2.0\",\"generator\":\"HBIM构件信息录入插件\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}]";
+			json += ",\"nodes\":[" + root + "," + nodes + "]";
+			json += ",\"meshes\":[" + meshes + "]";
+			json += ",\"materials\":[{\"name\":\"HBIM\",\"doubleSided\":true,\"pbrMetallicRoughness\":{\"baseColorFactor\":[0.8,0.78,0.74,1],"
+					"\"metallicFactor\":0,\"roughnessFactor\":0.9}}]";
+			json += ",\"accessors\":[" + accessors + "]";
+			json += ",\"bufferViews\":[" + bufferViews + "]";
+			json += ",\"buffers\":[{\"byteLength\":" + std::to_string(binBytes) + "}]}";
+			while (json.size() % 4 != 0)
+				json.push_back(' ');
+
+			const UInt64 totalBytes = 12 + 8 + json.size() + 8 + binBytes;
+			if (totalBytes > std::numeric_limits<UInt32>::max()) {
+				outError = "导出数据超过 GLB 的 4 GB 上限，请分批选择构件导出";
+				return false;
+			}
+
+			std::filesystem::path tempPath = glbPath;
+			tempPath += ".tmp";
+			std::FILE* out = std::fopen(tempPath.string().c_str(), "wb");
+			std::FILE* in = std::fopen(binPath.string().c_str(), "rb");
+			bool ok = out != nullptr && in != nullptr;
+			auto writeWord = [&](UInt32 value) { ok = ok && std::fwrite(&value, sizeof(value), 1, out) == 1; };
+			writeWord(kGlbMagic);
+			writeWord(kGlbVersion);
+			writeWord(static_cast<UInt32>(totalBytes));
+			writeWord(static_cast<UInt32>(json.size()));
+			writeWord(kChunkTypeJson);
+			ok = ok && std::fwrite(json.data(), 1, json.size(), out) == json.size();
+			writeWord(static_cast<UInt32>(binBytes));
+			writeWord(kChunkTypeBin);
+			std::vector<char> block(kCopyBlockBytes);
+			UInt64 copied = 0;
+			while (ok) {
+				const size_t read = std::fread(block.data(), 1, block.size(), in);
+				if (read == 0)
+					break;
+				ok = std::fwrite(block.data(), 1, read, out) == read;
+				copied += read;
+			}
+			ok = ok && copied == binBytes;
+			if (in != nullptr)
+				std::fclose(in);
+			if (out != nullptr)
+				ok = std::fclose(out) == 0 && ok;
+
+			std::error_code ec;
+			std::filesystem::remove(binPath, ec);
+			if (ok) {
+				std::filesystem::rename(tempPath, glbPath, ec);
+				ok = !ec;
+			}
+			if (!ok) {
+				std::filesystem::remove(tempPath, ec);
+				outError = "写入 GLB 文件失败";
+			}
+			return ok;
+		}
+
+		void Abort() {
+			if (bin != nullptr)
+				std::fclose(bin);
+			bin = nullptr;
+			std::error_code ec;
+			std::filesystem::remove(binPath, ec);
+		}
+
+	private:
+		struct KnownMesh {
+			UInt32 mesh;
+			size_t vertexCount;
+			size_t indexCount;
+			UInt64 positionOffset;		// 在临时文件中的位置
+			UInt64 indexOffset;
+		};
+
+		std::filesystem::path binPath;
+		std::FILE* bin = nullptr;
+		UInt64 binBytes = 0;
+		bool good = true;
+		double origin[3] = { 0.0, 0.0, 0.0 };
+		std::string bufferViews, accessors, meshes, nodes;
+		UInt32 bufferViewCount = 0, accessorCount = 0, meshCount = 0, nodeCount = 0, sharedCount = 0;
+		std::unordered_map<UInt64, std::vector<KnownMesh>> known;		// 内容散列 → 已写出的网格
+
+		UInt32 WriteBufferView(const void* data, size_t bytes, int target, UInt64& outOffset) {
+			outOffset = binBytes;
+			good = good && std::fwrite(data, 1, bytes, bin) == bytes;
+			AppendItem(bufferViews, "{\"buffer\":0,\"byteOffset\":" + std::to_string(binBytes) + ",\"byteLength\":" + std::to_string(bytes) +
+										",\"target\":" + std::to_string(target) + "}");
+			binBytes += bytes;
+			// 下一个缓冲从 4 字节边界开始
+			static const char kPadding[4] = { 0, 0, 0, 0 };
+			const size_t padding = (4 - binBytes % 4) % 4;
+			good = good && std::fwrite(kPadding, 1, padding, bin) == padding;
+			binBytes += padding;
+			return bufferViewCount++;
+		}
+
+		// 读回临时文件中 offset 处的 bytes 字节与 data 比较；之后回到文件末尾继续追加
+		bool SameBytes(UInt64 offset, const void* data, size_t bytes) {
+			std::vector<char> written(bytes);
+			bool same = std::fflush(bin) == 0 && SeekFile(bin, offset, SEEK_SET) == 0 &&
+						std::fread(written.data(), 1, bytes, bin) == bytes && std::memcmp(written.data(), data, bytes) == 0;
+			good = good && SeekFile(bin, 0, SEEK_END) == 0;
+			return same;
+		}
+
+		static bool UsesShortIndices(size_t vertexCount) {
+			return vertexCount <= std::numeric_limits<UInt16>::max();
+		}
+
+		// 散列、顶点数与索引数都相同，且已写出的顶点与索引缓冲逐字节相同时视为同一网格
+		UInt32 FindOrAddMesh(const PreparedMesh& mesh) {
+			const size_t vertexCount = mesh.positions.size() / 3;
+			const bool shortIndices = UsesShortIndices(vertexCount);
+			const std::vector<UInt16> shortIndexData = shortIndices ? std::vector<UInt16>(mesh.indices.begin(), mesh.indices.end()) : std::vector<UInt16>();
+			const void* indexData = shortIndices ? static_cast<const void*>(shortIndexData.data()) : static_cast<const void*>(mesh.indices.data());
+			const size_t indexBytes = mesh.indices.size() * (shortIndices ? sizeof(UInt16) : sizeof(UInt32));
+
+			std::vector<KnownMesh>& candidates = known[mesh.hash];
+			for (const KnownMesh& candidate : candidates) {
+				if (candidate.vertexCount == vertexCount && candidate.indexCount == mesh.indices.size() &&
+					SameBytes(candidate.positionOffset, mesh.positions.data(), mesh.positions.size() * sizeof(float)) &&
+					SameBytes(candidate.indexOffset, indexData, indexBytes)) {
+					++sharedCount;
+					return candidate.mesh;
+				}
+			}
+
+			UInt64 positionOffset = 0, indexOffset = 0;
+			const UInt32 positionView = WriteBufferView(mesh.positions.data(), mesh.positions.size() * sizeof(float), kTargetArrayBuffer, positionOffset);
+			const double min[3] = { mesh.min[0], mesh.min[1], mesh.min[2] };
+			const double max[3] = { mesh.max[0], mesh.max[1], mesh.max[2] };
+			AppendItem(accessors, "{\"bufferView\":" + std::to_string(positionView) + ",\"componentType\":" + std::to_string(kComponentFloat) +
+									  ",\"count\":" + std::to_string(vertexCount) + ",\"type\":\"VEC3\",\"min\":" + JsonVector(min) +
+									  ",\"max\":" + JsonVector(max) + "}");
+			const UInt32 positionAccessor = accessorCount++;
+
+			// 顶点不超过 65535 个时用 16 位索引
+			const UInt32 indexView = WriteBufferView(indexData, indexBytes, kTargetElementArrayBuffer, indexOffset);
+			const int componentType = shortIndices ? kComponentUInt16 : kComponentUInt32;
+			AppendItem(accessors, "{\"bufferView\":" + std::to_string(indexView) + ",\"componentType\":" + std::to_string(componentType) +
+									  ",\"count\":" + std::to_string(mesh.indices.size()) + ",\"type\":\"SCALAR\"}");
+			const UInt32 indexAccessor = accessorCount++;
+
+			AppendItem(meshes, "{\"primitives\":[{\"attributes\":{\"POSITION\":" + std::to_string(positionAccessor) + "},\"indices\":" +
+								   std::to_string(indexAccessor) + ",\"material\":0}]}");
+			candidates.push_back({ meshCount, vertexCount, mesh.indices.size(), positionOffset, indexOffset });
+			return meshCount++;
+		}
+	};
+
+	// ---- HBIM属性 ----------------------------------------------------------------
+
+	static GS::UniString StringValueOf(const API_Property& property) {
+		if (property.status != API_Property_HasValue || property.value.variantStatus != API_VariantStatusNormal)
+			return GS::UniString();
+		return property.value.singleVariant.variant.uniStringValue;
+	}
+
+	// 主线程：defGuids 为空时（属性组不存在）只读取 GlobalId 与图片
+	static ElementAttributes ReadAttributes(const API_Guid& elemGuid, const GS::Array<API_Guid>& defGuids) {
+		ElementAttributes attributes;
+		attributes.globalId = HBIMGlobalIdIndex::GetGlobalId(elemGuid);
+		GS::Array<API_Property> properties;
+		if (!defGuids.IsEmpty() && ACAPI_Element_GetPropertyValuesByGuid(elemGuid, defGuids, properties) == NoError && properties.GetSize() == 2) {
+			attributes.hbimId = StringValueOf(properties[0]);
+			attributes.hbimDesc = StringValueOf(properties[1]);
+		}
+		HBIMImageStore::GetActiveStorage().Read(elemGuid, attributes.imageLinks);
+		return attributes;
+	}
+
+	// 图片链接相对项目目录；HEIC/DNG/TIFF 等有派生缩略图时一并给出，网页直接显示缩略图
+	static std::string BuildExtras(const ElementAttributes& attributes, const std::filesystem::path& projectDir) {
+		std::string extras = "{\"GlobalId\":" + JsonString(attributes.globalId);
+		if (!attributes.hbimId.IsEmpty())
+			extras += "," + JsonString(HBIM::kHBIMIdName) + ":" + JsonString(attributes.hbimId);
+		if (!attributes.hbimDesc.IsEmpty())
+			extras += "," + JsonString(HBIM::kHBIMDescName) + ":" + JsonString(attributes.hbimDesc);
+		if (!attributes.imageLinks.IsEmpty()) {
+			std::string images;
+			for (const GS::UniString& link : attributes.imageLinks) {
+				std::string image = "{\"uri\":" + JsonString(link);
+				GS::UniString thumbnailPath;
+				if (HBIMImageDerivatives::GetPath(link, HBIMImageDerivatives::Kind::Thumbnail, thumbnailPath)) {
+					const std::filesystem::path relative = std::filesystem::path(thumbnailPath.ToCStr().Get()).lexically_relative(projectDir);
+					image += ",\"thumbnail\":" + JsonString(relative.generic_string());
+				}
+				AppendItem(images, image + "}");
+			}
+			extras += "," + JsonString(HBIM::kHBIMImageLinksName) + ":[" + images + "]";
+		}
+		return extras + "}";
+	}
+
+}
+
+namespace HBIMGltfExport {
+
+void RunExportCommand() {
+	const HBIMProject::Context& context = HBIMProject::GetContext();
+	if (!context.isSaved) {
+		DG::InformationAlert("导出 glTF", "项目未保存，无法确定图片的相对路径与导出位置。", "确定");
+		return;
+	}
+
+	API_SelectionInfo selInfo = {};
+	GS::Array<API_Neig> selNeigs;
+	const GSErrCode selErr = ACAPI_Selection_Get(&selInfo, &selNeigs, false);
+	BMKillHandle(reinterpret_cast<GSHandle*>(&selInfo.marquee.coords));
+	GS::Array<API_Guid> elemGuids;
+	for (const API_Neig& neig : selNeigs)
+		elemGuids.Push(neig.guid);
+	if (selErr != NoError || elemGuids.IsEmpty()) {
+		DG::InformationAlert("导出 glTF", "请先选择要导出的构件。", "确定");
+		return;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	GS::Array<API_Guid> defGuids;
+	API_Guid groupGuid, idGuid, descGuid;
+	if (HBIM::FindExistingHBIMPropertyGroupAndDefinitions(groupGuid, idGuid, descGuid) == NoError) {
+		defGuids.Push(idGuid);
+		defGuids.Push(descGuid);
+	}
+
+	const std::filesystem::path glbPath = context.projectDir / kExportFileName;
+	std::filesystem::path binPath = glbPath;
+	binPath += ".bin.tmp";
+	GltfBuilder builder;
+	if (!builder.Open(binPath)) {
+		DG::InformationAlert("导出 glTF", "无法在项目目录中创建临时文件。", "确定");
+		return;
+	}
+
+	// 进度窗口：每读出一个构件前进一格，可取消
+	const GS::UniString processTitle = "导出 glTF";
+	Int32 phaseCount = 1;
+	ACAPI_ProcessWindow_InitProcessWindow(&processTitle, &phaseCount);
+	const GS::UniString phaseTitle = "生成三维模型并写出网格";
+	Int32 maxValue = static_cast<Int32>(elemGuids.GetSize());
+	bool showPercent = true;
+	ACAPI_ProcessWindow_SetNextProcessPhase(&phaseTitle, &maxValue, &showPercent);
+	Int32 processed = 0;
+	bool canceled = false;
+
+	std::vector<HBIMElementMesh::Mesh> batch;
+	size_t batchVertices = 0;
+	auto flushBatch = [&]() {
+		std::vector<PreparedMesh> prepared(batch.size());
+		RunParallel(batch.size(), [&](size_t i) { PrepareMesh(batch[i], prepared[i]); });
+		for (size_t i = 0; i < batch.size(); ++i) {
+			const ElementAttributes attributes = ReadAttributes(batch[i].elemGuid, defGuids);
+			builder.AddElement(attributes, BuildExtras(attributes, context.projectDir), prepared[i]);
+		}
+		batch.clear();
+		batchVertices = 0;
+		return builder.IsGood();
+	};
+	// 分批生成三维模型，Archicad 中同时存在的模型只有一批构件
+	GSErrCode err = NoError;
+	for (UIndex first = 0; first < elemGuids.GetSize() && err == NoError && builder.IsGood() && !canceled; first += kBatchElements) {
+		GS::Array<API_Guid> chunk;
+		for (UIndex i = first; i < std::min(first + kBatchElements, elemGuids.GetSize()); ++i)
+			chunk.Push(elemGuids[i]);
+		err = HBIMElementMesh::ForEachMesh(chunk, [&](HBIMElementMesh::Mesh& mesh) {
+			++processed;
+			ACAPI_ProcessWindow_SetProcessValue(&processed);
+			if (ACAPI_ProcessWindow_IsProcessCanceled()) {
+				canceled = true;
+				return false;
+			}
+			batchVertices += mesh.positions.size() / 3;
+			batch.push_back(std::move(mesh));
+			return batchVertices < kBatchVertices || flushBatch();
+		});
+		if (err == NoError && builder.IsGood() && !canceled)
+			flushBatch();
+		// 没有三维模型的构件不经过 visitor，按批补齐进度
+		processed = static_cast<Int32>(first + chunk.GetSize());
+		ACAPI_ProcessWindow_SetProcessValue(&processed);
+	}
+	ACAPI_ProcessWindow_CloseProcessWindow();
+
+	if (canceled) {
+		builder.Abort();
+		ACAPI_WriteReport("HBIMGltfExport: 导出已取消", false);
+		return;
+	}
+
+	GS::UniString error;
+	if (err != NoError) {
+		builder.Abort();
+		error = GS::UniString::Printf("无法生成构件的三维模型 (错误码: %d)", err);
+	} else if (builder.GetElementCount() == 0) {
+		builder.Abort();
+		error = "选中的构件没有三维模型。";
+	} else if (!builder.Finish(glbPath, error)) {
+		builder.Abort();
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (!error.IsEmpty()) {
+		ACAPI_WriteReport("HBIMGltfExport: 导出失败", true);
+		DG::InformationAlert("导出 glTF", error, "确定");
+		return;
+	}
+
+	std::error_code ec;
+	const UInt64 fileBytes = std::filesystem::file_size(glbPath, ec);
+	ACAPI_WriteReport("HBIMGltfExport: 导出 %u 个构件，%u 个网格，%.3f 秒", false, builder.GetElementCount(), builder.GetMeshCount(), seconds);
+	GS::UniString msg = GS::UniString::Printf("已导出 %u 个构件（%u 个不同网格，%u 个构件与其他构件共用网格），文件 %.1f MB，用时 %.1f 秒。\n",
+											  builder.GetElementCount(), builder.GetMeshCount(), builder.GetSharedCount(),
+											  fileBytes / (1024.0 * 1024.0), seconds);
+	if (builder.GetElementCount() < elemGuids.GetSize())
+		msg.Append(GS::UniString::Printf("%u 个选中的构件没有三维模型，未导出。\n", static_cast<UInt32>(elemGuids.GetSize() - builder.GetElementCount())));
+	msg.Append("文件: ");
+	msg.Append(GS::UniString(glbPath.string().c_str(), CC_UTF8));
+	DG::InformationAlert("导出 glTF", msg, "确定");
+}
+
+}
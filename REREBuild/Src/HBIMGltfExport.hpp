@@ -0,0 +1,20 @@
+#ifndef HBIMGLTFEXPORT_HPP
+#define HBIMGLTFEXPORT_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+
+// 选中构件导出为二进制 glTF（.glb），供网页查看已记录的构件。
+// 每次为一批构件生成三维模型（显示进度，可取消），网格经 HBIMElementMesh（ModelerAPI）逐个读出，攒满一批后
+// 由多个线程同时焊接重复顶点、平移到包围盒角点并取整到 0.1 mm、计算内容散列；形状完全相同的构件（如一排相同的柱）
+// 经逐字节核对后共用同一组顶点与索引缓冲，各自的节点只记录平移。每批的缓冲处理完即追加写入临时文件，
+// 最后与 JSON 拼成 GLB；网格与模型的内存只与批大小有关，JSON 随构件数增长。
+// 每个构件节点的 extras 中有 GlobalId、HBIM构件编号与说明、图片链接及缩略图路径（相对项目目录）。
+namespace HBIMGltfExport {
+
+	// 菜单入口：导出选中的构件到项目目录下的 HBIM_Export.glb
+	void RunExportCommand();
+
+}
+
+#endif
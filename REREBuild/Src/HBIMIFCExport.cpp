@@ -0,0 +1,178 @@
+// *****************************************************************************
+// File:			HBIMIFCExport.cpp
+// Description:		IFC导出钩子：按导出前建立的快照批量写出 Pset_HBIM
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMIFCExport.hpp"
+#include "HBIMCommon.hpp"
+#include "HBIMEventLoop.hpp"
+#include "HBIMImageStore.hpp"
+#include "HashTable.hpp"
+
+#include "ACAPI/IFCHookManager.hpp"
+#include "ACAPI/IFCObjectAccessor.hpp"
+#include "ACAPI/IFCProperty.hpp"
+#include "ACAPI/IFCPropertyBuilder.hpp"
+
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace {
+
+	static const GS::UniString kPropertySetName = "Pset_HBIM";
+	static const GS::UniString kImageCountName = "HBIM图片数量";
+
+	// 一个构件导出所需的全部HBIM数据
+	struct ElementSnapshot {
+		GS::UniString hbimId;
+		GS::UniString hbimDesc;
+		GS::Array<GS::UniString> imageLinks;
+	};
+
+	static std::mutex s_snapshotMutex;
+	static GS::HashTable<API_Guid, ElementSnapshot> s_snapshot;
+	static bool s_snapshotReady = false;
+	static bool s_hookRegistered = false;
+
+	static GS::UniString StringValueOf(const API_Property& property) {
+		if (property.status != API_Property_HasValue || property.value.variantStatus != API_VariantStatusNormal)
+			return GS::UniString();
+		return property.value.singleVariant.variant.uniStringValue;
+	}
+
+	// 调用方需持有 s_snapshotMutex
+	static void BuildSnapshot() {
+		auto start = std::chrono::steady_clock::now();
+		s_snapshot.Clear();
+
+		// 图片链接：当前存储后端一次读取全部
+		HBIMImageStore::LinkTable imageLinks;
+		HBIMImageStore::GetActiveStorage().ReadAll(imageLinks);
+		for (auto it = imageLinks.EnumeratePairs(); it != nullptr; ++it) {
+			ElementSnapshot entry;
+			entry.imageLinks = it->value;
+			s_snapshot.Put(it->key, entry);
+		}
+
+		// HBIM属性：属性组不存在时没有任何构件有值；每个构件一次调用读取两个属性
+		API_Guid groupGuid, idGuid, descGuid;
+		if (HBIM::FindExistingHBIMPropertyGroupAndDefinitions(groupGuid, idGuid, descGuid) == NoError) {
+			GS::Array<API_Guid> defGuids;
+			defGuids.Push(idGuid);
+			defGuids.Push(descGuid);
+
+			GS::Array<API_Guid> elemGuids;
+			ACAPI_Element_GetElemList(API_ZombieElemID, &elemGuids);
+			for (const API_Guid& elemGuid : elemGuids) {
+				GS::Array<API_Property> properties;
+				if (ACAPI_Element_GetPropertyValuesByGuid(elemGuid, defGuids, properties) != NoError || properties.GetSize() != 2)
+					continue;
+				GS::UniString hbimId = StringValueOf(properties[0]);
+				GS::UniString hbimDesc = StringValueOf(properties[1]);
+				if (hbimId.IsEmpty() && hbimDesc.IsEmpty())
+					continue;
+				if (!s_snapshot.ContainsKey(elemGuid))
+					s_snapshot.Put(elemGuid, ElementSnapshot());
+				ElementSnapshot& entry = s_snapshot[elemGuid];
+				entry.hbimId = hbimId;
+				entry.hbimDesc = hbimDesc;
+			}
+		}
+
+		s_snapshotReady = true;
+		ACAPI_WriteReport("HBIMIFCExport: 导出快照 %d 个构件，耗时 %.3f 秒", false, static_cast<int>(s_snapshot.GetSize()),
+						  std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+		// 导出过程中不会回到主事件循环；回到时导出已结束，丢弃快照
+		HBIMEventLoop::Post([]() {
+			std::lock_guard<std::mutex> lock(s_snapshotMutex);
+			s_snapshot.Clear();
+			s_snapshotReady = false;
+		});
+	}
+
+	static std::optional<IFCAPI::Value> CreateValue(const IFCAPI::IFCType& valueType, const IFCAPI::AnyValue& anyValue) {
+		auto value = IFCAPI::GetPropertyBuilder().CreateValue(valueType, anyValue);
+		if (value.IsErr())
+			return std::nullopt;
+		return *value;
+	}
+
+	static void AddSingleValue(std::vector<IFCAPI::Property>& properties, const GS::UniString& name, const IFCAPI::IFCType& valueType, const IFCAPI::AnyValue& anyValue) {
+		std::optional<IFCAPI::Value> value = CreateValue(valueType, anyValue);
+		if (!value.has_value())
+			return;
+		auto property = IFCAPI::GetPropertyBuilder().CreatePropertySingleValue(kPropertySetName, name, *value);
+		if (property.IsOk())
+			properties.push_back(*property);
+	}
+
+	// 图片以相对项目目录的URI列表导出（IFC2x3 没有 IfcURIReference，退回 IfcText）
+	static void AddImageLinks(std::vector<IFCAPI::Property>& properties, const GS::Array<GS::UniString>& links) {
+		std::vector<IFCAPI::Value> values;
+		for (const GS::UniString& link : links) {
+			std::optional<IFCAPI::Value> value = CreateValue("IfcURIReference", link);
+			if (!value.has_value())
+				value = CreateValue("IfcText", link);
+			if (value.has_value())
+				values.push_back(*value);
+		}
+		if (values.empty())
+			return;
+		auto property = IFCAPI::GetPropertyBuilder().CreatePropertyListValue(kPropertySetName, HBIM::kHBIMImageLinksName, values);
+		if (property.IsOk())
+			properties.push_back(*property);
+	}
+
+	static void PropertyHook(const IFCAPI::ObjectID& objectID, std::vector<IFCAPI::Property>& properties) {
+		auto elemGuid = IFCAPI::GetObjectAccessor().GetAPIElementID(objectID);
+		if (elemGuid.IsErr() || *elemGuid == APINULLGuid)
+			return;
+
+		std::lock_guard<std::mutex> lock(s_snapshotMutex);
+		if (!s_snapshotReady)
+			BuildSnapshot();
+
+		const ElementSnapshot* entry = s_snapshot.GetPtr(*elemGuid);
+		if (entry == nullptr)
+			return;
+
+		if (!entry->hbimId.IsEmpty())
+			AddSingleValue(properties, HBIM::kHBIMIdName, "IfcIdentifier", entry->hbimId);
+		if (!entry->hbimDesc.IsEmpty())
+			AddSingleValue(properties, HBIM::kHBIMDescName, "IfcText", entry->hbimDesc);
+		if (!entry->imageLinks.IsEmpty()) {
+			AddSingleValue(properties, kImageCountName, "IfcInteger", static_cast<Int64>(entry->imageLinks.GetSize()));
+			AddImageLinks(properties, entry->imageLinks);
+		}
+	}
+
+}
+
+namespace HBIMIFCExport {
+
+void Initialize() {
+	auto result = IFCAPI::GetHookManager().RegisterPropertyHook(PropertyHook);
+	if (result.IsErr()) {
+		ACAPI_WriteReport("HBIMIFCExport: 注册IFC属性钩子失败", true);
+		return;
+	}
+	s_hookRegistered = true;
+	// 注册钩子后插件须保持加载直到注销
+	ACAPI_KeepInMemory(true);
+}
+
+void Shutdown() {
+	if (s_hookRegistered)
+		IFCAPI::GetHookManager().UnregisterPropertyHook();
+	s_hookRegistered = false;
+
+	std::lock_guard<std::mutex> lock(s_snapshotMutex);
+	s_snapshot.Clear();
+	s_snapshotReady = false;
+}
+
+}
@@ -0,0 +1,20 @@
+#ifndef HBIMIFCEXPORT_HPP
+#define HBIMIFCEXPORT_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+
+// IFC导出钩子：为有HBIM数据的构件写出 Pset_HBIM（构件编号、构件说明、图片数量、图片链接）。
+// 导出时第一次回调前一次性读取所有构件的HBIM属性与图片链接（快照），之后每个构件只做哈希查找；
+// 快照在导出结束、回到主事件循环后丢弃，下一次导出重新读取。
+namespace HBIMIFCExport {
+
+	// 在 Initialize 中调用（需在 HBIMEventLoop::Initialize 之后）
+	void Initialize();
+
+	// 在 FreeData 中调用
+	void Shutdown();
+
+}
+
+#endif
@@ -0,0 +1,363 @@
+// *****************************************************************************
+// File:			HBIMImageDerivatives.cpp
+// Description:		HEIC/DNG/TIFF 照片的 JPEG 派生图：后台线程池按目标尺寸解码并转码
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMImageDerivatives.hpp"
+#include "HBIMEventLoop.hpp"
+#include "HBIMNotifications.hpp"
+#include "HBIMProject.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <sys/stat.h>
+
+#if defined(GS_MAC)
+#include <CoreFoundation/CoreFoundation.h>
+#include <ImageIO/ImageIO.h>
+#else
+#include "GXImage.hpp"
+#include "NativeImage.hpp"
+#include "MemoryOChannel.hpp"
+#include <fstream>
+#endif
+
+namespace {
+
+	static const char* kDerivedFolderName = ".derived";
+	static const char* kDerivedExtensions[] = { ".heic", ".heif", ".dng", ".tif", ".tiff" };
+	static const int kDisplayMaxPixels = 2560;
+	static const int kThumbnailMaxPixels = 768;
+	static const double kJpegQuality = 0.85;
+	// 每个线程同一时间只解码一张图片，线程数即同时驻留内存的图片数上限
+	static const unsigned kMaxWorkers = 2;
+
+	struct Job {
+		std::string relativePath;
+		std::string sourcePath;
+		std::string displayPath;
+		std::string thumbnailPath;
+	};
+
+	static std::mutex s_mutex;
+	static std::condition_variable s_wake;
+	static std::deque<Job> s_queue;
+	static std::unordered_set<std::string> s_queued;		// 排队或正在转码的相对路径
+	static std::vector<std::thread> s_workers;
+	static bool s_stop = false;
+	static std::atomic<UInt32> s_batchDone(0);
+	static std::atomic<UInt32> s_batchFailed(0);
+
+	// 只在主线程访问
+	static std::function<void()> s_listener;
+
+	static std::string ToLower(std::string text) {
+		std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return text;
+	}
+
+	static bool GetModTime(const std::string& path, Int64& outModTime) {
+		struct stat st;
+		if (stat(path.c_str(), &st) != 0)
+			return false;
+		outModTime = static_cast<Int64>(st.st_mtime);
+		return true;
+	}
+
+	// 与瓦片缓存相同，按相对路径散列命名
+	static std::filesystem::path DerivedPath(const std::filesystem::path& imageRoot, const std::string& relativePath, HBIMImageDerivatives::Kind kind) {
+		char name[40];
+		snprintf(name, sizeof(name), "%016llx%s.jpg", static_cast<unsigned long long>(std::hash<std::string>()(relativePath)),
+				 kind == HBIMImageDerivatives::Kind::Thumbnail ? "_thumb" : "");
+		return imageRoot / kDerivedFolderName / name;
+	}
+
+	static bool IsFresh(const std::string& derivedPath, Int64 sourceModTime) {
+		Int64 derivedModTime = 0;
+		return GetModTime(derivedPath, derivedModTime) && derivedModTime >= sourceModTime;
+	}
+
+	// 先写临时文件再改名，中途退出不会留下半张图
+	static bool CommitTemp(const std::string& tempPath, const std::string& path) {
+		std::error_code ec;
+		std::filesystem::rename(tempPath, path, ec);
+		if (ec)
+			std::filesystem::remove(tempPath, ec);
+		return !ec;
+	}
+
+#if defined(GS_MAC)
+	template <typename T>
+	struct CFHolder {
+		T ref = nullptr;
+		explicit CFHolder(T value) : ref(value) {}
+		~CFHolder() { if (ref != nullptr) CFRelease(ref); }
+		CFHolder(const CFHolder&) = delete;
+		CFHolder& operator=(const CFHolder&) = delete;
+	};
+
+	static CFURLRef CreateFileURL(const std::string& path) {
+		return CFURLCreateFromFileSystemRepresentation(kCFAllocatorDefault, reinterpret_cast<const UInt8*>(path.c_str()),
+													   static_cast<CFIndex>(path.size()), false);
+	}
+
+	// ImageIO 按目标尺寸解码：不展开整张原图，同时按 EXIF 方向旋转
+	static CGImageRef CreateScaledImage(CGImageSourceRef source, int maxPixels) {
+		int size = maxPixels;
+		CFHolder<CFNumberRef> maxSize(CFNumberCreate(kCFAllocatorDefault, kCFNumberIntType, &size));
+		const void* keys[] = { kCGImageSourceCreateThumbnailFromImageAlways, kCGImageSourceCreateThumbnailWithTransform,
+							   kCGImageSourceThumbnailMaxPixelSize, kCGImageSourceShouldCacheImmediately };
+		const void* values[] = { kCFBooleanTrue, kCFBooleanTrue, maxSize.ref, kCFBooleanTrue };
+		CFHolder<CFDictionaryRef> options(CFDictionaryCreate(kCFAllocatorDefault, keys, values, 4,
+															 &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks));
+		return CGImageSourceCreateThumbnailAtIndex(source, 0, options.ref);
+	}
+
+	static bool WriteJpeg(CGImageRef image, const std::string& path) {
+		const std::string tempPath = path + ".tmp";
+		CFHolder<CFURLRef> url(CreateFileURL(tempPath));
+		if (url.ref == nullptr)
+			return false;
+		CFHolder<CGImageDestinationRef> destination(CGImageDestinationCreateWithURL(url.ref, CFSTR("public.jpeg"), 1, nullptr));
+		if (destination.ref == nullptr)
+			return false;
+		double quality = kJpegQuality;
+		CFHolder<CFNumberRef> qualityNumber(CFNumberCreate(kCFAllocatorDefault, kCFNumberDoubleType, &quality));
+		const void* keys[] = { kCGImageDestinationLossyCompressionQuality };
+		const void* values[] = { qualityNumber.ref };
+		CFHolder<CFDictionaryRef> properties(CFDictionaryCreate(kCFAllocatorDefault, keys, values, 1,
+																&kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks));
+		CGImageDestinationAddImage(destination.ref, image, properties.ref);
+		if (!CGImageDestinationFinalize(destination.ref))
+			return false;
+		return CommitTemp(tempPath, path);
+	}
+
+	static bool Transcode(const Job& job) {
+		CFHolder<CFURLRef> url(CreateFileURL(job.sourcePath));
+		if (url.ref == nullptr)
+			return false;
+		CFHolder<CGImageSourceRef> source(CGImageSourceCreateWithURL(url.ref, nullptr));
+		if (source.ref == nullptr || CGImageSourceGetCount(source.ref) == 0)
+			return false;
+		CFHolder<CGImageRef> display(CreateScaledImage(source.ref, kDisplayMaxPixels));
+		if (display.ref == nullptr || !WriteJpeg(display.ref, job.displayPath))
+			return false;
+		CFHolder<CGImageRef> thumbnail(CreateScaledImage(source.ref, kThumbnailMaxPixels));
+		return thumbnail.ref != nullptr && WriteJpeg(thumbnail.ref, job.thumbnailPath);
+	}
+#else
+	// 其他平台没有按尺寸解码的接口：整图解码后逐级缩小，线程数限制了同时展开的原图数量
+	static bool WriteJpeg(const NewDisplay::NativeImage& image, const std::string& path) {
+		GS::MemoryOChannel channel;
+		if (!image.Encode(channel, NewDisplay::NativeImage::JPEG))
+			return false;
+		const std::string tempPath = path + ".tmp";
+		{
+			std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+			out.write(channel.GetDestination(), static_cast<std::streamsize>(channel.GetDataSize()));
+			if (!out)
+				return false;
+		}
+		return CommitTemp(tempPath, path);
+	}
+
+	static NewDisplay::NativeImage ScaleTo(const NewDisplay::NativeImage& image, int maxPixels) {
+		const double scale = std::min(1.0, static_cast<double>(maxPixels) / std::max(image.GetWidth(), image.GetHeight()));
+		if (scale >= 1.0)
+			return image;
+		return image.Resize(std::max<UInt32>(1, static_cast<UInt32>(image.GetWidth() * scale)),
+							std::max<UInt32>(1, static_cast<UInt32>(image.GetHeight() * scale)));
+	}
+
+	static bool Transcode(const Job& job) {
+		GX::Image image{IO::Location(GS::UniString(job.sourcePath.c_str(), CC_UTF8))};
+		if (image.IsEmpty() || image.GetWidth() == 0 || image.GetHeight() == 0)
+			return false;
+		NewDisplay::NativeImage display = ScaleTo(image.ToNativeImage(1.0, false), kDisplayMaxPixels);
+		if (display == nullptr || !WriteJpeg(display, job.displayPath))
+			return false;
+		NewDisplay::NativeImage thumbnail = ScaleTo(display, kThumbnailMaxPixels);
+		return thumbnail != nullptr && WriteJpeg(thumbnail, job.thumbnailPath);
+	}
+#endif
+
+	static void NotifyReady() {
+		HBIMEventLoop::Post([]() {
+			if (s_listener)
+				s_listener();
+		});
+	}
+
+	static void WorkerLoop() {
+		while (true) {
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(s_mutex);
+				s_wake.wait(lock, []() { return s_stop || !s_queue.empty(); });
+				if (s_stop)
+					return;
+				job = std::move(s_queue.front());
+				s_queue.pop_front();
+			}
+
+			const auto start = std::chrono::steady_clock::now();
+			std::error_code ec;
+			std::filesystem::create_directories(std::filesystem::path(job.displayPath).parent_path(), ec);
+			bool ok = false;
+			try {
+				ok = Transcode(job);
+			} catch (...) {
+				ok = false;
+			}
+			if (ok) {
+				++s_batchDone;
+				HBIMEventLoop::PostReport(false, "HBIMImageDerivatives: 已生成 %s 的派生图，耗时 %.2f 秒", job.relativePath.c_str(),
+										  std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+			} else {
+				++s_batchFailed;
+				HBIMEventLoop::PostReport(false, "HBIMImageDerivatives: 无法转码 %s，预览将直接读取原图", job.relativePath.c_str());
+			}
+
+			bool batchFinished = false;
+			{
+				std::lock_guard<std::mutex> lock(s_mutex);
+				s_queued.erase(job.relativePath);
+				batchFinished = s_queued.empty();
+			}
+			if (batchFinished) {
+				HBIMEventLoop::PostReport(false, "HBIMImageDerivatives: 本批完成 %u 张，失败 %u 张",
+										  s_batchDone.exchange(0), s_batchFailed.exchange(0));
+			}
+			if (ok)
+				NotifyReady();
+		}
+	}
+
+	// 切换项目后旧项目的任务不再需要；正在转码的图片写完即止
+	static void OnProjectEvent(API_NotifyEventID notifID) {
+		switch (notifID) {
+			case APINotify_New:
+			case APINotify_NewAndReset:
+			case APINotify_Open:
+			case APINotify_Close:
+			case APINotify_Quit: {
+				std::lock_guard<std::mutex> lock(s_mutex);
+				for (const Job& job : s_queue)
+					s_queued.erase(job.relativePath);
+				s_queue.clear();
+				break;
+			}
+			default:
+				break;
+		}
+	}
+
+}
+
+namespace HBIMImageDerivatives {
+
+void Initialize() {
+	{
+		std::lock_guard<std::mutex> lock(s_mutex);
+		s_stop = false;
+	}
+	HBIMNotifications::AddProjectListener(OnProjectEvent);
+}
+
+void Shutdown() {
+	{
+		std::lock_guard<std::mutex> lock(s_mutex);
+		s_stop = true;
+		s_queue.clear();
+		s_queued.clear();
+	}
+	s_wake.notify_all();
+	for (std::thread& worker : s_workers) {
+		if (worker.joinable())
+			worker.join();
+	}
+	s_workers.clear();
+	s_listener = nullptr;
+}
+
+bool NeedsDerivatives(const GS::UniString& path) {
+	const std::string extension = ToLower(std::filesystem::path(path.ToCStr().Get()).extension().string());
+	for (const char* candidate : kDerivedExtensions) {
+		if (extension == candidate)
+			return true;
+	}
+	return false;
+}
+
+void Enqueue(const GS::Array<GS::UniString>& relativePaths) {
+	const HBIMProject::Context& context = HBIMProject::GetContext();
+	if (!context.isSaved)
+		return;
+
+	std::vector<Job> jobs;
+	for (const GS::UniString& relativePath : relativePaths) {
+		if (!NeedsDerivatives(relativePath))
+			continue;
+		Job job;
+		job.relativePath = relativePath.ToCStr().Get();
+		Int64 sourceModTime = 0;
+		if (!HBIMProject::BuildFullPath(relativePath, job.sourcePath) || !GetModTime(job.sourcePath, sourceModTime))
+			continue;
+		job.displayPath = DerivedPath(context.imageRoot, job.relativePath, Kind::Display).string();
+		job.thumbnailPath = DerivedPath(context.imageRoot, job.relativePath, Kind::Thumbnail).string();
+		if (IsFresh(job.displayPath, sourceModTime) && IsFresh(job.thumbnailPath, sourceModTime))
+			continue;
+		jobs.push_back(std::move(job));
+	}
+	if (jobs.empty())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(s_mutex);
+		if (s_stop)
+			return;
+		for (Job& job : jobs) {
+			if (!s_queued.insert(job.relativePath).second)
+				continue;
+			s_queue.push_back(std::move(job));
+		}
+		// 线程按需创建，最多 kMaxWorkers 个，之后常驻等待
+		while (s_workers.size() < std::min<size_t>(kMaxWorkers, s_queued.size()))
+			s_workers.emplace_back(WorkerLoop);
+		ACAPI_WriteReport("HBIMImageDerivatives: 排队转码 %u 张图片", false, static_cast<UInt32>(s_queue.size()));
+	}
+	s_wake.notify_all();
+}
+
+bool GetPath(const GS::UniString& relativePath, Kind kind, GS::UniString& outFullPath) {
+	if (!NeedsDerivatives(relativePath))
+		return false;
+	const HBIMProject::Context& context = HBIMProject::GetContext();
+	std::string sourcePath;
+	Int64 sourceModTime = 0;
+	if (!context.isSaved || !HBIMProject::BuildFullPath(relativePath, sourcePath) || !GetModTime(sourcePath, sourceModTime))
+		return false;
+	const std::string derivedPath = DerivedPath(context.imageRoot, relativePath.ToCStr().Get(), kind).string();
+	if (!IsFresh(derivedPath, sourceModTime))
+		return false;
+	outFullPath = GS::UniString(derivedPath.c_str(), CC_UTF8);
+	return true;
+}
+
+void SetReadyListener(const std::function<void()>& listener) {
+	s_listener = listener;
+}
+
+}
@@ -0,0 +1,41 @@
+#ifndef HBIMIMAGEDERIVATIVES_HPP
+#define HBIMIMAGEDERIVATIVES_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+
+#include <functional>
+
+// HEIC/HEIF、DNG 和 TIFF 照片的 JPEG 派生图。
+// 原图原样保存在构件图片文件夹中（图片链接仍指向原图），另在图片文件夹下的 .derived 中生成
+// 一张适合屏幕浏览的 JPEG 和一张缩略图，面板预览使用缩略图，不必每次解码几十 MB 的原图。
+// 转码在固定数量的后台线程中进行，每个线程同一时间只处理一张图片；macOS 上由 ImageIO 按目标尺寸
+// 直接解码（HEIC/JPEG 按块缩小解码，DNG 优先使用内嵌预览），不在内存中展开整张原图。
+namespace HBIMImageDerivatives {
+
+	enum class Kind {
+		Display,		// 长边不超过 2560 像素
+		Thumbnail		// 长边不超过 768 像素
+	};
+
+	// 在 Initialize 中调用
+	void Initialize();
+
+	// 在 FreeData 中调用：丢弃排队的任务并等待正在转码的图片完成
+	void Shutdown();
+
+	// 按扩展名判断是否需要派生图（HEIC/HEIF/DNG/TIF/TIFF）
+	bool NeedsDerivatives(const GS::UniString& path);
+
+	// 主线程调用：为需要派生图且派生图缺失或过期的图片（相对项目目录的路径）排队转码，立即返回
+	void Enqueue(const GS::Array<GS::UniString>& relativePaths);
+
+	// 派生图存在且不早于原图时返回 true 与完整路径
+	bool GetPath(const GS::UniString& relativePath, Kind kind, GS::UniString& outFullPath);
+
+	// 每完成一张图片在主线程调用一次
+	void SetReadyListener(const std::function<void()>& listener);
+
+}
+
+#endif
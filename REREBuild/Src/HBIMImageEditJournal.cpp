@@ -0,0 +1,252 @@
+// *****************************************************************************
+// File:			HBIMImageEditJournal.cpp
+// Description:		图片编辑会话的预写日志：追加写入、批量fsync、启动时恢复
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMImageEditJournal.hpp"
+#include "HBIMCommon.hpp"
+#include "HBIMEventLoop.hpp"
+#include "HBIMImageStore.hpp"
+#include "HBIMImageTombstones.hpp"
+#include "HBIMNotifications.hpp"
+#include "HBIMProject.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#if defined(GS_MAC)
+#include <unistd.h>
+#else
+#include <io.h>
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+	static const char* kJournalFileName = ".edit_journal";
+
+	static int s_fd = -1;
+	static std::filesystem::path s_journalPath;
+	static bool s_dirty = false;		// 有尚未 fsync 的记录
+
+	// ---- 文件描述符：Mac 用 POSIX，Windows 用 CRT 的对应函数（_commit 即 FlushFileBuffers） ----
+
+	static int OpenJournalFile(const std::filesystem::path& path) {
+#if defined(GS_MAC)
+		return open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+#else
+		return _wopen(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#endif
+	}
+
+	static long WriteJournalFile(int fd, const char* data, size_t size) {
+#if defined(GS_MAC)
+		return static_cast<long>(write(fd, data, size));
+#else
+		return _write(fd, data, static_cast<unsigned>(std::min<size_t>(size, INT_MAX)));
+#endif
+	}
+
+	static void SyncJournalFile(int fd) {
+#if defined(GS_MAC)
+		fsync(fd);
+#else
+		_commit(fd);
+#endif
+	}
+
+	static void CloseJournalFile(int fd) {
+#if defined(GS_MAC)
+		close(fd);
+#else
+		_close(fd);
+#endif
+	}
+
+	static bool GetJournalPath(std::filesystem::path& outJournalPath) {
+		const HBIMProject::Context& context = HBIMProject::GetContext();
+		if (!context.isSaved)
+			return false;
+		outJournalPath = context.imageRoot / kJournalFileName;
+		return true;
+	}
+
+	// 每条记录一次 write，进程崩溃时已写入内核的数据不会丢失
+	static void AppendRecord(const std::string& record) {
+		if (s_fd < 0)
+			return;
+		std::string line = record + "\n";
+		const char* data = line.c_str();
+		size_t remaining = line.size();
+		while (remaining > 0) {
+			const long written = WriteJournalFile(s_fd, data, remaining);
+			if (written < 0) {
+				ACAPI_WriteReport("HBIMImageEditJournal: 写入日志失败", true);
+				return;
+			}
+			data += written;
+			remaining -= static_cast<size_t>(written);
+		}
+		s_dirty = true;
+	}
+
+	static void SyncRecords() {
+		if (s_fd >= 0 && s_dirty) {
+			SyncJournalFile(s_fd);
+			s_dirty = false;
+		}
+	}
+
+	static void CloseJournal(bool removeFile) {
+		if (s_fd >= 0) {
+			SyncRecords();
+			CloseJournalFile(s_fd);
+			s_fd = -1;
+		}
+		if (removeFile && !s_journalPath.empty()) {
+			std::error_code ec;
+			std::filesystem::remove(s_journalPath, ec);
+		}
+		s_journalPath.clear();
+	}
+
+	static void EndSession(const char* marker) {
+		if (s_fd < 0)
+			return;
+		AppendRecord(marker);
+		CloseJournal(true);
+	}
+
+	static void OnProjectEvent(API_NotifyEventID notifID) {
+		switch (notifID) {
+			case APINotify_AllInputFinished:
+				HBIMEventLoop::Post(HBIMImageEditJournal::Recover);
+				break;
+			case APINotify_Close:
+			case APINotify_Quit:
+				// 未结束的会话留在磁盘上，下次打开时恢复
+				CloseJournal(false);
+				break;
+			default:
+				break;
+		}
+	}
+
+}
+
+namespace HBIMImageEditJournal {
+
+void Initialize() {
+	HBIMNotifications::AddProjectListener(OnProjectEvent);
+}
+
+void Shutdown() {
+	CloseJournal(false);
+}
+
+GSErrCode BeginSession(const API_Guid& elemGuid, const GS::Array<GS::UniString>& originalPaths) {
+	// 上一个会话未正常结束（例如保存属性失败），按崩溃恢复处理
+	CloseJournal(false);
+	Recover();
+
+	std::filesystem::path journalPath;
+	if (!GetJournalPath(journalPath))
+		return APIERR_GENERAL;
+
+	std::error_code ec;
+	std::filesystem::create_directories(journalPath.parent_path(), ec);
+	s_fd = OpenJournalFile(journalPath);
+	if (s_fd < 0) {
+		ACAPI_WriteReport("HBIMImageEditJournal: 无法创建日志 %s", true, journalPath.string().c_str());
+		return APIERR_GENERAL;
+	}
+	s_journalPath = journalPath;
+
+	std::string record = "BEGIN\t";
+	record += APIGuidToString(elemGuid).ToCStr().Get();
+	record += "\t";
+	record += HBIM::BuildImageLinksJson(originalPaths).ToCStr().Get();
+	AppendRecord(record);
+	return NoError;
+}
+
+void LogAdd(const GS::UniString& relativePath) {
+	AppendRecord(std::string("ADD\t") + relativePath.ToCStr().Get());
+}
+
+void LogRemove(const GS::UniString& relativePath) {
+	AppendRecord(std::string("REMOVE\t") + relativePath.ToCStr().Get());
+}
+
+void Sync() {
+	SyncRecords();
+}
+
+void Commit() {
+	EndSession("COMMIT");
+}
+
+void Abort() {
+	EndSession("ABORT");
+}
+
+void Recover() {
+	// 当前会话正在进行时不处理自己的日志
+	if (s_fd >= 0)
+		return;
+
+	std::filesystem::path journalPath;
+	if (!GetJournalPath(journalPath) || !std::filesystem::exists(journalPath))
+		return;
+
+	API_Guid elemGuid = APINULLGuid;
+	std::vector<std::string> touchedPaths;
+	bool finished = false;
+	{
+		std::ifstream in(journalPath);
+		std::string line;
+		while (std::getline(in, line)) {
+			size_t tab = line.find('\t');
+			std::string kind = line.substr(0, tab);
+			std::string rest = tab == std::string::npos ? std::string() : line.substr(tab + 1);
+			if (kind == "BEGIN") {
+				elemGuid = APIGuidFromString(rest.substr(0, rest.find('\t')).c_str());
+			} else if ((kind == "ADD" || kind == "REMOVE") && !rest.empty()) {
+				touchedPaths.push_back(rest);
+			} else if (kind == "COMMIT" || kind == "ABORT") {
+				finished = true;
+			}
+		}
+	}
+
+	if (!finished && elemGuid != APINULLGuid) {
+		// 以已保存的图片链接为准：仍有的保留（相当于重放），其余回滚
+		GS::Array<GS::UniString> liveLinks;
+		HBIMImageStore::GetActiveStorage().Read(elemGuid, liveLinks);
+
+		UInt32 kept = 0, rolledBack = 0;
+		for (const std::string& path : touchedPaths) {
+			GS::UniString relativePath(path.c_str());
+			if (liveLinks.Contains(relativePath)) {
+				++kept;
+			} else {
+				HBIMImageTombstones::Add(elemGuid, relativePath, false);
+				++rolledBack;
+			}
+		}
+		ACAPI_WriteReport("HBIMImageEditJournal: 恢复未完成的图片编辑，保留 %d，回滚 %d", false,
+						  static_cast<int>(kept), static_cast<int>(rolledBack));
+		if (rolledBack > 0)
+			HBIMImageTombstones::ScheduleCompaction();
+	}
+
+	std::error_code ec;
+	std::filesystem::remove(journalPath, ec);
+}
+
+}
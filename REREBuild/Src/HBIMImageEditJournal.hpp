@@ -0,0 +1,42 @@
+#ifndef HBIMIMAGEEDITJOURNAL_HPP
+#define HBIMIMAGEEDITJOURNAL_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+
+// 图片编辑会话的预写日志 (HBIM_Images_{projectHash}/.edit_journal)。
+// 复制图片前先写入 ADD 记录（write 后即使 Archicad 崩溃也不会丢失），
+// 一批导入结束或提交时才 fsync 一次。下次打开项目时若日志未以 COMMIT/ABORT 结束，
+// 以构件已保存的图片链接属性为准：属性中已有的文件保留，其余记入墓碑日志等待删除。
+namespace HBIMImageEditJournal {
+
+	// 在 Initialize 中调用（需在 HBIMNotifications::Initialize 之后）
+	void Initialize();
+
+	// 在 FreeData 中调用：关闭日志文件（未结束的会话留待下次恢复）
+	void Shutdown();
+
+	// 开始编辑会话；若存在上次未结束的日志，先恢复
+	GSErrCode BeginSession(const API_Guid& elemGuid, const GS::Array<GS::UniString>& originalPaths);
+
+	// 即将复制到图片文件夹的文件（相对项目目录），须在复制之前调用
+	void LogAdd(const GS::UniString& relativePath);
+
+	// 会话中移除的链接
+	void LogRemove(const GS::UniString& relativePath);
+
+	// 把已写入的记录落盘（一批导入结束时调用一次）
+	void Sync();
+
+	// 属性已保存：写入 COMMIT 并结束会话
+	void Commit();
+
+	// 已取消并处理了新增文件：写入 ABORT 并结束会话
+	void Abort();
+
+	// 处理上次未结束的会话（打开项目后自动调用）
+	void Recover();
+
+}
+
+#endif
@@ -0,0 +1,416 @@
+// *****************************************************************************
+// File:			HBIMImageReconciler.cpp
+// Description:		HBIM图片文件夹与图片链接属性的核对：孤立文件、失效链接、重复引用
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMImageReconciler.hpp"
+#include "HBIMCommon.hpp"
+#include "HBIMGlobalIdIndex.hpp"
+#include "HBIMImageStore.hpp"
+#include "HBIMProject.hpp"
+#include "HBIMStatusOverlay.hpp"
+#include "PluginPalette.hpp"
+#include "DGModule.hpp"
+#include "HashSet.hpp"
+#include "HashTable.hpp"
+
+#include <cctype>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <future>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+	static const char* kOrphanFolderName = "_orphans";
+	static const USize kMaxReportedItems = 20;
+
+	using PathMap = GS::HashTable<GS::UniString, GS::UniString>;
+
+	struct FolderScanResult {
+		std::vector<std::string> files;		// 相对项目目录，'/' 分隔
+		std::string error;
+	};
+
+	static std::string ToUtf8(const GS::UniString& str) {
+		return std::string(str.ToCStr(CC_UTF8).Get());
+	}
+
+	static GS::UniString FromUtf8(const std::string& str) {
+		return GS::UniString(str.c_str(), CC_UTF8);
+	}
+
+	// 工作线程：只做文件系统遍历，不调用 Archicad API
+	static FolderScanResult ScanImageFolder(std::filesystem::path projectDir, std::string imageFolderName) {
+		FolderScanResult result;
+		try {
+			std::filesystem::path root = projectDir / imageFolderName;
+			if (!std::filesystem::exists(root))
+				return result;
+
+			std::error_code ec;
+			for (auto it = std::filesystem::recursive_directory_iterator(root, ec);
+				 !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+				const std::filesystem::path& path = it->path();
+				std::string name = path.filename().string();
+				if (it->is_directory()) {
+					// 已隔离的孤立文件和 .tile_cache、.derived 等缓存文件夹不参与核对
+					if (it.depth() == 0 && (name == kOrphanFolderName || (!name.empty() && name[0] == '.')))
+						it.disable_recursion_pending();
+					continue;
+				}
+				if (!it->is_regular_file() || name.empty() || name[0] == '.')
+					continue;
+				result.files.push_back(std::filesystem::relative(path, projectDir).generic_string());
+			}
+			if (ec)
+				result.error = ec.message();
+		} catch (const std::exception& e) {
+			result.error = e.what();
+		}
+		return result;
+	}
+
+	static std::string FileNameOf(const std::string& relativePath) {
+		size_t slash = relativePath.find_last_of('/');
+		return slash == std::string::npos ? relativePath : relativePath.substr(slash + 1);
+	}
+
+	// 去掉扩展名的路径，用于识别 labelme 等工具生成的同名标注文件
+	static std::string StemPathOf(const std::string& relativePath) {
+		size_t slash = relativePath.find_last_of('/');
+		size_t dot = relativePath.find_last_of('.');
+		if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+			return relativePath;
+		return relativePath.substr(0, dot);
+	}
+
+	static bool IsSidecarFile(const std::string& relativePath) {
+		std::string name = FileNameOf(relativePath);
+		size_t dot = name.find_last_of('.');
+		if (dot == std::string::npos)
+			return false;
+		std::string ext = name.substr(dot);
+		for (char& ch : ext) ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+		return ext == ".json";
+	}
+
+	static GS::UniString TimestampForFolder() {
+		std::time_t now = std::time(nullptr);
+		std::tm tmBuf;
+		localtime_r(&now, &tmBuf);
+		char buf[32];
+		std::strftime(buf, sizeof(buf), "%Y%m%d_%H%M%S", &tmBuf);
+		return GS::UniString(buf);
+	}
+
+	static void AppendList(GS::UniString& msg, const char* title, const GS::Array<GS::UniString>& items) {
+		if (items.IsEmpty())
+			return;
+		msg.Append("\n\n");
+		msg.Append(GS::UniString(title, CC_UTF8));
+		for (UIndex i = 0; i < items.GetSize() && i < kMaxReportedItems; ++i) {
+			msg.Append("\n  ");
+			msg.Append(items[i]);
+		}
+		if (items.GetSize() > kMaxReportedItems)
+			msg.Append(GS::UniString::Printf("\n  ……共 %d 项", static_cast<int>(items.GetSize())));
+	}
+
+	static GS::UniString FormatReport(const HBIMImageReconciler::Report& report) {
+		GS::UniString msg;
+		msg.Append("图片文件夹: ");
+		msg.Append(report.imageFolderName);
+		msg.Append(GS::UniString::Printf("\n文件数: %d，构件数: %d，图片链接数: %d",
+										 static_cast<int>(report.scannedFiles), static_cast<int>(report.scannedElements),
+										 static_cast<int>(report.totalLinks)));
+		msg.Append(GS::UniString::Printf("\n\n孤立文件: %d\n失效链接: %d（可找回 %d）\n重复引用: %d",
+										 static_cast<int>(report.orphanFiles.GetSize()),
+										 static_cast<int>(report.missingLinks.GetSize() + report.relinks.GetSize()),
+										 static_cast<int>(report.relinks.GetSize()),
+										 static_cast<int>(report.duplicateLinks.GetSize())));
+		msg.Append(GS::UniString::Printf("\n\n扫描文件夹 %.2f 秒，读取属性 %.2f 秒",
+										 report.folderScanSeconds, report.propertyScanSeconds));
+
+		GS::Array<GS::UniString> missing;
+		for (const HBIMImageReconciler::LinkRef& link : report.missingLinks)
+			missing.Push(link.relativePath);
+		GS::Array<GS::UniString> duplicates;
+		for (const HBIMImageReconciler::LinkRef& link : report.duplicateLinks)
+			duplicates.Push(link.relativePath);
+
+		AppendList(msg, "孤立文件:", report.orphanFiles);
+		AppendList(msg, "失效链接:", missing);
+		AppendList(msg, "重复引用:", duplicates);
+		return msg;
+	}
+
+	static bool HasAnythingToFix(const HBIMImageReconciler::Report& report) {
+		return !report.orphanFiles.IsEmpty() || !report.missingLinks.IsEmpty() ||
+			   !report.relinks.IsEmpty() || !report.duplicateLinks.IsEmpty();
+	}
+
+	// 为共享引用的构件复制一份独立文件到其 GlobalId 文件夹，返回新的相对路径（失败返回空）
+	static GS::UniString CopyForElement(const std::filesystem::path& projectDir, const GS::UniString& imageFolderName,
+										const API_Guid& elemGuid, const GS::UniString& sharedPath) {
+		GS::UniString globalId = HBIMGlobalIdIndex::GetGlobalId(elemGuid);
+		if (globalId.IsEmpty() || globalId == "未找到")
+			return GS::UniString();
+
+		std::string shared = ToUtf8(sharedPath);
+		GS::UniString newPath = imageFolderName + "/" + HBIM::SanitizeForFilePath(globalId) + "/" + FromUtf8(FileNameOf(shared));
+		if (newPath == sharedPath)
+			return GS::UniString();
+
+		try {
+			std::filesystem::path source = projectDir / std::filesystem::path(shared);
+			std::filesystem::path dest = projectDir / std::filesystem::path(ToUtf8(newPath));
+			std::filesystem::create_directories(dest.parent_path());
+			std::filesystem::copy_file(source, dest, std::filesystem::copy_options::skip_existing);
+			return newPath;
+		} catch (const std::exception& e) {
+			ACAPI_WriteReport("HBIMImageReconciler: 复制共享图片失败: %s", true, e.what());
+			return GS::UniString();
+		}
+	}
+
+}
+
+namespace HBIMImageReconciler {
+
+GSErrCode BuildReport(Report& outReport, GS::UniString* outError) {
+	outReport = Report();
+
+	const HBIMProject::Context& context = HBIMProject::GetContext();
+	if (!context.isSaved) {
+		if (outError != nullptr) *outError = "项目未保存，无法定位图片文件夹";
+		return APIERR_GENERAL;
+	}
+	const std::filesystem::path projectDir = context.projectDir;
+	outReport.imageFolderName = context.imageFolderName;
+	const std::string imageFolderName = ToUtf8(outReport.imageFolderName);
+
+	// 文件夹扫描在工作线程进行，与下面主线程读取属性同时执行
+	auto folderStart = std::chrono::steady_clock::now();
+	std::future<FolderScanResult> folderScan = std::async(std::launch::async, ScanImageFolder, projectDir, imageFolderName);
+
+	auto propertyStart = std::chrono::steady_clock::now();
+	GS::Array<API_Guid> elemGuids;
+	ACAPI_Element_GetElemList(API_ZombieElemID, &elemGuids);
+	HBIMImageStore::LinkTable linkTable;
+	GSErrCode readErr = HBIMImageStore::GetActiveStorage().ReadAll(linkTable);
+	if (readErr != NoError) {
+		folderScan.wait();
+		if (outError != nullptr) *outError = GS::UniString::Printf("读取图片链接失败 (错误码: %d)", readErr);
+		return readErr;
+	}
+	for (auto it = linkTable.EnumeratePairs(); it != nullptr; ++it) {
+		ElementLinks entry;
+		entry.elemGuid = it->key;
+		entry.links = it->value;
+		outReport.elementLinks.Push(entry);
+		outReport.totalLinks += it->value.GetSize();
+	}
+	outReport.scannedElements = elemGuids.GetSize();
+	outReport.propertyScanSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - propertyStart).count();
+
+	FolderScanResult folder = folderScan.get();
+	outReport.folderScanSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - folderStart).count();
+	if (!folder.error.empty()) {
+		if (outError != nullptr) *outError = GS::UniString::Printf("扫描图片文件夹失败: %s", folder.error.c_str());
+		return APIERR_GENERAL;
+	}
+	outReport.scannedFiles = static_cast<UInt32>(folder.files.size());
+
+	// 两侧都放进哈希集合，之后每次判断为 O(1)
+	std::unordered_set<std::string> folderFiles(folder.files.begin(), folder.files.end());
+	std::unordered_map<std::string, std::vector<std::string>> filesByName;
+	for (const std::string& file : folder.files)
+		filesByName[FileNameOf(file)].push_back(file);
+
+	std::unordered_map<std::string, API_Guid> firstReference;
+	std::unordered_set<std::string> referenced;
+	const std::string ownPrefix = imageFolderName + "/";
+
+	for (const ElementLinks& entry : outReport.elementLinks) {
+		std::unordered_set<std::string> seenInElement;
+		for (const GS::UniString& link : entry.links) {
+			std::string path = ToUtf8(link);
+
+			bool exists = folderFiles.count(path) > 0;
+			if (!exists && path.compare(0, ownPrefix.size(), ownPrefix) != 0) {
+				// 指向其它图片根目录（如另存为之前的项目）：直接检查文件是否存在
+				std::error_code ec;
+				exists = std::filesystem::is_regular_file(projectDir / std::filesystem::path(path), ec);
+			}
+
+			if (!exists) {
+				auto candidates = filesByName.find(FileNameOf(path));
+				if (candidates != filesByName.end() && candidates->second.size() == 1) {
+					const std::string& found = candidates->second.front();
+					outReport.relinks.Push({ entry.elemGuid, link, FromUtf8(found) });
+					referenced.insert(found);
+				} else {
+					outReport.missingLinks.Push({ entry.elemGuid, link });
+				}
+				continue;
+			}
+
+			referenced.insert(path);
+			if (!seenInElement.insert(path).second) {
+				outReport.duplicateLinks.Push({ entry.elemGuid, link });
+				continue;
+			}
+			auto first = firstReference.emplace(path, entry.elemGuid);
+			if (!first.second && first.first->second != entry.elemGuid)
+				outReport.duplicateLinks.Push({ entry.elemGuid, link });
+		}
+	}
+
+	std::unordered_set<std::string> referencedStems;
+	for (const std::string& path : referenced)
+		referencedStems.insert(StemPathOf(path));
+
+	for (const std::string& file : folder.files) {
+		if (referenced.count(file) > 0)
+			continue;
+		if (IsSidecarFile(file) && referencedStems.count(StemPathOf(file)) > 0)
+			continue;
+		outReport.orphanFiles.Push(FromUtf8(file));
+	}
+
+	return NoError;
+}
+
+GSErrCode ApplyFixes(const Report& report) {
+	std::filesystem::path projectDir;
+	if (!HBIMProject::GetProjectDirectory(projectDir))
+		return APIERR_GENERAL;
+
+	// 按构件汇总要修改的链接
+	GS::HashTable<API_Guid, PathMap> replacements;	// 旧路径 → 新路径（空表示删除）
+	for (const Relink& relink : report.relinks) {
+		if (!replacements.ContainsKey(relink.elemGuid))
+			replacements.Add(relink.elemGuid, PathMap());
+		replacements[relink.elemGuid].Put(relink.oldPath, relink.newPath);
+	}
+	for (const LinkRef& missing : report.missingLinks) {
+		if (!replacements.ContainsKey(missing.elemGuid))
+			replacements.Add(missing.elemGuid, PathMap());
+		replacements[missing.elemGuid].Put(missing.relativePath, GS::UniString());
+	}
+
+	// 共享引用：先复制文件（不可撤销），再在属性中改为各自的副本
+	GS::HashTable<API_Guid, PathMap> copies;
+	for (const LinkRef& duplicate : report.duplicateLinks) {
+		if (!copies.ContainsKey(duplicate.elemGuid))
+			copies.Add(duplicate.elemGuid, PathMap());
+		PathMap& elemCopies = copies[duplicate.elemGuid];
+		if (elemCopies.ContainsKey(duplicate.relativePath))
+			continue;	// 同一构件重复引用：只保留第一次
+		elemCopies.Put(duplicate.relativePath, CopyForElement(projectDir, report.imageFolderName, duplicate.elemGuid, duplicate.relativePath));
+	}
+
+	GSErrCode err = ACAPI_CallUndoableCommand("核对HBIM图片链接",
+		[&]() -> GSErrCode {
+			HBIMImageStore::LinkTable changedLinks;
+			for (const ElementLinks& entry : report.elementLinks) {
+				const PathMap* elemReplacements = replacements.GetPtr(entry.elemGuid);
+				const PathMap* elemCopies = copies.GetPtr(entry.elemGuid);
+				if (elemReplacements == nullptr && elemCopies == nullptr)
+					continue;
+
+				GS::Array<GS::UniString> newLinks;
+				GS::HashSet<GS::UniString> seen;
+				for (const GS::UniString& link : entry.links) {
+					GS::UniString target = link;
+					const GS::UniString* replacement = elemReplacements != nullptr ? elemReplacements->GetPtr(link) : nullptr;
+					if (replacement != nullptr) {
+						target = *replacement;
+					} else if (elemCopies != nullptr && seen.Contains(link)) {
+						continue;	// 同一构件内的重复链接
+					} else if (elemCopies != nullptr) {
+						const GS::UniString* copy = elemCopies->GetPtr(link);
+						if (copy != nullptr && !copy->IsEmpty())
+							target = *copy;
+					}
+					seen.Add(link);
+					if (!target.IsEmpty() && !newLinks.Contains(target))
+						newLinks.Push(target);
+				}
+
+				changedLinks.Put(entry.elemGuid, newLinks);
+			}
+			// 一次批量写入（项目数据后端只编码存储一次）
+			GSErrCode writeErr = HBIMImageStore::GetActiveStorage().WriteAll(changedLinks);
+			if (writeErr == NoError) {
+				GS::Array<API_Guid> changedElements;
+				for (auto it = changedLinks.EnumerateKeys(); it != nullptr; ++it)
+					changedElements.Push(*it);
+				HBIMStatusOverlay::UpdateStatuses(changedElements);
+			}
+			return writeErr;
+		}
+	);
+	if (err != NoError)
+		return err;
+
+	// 孤立文件移入隔离目录，保留相对结构，便于人工找回
+	if (!report.orphanFiles.IsEmpty()) {
+		std::filesystem::path orphanRoot = projectDir / std::filesystem::path(ToUtf8(report.imageFolderName)) /
+										   kOrphanFolderName / ToUtf8(TimestampForFolder());
+		const std::string prefix = ToUtf8(report.imageFolderName) + "/";
+		UInt32 moved = 0;
+		for (const GS::UniString& orphan : report.orphanFiles) {
+			std::string path = ToUtf8(orphan);
+			std::string inner = path.compare(0, prefix.size(), prefix) == 0 ? path.substr(prefix.size()) : FileNameOf(path);
+			try {
+				std::filesystem::path dest = orphanRoot / std::filesystem::path(inner);
+				std::filesystem::create_directories(dest.parent_path());
+				std::filesystem::rename(projectDir / std::filesystem::path(path), dest);
+				++moved;
+			} catch (const std::exception& e) {
+				ACAPI_WriteReport("HBIMImageReconciler: 移动孤立文件失败 %s: %s", true, path.c_str(), e.what());
+			}
+		}
+		ACAPI_WriteReport("HBIMImageReconciler: 已移动 %d 个孤立文件到 %s", false, static_cast<int>(moved), orphanRoot.string().c_str());
+	}
+
+	return NoError;
+}
+
+void RunReconcileCommand() {
+	if (PluginPalette::IsInImageEditMode()) {
+		DG::InformationAlert("提示", "请先完成或取消当前的图片编辑，再核对图片文件夹", "确定");
+		return;
+	}
+
+	Report report;
+	GS::UniString error;
+	GSErrCode err = BuildReport(report, &error);
+	if (err != NoError) {
+		DG::InformationAlert("核对失败", error, "确定");
+		return;
+	}
+
+	GS::UniString summary = FormatReport(report);
+	ACAPI_WriteReport("HBIMImageReconciler: %s", false, summary.ToCStr().Get());
+	if (!HasAnythingToFix(report)) {
+		DG::InformationAlert("HBIM图片文件夹核对", summary + "\n\n图片文件夹与属性一致。", "确定");
+		return;
+	}
+
+	if (DG::WarningAlert("HBIM图片文件夹核对", summary, "修复", "取消") != DG::Accept)
+		return;
+
+	err = ApplyFixes(report);
+	if (err != NoError)
+		DG::InformationAlert("修复失败", GS::UniString::Printf("写入图片链接属性失败 (错误码: %d)", err), "确定");
+}
+
+}
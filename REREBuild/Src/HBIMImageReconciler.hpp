@@ -0,0 +1,54 @@
+#ifndef HBIMIMAGERECONCILER_HPP
+#define HBIMIMAGERECONCILER_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+
+namespace HBIMImageReconciler {
+
+	// 某构件图片链接属性中的一条链接（相对项目目录）
+	struct LinkRef {
+		API_Guid elemGuid = APINULLGuid;
+		GS::UniString relativePath;
+	};
+
+	// 链接的文件已不在原位置，但按文件名在图片文件夹中找到唯一一份
+	struct Relink {
+		API_Guid elemGuid = APINULLGuid;
+		GS::UniString oldPath;
+		GS::UniString newPath;
+	};
+
+	// 构件当前的全部图片链接（修复时整体重写）
+	struct ElementLinks {
+		API_Guid elemGuid = APINULLGuid;
+		GS::Array<GS::UniString> links;
+	};
+
+	struct Report {
+		GS::UniString imageFolderName;		// HBIM_Images_{projectHash}
+		UInt32 scannedFiles = 0;
+		UInt32 scannedElements = 0;
+		UInt32 totalLinks = 0;
+		GS::Array<GS::UniString> orphanFiles;		// 文件夹中没有任何构件引用的文件
+		GS::Array<LinkRef> missingLinks;			// 文件不存在且无法找回的链接
+		GS::Array<Relink> relinks;					// 可按文件名找回的链接
+		GS::Array<LinkRef> duplicateLinks;			// 同一文件被多个构件引用，或同一构件重复引用（第二次及以后）
+		GS::Array<ElementLinks> elementLinks;
+		double folderScanSeconds = 0.0;
+		double propertyScanSeconds = 0.0;
+	};
+
+	// 并行扫描图片文件夹（工作线程）与所有构件的图片链接（主线程，当前存储后端），计算差异
+	GSErrCode BuildReport(Report& outReport, GS::UniString* outError = nullptr);
+
+	// 修复：找回移动的链接、删除失效链接、为重复引用复制独立文件，属性修改在一个可撤销命令中完成；
+	// 孤立文件移到 {图片文件夹}/_orphans/{时间} 下，不直接删除
+	GSErrCode ApplyFixes(const Report& report);
+
+	// 菜单入口：扫描 → 报告 → 确认后修复
+	void RunReconcileCommand();
+
+}
+
+#endif
@@ -0,0 +1,647 @@
+// *****************************************************************************
+// File:			HBIMImageStore.cpp
+// Description:		构件图片链接存储：属性后端与项目数据(ModulData)后端、迁移与读取测试
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMImageStore.hpp"
+#include "HBIMCommon.hpp"
+#include "HBIMNotifications.hpp"
+#include "PluginPalette.hpp"
+#include "DGModule.hpp"
+#include "HashSet.hpp"
+#include "MemoryIChannel32.hpp"
+#include "MemoryOChannel32.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+	static const GS::UniString kModulName = "HBIMImageLinks";
+	static const Int32 kModulDataVersion = 2;
+	static const UInt32 kBlobMagic = 'HBIL';
+
+	static double SecondsSince(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	static void SortGuids(std::vector<API_Guid>& guids) {
+		std::sort(guids.begin(), guids.end(), [](const API_Guid& a, const API_Guid& b) {
+			return std::memcmp(&a, &b, sizeof(API_Guid)) < 0;
+		});
+	}
+
+	// 项目数据块格式：magic, 构件数, 按GUID字节序排序的 {GUID, 链接数, 链接...}；
+	// 版本2 之后再接链接保存在属性中的构件数与按GUID排序的构件GUID
+	static GSErrCode EncodeTable(const HBIMImageStore::LinkTable& table, const GS::HashSet<API_Guid>& propertyElements, GS::OChannel& oc) {
+		std::vector<API_Guid> guids;
+		guids.reserve(table.GetSize());
+		for (auto it = table.EnumeratePairs(); it != nullptr; ++it) {
+			if (!it->value.IsEmpty())
+				guids.push_back(it->key);
+		}
+		SortGuids(guids);
+
+		GSErrCode err = oc.Write(kBlobMagic);
+		if (err == NoError) err = oc.Write(static_cast<UInt32>(guids.size()));
+		for (const API_Guid& guid : guids) {
+			if (err != NoError)
+				break;
+			const GS::Array<GS::UniString>& links = table[guid];
+			err = oc.Write(APIGuid2GSGuid(guid));
+			if (err == NoError) err = oc.Write(static_cast<UInt32>(links.GetSize()));
+			for (UInt32 i = 0; i < links.GetSize() && err == NoError; ++i)
+				err = links[i].Write(oc);
+		}
+
+		std::vector<API_Guid> propertyGuids;
+		propertyGuids.reserve(propertyElements.GetSize());
+		for (const API_Guid& guid : propertyElements)
+			propertyGuids.push_back(guid);
+		SortGuids(propertyGuids);
+		if (err == NoError) err = oc.Write(static_cast<UInt32>(propertyGuids.size()));
+		for (const API_Guid& guid : propertyGuids) {
+			if (err != NoError)
+				break;
+			err = oc.Write(APIGuid2GSGuid(guid));
+		}
+		return err;
+	}
+
+	static GSErrCode DecodeTable(GS::IChannel& ic, Int32 version, HBIMImageStore::LinkTable& outTable, GS::HashSet<API_Guid>& outPropertyElements) {
+		outTable.Clear();
+		outPropertyElements.Clear();
+		UInt32 magic = 0, count = 0;
+		GSErrCode err = ic.Read(magic);
+		if (err != NoError)
+			return err;
+		if (magic != kBlobMagic)
+			return APIERR_BADPARS;
+		err = ic.Read(count);
+		for (UInt32 i = 0; i < count && err == NoError; ++i) {
+			GS::Guid guid;
+			UInt32 linkCount = 0;
+			err = ic.Read(guid);
+			if (err == NoError) err = ic.Read(linkCount);
+			GS::Array<GS::UniString> links;
+			for (UInt32 j = 0; j < linkCount && err == NoError; ++j) {
+				GS::UniString link;
+				err = link.Read(ic);
+				links.Push(link);
+			}
+			if (err == NoError)
+				outTable.Put(GSGuid2APIGuid(guid), links);
+		}
+		if (err != NoError || version < 2)
+			return err;
+
+		UInt32 propertyCount = 0;
+		err = ic.Read(propertyCount);
+		for (UInt32 i = 0; i < propertyCount && err == NoError; ++i) {
+			GS::Guid guid;
+			err = ic.Read(guid);
+			if (err == NoError)
+				outPropertyElements.Add(GSGuid2APIGuid(guid));
+		}
+		return err;
+	}
+
+	// ---------------------------------------------------------------- 照片 → 构件索引
+
+	// 只在主线程访问；第一次查询时读取全部链接建立，之后随写入与构件事件更新
+	static bool s_photoIndexBuilt = false;
+	static HBIMImageStore::LinkTable s_indexedLinks;								// 构件 → 链接
+	static GS::HashTable<GS::UniString, GS::HashSet<API_Guid>> s_photoElements;		// 照片 → 构件
+	static GS::HashSet<API_Guid> s_staleElements;									// 撤销、重做、复制等，查询前重读链接
+
+	static void IndexLinks(const API_Guid& elemGuid, const GS::Array<GS::UniString>& links) {
+		if (!s_photoIndexBuilt)
+			return;
+		const GS::Array<GS::UniString>* oldLinks = s_indexedLinks.GetPtr(elemGuid);
+		if (oldLinks != nullptr) {
+			for (const GS::UniString& link : *oldLinks) {
+				GS::HashSet<API_Guid>* elements = s_photoElements.GetPtr(link);
+				if (elements == nullptr)
+					continue;
+				elements->Delete(elemGuid);
+				if (elements->IsEmpty())
+					s_photoElements.Delete(link);
+			}
+			s_indexedLinks.Delete(elemGuid);
+		}
+		if (links.IsEmpty())
+			return;
+		s_indexedLinks.Add(elemGuid, links);
+		for (const GS::UniString& link : links) {
+			if (!s_photoElements.ContainsKey(link))
+				s_photoElements.Add(link, GS::HashSet<API_Guid>());
+			s_photoElements.Get(link).Add(elemGuid);
+		}
+		// 撤销、重做改变链接时随构件事件重读
+		HBIMNotifications::ObserveElement(elemGuid);
+	}
+
+	static void ClearPhotoIndex() {
+		s_photoIndexBuilt = false;
+		s_indexedLinks.Clear();
+		s_photoElements.Clear();
+		s_staleElements.Clear();
+	}
+
+	// ---------------------------------------------------------------- 属性后端
+
+	class PropertyStorage : public HBIMImageStore::Storage {
+	public:
+		const char* GetName() const override { return "属性"; }
+
+		GSErrCode Read(const API_Guid& elemGuid, GS::Array<GS::UniString>& outLinks) override {
+			outLinks.Clear();
+			API_Guid defGuid;
+			if (!FindDefinition(defGuid))
+				return NoError;		// 属性定义不存在：没有任何构件有图片链接
+			GS::UniString json;
+			GSErrCode err = HBIM::GetHBIMImageLinksPropertyValue(elemGuid, defGuid, json);
+			if (err == NoError)
+				outLinks = HBIM::ParseImageLinksJson(json);
+			return err;
+		}
+
+		GSErrCode Write(const API_Guid& elemGuid, const GS::Array<GS::UniString>& links) override {
+			API_Guid defGuid;
+			GSErrCode err = EnsureDefinition(defGuid);
+			if (err == NoError)
+				err = HBIM::SetHBIMImageLinksPropertyValue(elemGuid, defGuid, HBIM::BuildImageLinksJson(links));
+			if (err == NoError)
+				IndexLinks(elemGuid, links);
+			return err;
+		}
+
+		GSErrCode ReadAll(HBIMImageStore::LinkTable& outTable) override {
+			outTable.Clear();
+			API_Guid defGuid;
+			if (!FindDefinition(defGuid))
+				return NoError;
+			GS::Array<API_Guid> elemGuids;
+			GSErrCode err = ACAPI_Element_GetElemList(API_ZombieElemID, &elemGuids);
+			if (err != NoError)
+				return err;
+			for (const API_Guid& elemGuid : elemGuids) {
+				GS::UniString json;
+				if (HBIM::GetHBIMImageLinksPropertyValue(elemGuid, defGuid, json) != NoError)
+					continue;
+				GS::Array<GS::UniString> links = HBIM::ParseImageLinksJson(json);
+				if (!links.IsEmpty())
+					outTable.Put(elemGuid, links);
+			}
+			return NoError;
+		}
+
+		GSErrCode WriteAll(const HBIMImageStore::LinkTable& table) override {
+			API_Guid defGuid;
+			GSErrCode err = EnsureDefinition(defGuid);
+			for (auto it = table.EnumeratePairs(); it != nullptr && err == NoError; ++it) {
+				err = HBIM::SetHBIMImageLinksPropertyValue(it->key, defGuid, HBIM::BuildImageLinksJson(it->value));
+				if (err == NoError)
+					IndexLinks(it->key, it->value);
+			}
+			return err;
+		}
+
+		// 切换项目或接收团队工作更改时重新查找属性定义
+		void Invalidate() {
+			resolved = false;
+			defGuid = APINULLGuid;
+		}
+
+	private:
+		// 每个项目只查找一次（只查找、不创建）；定义不存在时也记下，直到第一次写入时创建
+		API_Guid defGuid = APINULLGuid;
+		bool resolved = false;
+
+		bool FindDefinition(API_Guid& outDefGuid) {
+			if (!resolved) {
+				if (HBIM::FindExistingHBIMImageLinksDefinition(defGuid) != NoError)
+					defGuid = APINULLGuid;
+				resolved = true;
+			}
+			outDefGuid = defGuid;
+			return defGuid != APINULLGuid;
+		}
+
+		// 写入在撤销作用域内，定义不存在时可以创建
+		GSErrCode EnsureDefinition(API_Guid& outDefGuid) {
+			if (FindDefinition(outDefGuid))
+				return NoError;
+			API_Guid groupGuid;
+			GSErrCode err = HBIM::EnsureHBIMImagePropertyGroupAndDefinitions(groupGuid, outDefGuid);
+			if (err == NoError)
+				defGuid = outDefGuid;
+			return err;
+		}
+	};
+
+	// ---------------------------------------------------------------- 项目数据后端
+
+	// 整张表解码后缓存在内存中，只需在切换项目或接收团队工作更改时作废。
+	// ACAPI_ModulData_Store 不可撤销，所以迁移之后的链接修改（都在可撤销命令中）仍写入属性，
+	// 表中只记下"该构件的链接在属性中"，读取这些构件时改读属性：撤销、重做随属性一起生效，
+	// 而这条记录只增不减，撤销后保留也不影响结果。迁移按两处合并后的链接进行。
+	// 表按构件GUID索引：复制的构件得到新GUID，不带原构件的图片链接；删除的构件的记录留在表中，
+	// 撤销删除后链接随之恢复，但在迁移回属性之前，这些记录引用的图片也不会被核对为孤立文件。
+	class ModulDataStorage : public HBIMImageStore::Storage {
+	public:
+		explicit ModulDataStorage(PropertyStorage& propertyStorage) : propertyStorage(propertyStorage) {}
+
+		const char* GetName() const override { return "项目数据"; }
+
+		GSErrCode Read(const API_Guid& elemGuid, GS::Array<GS::UniString>& outLinks) override {
+			outLinks.Clear();
+			GSErrCode err = Load();
+			if (err != NoError)
+				return err;
+			if (propertyElements.Contains(elemGuid))
+				return propertyStorage.Read(elemGuid, outLinks);
+			const GS::Array<GS::UniString>* links = table.GetPtr(elemGuid);
+			if (links != nullptr)
+				outLinks = *links;
+			return NoError;
+		}
+
+		GSErrCode Write(const API_Guid& elemGuid, const GS::Array<GS::UniString>& links) override {
+			HBIMImageStore::LinkTable entries;
+			entries.Add(elemGuid, links);
+			return WriteAll(entries);
+		}
+
+		GSErrCode ReadAll(HBIMImageStore::LinkTable& outTable) override {
+			GSErrCode err = Load();
+			if (err != NoError)
+				return err;
+			outTable = table;
+			for (const API_Guid& elemGuid : propertyElements) {
+				GS::Array<GS::UniString> links;
+				err = propertyStorage.Read(elemGuid, links);
+				if (err != NoError)
+					return err;
+				if (links.IsEmpty())
+					outTable.Delete(elemGuid);
+				else
+					outTable.Put(elemGuid, links);
+			}
+			return NoError;
+		}
+
+		// 可撤销的修改写入属性；第一次改到某个构件时把它记入表中并存储一次项目数据
+		GSErrCode WriteAll(const HBIMImageStore::LinkTable& entries) override {
+			GSErrCode err = Load();
+			if (err != NoError)
+				return err;
+			err = propertyStorage.WriteAll(entries);
+			if (err != NoError)
+				return err;
+			bool changed = false;
+			for (auto it = entries.EnumeratePairs(); it != nullptr; ++it) {
+				if (propertyElements.Contains(it->key))
+					continue;
+				propertyElements.Add(it->key);
+				table.Delete(it->key);
+				changed = true;
+			}
+			return changed ? Store() : NoError;
+		}
+
+		// 迁移：整张表写入项目数据，属性中不再有链接
+		GSErrCode ReplaceAll(const HBIMImageStore::LinkTable& entries) {
+			table.Clear();
+			propertyElements.Clear();
+			for (auto it = entries.EnumeratePairs(); it != nullptr; ++it) {
+				if (!it->value.IsEmpty())
+					table.Put(it->key, it->value);
+			}
+			loaded = true;
+			return Store();
+		}
+
+		void Invalidate() {
+			loaded = false;
+			table.Clear();
+			propertyElements.Clear();
+		}
+
+		static bool Exists() {
+			API_ModulData info {};
+			return ACAPI_ModulData_GetInfo(&info, kModulName) == NoError;
+		}
+
+		static GSErrCode Delete() {
+			return ACAPI_ModulData_Delete(kModulName);
+		}
+
+	private:
+		PropertyStorage& propertyStorage;
+		HBIMImageStore::LinkTable table;
+		GS::HashSet<API_Guid> propertyElements;		// 链接保存在属性中的构件
+		bool loaded = false;
+
+		GSErrCode Load() {
+			if (loaded)
+				return NoError;
+
+			API_ModulData modulData {};
+			GSErrCode err = ACAPI_ModulData_Get(&modulData, kModulName);
+			if (err == APIERR_NOMODULEDATA) {
+				table.Clear();
+				propertyElements.Clear();
+				loaded = true;
+				return NoError;
+			}
+			if (err != NoError)
+				return err;
+			if (modulData.dataVersion < 1 || modulData.dataVersion > kModulDataVersion) {
+				ACAPI_WriteReport("HBIMImageStore: 不支持的项目数据版本 %d", true, modulData.dataVersion);
+				BMKillHandle(&modulData.dataHdl);
+				return APIERR_BADPARS;
+			}
+
+			GS::MemoryIChannel32 ic(*modulData.dataHdl, BMGetHandleSize(modulData.dataHdl));
+			err = DecodeTable(ic, modulData.dataVersion, table, propertyElements);
+			BMKillHandle(&modulData.dataHdl);
+			if (err != NoError) {
+				ACAPI_WriteReport("HBIMImageStore: 解析项目数据失败: %d", true, err);
+				table.Clear();
+				propertyElements.Clear();
+				return err;
+			}
+			loaded = true;
+			return NoError;
+		}
+
+		GSErrCode Store() {
+			GS::MemoryOChannel32 oc(GS::MemoryOChannel32::BMAllocation);
+			GSErrCode err = EncodeTable(table, propertyElements, oc);
+			if (err != NoError)
+				return err;
+
+			API_ModulData modulData {};
+			modulData.dataVersion = kModulDataVersion;
+			modulData.platformSign = GS::Act_Platform_Sign;
+			modulData.dataHdl = BMAllocateHandle(oc.GetDataSize(), ALLOCATE_CLEAR, 0);
+			if (modulData.dataHdl == nullptr)
+				return APIERR_MEMFULL;
+			BNCopyMemory(*modulData.dataHdl, oc.GetDestination(), oc.GetDataSize());
+			err = ACAPI_ModulData_Store(&modulData, kModulName);
+			BMKillHandle(&modulData.dataHdl);
+			return err;
+		}
+	};
+
+	static PropertyStorage s_propertyStorage;
+	static ModulDataStorage s_modulDataStorage(s_propertyStorage);
+	static bool s_activeResolved = false;
+	static bool s_modulDataActive = false;
+
+	static void OnProjectEvent(API_NotifyEventID notifID) {
+		switch (notifID) {
+			case APINotify_New:
+			case APINotify_NewAndReset:
+			case APINotify_Open:
+			case APINotify_Close:
+			case APINotify_Quit:
+			case APINotify_ReceiveChanges:
+				s_activeResolved = false;
+				s_propertyStorage.Invalidate();
+				s_modulDataStorage.Invalidate();
+				ClearPhotoIndex();
+				break;
+			default:
+				break;
+		}
+	}
+
+	static void OnElementEvent(const API_NotifyElementType& elemType) {
+		if (!s_photoIndexBuilt)
+			return;
+		switch (elemType.notifID) {
+			case APINotifyElement_Copy:
+			case APINotifyElement_Change:
+			case APINotifyElement_Edit:
+			case APINotifyElement_Delete:
+			case APINotifyElement_Undo_Created:
+			case APINotifyElement_Undo_Modified:
+			case APINotifyElement_Undo_Deleted:
+			case APINotifyElement_Redo_Created:
+			case APINotifyElement_Redo_Modified:
+			case APINotifyElement_Redo_Deleted:
+				s_staleElements.Add(elemType.elemHead.guid);
+				break;
+			default:
+				break;
+		}
+	}
+
+	struct BenchmarkResult {
+		UInt32 elements = 0;
+		UInt32 links = 0;
+		double bulkSeconds = 0.0;		// 读取全部
+		double lookupSeconds = 0.0;		// 逐个构件读取
+	};
+
+	static BenchmarkResult RunReads(HBIMImageStore::Storage& storage, const GS::Array<API_Guid>& elemGuids) {
+		BenchmarkResult result;
+		auto bulkStart = std::chrono::steady_clock::now();
+		HBIMImageStore::LinkTable table;
+		storage.ReadAll(table);
+		result.bulkSeconds = SecondsSince(bulkStart);
+		for (auto it = table.EnumeratePairs(); it != nullptr; ++it) {
+			++result.elements;
+			result.links += it->value.GetSize();
+		}
+
+		auto lookupStart = std::chrono::steady_clock::now();
+		GS::Array<GS::UniString> links;
+		for (const API_Guid& elemGuid : elemGuids)
+			storage.Read(elemGuid, links);
+		result.lookupSeconds = SecondsSince(lookupStart);
+		return result;
+	}
+
+	static GS::UniString FormatResult(const char* name, const BenchmarkResult& result, UInt32 totalElements) {
+		const double bulkRate = result.bulkSeconds > 0.0 ? totalElements / result.bulkSeconds : 0.0;
+		const double lookupRate = result.lookupSeconds > 0.0 ? totalElements / result.lookupSeconds : 0.0;
+		return GS::UniString::Printf("%s: 全部读取 %.3f 秒（%.0f 构件/秒，%u 个有图片构件，%u 条链接）；逐个读取 %.3f 秒（%.0f 构件/秒）",
+									 name, result.bulkSeconds, bulkRate, result.elements, result.links, result.lookupSeconds, lookupRate);
+	}
+
+}
+
+namespace HBIMImageStore {
+
+Storage::~Storage() {
+}
+
+void Initialize() {
+	HBIMNotifications::AddProjectListener(OnProjectEvent);
+	HBIMNotifications::AddElementListener(OnElementEvent);
+}
+
+bool IsModulDataActive() {
+	if (!s_activeResolved) {
+		s_modulDataActive = ModulDataStorage::Exists();
+		s_activeResolved = true;
+	}
+	return s_modulDataActive;
+}
+
+Storage& GetActiveStorage() {
+	if (IsModulDataActive())
+		return s_modulDataStorage;
+	return s_propertyStorage;
+}
+
+void GetPhotoElements(const GS::UniString& relativePhotoPath, GS::Array<API_Guid>& outElements) {
+	outElements.Clear();
+	Storage& storage = GetActiveStorage();
+	if (!s_photoIndexBuilt) {
+		LinkTable table;
+		if (storage.ReadAll(table) != NoError)
+			return;
+		s_photoIndexBuilt = true;
+		for (auto it = table.EnumeratePairs(); it != nullptr; ++it)
+			IndexLinks(it->key, it->value);
+		s_staleElements.Clear();
+	}
+	for (const API_Guid& elemGuid : s_staleElements) {
+		// 读取失败（构件已删除）时从索引中去掉
+		GS::Array<GS::UniString> links;
+		if (storage.Read(elemGuid, links) != NoError)
+			links.Clear();
+		IndexLinks(elemGuid, links);
+	}
+	s_staleElements.Clear();
+
+	const GS::HashSet<API_Guid>* elements = s_photoElements.GetPtr(relativePhotoPath);
+	if (elements == nullptr)
+		return;
+	for (const API_Guid& elemGuid : *elements)
+		outElements.Push(elemGuid);
+}
+
+void RunMigrationCommand() {
+	if (PluginPalette::IsInImageEditMode()) {
+		DG::InformationAlert("提示", "请先完成或取消当前的图片编辑，再迁移图片记录", "确定");
+		return;
+	}
+
+	const bool toModulData = !IsModulDataActive();
+	Storage& source = GetActiveStorage();
+	Storage& target = toModulData ? static_cast<Storage&>(s_modulDataStorage) : static_cast<Storage&>(s_propertyStorage);
+
+	auto readStart = std::chrono::steady_clock::now();
+	LinkTable table;
+	GSErrCode err = source.ReadAll(table);
+	if (err != NoError) {
+		DG::InformationAlert("迁移失败", GS::UniString::Printf("读取图片链接失败 (错误码: %d)", err), "确定");
+		return;
+	}
+	const double readSeconds = SecondsSince(readStart);
+
+	UInt32 linkCount = 0;
+	for (auto it = table.EnumeratePairs(); it != nullptr; ++it)
+		linkCount += it->value.GetSize();
+
+	GS::UniString message = GS::UniString::Printf("当前存储：%s\n目标存储：%s\n\n有图片链接的构件：%u\n图片链接：%u\n\n",
+												  source.GetName(), target.GetName(), table.GetSize(), linkCount);
+	message += toModulData ? "迁移后图片链接保存在项目数据中，原属性值将被清空。"
+						   : "迁移后图片链接写回属性，项目数据将被删除。";
+	if (DG::WarningAlert("迁移HBIM图片记录存储", message, "迁移", "取消") != DG::Accept)
+		return;
+
+	auto writeStart = std::chrono::steady_clock::now();
+	err = ACAPI_CallUndoableCommand("迁移HBIM图片记录",
+		[&]() -> GSErrCode {
+			if (!toModulData)
+				return target.WriteAll(table);
+			GSErrCode writeErr = s_modulDataStorage.ReplaceAll(table);
+			if (writeErr != NoError)
+				return writeErr;
+			// 项目数据已写入（已成为当前后端），再清空属性，避免两处数据不一致
+			LinkTable cleared;
+			for (auto it = table.EnumeratePairs(); it != nullptr; ++it)
+				cleared.Put(it->key, GS::Array<GS::UniString>());
+			return s_propertyStorage.WriteAll(cleared);
+		}
+	);
+	// 写回属性成功后才删除项目数据；失败时项目数据仍是当前后端，数据不丢失
+	if (err == NoError && !toModulData)
+		err = ModulDataStorage::Delete();
+	s_activeResolved = false;
+	s_modulDataStorage.Invalidate();
+	ClearPhotoIndex();
+
+	const double writeSeconds = SecondsSince(writeStart);
+	if (err != NoError) {
+		DG::InformationAlert("迁移失败", GS::UniString::Printf("写入图片链接失败 (错误码: %d)", err), "确定");
+		return;
+	}
+
+	GS::UniString summary = GS::UniString::Printf("已将 %u 个构件的 %u 条图片链接迁移到%s（读取 %.2f 秒，写入 %.2f 秒）",
+												  table.GetSize(), linkCount, target.GetName(), readSeconds, writeSeconds);
+	ACAPI_WriteReport("HBIMImageStore: %s", false, summary.ToCStr().Get());
+	DG::InformationAlert("迁移完成", summary, "确定");
+}
+
+void RunBenchmarkCommand() {
+	GS::Array<API_Guid> elemGuids;
+	ACAPI_Element_GetElemList(API_ZombieElemID, &elemGuids);
+	const UInt32 totalElements = elemGuids.GetSize();
+
+	GS::UniString summary = GS::UniString::Printf("构件总数：%u\n当前存储：%s\n\n", totalElements, GetActiveStorage().GetName());
+
+	BenchmarkResult propertyResult = RunReads(s_propertyStorage, elemGuids);
+	summary += FormatResult(s_propertyStorage.GetName(), propertyResult, totalElements);
+	summary += "\n";
+
+	if (ModulDataStorage::Exists()) {
+		// 冷读取：作废缓存，计入 ACAPI_ModulData_Get 与解码
+		s_modulDataStorage.Invalidate();
+		BenchmarkResult modulResult = RunReads(s_modulDataStorage, elemGuids);
+		summary += FormatResult(s_modulDataStorage.GetName(), modulResult, totalElements);
+	} else {
+		// 尚未迁移：用属性中读到的数据编码为同样格式的数据块，测量解码与查找（不写入项目）
+		LinkTable table;
+		s_propertyStorage.ReadAll(table);
+		GS::MemoryOChannel32 oc(GS::MemoryOChannel32::BMAllocation);
+		GS::HashSet<API_Guid> noPropertyElements;
+		EncodeTable(table, noPropertyElements, oc);
+
+		auto decodeStart = std::chrono::steady_clock::now();
+		GS::MemoryIChannel32 ic(oc.GetDestination(), oc.GetDataSize());
+		LinkTable decoded;
+		GS::HashSet<API_Guid> decodedPropertyElements;
+		DecodeTable(ic, kModulDataVersion, decoded, decodedPropertyElements);
+		BenchmarkResult modulResult;
+		modulResult.bulkSeconds = SecondsSince(decodeStart);
+		for (auto it = decoded.EnumeratePairs(); it != nullptr; ++it) {
+			++modulResult.elements;
+			modulResult.links += it->value.GetSize();
+		}
+
+		auto lookupStart = std::chrono::steady_clock::now();
+		UInt32 found = 0;
+		for (const API_Guid& elemGuid : elemGuids) {
+			if (decoded.GetPtr(elemGuid) != nullptr)
+				++found;
+		}
+		modulResult.lookupSeconds = SecondsSince(lookupStart);
+		summary += FormatResult("项目数据（模拟）", modulResult, totalElements);
+		summary += GS::UniString::Printf("\n（模拟数据块 %u 字节，命中 %u 个构件，未写入项目）", static_cast<UInt32>(oc.GetDataSize()), found);
+	}
+
+	ACAPI_WriteReport("HBIMImageStore: 读取测试\n%s", false, summary.ToCStr().Get());
+	DG::InformationAlert("HBIM图片记录读取性能", summary, "确定");
+}
+
+}
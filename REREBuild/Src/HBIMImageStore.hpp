@@ -0,0 +1,57 @@
+#ifndef HBIMIMAGESTORE_HPP
+#define HBIMIMAGESTORE_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+#include "HashTable.hpp"
+
+// 构件图片链接（相对项目目录的路径列表）的存储。两种后端：
+//   - 属性：HBIM构件图片组中的字符串属性，JSON数组（原有方式）
+//   - 项目数据：ACAPI_ModulData 中的一个二进制块，按构件GUID排序的表
+// 项目中存在 HBIMImageLinks 项目数据时使用项目数据后端，否则使用属性后端；
+// 两者之间通过迁移命令一次性转换。项目数据不可撤销，迁移之后的链接修改仍写入属性（见 ModulDataStorage）。
+// 项目数据后端按构件GUID记录：复制出的构件不带原构件的图片链接（属性后端随属性一起复制），
+// 删除构件后其记录仍留在表中。
+namespace HBIMImageStore {
+
+	using LinkTable = GS::HashTable<API_Guid, GS::Array<GS::UniString>>;
+
+	class Storage {
+	public:
+		virtual ~Storage();
+
+		virtual const char* GetName() const = 0;
+
+		// 读取构件的图片链接；没有记录时返回 NoError 和空列表
+		virtual GSErrCode Read(const API_Guid& elemGuid, GS::Array<GS::UniString>& outLinks) = 0;
+
+		// 写入构件的图片链接，空列表表示删除记录（需在 ACAPI_CallUndoableCommand 作用域内调用）
+		virtual GSErrCode Write(const API_Guid& elemGuid, const GS::Array<GS::UniString>& links) = 0;
+
+		// 读取所有有图片链接的构件
+		virtual GSErrCode ReadAll(LinkTable& outTable) = 0;
+
+		// 批量写入表中列出的构件（需在 ACAPI_CallUndoableCommand 作用域内调用）
+		virtual GSErrCode WriteAll(const LinkTable& table) = 0;
+	};
+
+	// 在 Initialize 中调用（需在 HBIMNotifications::Initialize 之后）
+	void Initialize();
+
+	// 当前项目使用的后端（主线程）
+	Storage& GetActiveStorage();
+	bool IsModulDataActive();
+
+	// 链接到一张图片（相对项目目录）的构件（主线程）。第一次调用时读取全部链接建立 照片 → 构件 索引，
+	// 之后随 Storage::Write/WriteAll 与构件事件（撤销、重做、复制、删除）更新，不再读取全部链接
+	void GetPhotoElements(const GS::UniString& relativePhotoPath, GS::Array<API_Guid>& outElements);
+
+	// 菜单入口：在属性与项目数据之间迁移全部图片链接
+	void RunMigrationCommand();
+
+	// 菜单入口：两种后端的批量读取吞吐量测试
+	void RunBenchmarkCommand();
+
+}
+
+#endif
@@ -0,0 +1,231 @@
+// *****************************************************************************
+// File:			HBIMImageTombstones.cpp
+// Description:		图片墓碑日志：记录待删除的图片，保存后在后台确认并删除
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMImageTombstones.hpp"
+#include "HBIMCommon.hpp"
+#include "HBIMEventLoop.hpp"
+#include "HBIMImageStore.hpp"
+#include "HBIMNotifications.hpp"
+#include "HBIMProject.hpp"
+#include "PluginPalette.hpp"
+
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+	static const char* kJournalFileName = ".tombstones";
+
+	// 一行：时间戳 \t 构件GUID \t 相对路径
+	struct Tombstone {
+		std::string timestamp;
+		std::string elemGuid;
+		std::string relativePath;
+
+		std::string ToLine() const {
+			return timestamp + "\t" + elemGuid + "\t" + relativePath;
+		}
+	};
+
+	// 日志文件可能同时被主线程追加和后台线程重写
+	static std::mutex s_journalMutex;
+	static std::future<void> s_worker;
+	static bool s_compactionScheduled = false;
+	// 本次会话中可撤销的删除（日志行）：撤销后图片会重新被引用，关闭项目、撤销记录清空前不删除文件
+	static std::set<std::string> s_undoableLines;
+
+	static bool GetJournalPath(std::filesystem::path& outProjectDir, std::filesystem::path& outJournalPath) {
+		const HBIMProject::Context& context = HBIMProject::GetContext();
+		if (!context.isSaved)
+			return false;
+		outProjectDir = context.projectDir;
+		outJournalPath = context.imageRoot / kJournalFileName;
+		return true;
+	}
+
+	// 调用方需持有 s_journalMutex
+	static std::vector<Tombstone> ReadJournal(const std::filesystem::path& journalPath) {
+		std::vector<Tombstone> entries;
+		std::ifstream in(journalPath);
+		std::string line;
+		while (std::getline(in, line)) {
+			size_t tab1 = line.find('\t');
+			size_t tab2 = tab1 == std::string::npos ? std::string::npos : line.find('\t', tab1 + 1);
+			if (tab2 == std::string::npos)
+				continue;	// 崩溃时可能留下半行
+			entries.push_back({ line.substr(0, tab1), line.substr(tab1 + 1, tab2 - tab1 - 1), line.substr(tab2 + 1) });
+		}
+		return entries;
+	}
+
+	// 调用方需持有 s_journalMutex；先写临时文件再改名，避免中途崩溃损坏日志
+	static void WriteJournal(const std::filesystem::path& journalPath, const std::vector<Tombstone>& entries) {
+		std::error_code ec;
+		if (entries.empty()) {
+			std::filesystem::remove(journalPath, ec);
+			return;
+		}
+		std::filesystem::path tmpPath = journalPath;
+		tmpPath += ".tmp";
+		{
+			std::ofstream out(tmpPath, std::ios::trunc);
+			for (const Tombstone& entry : entries)
+				out << entry.ToLine() << "\n";
+		}
+		std::filesystem::rename(tmpPath, journalPath, ec);
+	}
+
+	// 后台线程：删除文件，然后从日志中去掉已处理的条目（保留处理期间新追加的）
+	static void DeleteAndCompact(std::filesystem::path projectDir, std::filesystem::path journalPath,
+								 std::vector<Tombstone> toDelete, std::set<std::string> processedLines) {
+		for (const Tombstone& entry : toDelete) {
+			std::error_code ec;
+			std::filesystem::remove(projectDir / entry.relativePath, ec);
+			if (ec)
+				processedLines.erase(entry.ToLine());	// 删除失败，下次再试
+		}
+
+		std::lock_guard<std::mutex> lock(s_journalMutex);
+		std::vector<Tombstone> remaining;
+		for (const Tombstone& entry : ReadJournal(journalPath)) {
+			if (processedLines.count(entry.ToLine()) == 0)
+				remaining.push_back(entry);
+		}
+		WriteJournal(journalPath, remaining);
+	}
+
+	// 只有确实读到构件的图片链接且其中没有该图片时才可删除；构件不存在（删除构件也可撤销）
+	// 或读取出错时一律当作仍被引用，保留文件
+	static bool IsStillReferenced(const Tombstone& entry) {
+		API_Guid elemGuid = APIGuidFromString(entry.elemGuid.c_str());
+		API_Elem_Head elemHead{};
+		elemHead.guid = elemGuid;
+		if (elemGuid == APINULLGuid || ACAPI_Element_GetHeader(&elemHead) != NoError)
+			return true;
+
+		GS::Array<GS::UniString> links;
+		if (HBIMImageStore::GetActiveStorage().Read(elemGuid, links) != NoError)
+			return true;
+		GS::UniString path(entry.relativePath.c_str());
+		return links.Contains(path);
+	}
+
+	static void Compact() {
+		s_compactionScheduled = false;
+
+		// 图片编辑中，属性尚未反映最终结果，留到下次
+		if (PluginPalette::IsInImageEditMode())
+			return;
+		// 上一次后台删除尚未结束
+		if (HBIM::IsWorkerRunning(s_worker))
+			return;
+
+		std::filesystem::path projectDir, journalPath;
+		if (!GetJournalPath(projectDir, journalPath))
+			return;
+
+		std::vector<Tombstone> entries;
+		{
+			std::lock_guard<std::mutex> lock(s_journalMutex);
+			entries = ReadJournal(journalPath);
+		}
+		if (entries.empty())
+			return;
+
+		// 引用检查需要 Archicad API，在主线程逐条进行（每条 O(1)）
+		std::vector<Tombstone> toDelete;
+		std::set<std::string> processedLines;
+		UInt32 revived = 0;
+		for (const Tombstone& entry : entries) {
+			if (s_undoableLines.count(entry.ToLine()) != 0)
+				continue;
+			processedLines.insert(entry.ToLine());
+			if (IsStillReferenced(entry)) {
+				++revived;
+				continue;
+			}
+			toDelete.push_back(entry);
+		}
+
+		ACAPI_WriteReport("HBIMImageTombstones: 压缩墓碑日志，待删除 %d，仍被引用 %d", false,
+						  static_cast<int>(toDelete.size()), static_cast<int>(revived));
+		s_worker = std::async(std::launch::async, DeleteAndCompact, projectDir, journalPath, std::move(toDelete), std::move(processedLines));
+	}
+
+	static void OnProjectEvent(API_NotifyEventID notifID) {
+		switch (notifID) {
+			case APINotify_New:
+			case APINotify_NewAndReset:
+			case APINotify_Open:
+			case APINotify_Close:
+			case APINotify_Quit:
+				// 撤销记录随项目关闭而清空；打开后上次会话留下的记录都可以处理
+				s_undoableLines.clear();
+				if (notifID == APINotify_Open)
+					HBIMImageTombstones::ScheduleCompaction();
+				break;
+			case APINotify_Save:
+			case APINotify_ChangeProjectDB:
+				HBIMImageTombstones::ScheduleCompaction();
+				break;
+			default:
+				break;
+		}
+	}
+
+}
+
+namespace HBIMImageTombstones {
+
+void Initialize() {
+	HBIMNotifications::AddProjectListener(OnProjectEvent);
+}
+
+void Shutdown() {
+	if (s_worker.valid())
+		s_worker.wait();
+}
+
+void Add(const API_Guid& elemGuid, const GS::UniString& relativePath, bool undoable) {
+	if (relativePath.IsEmpty())
+		return;
+
+	std::filesystem::path projectDir, journalPath;
+	if (!GetJournalPath(projectDir, journalPath))
+		return;
+
+	char timestamp[32];
+	std::time_t now = std::time(nullptr);
+	std::snprintf(timestamp, sizeof(timestamp), "%lld", static_cast<long long>(now));
+	Tombstone entry = { timestamp, APIGuidToString(elemGuid).ToCStr().Get(), relativePath.ToCStr().Get() };
+
+	try {
+		std::lock_guard<std::mutex> lock(s_journalMutex);
+		std::filesystem::create_directories(journalPath.parent_path());
+		std::ofstream out(journalPath, std::ios::app);
+		out << entry.ToLine() << "\n";
+		if (undoable)
+			s_undoableLines.insert(entry.ToLine());
+	} catch (const std::exception& e) {
+		ACAPI_WriteReport("HBIMImageTombstones: 写入墓碑日志失败: %s", true, e.what());
+	}
+}
+
+void ScheduleCompaction() {
+	if (s_compactionScheduled)
+		return;
+	s_compactionScheduled = true;
+	HBIMEventLoop::Post(Compact);
+}
+
+}
@@ -0,0 +1,29 @@
+#ifndef HBIMIMAGETOMBSTONES_HPP
+#define HBIMIMAGETOMBSTONES_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+
+// 已删除/取消编辑的图片不立即删除文件，而是记入图片文件夹下的墓碑日志
+// (HBIM_Images_{projectHash}/.tombstones)。保存项目、项目数据库变化或打开项目后，
+// 在主事件循环中逐条检查记录构件是否仍引用该图片，确认无引用的文件由后台线程删除并压缩日志；
+// 无需扫描整个图片文件夹。本次会话中可撤销的删除留到项目关闭、撤销记录清空后（下次打开时）再处理，
+// 读取构件或图片链接出错时保留文件。
+namespace HBIMImageTombstones {
+
+	// 在 Initialize 中调用（需在 HBIMNotifications::Initialize 之后）
+	void Initialize();
+
+	// 在 FreeData 中调用：等待正在进行的后台删除结束
+	void Shutdown();
+
+	// 记录一个不再需要的图片（相对项目目录）；elemGuid 为最后引用它的构件。
+	// undoable：图片链接是在可撤销命令中去掉的，本次会话内不删除文件
+	void Add(const API_Guid& elemGuid, const GS::UniString& relativePath, bool undoable);
+
+	// 安排一次压缩（合并多次调用，在主事件循环中执行）
+	void ScheduleCompaction();
+
+}
+
+#endif
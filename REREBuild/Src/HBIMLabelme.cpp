@@ -0,0 +1,325 @@
+// *****************************************************************************
+// File:			HBIMLabelme.cpp
+// Description:		labelme 进程管理：后台查找解释器、启动与回收子进程
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMLabelme.hpp"
+#include "HBIMEventLoop.hpp"
+#include "DGModule.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(GS_MAC)
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <crt_externs.h>
+#endif
+
+namespace {
+
+	static const int kPollMilliseconds = 250;
+	// 启动后在此时间内非正常退出视为该候选不可用
+	static const int kStartupSeconds = 5;
+
+	// 常见安装位置（conda优先）；"~" 开头的相对用户主目录
+	static const char* kCandidateDirs[] = {
+		"/opt/miniconda3/bin",
+		"~/miniconda3/bin",
+		"/opt/anaconda3/bin",
+		"~/anaconda3/bin",
+		"/opt/homebrew/bin",
+		"/usr/local/bin",
+		"~/.local/bin",
+		"/usr/bin"
+	};
+
+	struct Launcher {
+		std::string program;
+		bool moduleMode = false;		// program 为 Python：python -m labelme
+	};
+
+	struct Request {
+		std::string imagePath;
+	};
+
+	struct Child {
+		int pid = 0;
+		Request request;
+		size_t launcherIndex = 0;
+		std::chrono::steady_clock::time_point started;
+	};
+
+	static std::mutex s_mutex;
+	static std::condition_variable s_wake;
+	static std::deque<Request> s_requests;
+	static bool s_stop = false;
+	static std::thread s_supervisor;
+
+	// 只在后台线程访问
+	static std::vector<Launcher> s_launchers;
+	static bool s_resolved = false;
+	static size_t s_currentLauncher = 0;
+	static std::vector<Child> s_children;
+	static std::vector<std::string> s_searchedDirs;
+
+	// 只在主线程访问
+	static HBIMLabelme::StatusListener s_listener;
+
+	// 以下函数都在后台线程执行，日志与通知一律交回主线程
+	static void Notify(const std::string& message, bool failed) {
+		HBIMEventLoop::Post([message, failed]() {
+			ACAPI_WriteReport("HBIMLabelme: %s", false, message.c_str());
+			if (s_listener)
+				s_listener(GS::UniString(message.c_str(), CC_UTF8), failed);
+		});
+	}
+
+	static std::string ExpandHome(const char* dir) {
+		if (dir[0] != '~')
+			return dir;
+		const char* home = std::getenv("HOME");
+		return home != nullptr ? std::string(home) + (dir + 1) : std::string();
+	}
+
+	// labelme 入口脚本首行为 "#!/.../python3.x"，得到安装 labelme 的那个 Python；"#!/usr/bin/env" 形式不处理
+	static std::string ReadShebangInterpreter(const std::filesystem::path& script) {
+		std::ifstream in(script);
+		std::string line;
+		if (!std::getline(in, line) || line.rfind("#!", 0) != 0)
+			return std::string();
+		line.erase(0, 2);
+		const size_t begin = line.find_first_not_of(" \t");
+		if (begin == std::string::npos)
+			return std::string();
+		const size_t end = line.find_first_of(" \t\r", begin);
+		std::string interpreter = line.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+		if (interpreter.find("python") == std::string::npos)
+			return std::string();
+		return interpreter;
+	}
+
+	static bool IsExecutable(const std::string& path) {
+#if defined(GS_MAC)
+		return !path.empty() && access(path.c_str(), X_OK) == 0;
+#else
+		(void)path;
+		return false;
+#endif
+	}
+
+	static void AddLauncher(const std::string& program, bool moduleMode) {
+		if (!IsExecutable(program))
+			return;
+		for (const Launcher& existing : s_launchers) {
+			if (existing.program == program && existing.moduleMode == moduleMode)
+				return;
+		}
+		s_launchers.push_back({ program, moduleMode });
+	}
+
+	// 按优先级列出全部可用的启动方式：脚本所在环境的 Python、同目录的 python/python3、直接执行脚本
+	static void ResolveLaunchers() {
+		if (s_resolved)
+			return;
+		s_resolved = true;
+		for (const char* candidate : kCandidateDirs) {
+			const std::string dir = ExpandHome(candidate);
+			if (dir.empty())
+				continue;
+			s_searchedDirs.push_back(dir);
+			std::error_code ec;
+			const std::filesystem::path script = std::filesystem::path(dir) / "labelme";
+			if (!std::filesystem::exists(script, ec))
+				continue;
+			AddLauncher(ReadShebangInterpreter(script), true);
+			AddLauncher(dir + "/python", true);
+			AddLauncher(dir + "/python3", true);
+			AddLauncher(script.string(), false);
+		}
+		for (const Launcher& launcher : s_launchers)
+			HBIMEventLoop::PostReport(false, "HBIMLabelme: 候选 %s%s", launcher.program.c_str(), launcher.moduleMode ? " -m labelme" : "");
+	}
+
+	static std::string NotFoundMessage() {
+		std::string msg = "未找到可用的 labelme 或启动失败。\n\n"
+						  "请在终端中确认 labelme 已正确安装:\n"
+						  "  which labelme\n"
+						  "  labelme --version\n\n"
+						  "如未安装，请执行:\n"
+						  "  pip install labelme\n\n"
+						  "已搜索路径:";
+		for (const std::string& dir : s_searchedDirs)
+			msg += "\n  " + dir + "/labelme";
+		return msg;
+	}
+
+#if defined(GS_MAC)
+	static bool Spawn(const Launcher& launcher, const Request& request, int& outPid) {
+		std::vector<char*> argv;
+		argv.push_back(const_cast<char*>(launcher.program.c_str()));
+		if (launcher.moduleMode) {
+			argv.push_back(const_cast<char*>("-m"));
+			argv.push_back(const_cast<char*>("labelme"));
+		}
+		argv.push_back(const_cast<char*>(request.imagePath.c_str()));
+		argv.push_back(nullptr);
+
+		pid_t pid = 0;
+		const int ret = posix_spawn(&pid, launcher.program.c_str(), nullptr, nullptr, argv.data(), *_NSGetEnviron());
+		if (ret != 0) {
+			HBIMEventLoop::PostReport(false, "HBIMLabelme: posix_spawn(%s) 失败, errno=%d (%s)", launcher.program.c_str(), ret, strerror(ret));
+			return false;
+		}
+		outPid = static_cast<int>(pid);
+		return true;
+	}
+#else
+	static bool Spawn(const Launcher&, const Request&, int&) {
+		return false;
+	}
+#endif
+
+	// 从当前候选开始依次尝试，直到有一个能创建进程
+	static void Launch(const Request& request) {
+		ResolveLaunchers();
+		while (s_currentLauncher < s_launchers.size()) {
+			Child child;
+			if (Spawn(s_launchers[s_currentLauncher], request, child.pid)) {
+				child.request = request;
+				child.launcherIndex = s_currentLauncher;
+				child.started = std::chrono::steady_clock::now();
+				s_children.push_back(child);
+				HBIMEventLoop::PostReport(false, "HBIMLabelme: 已启动 PID=%d, 照片=%s", child.pid, request.imagePath.c_str());
+				return;
+			}
+			++s_currentLauncher;
+		}
+		Notify(NotFoundMessage(), true);
+	}
+
+	// 新的打开请求：这张照片已在某个 labelme 中打开时只提示，否则启动新的 labelme 直接打开它
+	// （labelme 没有远程控制接口，无法让已在运行的进程切换文件）
+	static void HandleRequest(const Request& request) {
+		for (const Child& child : s_children) {
+			if (child.request.imagePath == request.imagePath) {
+				Notify("labelme 已打开这张照片。", false);
+				return;
+			}
+		}
+		Launch(request);
+	}
+
+	// 回收已退出的子进程；启动后很快非正常退出的，换下一个候选重新启动同一请求
+	static void ReapChildren() {
+#if defined(GS_MAC)
+		std::vector<Request> relaunch;
+		for (size_t i = 0; i < s_children.size();) {
+			const Child child = s_children[i];
+			int status = 0;
+			const pid_t r = waitpid(static_cast<pid_t>(child.pid), &status, WNOHANG);
+			if (r == 0) {
+				++i;
+				continue;
+			}
+			s_children.erase(s_children.begin() + static_cast<std::ptrdiff_t>(i));
+			if (r < 0)
+				continue;
+
+			const bool normalExit = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+			if (normalExit)
+				continue;
+			const int code = WIFEXITED(status) ? WEXITSTATUS(status) : -WTERMSIG(status);
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - child.started).count();
+			HBIMEventLoop::PostReport(false, "HBIMLabelme: PID=%d 退出, exit_code=%d, 运行 %.1f 秒", child.pid, code, seconds);
+			if (seconds < kStartupSeconds) {
+				if (child.launcherIndex == s_currentLauncher)
+					++s_currentLauncher;
+				relaunch.push_back(child.request);
+			} else {
+				Notify("labelme 异常退出（exit_code=" + std::to_string(code) + "），未保存的标注可能丢失。", true);
+			}
+		}
+		// 重新启动的是同一请求，不做已打开判断
+		for (const Request& request : relaunch)
+			Launch(request);
+#endif
+	}
+
+	static void SupervisorLoop() {
+		while (true) {
+			std::deque<Request> requests;
+			{
+				std::unique_lock<std::mutex> lock(s_mutex);
+				auto ready = []() { return s_stop || !s_requests.empty(); };
+				// 没有子进程时只等待新请求
+				if (s_children.empty())
+					s_wake.wait(lock, ready);
+				else
+					s_wake.wait_for(lock, std::chrono::milliseconds(kPollMilliseconds), ready);
+				if (s_stop)
+					return;
+				requests.swap(s_requests);
+			}
+			ReapChildren();
+			for (const Request& request : requests)
+				HandleRequest(request);
+		}
+	}
+
+}
+
+namespace HBIMLabelme {
+
+void Initialize() {
+	std::lock_guard<std::mutex> lock(s_mutex);
+	s_stop = false;
+}
+
+void Shutdown() {
+	{
+		std::lock_guard<std::mutex> lock(s_mutex);
+		s_stop = true;
+		s_requests.clear();
+	}
+	s_wake.notify_all();
+	if (s_supervisor.joinable())
+		s_supervisor.join();
+	s_listener = nullptr;
+}
+
+void SetStatusListener(const StatusListener& listener) {
+	s_listener = listener;
+}
+
+void Open(const GS::UniString& imageFullPath) {
+#if defined(GS_MAC)
+	Request request;
+	request.imagePath = imageFullPath.ToCStr().Get();
+	{
+		std::lock_guard<std::mutex> lock(s_mutex);
+		if (s_stop)
+			return;
+		s_requests.push_back(request);
+		if (!s_supervisor.joinable())
+			s_supervisor = std::thread(SupervisorLoop);
+	}
+	s_wake.notify_all();
+#elif defined (GS_WIN)
+	(void)imageFullPath;
+	DG::InformationAlert("Labelme", "Windows 暂不支持直接启动 labelme", "确定");
+#endif
+}
+
+}
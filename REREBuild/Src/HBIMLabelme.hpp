@@ -0,0 +1,33 @@
+#ifndef HBIMLABELME_HPP
+#define HBIMLABELME_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+
+#include <functional>
+
+// labelme 进程管理。
+// 启动请求交给后台线程处理，界面线程立即返回：第一次请求时查找一次可用的 labelme（读取脚本首行得到
+// 所在 Python 环境），之后沿用；后台线程定期回收已退出的子进程，启动后很快异常退出的改用下一个候选重新启动，
+// 结果经主事件循环通知面板。每个请求用一个新的 labelme 直接打开所选照片，同一张照片已打开时只提示。
+// Windows 与原来一样只提示暂不支持。
+namespace HBIMLabelme {
+
+	// 主线程调用：message 为提示文字，failed 表示启动失败或异常退出
+	using StatusListener = std::function<void(const GS::UniString& message, bool failed)>;
+
+	// 在 Initialize 中调用
+	void Initialize();
+
+	// 在 FreeData 中调用：停止后台线程（不结束已打开的 labelme）
+	void Shutdown();
+
+	// 主线程调用；传入空函数取消
+	void SetStatusListener(const StatusListener& listener);
+
+	// 用 labelme 打开一张图片（完整路径），不等待进程启动
+	void Open(const GS::UniString& imageFullPath);
+
+}
+
+#endif
@@ -0,0 +1,89 @@
+// *****************************************************************************
+// File:			HBIMNotifications.cpp
+// Description:		项目事件/构件事件处理函数的注册与分发
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMNotifications.hpp"
+
+#include <vector>
+
+namespace {
+
+	static const GSFlags kProjectEventMask = API_AllProjectNotificationMask |
+											 APINotify_ReceiveChanges |
+											 APINotify_ChangeProjectDB |
+											 APINotify_AllInputFinished;
+
+	static std::vector<HBIMNotifications::ProjectListener> s_projectListeners;
+	static std::vector<HBIMNotifications::ElementListener> s_elementListeners;
+
+	static GSErrCode ProjectEventHandler(API_NotifyEventID notifID, Int32 /*param*/) {
+		// 复制一份，监听函数内部可以继续订阅
+		std::vector<HBIMNotifications::ProjectListener> listeners = s_projectListeners;
+		for (const HBIMNotifications::ProjectListener& listener : listeners)
+			listener(notifID);
+		return NoError;
+	}
+
+	static GSErrCode ElementEventHandler(const API_NotifyElementType* elemType) {
+		if (elemType == nullptr)
+			return NoError;
+		if (elemType->notifID == APINotifyElement_BeginEvents || elemType->notifID == APINotifyElement_EndEvents)
+			return NoError;
+
+		std::vector<HBIMNotifications::ElementListener> listeners = s_elementListeners;
+		for (const HBIMNotifications::ElementListener& listener : listeners)
+			listener(*elemType);
+		return NoError;
+	}
+
+}
+
+namespace HBIMNotifications {
+
+GSErrCode Initialize() {
+	GSErrCode err = ACAPI_ProjectOperation_CatchProjectEvent(kProjectEventMask, ProjectEventHandler);
+	if (err != NoError) {
+		ACAPI_WriteReport("HBIMNotifications: 注册项目事件失败，错误码=%d", true, err);
+		return err;
+	}
+
+	// 新建/复制构件（所有类型）
+	err = ACAPI_Element_CatchNewElement(nullptr, ElementEventHandler);
+	if (err != NoError) {
+		ACAPI_WriteReport("HBIMNotifications: 注册新建构件事件失败，错误码=%d", true, err);
+		return err;
+	}
+
+	// 已挂接观察者的构件的修改/删除/撤销/重做
+	err = ACAPI_Element_InstallElementObserver(ElementEventHandler);
+	if (err != NoError)
+		ACAPI_WriteReport("HBIMNotifications: 安装构件观察者失败，错误码=%d", true, err);
+	return err;
+}
+
+void Shutdown() {
+	ACAPI_ProjectOperation_CatchProjectEvent(kProjectEventMask, nullptr);
+	ACAPI_Element_CatchNewElement(nullptr, nullptr);
+	ACAPI_Element_InstallElementObserver(nullptr);
+	s_projectListeners.clear();
+	s_elementListeners.clear();
+}
+
+void AddProjectListener(const ProjectListener& listener) {
+	s_projectListeners.push_back(listener);
+}
+
+void AddElementListener(const ElementListener& listener) {
+	s_elementListeners.push_back(listener);
+}
+
+GSErrCode ObserveElement(const API_Guid& elemGuid) {
+	GSErrCode err = ACAPI_Element_AttachObserver(elemGuid);
+	if (err == APIERR_LINKEXIST)
+		return NoError;
+	return err;
+}
+
+}
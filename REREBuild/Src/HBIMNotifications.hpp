@@ -0,0 +1,31 @@
+#ifndef HBIMNOTIFICATIONS_HPP
+#define HBIMNOTIFICATIONS_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+
+#include <functional>
+
+// 项目事件与构件数据库事件的统一分发。
+// 每个插件只能注册一个项目事件处理函数和一个构件事件处理函数，
+// 各模块通过 Add*Listener 订阅，不要再直接调用 ACAPI_ProjectOperation_CatchProjectEvent。
+namespace HBIMNotifications {
+
+	using ProjectListener = std::function<void(API_NotifyEventID notifID)>;
+	using ElementListener = std::function<void(const API_NotifyElementType& elemType)>;
+
+	// 在 Initialize 中调用
+	GSErrCode Initialize();
+
+	// 在 FreeData 中调用：注销处理函数并清空订阅
+	void Shutdown();
+
+	void AddProjectListener(const ProjectListener& listener);
+	void AddElementListener(const ElementListener& listener);
+
+	// 为构件挂接观察者，之后该构件的修改/删除事件才会发给 ElementListener（已挂接时返回 NoError）
+	GSErrCode ObserveElement(const API_Guid& elemGuid);
+
+}
+
+#endif
@@ -0,0 +1,882 @@
+// *****************************************************************************
+// File:			HBIMPhotoMetadata.cpp
+// Description:		HBIM图片拍摄信息：只读文件头的EXIF/XMP解析、并行提取、按列存储的索引
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMPhotoMetadata.hpp"
+#include "HBIMCommon.hpp"
+#include "HBIMEventLoop.hpp"
+#include "HBIMNotifications.hpp"
+#include "HBIMProject.hpp"
+#include "PluginPalette.hpp"
+#include "DGModule.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <sys/stat.h>
+
+#if defined(GS_MAC)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+	static const char* kIndexFileName = ".photo_metadata";
+	static const UInt32 kIndexMagic = 0x4D504248;		// 'HBPM'
+	static const UInt32 kIndexVersion = 1;
+
+	// 每个文件最多映射的字节数；解析遇到图像数据即停止，实际只会读到前几页
+	static const size_t kHeadBytes = 64 * 1024;
+	static const unsigned kMaxWorkers = 8;
+
+	// 一张图片的拍摄信息（工作线程中使用，不含 GS 类型）
+	struct Row {
+		std::string path;				// 相对项目目录
+		Int64 captureTime = 0;
+		std::string camera;
+		double latitude = std::nan("");
+		double longitude = std::nan("");
+		UInt64 fileSize = 0;
+		Int64 modTime = 0;
+	};
+
+	struct Job {
+		std::string relativePath;
+		std::string fullPath;
+	};
+
+	// 列式索引：按路径排序，相机名用字典编号（0 表示无）
+	struct Columns {
+		std::vector<std::string> paths;
+		std::vector<Int64> captureTime;
+		std::vector<UInt32> cameraId;
+		std::vector<std::string> cameras;
+		std::vector<double> latitude;
+		std::vector<double> longitude;
+		std::vector<UInt64> fileSize;
+		std::vector<Int64> modTime;
+
+		size_t Size() const { return paths.size(); }
+	};
+
+	// 只在主线程访问
+	static Columns s_index;
+	static bool s_loaded = false;
+	static std::filesystem::path s_loadedRoot;
+	static std::future<void> s_worker;
+	// 从启动后台扫描到结果交回主线程之间导入的图片：扫描结果不含它们，交回时合并后再写一次索引文件
+	static bool s_rebuildPending = false;
+	static std::vector<Row> s_rowsDuringRebuild;
+	// 每次保存用不同的临时文件名，主线程与工作线程同时保存时不会互相覆盖
+	static std::atomic<UInt32> s_saveCounter(0);
+
+	// ---- 日期 ----------------------------------------------------------------
+
+	// 公历日期 → 1970-01-01 起的天数（H. Hinnant 算法）
+	static Int64 DaysFromCivil(Int64 y, unsigned m, unsigned d) {
+		y -= m <= 2;
+		const Int64 era = (y >= 0 ? y : y - 399) / 400;
+		const unsigned yoe = static_cast<unsigned>(y - era * 400);
+		const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+		const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+		return era * 146097 + static_cast<Int64>(doe) - 719468;
+	}
+
+	static void CivilFromDays(Int64 z, Int64& y, unsigned& m, unsigned& d) {
+		z += 719468;
+		const Int64 era = (z >= 0 ? z : z - 146096) / 146097;
+		const unsigned doe = static_cast<unsigned>(z - era * 146097);
+		const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+		const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+		const unsigned mp = (5 * doy + 2) / 153;
+		d = doy - (153 * mp + 2) / 5 + 1;
+		m = mp < 10 ? mp + 3 : mp - 9;
+		y = static_cast<Int64>(yoe) + era * 400 + (m <= 2);
+	}
+
+	// "YYYY:MM:DD HH:MM:SS"（EXIF）或 "YYYY-MM-DDTHH:MM:SS"（XMP），时间部分可省略
+	static Int64 ParseDateTime(std::string_view text) {
+		int fields[6] = { 0, 0, 0, 0, 0, 0 };
+		int count = 0;
+		size_t i = 0;
+		while (i < text.size() && count < 6) {
+			if (text[i] < '0' || text[i] > '9') {
+				// 时区或小数秒之后的内容不再解析
+				if (count >= 3 && (text[i] == '+' || text[i] == 'Z' || text[i] == '.'))
+					break;
+				++i;
+				continue;
+			}
+			int value = 0;
+			while (i < text.size() && text[i] >= '0' && text[i] <= '9')
+				value = value * 10 + (text[i++] - '0');
+			fields[count++] = value;
+		}
+		if (count < 3 || fields[0] < 1900 || fields[1] < 1 || fields[1] > 12 || fields[2] < 1 || fields[2] > 31)
+			return 0;
+		const Int64 days = DaysFromCivil(fields[0], static_cast<unsigned>(fields[1]), static_cast<unsigned>(fields[2]));
+		return days * 86400 + fields[3] * 3600 + fields[4] * 60 + fields[5];
+	}
+
+	// ---- TIFF/EXIF -------------------------------------------------------------
+
+	class TiffReader {
+	public:
+		TiffReader(const UInt8* data, size_t size) : data(data), size(size) {}
+
+		bool ParseHeader() {
+			if (size < 8)
+				return false;
+			if (data[0] == 'I' && data[1] == 'I')
+				little = true;
+			else if (data[0] == 'M' && data[1] == 'M')
+				little = false;
+			else
+				return false;
+			return U16(2) == 42;
+		}
+
+		UInt16 U16(size_t offset) const {
+			if (offset + 2 > size)
+				return 0;
+			return little ? static_cast<UInt16>(data[offset] | (data[offset + 1] << 8))
+						  : static_cast<UInt16>((data[offset] << 8) | data[offset + 1]);
+		}
+
+		UInt32 U32(size_t offset) const {
+			if (offset + 4 > size)
+				return 0;
+			return little ? (static_cast<UInt32>(data[offset]) | (static_cast<UInt32>(data[offset + 1]) << 8) |
+							 (static_cast<UInt32>(data[offset + 2]) << 16) | (static_cast<UInt32>(data[offset + 3]) << 24))
+						  : ((static_cast<UInt32>(data[offset]) << 24) | (static_cast<UInt32>(data[offset + 1]) << 16) |
+							 (static_cast<UInt32>(data[offset + 2]) << 8) | static_cast<UInt32>(data[offset + 3]));
+		}
+
+		// entry 为 IFD 项的起始偏移；数据不超过4字节时直接存放在项内
+		size_t ValueOffset(size_t entry, size_t byteCount) const {
+			return byteCount <= 4 ? entry + 8 : U32(entry + 8);
+		}
+
+		std::string Ascii(size_t entry) const {
+			const UInt32 count = U32(entry + 4);
+			const size_t offset = ValueOffset(entry, count);
+			if (count == 0 || offset + count > size)
+				return std::string();
+			std::string text(reinterpret_cast<const char*>(data + offset), count);
+			text.erase(std::find(text.begin(), text.end(), '\0'), text.end());
+			while (!text.empty() && text.back() == ' ')
+				text.pop_back();
+			return text;
+		}
+
+		// 度分秒三个 RATIONAL → 十进制度
+		double Degrees(size_t entry) const {
+			if (U16(entry + 2) != 5 || U32(entry + 4) < 3)
+				return std::nan("");
+			const size_t offset = U32(entry + 8);
+			double result = 0.0;
+			double scale = 1.0;
+			for (int i = 0; i < 3; ++i) {
+				const UInt32 num = U32(offset + i * 8);
+				const UInt32 den = U32(offset + i * 8 + 4);
+				if (offset + i * 8 + 8 > size)
+					return std::nan("");
+				if (den != 0)
+					result += static_cast<double>(num) / den / scale;
+				scale *= 60.0;
+			}
+			return result;
+		}
+
+		// 遍历一个 IFD，回调参数为 标签 和 项起始偏移
+		template <typename Visitor>
+		void ForEachEntry(size_t ifdOffset, Visitor&& visit) const {
+			if (ifdOffset == 0 || ifdOffset + 2 > size)
+				return;
+			const UInt16 count = U16(ifdOffset);
+			for (UInt16 i = 0; i < count; ++i) {
+				const size_t entry = ifdOffset + 2 + static_cast<size_t>(i) * 12;
+				if (entry + 12 > size)
+					return;
+				visit(U16(entry), entry);
+			}
+		}
+
+	private:
+		const UInt8* data;
+		size_t size;
+		bool little = true;
+	};
+
+	static std::string JoinCamera(const std::string& make, const std::string& model) {
+		if (make.empty())
+			return model;
+		// 很多相机的型号已包含厂商名（"Canon" + "Canon EOS R5"）
+		if (model.empty() || model.compare(0, make.size(), make) == 0)
+			return model.empty() ? make : model;
+		return make + " " + model;
+	}
+
+	static void ParseTiff(const UInt8* data, size_t size, Row& row) {
+		TiffReader tiff(data, size);
+		if (!tiff.ParseHeader())
+			return;
+
+		std::string make, model, dateTime, dateTimeOriginal;
+		size_t exifIFD = 0, gpsIFD = 0;
+		tiff.ForEachEntry(tiff.U32(4), [&](UInt16 tag, size_t entry) {
+			switch (tag) {
+				case 0x010F: make = tiff.Ascii(entry); break;
+				case 0x0110: model = tiff.Ascii(entry); break;
+				case 0x0132: dateTime = tiff.Ascii(entry); break;
+				case 0x8769: exifIFD = tiff.U32(entry + 8); break;
+				case 0x8825: gpsIFD = tiff.U32(entry + 8); break;
+				default: break;
+			}
+		});
+		tiff.ForEachEntry(exifIFD, [&](UInt16 tag, size_t entry) {
+			if (tag == 0x9003)
+				dateTimeOriginal = tiff.Ascii(entry);
+		});
+
+		std::string latRef, lonRef;
+		double lat = std::nan(""), lon = std::nan("");
+		tiff.ForEachEntry(gpsIFD, [&](UInt16 tag, size_t entry) {
+			switch (tag) {
+				case 1: latRef = tiff.Ascii(entry); break;
+				case 2: lat = tiff.Degrees(entry); break;
+				case 3: lonRef = tiff.Ascii(entry); break;
+				case 4: lon = tiff.Degrees(entry); break;
+				default: break;
+			}
+		});
+
+		row.captureTime = ParseDateTime(dateTimeOriginal.empty() ? dateTime : dateTimeOriginal);
+		row.camera = JoinCamera(make, model);
+		if (!std::isnan(lat) && !std::isnan(lon)) {
+			row.latitude = (latRef == "S") ? -lat : lat;
+			row.longitude = (lonRef == "W") ? -lon : lon;
+		}
+	}
+
+	// ---- XMP -----------------------------------------------------------------
+
+	// 属性形式 key="value" 或元素形式 <key>value</key>
+	static std::string XmpValue(std::string_view xmp, std::string_view key) {
+		size_t pos = 0;
+		while ((pos = xmp.find(key, pos)) != std::string_view::npos) {
+			size_t after = pos + key.size();
+			if (after + 1 < xmp.size() && xmp[after] == '=' && (xmp[after + 1] == '"' || xmp[after + 1] == '\'')) {
+				const char quote = xmp[after + 1];
+				size_t end = xmp.find(quote, after + 2);
+				if (end != std::string_view::npos)
+					return std::string(xmp.substr(after + 2, end - after - 2));
+			} else if (pos > 0 && xmp[pos - 1] == '<' && after < xmp.size() && xmp[after] == '>') {
+				size_t end = xmp.find('<', after + 1);
+				if (end != std::string_view::npos)
+					return std::string(xmp.substr(after + 1, end - after - 1));
+			}
+			pos = after;
+		}
+		return std::string();
+	}
+
+	// XMP GPS 坐标："39,54.123N" 或 "39,54,7.4N"
+	static double ParseXmpCoordinate(const std::string& text) {
+		if (text.empty())
+			return std::nan("");
+		double parts[3] = { 0.0, 0.0, 0.0 };
+		int count = 0;
+		const char* p = text.c_str();
+		while (*p != '\0' && count < 3) {
+			char* end = nullptr;
+			parts[count++] = std::strtod(p, &end);
+			if (end == p)
+				return std::nan("");
+			p = (*end == ',') ? end + 1 : end;
+			if (*end != ',')
+				break;
+		}
+		double value = parts[0] + parts[1] / 60.0 + parts[2] / 3600.0;
+		const char ref = text.back();
+		return (ref == 'S' || ref == 'W') ? -value : value;
+	}
+
+	// XMP 只补充 EXIF 中没有的字段
+	static void ParseXmp(std::string_view xmp, Row& row) {
+		if (row.captureTime == 0) {
+			for (std::string_view key : { "exif:DateTimeOriginal", "xmp:CreateDate", "photoshop:DateCreated" }) {
+				row.captureTime = ParseDateTime(XmpValue(xmp, key));
+				if (row.captureTime != 0)
+					break;
+			}
+		}
+		if (row.camera.empty())
+			row.camera = JoinCamera(XmpValue(xmp, "tiff:Make"), XmpValue(xmp, "tiff:Model"));
+		if (std::isnan(row.latitude)) {
+			double lat = ParseXmpCoordinate(XmpValue(xmp, "exif:GPSLatitude"));
+			double lon = ParseXmpCoordinate(XmpValue(xmp, "exif:GPSLongitude"));
+			if (!std::isnan(lat) && !std::isnan(lon)) {
+				row.latitude = lat;
+				row.longitude = lon;
+			}
+		}
+	}
+
+	// ---- 文件头 ----------------------------------------------------------------
+
+	static UInt32 BE32(const UInt8* p) {
+		return (static_cast<UInt32>(p[0]) << 24) | (static_cast<UInt32>(p[1]) << 16) | (static_cast<UInt32>(p[2]) << 8) | p[3];
+	}
+
+	// JPEG：依次读取标记段，遇到 SOS（图像数据）即停止
+	static void ParseJpeg(const UInt8* data, size_t size, Row& row) {
+		static const char kExifId[] = "Exif\0";
+		static const char kXmpId[] = "http://ns.adobe.com/xap/1.0/";
+		size_t pos = 2;
+		while (pos + 4 <= size) {
+			if (data[pos] != 0xFF)
+				return;
+			const UInt8 marker = data[pos + 1];
+			if (marker == 0xFF) {
+				++pos;
+				continue;
+			}
+			if (marker == 0xDA || marker == 0xD9)
+				return;
+			if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+				pos += 2;
+				continue;
+			}
+			const size_t length = (static_cast<size_t>(data[pos + 2]) << 8) | data[pos + 3];
+			if (length < 2)
+				return;
+			const UInt8* segment = data + pos + 4;
+			const size_t segmentSize = std::min(length - 2, size - (pos + 4));
+			if (marker == 0xE1) {
+				if (segmentSize > 6 && std::memcmp(segment, kExifId, 6) == 0)
+					ParseTiff(segment + 6, segmentSize - 6, row);
+				else if (segmentSize > sizeof(kXmpId) && std::memcmp(segment, kXmpId, sizeof(kXmpId)) == 0)
+					ParseXmp(std::string_view(reinterpret_cast<const char*>(segment + sizeof(kXmpId)), segmentSize - sizeof(kXmpId)), row);
+			}
+			pos += 2 + length;
+		}
+	}
+
+	// PNG：读取 eXIf 与 XMP iTXt 块，遇到 IDAT 即停止
+	static void ParsePng(const UInt8* data, size_t size, Row& row) {
+		static const char kXmpKeyword[] = "XML:com.adobe.xmp";
+		size_t pos = 8;
+		while (pos + 8 <= size) {
+			const size_t length = BE32(data + pos);
+			const char* type = reinterpret_cast<const char*>(data + pos + 4);
+			if (std::memcmp(type, "IDAT", 4) == 0 || std::memcmp(type, "IEND", 4) == 0)
+				return;
+			const UInt8* chunk = data + pos + 8;
+			const size_t chunkSize = std::min(length, size - (pos + 8));
+			if (std::memcmp(type, "eXIf", 4) == 0) {
+				ParseTiff(chunk, chunkSize, row);
+			} else if (std::memcmp(type, "iTXt", 4) == 0 && chunkSize > sizeof(kXmpKeyword) + 2 &&
+					   std::memcmp(chunk, kXmpKeyword, sizeof(kXmpKeyword)) == 0 && chunk[sizeof(kXmpKeyword)] == 0) {
+				// 关键字\0 压缩标志 压缩方法 语言\0 翻译关键字\0 文本；压缩的XMP不处理
+				std::string_view rest(reinterpret_cast<const char*>(chunk + sizeof(kXmpKeyword) + 2), chunkSize - sizeof(kXmpKeyword) - 2);
+				size_t languageEnd = rest.find('\0');
+				size_t keywordEnd = (languageEnd == std::string_view::npos) ? languageEnd : rest.find('\0', languageEnd + 1);
+				if (keywordEnd != std::string_view::npos)
+					ParseXmp(rest.substr(keywordEnd + 1), row);
+			}
+			pos += 12 + length;
+		}
+	}
+
+	static bool StatFile(const std::string& fullPath, UInt64& outSize, Int64& outModTime) {
+		struct stat st;
+		if (stat(fullPath.c_str(), &st) != 0)
+			return false;
+		outSize = static_cast<UInt64>(st.st_size);
+		outModTime = static_cast<Int64>(st.st_mtime);
+		return true;
+	}
+
+	static void ParseHeader(const UInt8* data, size_t size, Row& row) {
+		static const UInt8 kPngSignature[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+		if (data[0] == 0xFF && data[1] == 0xD8)
+			ParseJpeg(data, size, row);
+		else if ((data[0] == 'I' && data[1] == 'I') || (data[0] == 'M' && data[1] == 'M'))
+			ParseTiff(data, size, row);		// TIFF 与 DNG 文件本身就是 TIFF 结构
+		else if (std::memcmp(data, kPngSignature, 8) == 0)
+			ParsePng(data, size, row);
+	}
+
+	// 只映射文件开头 kHeadBytes 字节，页面在解析访问时才读入；其他平台读入同样长度的缓冲区
+	static void ReadPhotoHeader(const std::string& fullPath, Row& row) {
+#if defined(GS_MAC)
+		int fd = open(fullPath.c_str(), O_RDONLY);
+		if (fd < 0)
+			return;
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size < 8) {
+			close(fd);
+			return;
+		}
+		row.fileSize = static_cast<UInt64>(st.st_size);
+		row.modTime = static_cast<Int64>(st.st_mtime);
+
+		const size_t window = std::min(static_cast<size_t>(st.st_size), kHeadBytes);
+		void* mapped = mmap(nullptr, window, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (mapped == MAP_FAILED)
+			return;
+		ParseHeader(static_cast<const UInt8*>(mapped), window, row);
+		munmap(mapped, window);
+#else
+		if (!StatFile(fullPath, row.fileSize, row.modTime) || row.fileSize < 8)
+			return;
+		std::ifstream in(fullPath, std::ios::binary);
+		if (!in.is_open())
+			return;
+		std::vector<UInt8> buffer(static_cast<size_t>(std::min<UInt64>(row.fileSize, kHeadBytes)));
+		in.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+		const size_t window = static_cast<size_t>(in.gcount());
+		if (window >= 8)
+			ParseHeader(buffer.data(), window, row);
+#endif
+	}
+
+	// 工作线程按原子计数领取任务，结果与 jobs 顺序一致
+	static std::vector<Row> ExtractAll(const std::vector<Job>& jobs) {
+		std::vector<Row> rows(jobs.size());
+		std::atomic<size_t> next(0);
+		auto work = [&]() {
+			for (size_t i = next++; i < jobs.size(); i = next++) {
+				rows[i].path = jobs[i].relativePath;
+				ReadPhotoHeader(jobs[i].fullPath, rows[i]);
+			}
+		};
+		const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+		const size_t workers = std::min<size_t>(std::min(hardware, kMaxWorkers), jobs.size());
+		std::vector<std::thread> threads;
+		for (size_t i = 1; i < workers; ++i)
+			threads.emplace_back(work);
+		work();
+		for (std::thread& thread : threads)
+			thread.join();
+		return rows;
+	}
+
+	static bool IsPhotoFile(const std::filesystem::path& path) {
+		std::string ext = path.extension().string();
+		std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".tif" || ext == ".tiff" || ext == ".dng";
+	}
+
+	// ---- 列式索引 ----------------------------------------------------------------
+
+	static Row GetRow(const Columns& columns, size_t i) {
+		Row row;
+		row.path = columns.paths[i];
+		row.captureTime = columns.captureTime[i];
+		if (columns.cameraId[i] != 0 && columns.cameraId[i] <= columns.cameras.size())
+			row.camera = columns.cameras[columns.cameraId[i] - 1];
+		row.latitude = columns.latitude[i];
+		row.longitude = columns.longitude[i];
+		row.fileSize = columns.fileSize[i];
+		row.modTime = columns.modTime[i];
+		return row;
+	}
+
+	static std::vector<Row> ToRows(const Columns& columns) {
+		std::vector<Row> rows;
+		rows.reserve(columns.Size());
+		for (size_t i = 0; i < columns.Size(); ++i)
+			rows.push_back(GetRow(columns, i));
+		return rows;
+	}
+
+	// 按路径排序；同一路径以后出现的记录为准
+	static Columns BuildColumns(std::vector<Row> rows) {
+		std::stable_sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return a.path < b.path; });
+
+		Columns columns;
+		std::unordered_map<std::string, UInt32> cameraIds;
+		for (size_t i = 0; i < rows.size(); ++i) {
+			if (i + 1 < rows.size() && rows[i + 1].path == rows[i].path)
+				continue;
+			const Row& row = rows[i];
+			UInt32 cameraId = 0;
+			if (!row.camera.empty()) {
+				auto it = cameraIds.find(row.camera);
+				if (it == cameraIds.end()) {
+					columns.cameras.push_back(row.camera);
+					it = cameraIds.emplace(row.camera, static_cast<UInt32>(columns.cameras.size())).first;
+				}
+				cameraId = it->second;
+			}
+			columns.paths.push_back(row.path);
+			columns.captureTime.push_back(row.captureTime);
+			columns.cameraId.push_back(cameraId);
+			columns.latitude.push_back(row.latitude);
+			columns.longitude.push_back(row.longitude);
+			columns.fileSize.push_back(row.fileSize);
+			columns.modTime.push_back(row.modTime);
+		}
+		return columns;
+	}
+
+	template <typename T>
+	static void WriteColumn(std::ofstream& out, const std::vector<T>& column) {
+		if (!column.empty())
+			out.write(reinterpret_cast<const char*>(column.data()), static_cast<std::streamsize>(column.size() * sizeof(T)));
+	}
+
+	template <typename T>
+	static bool ReadColumn(std::ifstream& in, std::vector<T>& column, size_t count) {
+		column.resize(count);
+		if (count > 0)
+			in.read(reinterpret_cast<char*>(column.data()), static_cast<std::streamsize>(count * sizeof(T)));
+		return static_cast<bool>(in);
+	}
+
+	static void WriteStrings(std::ofstream& out, const std::vector<std::string>& strings) {
+		for (const std::string& text : strings) {
+			const UInt32 length = static_cast<UInt32>(text.size());
+			out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+			out.write(text.data(), length);
+		}
+	}
+
+	static bool ReadStrings(std::ifstream& in, std::vector<std::string>& strings, size_t count) {
+		strings.resize(count);
+		for (std::string& text : strings) {
+			UInt32 length = 0;
+			if (!in.read(reinterpret_cast<char*>(&length), sizeof(length)) || length > (1u << 16))
+				return false;
+			text.resize(length);
+			if (length > 0 && !in.read(text.data(), length))
+				return false;
+		}
+		return true;
+	}
+
+	// 先写临时文件再替换，中途失败不破坏旧索引
+	static bool SaveColumns(const std::filesystem::path& indexPath, const Columns& columns) {
+		std::filesystem::path tempPath = indexPath;
+		tempPath += ".tmp" + std::to_string(s_saveCounter++);
+		std::error_code ec;
+		{
+			std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+			if (!out)
+				return false;
+			const UInt32 header[4] = { kIndexMagic, kIndexVersion, static_cast<UInt32>(columns.Size()), static_cast<UInt32>(columns.cameras.size()) };
+			out.write(reinterpret_cast<const char*>(header), sizeof(header));
+			WriteStrings(out, columns.cameras);
+			WriteStrings(out, columns.paths);
+			WriteColumn(out, columns.captureTime);
+			WriteColumn(out, columns.cameraId);
+			WriteColumn(out, columns.latitude);
+			WriteColumn(out, columns.longitude);
+			WriteColumn(out, columns.fileSize);
+			WriteColumn(out, columns.modTime);
+			if (!out) {
+				out.close();
+				std::filesystem::remove(tempPath, ec);
+				return false;
+			}
+		}
+		std::filesystem::rename(tempPath, indexPath, ec);
+		if (ec) {
+			std::error_code removeEc;
+			std::filesystem::remove(tempPath, removeEc);
+		}
+		return !ec;
+	}
+
+	static bool LoadColumns(const std::filesystem::path& indexPath, Columns& columns) {
+		columns = Columns();
+		std::ifstream in(indexPath, std::ios::binary);
+		if (!in)
+			return false;
+		UInt32 header[4] = { 0, 0, 0, 0 };
+		if (!in.read(reinterpret_cast<char*>(header), sizeof(header)) || header[0] != kIndexMagic || header[1] != kIndexVersion)
+			return false;
+		const size_t count = header[2];
+		bool ok = ReadStrings(in, columns.cameras, header[3]) &&
+				  ReadStrings(in, columns.paths, count) &&
+				  ReadColumn(in, columns.captureTime, count) &&
+				  ReadColumn(in, columns.cameraId, count) &&
+				  ReadColumn(in, columns.latitude, count) &&
+				  ReadColumn(in, columns.longitude, count) &&
+				  ReadColumn(in, columns.fileSize, count) &&
+				  ReadColumn(in, columns.modTime, count);
+		if (!ok)
+			columns = Columns();
+		return ok;
+	}
+
+	static bool EnsureLoaded() {
+		const HBIMProject::Context& context = HBIMProject::GetContext();
+		if (!context.isSaved) {
+			s_index = Columns();
+			s_loaded = false;
+			return false;
+		}
+		if (s_loaded && s_loadedRoot == context.imageRoot)
+			return true;
+		LoadColumns(context.imageRoot / kIndexFileName, s_index);
+		s_loadedRoot = context.imageRoot;
+		s_loaded = true;
+		return true;
+	}
+
+	static const Row* FindRow(const Columns& columns, const std::string& path, Row& outRow) {
+		auto it = std::lower_bound(columns.paths.begin(), columns.paths.end(), path);
+		if (it == columns.paths.end() || *it != path)
+			return nullptr;
+		outRow = GetRow(columns, static_cast<size_t>(it - columns.paths.begin()));
+		return &outRow;
+	}
+
+	// 后台扫描：未变化的文件沿用旧记录，其余并行读取；完成后交回主线程替换内存索引
+	static void RebuildInBackground(std::filesystem::path imageRoot, std::string imageFolderName, std::vector<Row> previous) {
+		auto start = std::chrono::steady_clock::now();
+
+		std::unordered_map<std::string, size_t> previousByPath;
+		for (size_t i = 0; i < previous.size(); ++i)
+			previousByPath.emplace(previous[i].path, i);
+
+		std::vector<Row> rows;
+		std::vector<Job> jobs;
+		std::error_code ec;
+		for (std::filesystem::recursive_directory_iterator it(imageRoot, std::filesystem::directory_options::skip_permission_denied, ec), end; !ec && it != end; it.increment(ec)) {
+			const std::filesystem::path& path = it->path();
+			// .derived 中的派生图不是照片
+			if (it->is_directory() && path.filename().string().rfind('.', 0) == 0) {
+				it.disable_recursion_pending();
+				continue;
+			}
+			if (!it->is_regular_file() || path.filename().string().rfind('.', 0) == 0 || !IsPhotoFile(path))
+				continue;
+			const std::string fullPath = path.string();
+			const std::string relativePath = imageFolderName + "/" + path.lexically_relative(imageRoot).generic_string();
+
+			UInt64 fileSize = 0;
+			Int64 modTime = 0;
+			if (!StatFile(fullPath, fileSize, modTime))
+				continue;
+			auto found = previousByPath.find(relativePath);
+			if (found != previousByPath.end() && previous[found->second].fileSize == fileSize && previous[found->second].modTime == modTime)
+				rows.push_back(previous[found->second]);
+			else
+				jobs.push_back({ relativePath, fullPath });
+		}
+
+		const size_t reused = rows.size();
+		std::vector<Row> extracted = ExtractAll(jobs);
+		rows.insert(rows.end(), extracted.begin(), extracted.end());
+
+		auto columns = std::make_shared<Columns>(BuildColumns(std::move(rows)));
+		const bool saved = SaveColumns(imageRoot / kIndexFileName, *columns);
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		HBIMEventLoop::Post([columns, imageRoot, reused, read = jobs.size(), saved, seconds]() {
+			ACAPI_WriteReport("HBIMPhotoMetadata: 扫描 %d 张图片（沿用 %d，读取 %d），耗时 %.3f 秒", false,
+							  static_cast<int>(columns->Size()), static_cast<int>(reused), static_cast<int>(read), seconds);
+			// 扫描期间切换了项目，结果作废
+			s_rebuildPending = false;
+			const HBIMProject::Context& context = HBIMProject::GetContext();
+			if (!context.isSaved || context.imageRoot != imageRoot) {
+				s_rowsDuringRebuild.clear();
+				return;
+			}
+			s_index = std::move(*columns);
+			s_loadedRoot = imageRoot;
+			s_loaded = true;
+			// 工作线程已写完文件，这里合并扫描期间导入的记录（以它们为准）后再覆盖一次
+			bool merged = false;
+			if (!s_rowsDuringRebuild.empty()) {
+				std::vector<Row> rows = ToRows(s_index);
+				rows.insert(rows.end(), s_rowsDuringRebuild.begin(), s_rowsDuringRebuild.end());
+				s_rowsDuringRebuild.clear();
+				s_index = BuildColumns(std::move(rows));
+				merged = SaveColumns(imageRoot / kIndexFileName, s_index);
+				if (!merged)
+					ACAPI_WriteReport("HBIMPhotoMetadata: 写入索引文件失败", true);
+			}
+			if (PluginPalette::HasInstance())
+				PluginPalette::GetInstance().UpdateFromSelection();
+
+			GS::UniString msg = GS::UniString::Printf("已扫描 %d 张图片（未变化 %d 张，重新读取 %d 张），耗时 %.2f 秒。",
+													  static_cast<int>(s_index.Size()), static_cast<int>(reused), static_cast<int>(read), seconds);
+			if (!saved && !merged)
+				msg.Append("\n\n写入索引文件失败，本次结果只在关闭项目前有效。");
+			DG::InformationAlert("HBIM图片拍摄信息", msg, "确定");
+		});
+	}
+
+	static void OnProjectEvent(API_NotifyEventID notifID) {
+		switch (notifID) {
+			case APINotify_New:
+			case APINotify_NewAndReset:
+			case APINotify_Open:
+			case APINotify_Close:
+			case APINotify_Quit:
+				s_index = Columns();
+				s_loaded = false;
+				s_rowsDuringRebuild.clear();
+				break;
+			default:
+				break;
+		}
+	}
+
+}
+
+namespace HBIMPhotoMetadata {
+
+void Initialize() {
+	HBIMNotifications::AddProjectListener(OnProjectEvent);
+}
+
+void Shutdown() {
+	if (s_worker.valid())
+		s_worker.wait();
+}
+
+bool Lookup(const GS::UniString& relativePath, PhotoInfo& outInfo) {
+	if (!EnsureLoaded())
+		return false;
+	Row row;
+	if (FindRow(s_index, relativePath.ToCStr().Get(), row) == nullptr)
+		return false;
+	outInfo.captureTime = row.captureTime;
+	outInfo.camera = GS::UniString(row.camera.c_str(), CC_UTF8);
+	outInfo.hasGPS = !std::isnan(row.latitude) && !std::isnan(row.longitude);
+	outInfo.latitude = outInfo.hasGPS ? row.latitude : 0.0;
+	outInfo.longitude = outInfo.hasGPS ? row.longitude : 0.0;
+	return true;
+}
+
+void IndexFiles(const GS::Array<GS::UniString>& relativePaths) {
+	if (relativePaths.IsEmpty() || !EnsureLoaded())
+		return;
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<Job> jobs;
+	for (const GS::UniString& relativePath : relativePaths) {
+		std::string fullPath;
+		if (HBIMProject::BuildFullPath(relativePath, fullPath))
+			jobs.push_back({ relativePath.ToCStr().Get(), fullPath });
+	}
+
+	std::vector<Row> rows = ToRows(s_index);
+	std::vector<Row> extracted = ExtractAll(jobs);
+	rows.insert(rows.end(), extracted.begin(), extracted.end());
+	s_index = BuildColumns(std::move(rows));
+	// 后台扫描尚未交回：它的结果会替换内存索引并写文件，新记录先记下，交回时合并后再写
+	if (s_rebuildPending)
+		s_rowsDuringRebuild.insert(s_rowsDuringRebuild.end(), extracted.begin(), extracted.end());
+	else if (!SaveColumns(s_loadedRoot / kIndexFileName, s_index))
+		ACAPI_WriteReport("HBIMPhotoMetadata: 写入索引文件失败", true);
+
+	ACAPI_WriteReport("HBIMPhotoMetadata: 读取 %d 张导入图片的拍摄信息，耗时 %.3f 秒", false, static_cast<int>(jobs.size()),
+					  std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+void ReadFiles(const GS::Array<GS::UniString>& fullPaths, GS::Array<PhotoInfo>& outInfos) {
+	outInfos.Clear();
+	std::vector<Job> jobs;
+	jobs.reserve(fullPaths.GetSize());
+	for (const GS::UniString& fullPath : fullPaths)
+		jobs.push_back({ std::string(), fullPath.ToCStr().Get() });
+
+	for (const Row& row : ExtractAll(jobs)) {
+		PhotoInfo info;
+		info.captureTime = row.captureTime;
+		info.camera = GS::UniString(row.camera.c_str(), CC_UTF8);
+		info.hasGPS = !std::isnan(row.latitude) && !std::isnan(row.longitude);
+		info.latitude = info.hasGPS ? row.latitude : 0.0;
+		info.longitude = info.hasGPS ? row.longitude : 0.0;
+		outInfos.Push(info);
+	}
+}
+
+void RunRebuildCommand() {
+	if (!EnsureLoaded()) {
+		DG::InformationAlert("HBIM图片拍摄信息", "项目未保存，没有图片文件夹。", "确定");
+		return;
+	}
+	if (HBIM::IsWorkerRunning(s_worker) || s_rebuildPending) {
+		DG::InformationAlert("HBIM图片拍摄信息", "上一次扫描尚未完成，请稍后再试。", "确定");
+		return;
+	}
+	const HBIMProject::Context& context = HBIMProject::GetContext();
+	std::error_code ec;
+	if (!std::filesystem::is_directory(context.imageRoot, ec)) {
+		DG::InformationAlert("HBIM图片拍摄信息", "图片文件夹不存在。", "确定");
+		return;
+	}
+	s_rebuildPending = true;
+	s_worker = std::async(std::launch::async, RebuildInBackground, context.imageRoot,
+						  std::string(context.imageFolderName.ToCStr().Get()), ToRows(s_index));
+}
+
+GS::UniString FormatCaptureTime(Int64 captureTime) {
+	if (captureTime == 0)
+		return GS::UniString();
+	Int64 days = captureTime / 86400;
+	Int64 seconds = captureTime % 86400;
+	if (seconds < 0) {
+		seconds += 86400;
+		--days;
+	}
+	Int64 year = 0;
+	unsigned month = 0, day = 0;
+	CivilFromDays(days, year, month, day);
+	return GS::UniString::Printf("%04d-%02u-%02u %02d:%02d:%02d", static_cast<int>(year), month, day,
+								 static_cast<int>(seconds / 3600), static_cast<int>((seconds % 3600) / 60), static_cast<int>(seconds % 60));
+}
+
+bool MatchesCaptureFilter(Int64 captureTime, const GS::UniString& filter) {
+	auto trim = [](std::string text) {
+		const size_t begin = text.find_first_not_of(" \t");
+		const size_t end = text.find_last_not_of(" \t");
+		return begin == std::string::npos ? std::string() : text.substr(begin, end - begin + 1);
+	};
+	const std::string trimmed = trim(filter.ToCStr().Get());
+	if (trimmed.empty())
+		return true;
+	if (captureTime == 0)
+		return false;
+
+	const std::string formatted = FormatCaptureTime(captureTime).ToCStr().Get();
+	const size_t tilde = trimmed.find('~');
+	if (tilde == std::string::npos)
+		return formatted.compare(0, trimmed.size(), trimmed) == 0;
+
+	// 区间两端按前缀比较："2024-05~2024-06" 包含整个六月
+	const std::string from = trim(trimmed.substr(0, tilde));
+	const std::string to = trim(trimmed.substr(tilde + 1));
+	if (!from.empty() && formatted.compare(0, from.size(), from) < 0)
+		return false;
+	if (!to.empty() && formatted.compare(0, to.size(), to) > 0)
+		return false;
+	return true;
+}
+
+}
@@ -0,0 +1,49 @@
+#ifndef HBIMPHOTOMETADATA_HPP
+#define HBIMPHOTOMETADATA_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+
+// HBIM图片的拍摄信息（拍摄时间、相机、GPS）索引。
+// 只映射每个文件开头的一段（JPEG 读到图像数据前的 APP1 段，PNG 读到 IDAT 前的 eXIf/iTXt 块），
+// 解析 EXIF/XMP，不解码像素；多个文件由工作线程并行读取。
+// 结果按列存放在图片文件夹下的 .photo_metadata（路径、时间、相机字典编号、经纬度、大小、修改时间各一列），
+// 面板显示和按拍摄时间筛选只查内存中的索引，不再打开图片文件。
+namespace HBIMPhotoMetadata {
+
+	struct PhotoInfo {
+		Int64 captureTime = 0;		// 拍摄时间（相机本地时间按UTC计的秒数），0 表示未知
+		GS::UniString camera;		// 厂商 + 型号
+		bool hasGPS = false;
+		double latitude = 0.0;
+		double longitude = 0.0;
+	};
+
+	// 在 Initialize 中调用（需在 HBIMNotifications::Initialize 之后）
+	void Initialize();
+
+	// 在 FreeData 中调用：等待正在进行的后台扫描结束
+	void Shutdown();
+
+	// 查询一张图片（相对项目目录）的拍摄信息，只访问内存索引（主线程）
+	bool Lookup(const GS::UniString& relativePath, PhotoInfo& outInfo);
+
+	// 导入后调用：并行读取新复制的图片并写入索引（主线程，等待读取完成）
+	void IndexFiles(const GS::Array<GS::UniString>& relativePaths);
+
+	// 并行读取任意位置图片的拍摄信息（不写入索引，主线程等待读取完成）；结果与 fullPaths 一一对应
+	void ReadFiles(const GS::Array<GS::UniString>& fullPaths, GS::Array<PhotoInfo>& outInfos);
+
+	// 菜单入口：后台并行扫描整个图片文件夹，未变化（大小、修改时间相同）的文件沿用已有记录
+	void RunRebuildCommand();
+
+	// "YYYY-MM-DD HH:MM:SS"；未知时返回空字符串
+	GS::UniString FormatCaptureTime(Int64 captureTime);
+
+	// 拍摄时间筛选：filter 为日期前缀（如 "2024-05"、"2024-05-01 10"）或 "起~止" 区间（两端按前缀比较，可省略一端）。
+	// 空筛选匹配所有图片；有筛选时未知拍摄时间不匹配
+	bool MatchesCaptureFilter(Int64 captureTime, const GS::UniString& filter);
+
+}
+
+#endif
@@ -0,0 +1,333 @@
+// *****************************************************************************
+// File:			HBIMPhotoPlacement.cpp
+// Description:		按照片拍摄位置（EXIF GPS）推荐构件：经纬度换算到项目坐标，
+//					在构件空间索引中查询最近构件，确认后批量附着图片
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMPhotoPlacement.hpp"
+#include "HBIMCommon.hpp"
+#include "HBIMElementIndex.hpp"
+#include "HBIMGlobalIdIndex.hpp"
+#include "HBIMImageStore.hpp"
+#include "HBIMImageTombstones.hpp"
+#include "HBIMPhotoMetadata.hpp"
+#include "HBIMProject.hpp"
+#include "HBIMStatusOverlay.hpp"
+#include "PluginPalette.hpp"
+#include "DGModule.hpp"
+#include "DGFileDialog.hpp"
+#include "FileTypeManager.hpp"
+#include "HashTable.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+	// 每张照片保留的候选数与搜索半径（米）；超出半径的照片不推荐，避免 GPS 漂移时误挂到远处构件
+	static const UInt32 kCandidateCount = 3;
+	static const double kMaxDistance = 50.0;
+	static const USize kMaxReportedSuggestions = 10;
+
+	// WGS84 平均地球半径（米）
+	static const double kEarthRadius = 6371008.8;
+	static const double kDegToRad = 3.14159265358979323846 / 180.0;
+
+	// 项目原点处的局部切平面：项目中的地点设置给出原点经纬度，north 为正北方向与 x 轴的夹角
+	struct ProjectFrame {
+		double latitude = 0.0;
+		double longitude = 0.0;
+		double cosLatitude = 1.0;
+		double northX = 0.0;
+		double northY = 1.0;
+	};
+
+	static GSErrCode GetProjectFrame(ProjectFrame& outFrame) {
+		API_PlaceInfo placeInfo = {};
+		GSErrCode err = ACAPI_GeoLocation_GetPlaceSets(&placeInfo);
+		if (err != NoError)
+			return err;
+		outFrame.latitude = placeInfo.latitude;
+		outFrame.longitude = placeInfo.longitude;
+		outFrame.cosLatitude = std::cos(placeInfo.latitude * kDegToRad);
+		outFrame.northX = std::cos(placeInfo.north);
+		outFrame.northY = std::sin(placeInfo.north);
+		return NoError;
+	}
+
+	// 等距圆柱近似：建筑群尺度（几公里内）误差远小于手机 GPS 本身的误差
+	static void ToProjectCoordinates(const ProjectFrame& frame, double latitude, double longitude, double& outX, double& outY) {
+		const double north = (latitude - frame.latitude) * kDegToRad * kEarthRadius;
+		const double east = (longitude - frame.longitude) * kDegToRad * kEarthRadius * frame.cosLatitude;
+		// 正东方向 = 正北方向顺时针转 90°
+		outX = north * frame.northX + east * frame.northY;
+		outY = north * frame.northY - east * frame.northX;
+	}
+
+	static GS::UniString FileNameOf(const GS::UniString& path) {
+		return GS::UniString(std::filesystem::path(path.ToCStr().Get()).filename().string().c_str(), CC_UTF8);
+	}
+
+	// 与面板导入图片相同的文件名前缀：YYYYMMDD_HHMMSS_mmm
+	static std::string GetCurrentTimestamp() {
+		auto now = std::chrono::system_clock::now();
+		auto nowTime = std::chrono::system_clock::to_time_t(now);
+		auto nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % 1000;
+		std::tm tmBuf;
+		localtime_r(&nowTime, &tmBuf);
+		std::ostringstream oss;
+		oss << std::put_time(&tmBuf, "%Y%m%d_%H%M%S_") << std::setfill('0') << std::setw(3) << nowMs.count();
+		return oss.str();
+	}
+
+	static GS::UniString FormatReport(const HBIMPhotoPlacement::Report& report) {
+		UInt32 withPosition = 0;
+		UInt32 withCandidates = 0;
+		for (const HBIMPhotoPlacement::Suggestion& suggestion : report.suggestions) {
+			if (suggestion.hasPosition)
+				++withPosition;
+			if (!suggestion.candidates.IsEmpty())
+				++withCandidates;
+		}
+
+		GS::UniString msg;
+		msg.Append(GS::UniString::Printf("照片: %u 张，带GPS位置: %u 张\n", static_cast<unsigned>(report.suggestions.GetSize()), withPosition));
+		msg.Append(GS::UniString::Printf("%.0f 米内找到构件: %u 张\n", kMaxDistance, withCandidates));
+		msg.Append(GS::UniString::Printf("参与查询的构件: %u 个\n\n", report.elementCount));
+		msg.Append(GS::UniString::Printf("读取照片 %.3f 秒，等待构件索引 %.3f 秒，查询 %.3f 秒",
+										 report.readSeconds, report.indexSeconds, report.querySeconds));
+
+		USize shown = 0;
+		for (const HBIMPhotoPlacement::Suggestion& suggestion : report.suggestions) {
+			if (suggestion.candidates.IsEmpty())
+				continue;
+			if (shown == 0)
+				msg.Append("\n\n推荐示例:");
+			if (shown++ >= kMaxReportedSuggestions)
+				break;
+			const HBIMPhotoPlacement::Candidate& nearest = suggestion.candidates[0];
+			msg.Append("\n  ");
+			msg.Append(FileNameOf(suggestion.sourcePath));
+			msg.Append(" → ");
+			msg.Append(HBIMGlobalIdIndex::GetGlobalId(nearest.elemGuid));
+			msg.Append(GS::UniString::Printf(" (%.1f 米)", nearest.distance));
+		}
+		return msg;
+	}
+
+}
+
+namespace HBIMPhotoPlacement {
+
+GSErrCode BuildReport(const GS::Array<GS::UniString>& photoPaths, Report& outReport, GS::UniString* outError) {
+	outReport = Report();
+
+	ProjectFrame frame;
+	GSErrCode err = GetProjectFrame(frame);
+	if (err != NoError) {
+		if (outError != nullptr) *outError = "无法读取项目地点（经纬度）设置";
+		return err;
+	}
+
+	auto readStart = std::chrono::steady_clock::now();
+	GS::Array<HBIMPhotoMetadata::PhotoInfo> infos;
+	HBIMPhotoMetadata::ReadFiles(photoPaths, infos);
+	outReport.readSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - readStart).count();
+
+	std::vector<std::pair<double, double>> points;
+	std::vector<UIndex> pointOwners;
+	for (UIndex i = 0; i < photoPaths.GetSize(); ++i) {
+		Suggestion suggestion;
+		suggestion.sourcePath = photoPaths[i];
+		if (i < infos.GetSize() && infos[i].hasGPS) {
+			suggestion.hasPosition = true;
+			ToProjectCoordinates(frame, infos[i].latitude, infos[i].longitude, suggestion.x, suggestion.y);
+			points.emplace_back(suggestion.x, suggestion.y);
+			pointOwners.push_back(i);
+		}
+		outReport.suggestions.Push(suggestion);
+	}
+	if (points.empty())
+		return NoError;
+
+	// 索引通常已在打开项目后建好，这里只应用尚未处理的构件修改
+	auto indexStart = std::chrono::steady_clock::now();
+	HBIMElementIndex::EnsureBuilt();
+	outReport.elementCount = HBIMElementIndex::GetSize();
+	outReport.indexSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - indexStart).count();
+
+	auto queryStart = std::chrono::steady_clock::now();
+	GS::Array<HBIMElementIndex::Neighbour> neighbours;
+	for (size_t i = 0; i < points.size(); ++i) {
+		HBIMElementIndex::FindNearest(points[i].first, points[i].second, 0.0, true, kCandidateCount, kMaxDistance, neighbours);
+		Suggestion& suggestion = outReport.suggestions[pointOwners[i]];
+		for (const HBIMElementIndex::Neighbour& neighbour : neighbours)
+			suggestion.candidates.Push({ neighbour.elemGuid, neighbour.distance });
+	}
+	outReport.querySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - queryStart).count();
+
+	ACAPI_WriteReport("HBIMPhotoPlacement: %d 张照片，%d 个构件；读取 %.3f 秒，等待索引 %.3f 秒，查询 %.3f 秒", false,
+					  static_cast<int>(photoPaths.GetSize()), static_cast<int>(outReport.elementCount),
+					  outReport.readSeconds, outReport.indexSeconds, outReport.querySeconds);
+	return NoError;
+}
+
+GSErrCode AttachToNearest(const Report& report, GS::Array<API_Guid>& outElements, GS::UniString* outError) {
+	outElements.Clear();
+	const HBIMProject::Context& context = HBIMProject::GetContext();
+	if (!context.isSaved) {
+		if (outError != nullptr) *outError = "项目未保存，无法复制图片";
+		return APIERR_GENERAL;
+	}
+
+	HBIMImageStore::Storage& storage = HBIMImageStore::GetActiveStorage();
+	HBIMImageStore::LinkTable table;
+	GS::Array<API_Guid> copiedOwners;
+	GS::Array<GS::UniString> copiedPaths;
+
+	for (const Suggestion& suggestion : report.suggestions) {
+		if (suggestion.candidates.IsEmpty())
+			continue;
+		const API_Guid elemGuid = suggestion.candidates[0].elemGuid;
+		const GS::UniString globalId = HBIMGlobalIdIndex::GetGlobalId(elemGuid);
+		const GS::UniString cleanGlobalId = HBIM::SanitizeForFilePath(globalId);
+		if (globalId.IsEmpty() || globalId == "未找到" || cleanGlobalId.IsEmpty()) {
+			ACAPI_WriteReport("HBIMPhotoPlacement: 构件没有GlobalId，跳过 %s", true, suggestion.sourcePath.ToCStr().Get());
+			continue;
+		}
+
+		if (!table.ContainsKey(elemGuid)) {
+			GS::Array<GS::UniString> links;
+			if (storage.Read(elemGuid, links) != NoError)
+				continue;
+			table.Put(elemGuid, links);
+			outElements.Push(elemGuid);
+		}
+
+		const std::filesystem::path source(suggestion.sourcePath.ToCStr().Get());
+		const std::filesystem::path destFolder = context.imageRoot / cleanGlobalId.ToCStr().Get();
+		std::string fileName = GetCurrentTimestamp() + "_" + source.filename().string();
+		std::error_code ec;
+		std::filesystem::create_directories(destFolder, ec);
+		for (int suffix = 1; std::filesystem::exists(destFolder / fileName, ec); ++suffix)
+			fileName = GetCurrentTimestamp() + "_" + std::to_string(suffix) + "_" + source.filename().string();
+		if (!std::filesystem::copy_file(source, destFolder / fileName, ec)) {
+			ACAPI_WriteReport("HBIMPhotoPlacement: 复制失败 %s: %s", true, suggestion.sourcePath.ToCStr().Get(), ec.message().c_str());
+			continue;
+		}
+
+		GS::UniString relativePath = context.imageFolderName;
+		relativePath.Append("/");
+		relativePath.Append(cleanGlobalId);
+		relativePath.Append("/");
+		relativePath.Append(GS::UniString(fileName.c_str(), CC_UTF8));
+		table.Get(elemGuid).Push(relativePath);
+		copiedOwners.Push(elemGuid);
+		copiedPaths.Push(relativePath);
+	}
+
+	if (copiedPaths.IsEmpty())
+		return NoError;
+
+	GSErrCode err = ACAPI_CallUndoableCommand("按拍摄位置附着HBIM图片",
+		[&]() -> GSErrCode {
+			GSErrCode writeErr = storage.WriteAll(table);
+			if (writeErr == NoError)
+				HBIMStatusOverlay::UpdateStatuses(outElements);
+			return writeErr;
+		}
+	);
+	if (err != NoError) {
+		// 链接没有写入：已复制的文件交给墓碑日志清理
+		for (UIndex i = 0; i < copiedPaths.GetSize(); ++i)
+			HBIMImageTombstones::Add(copiedOwners[i], copiedPaths[i], false);
+		HBIMImageTombstones::ScheduleCompaction();
+		if (outError != nullptr) *outError = GS::UniString::Printf("写入图片链接失败 (错误码: %d)", err);
+		outElements.Clear();
+		return err;
+	}
+
+	HBIMPhotoMetadata::IndexFiles(copiedPaths);
+	ACAPI_WriteReport("HBIMPhotoPlacement: 已附着 %d 张照片到 %d 个构件", false,
+					  static_cast<int>(copiedPaths.GetSize()), static_cast<int>(outElements.GetSize()));
+	return NoError;
+}
+
+void RunSuggestCommand() {
+	if (PluginPalette::IsInImageEditMode()) {
+		DG::InformationAlert("提示", "请先完成或取消当前的图片编辑，再按拍摄位置附着照片", "确定");
+		return;
+	}
+	if (!HBIMProject::GetContext().isSaved) {
+		DG::InformationAlert("按拍摄位置推荐构件", "项目未保存，没有图片文件夹。", "确定");
+		return;
+	}
+
+	DG::FileDialog dlg(DG::FileDialog::OpenMultiFile);
+	FTM::FileTypeManager mgr("HBIMPhotoPlacement");
+	FTM::FileType typeJpg("JPEG", "jpg", 0, 0, 0);
+	FTM::FileType typePng("PNG", "png", 0, 0, 0);
+	dlg.AddFilter(mgr.AddType(typeJpg));
+	dlg.AddFilter(mgr.AddType(typePng));
+	dlg.SetTitle("选择带拍摄位置的照片");
+	if (!dlg.Invoke() || dlg.GetSelectionCount() == 0)
+		return;
+
+	GS::Array<GS::UniString> photoPaths;
+	for (UIndex i = 0; i < dlg.GetSelectionCount(); ++i) {
+		GS::UniString path;
+		dlg.GetSelectedFile(i).ToPath(&path);
+		photoPaths.Push(path);
+	}
+
+	Report report;
+	GS::UniString error;
+	GSErrCode err = BuildReport(photoPaths, report, &error);
+	if (err != NoError) {
+		DG::InformationAlert("推荐失败", error, "确定");
+		return;
+	}
+
+	for (const Suggestion& suggestion : report.suggestions) {
+		for (const Candidate& candidate : suggestion.candidates) {
+			ACAPI_WriteReport("HBIMPhotoPlacement: %s → %s (%.2f 米)", false, suggestion.sourcePath.ToCStr().Get(),
+							  HBIMGlobalIdIndex::GetGlobalId(candidate.elemGuid).ToCStr().Get(), candidate.distance);
+		}
+	}
+
+	GS::UniString summary = FormatReport(report);
+	bool anyCandidate = false;
+	for (const Suggestion& suggestion : report.suggestions)
+		anyCandidate = anyCandidate || !suggestion.candidates.IsEmpty();
+	if (!anyCandidate) {
+		DG::InformationAlert("按拍摄位置推荐构件", summary, "确定");
+		return;
+	}
+
+	if (DG::InformationAlert("按拍摄位置推荐构件", summary, "附着到最近构件", "取消") != DG::Accept)
+		return;
+
+	GS::Array<API_Guid> attached;
+	err = AttachToNearest(report, attached, &error);
+	if (err != NoError) {
+		DG::InformationAlert("附着失败", error, "确定");
+		return;
+	}
+
+	// 选中附着了照片的构件，便于逐个检查
+	GS::Array<API_Neig> selNeigs;
+	for (const API_Guid& elemGuid : attached)
+		selNeigs.Push(API_Neig(elemGuid));
+	ACAPI_Selection_DeselectAll();
+	ACAPI_Selection_Select(selNeigs, true);
+}
+
+}
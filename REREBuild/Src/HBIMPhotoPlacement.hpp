@@ -0,0 +1,44 @@
+#ifndef HBIMPHOTOPLACEMENT_HPP
+#define HBIMPHOTOPLACEMENT_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+
+// 按拍摄位置为照片推荐构件：照片 EXIF 中的经纬度按项目地点（项目原点的经纬度与正北方向）
+// 换算为项目平面坐标，在常驻的构件空间索引（HBIMElementIndex）中查询最近的几个构件。
+// 照片由工作线程并行读取；索引在打开项目后已建好，每张照片的查询只需几微秒。
+namespace HBIMPhotoPlacement {
+
+	struct Candidate {
+		API_Guid elemGuid = APINULLGuid;
+		double distance = 0.0;		// 照片位置到构件包围盒的平面距离（米）
+	};
+
+	struct Suggestion {
+		GS::UniString sourcePath;
+		bool hasPosition = false;	// 照片带 GPS 信息
+		double x = 0.0;
+		double y = 0.0;
+		GS::Array<Candidate> candidates;	// 按距离升序
+	};
+
+	struct Report {
+		GS::Array<Suggestion> suggestions;
+		UInt32 elementCount = 0;
+		double readSeconds = 0.0;
+		double indexSeconds = 0.0;	// 等待索引建好并应用构件修改
+		double querySeconds = 0.0;
+	};
+
+	// 读取照片位置并查询候选构件（不修改项目）
+	GSErrCode BuildReport(const GS::Array<GS::UniString>& photoPaths, Report& outReport, GS::UniString* outError = nullptr);
+
+	// 把每张照片复制到最近构件的图片文件夹，并在一个可撤销命令中写入图片链接
+	GSErrCode AttachToNearest(const Report& report, GS::Array<API_Guid>& outElements, GS::UniString* outError = nullptr);
+
+	// 菜单入口：选择照片 → 推荐报告 → 确认后附着到最近构件并选中这些构件
+	void RunSuggestCommand();
+
+}
+
+#endif
@@ -0,0 +1,524 @@
+// *****************************************************************************
+// File:			HBIMPointCloud.cpp
+// Description:		扫描点云文件的流式读取：ASCII（XYZ/PTS）、PLY 与 LAS，按固定大小的块回调
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMPointCloud.hpp"
+#include "DGModule.hpp"
+#include "DGFileDialog.hpp"
+#include "FileTypeManager.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+	// ASCII 文件每次读入的字节数
+	static const size_t kReadBlockBytes = 4u << 20;
+
+	// LAS 1.0–1.3 文件头的最小长度与 LAS 1.4 文件头长度
+	static const size_t kLasMinHeaderBytes = 227;
+	static const size_t kLasHeaderBytes = 375;
+
+	static std::string ToLower(std::string text) {
+		std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return text;
+	}
+
+	static UInt32 PackColor(double r, double g, double b) {
+		auto channel = [](double value) {
+			return static_cast<UInt32>(std::max(0.0, std::min(255.0, value)));
+		};
+		return 0xFF000000u | (channel(r) << 16) | (channel(g) << 8) | channel(b);
+	}
+
+	// 攒满一块再交给回调
+	class ChunkBuffer {
+	public:
+		explicit ChunkBuffer(HBIMPointCloud::Callback& callback) : callback(callback) { points.reserve(HBIMPointCloud::kChunkPoints); }
+
+		bool Push(const HBIMPointCloud::Point& point) {
+			points.push_back(point);
+			return points.size() < HBIMPointCloud::kChunkPoints || Flush();
+		}
+
+		bool Flush() {
+			if (points.empty())
+				return true;
+			const bool keepGoing = callback.Append(points.data(), static_cast<UInt32>(points.size()));
+			points.clear();
+			return keepGoing;
+		}
+
+	private:
+		HBIMPointCloud::Callback& callback;
+		std::vector<HBIMPointCloud::Point> points;
+	};
+
+	// ---- ASCII ----------------------------------------------------------------
+
+	// 每行 x y z，之后的列：1 列为强度（灰度），3 列为 r g b，4 列及以上为 强度 r g b（PTS）。
+	// 首行只有一个数（PTS 点数）或无法解析的行跳过
+	class AsciiSource : public HBIMPointCloud::Source {
+	public:
+		explicit AsciiSource(const std::string& path) : path(path) {}
+
+		UInt64 GetNumberOfPoints() const override { return 0; }
+
+		bool DoStreaming(HBIMPointCloud::Callback& callback) override {
+			std::FILE* file = std::fopen(path.c_str(), "rb");
+			if (file == nullptr) {
+				error = "无法打开扫描文件";
+				return false;
+			}
+			ChunkBuffer chunk(callback);
+			std::vector<char> block(kReadBlockBytes + 1);
+			std::string carry;		// 上一块末尾不完整的行
+			bool keepGoing = true;
+			while (keepGoing) {
+				const size_t read = std::fread(block.data(), 1, kReadBlockBytes, file);
+				if (read == 0)
+					break;
+				const char* begin = block.data();
+				const char* end = begin + read;
+				const char* lineStart = begin;
+				for (const char* p = begin; p < end && keepGoing; ++p) {
+					if (*p != '\n')
+						continue;
+					if (!carry.empty()) {
+						carry.append(lineStart, p);
+						keepGoing = ParseLine(carry.c_str(), chunk);
+						carry.clear();
+					} else {
+						std::string line(lineStart, p);
+						keepGoing = ParseLine(line.c_str(), chunk);
+					}
+					lineStart = p + 1;
+				}
+				carry.append(lineStart, end);
+			}
+			const bool readError = std::ferror(file) != 0;
+			std::fclose(file);
+			if (keepGoing && !carry.empty())
+				keepGoing = ParseLine(carry.c_str(), chunk);
+			if (keepGoing)
+				keepGoing = chunk.Flush();
+			if (readError)
+				error = "读取扫描文件出错";
+			return keepGoing && !readError;
+		}
+
+	private:
+		std::string path;
+
+		static bool ParseLine(const char* line, ChunkBuffer& chunk) {
+			double values[7];
+			int count = 0;
+			const char* p = line;
+			while (count < 7) {
+				while (*p == ' ' || *p == '\t' || *p == ',' || *p == ';' || *p == '\r')
+					++p;
+				if (*p == '\0')
+					break;
+				char* next = nullptr;
+				values[count] = std::strtod(p, &next);
+				if (next == p)
+					break;
+				++count;
+				p = next;
+			}
+			if (count < 3)
+				return true;
+
+			HBIMPointCloud::Point point;
+			point.x = values[0];
+			point.y = values[1];
+			point.z = values[2];
+			if (count >= 7)
+				point.argbColor = PackColor(values[4], values[5], values[6]);
+			else if (count == 6)
+				point.argbColor = PackColor(values[3], values[4], values[5]);
+			else if (count == 4)
+				point.argbColor = PackColor(values[3], values[3], values[3]);
+			return chunk.Push(point);
+		}
+	};
+
+	// ---- PLY ------------------------------------------------------------------
+
+	enum class PlyType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, Unknown };
+
+	static PlyType ParsePlyType(const std::string& name) {
+		if (name == "char" || name == "int8") return PlyType::Int8;
+		if (name == "uchar" || name == "uint8") return PlyType::UInt8;
+		if (name == "short" || name == "int16") return PlyType::Int16;
+		if (name == "ushort" || name == "uint16") return PlyType::UInt16;
+		if (name == "int" || name == "int32") return PlyType::Int32;
+		if (name == "uint" || name == "uint32") return PlyType::UInt32;
+		if (name == "float" || name == "float32") return PlyType::Float32;
+		if (name == "double" || name == "float64") return PlyType::Float64;
+		return PlyType::Unknown;
+	}
+
+	static size_t PlyTypeSize(PlyType type) {
+		switch (type) {
+			case PlyType::Int8: case PlyType::UInt8: return 1;
+			case PlyType::Int16: case PlyType::UInt16: return 2;
+			case PlyType::Int32: case PlyType::UInt32: case PlyType::Float32: return 4;
+			case PlyType::Float64: return 8;
+			default: return 0;
+		}
+	}
+
+	// 小端字节序读取
+	static double ReadPlyValue(const unsigned char* data, PlyType type) {
+		switch (type) {
+			case PlyType::Int8: { Int8 v; std::memcpy(&v, data, 1); return v; }
+			case PlyType::UInt8: return data[0];
+			case PlyType::Int16: { Int16 v; std::memcpy(&v, data, 2); return v; }
+			case PlyType::UInt16: { UInt16 v; std::memcpy(&v, data, 2); return v; }
+			case PlyType::Int32: { Int32 v; std::memcpy(&v, data, 4); return v; }
+			case PlyType::UInt32: { UInt32 v; std::memcpy(&v, data, 4); return v; }
+			case PlyType::Float32: { float v; std::memcpy(&v, data, 4); return v; }
+			case PlyType::Float64: { double v; std::memcpy(&v, data, 8); return v; }
+			default: return 0.0;
+		}
+	}
+
+	// 只读取第一个元素 vertex 中的 x y z 与 red green blue，其他属性跳过
+	class PlySource : public HBIMPointCloud::Source {
+	public:
+		explicit PlySource(const std::string& path) : path(path) {}
+
+		bool ReadHeader(GS::UniString& outError) {
+			std::ifstream in(path, std::ios::binary);
+			std::string line;
+			if (!std::getline(in, line) || line.compare(0, 3, "ply") != 0) {
+				outError = "不是 PLY 文件";
+				return false;
+			}
+			bool inVertex = false;
+			bool seenElement = false;
+			while (std::getline(in, line)) {
+				if (!line.empty() && line.back() == '\r')
+					line.pop_back();
+				char word[64] = {}, arg1[64] = {}, arg2[64] = {};
+				const int fields = std::sscanf(line.c_str(), "%63s %63s %63s", word, arg1, arg2);
+				const std::string keyword = word;
+				if (keyword == "end_header")
+					break;
+				if (keyword == "format" && fields >= 2) {
+					const std::string format = arg1;
+					if (format == "ascii")
+						binary = false;
+					else if (format == "binary_little_endian")
+						binary = true;
+					else {
+						outError = "不支持的 PLY 格式（仅支持 ascii 与 binary_little_endian）";
+						return false;
+					}
+				} else if (keyword == "element" && fields >= 3) {
+					inVertex = !seenElement && std::string(arg1) == "vertex";
+					if (!seenElement && !inVertex) {
+						outError = "PLY 文件的第一个元素不是 vertex";
+						return false;
+					}
+					if (inVertex)
+						vertexCount = std::strtoull(arg2, nullptr, 10);
+					seenElement = true;
+				} else if (keyword == "property" && inVertex) {
+					if (std::string(arg1) == "list") {
+						outError = "PLY 顶点中不支持列表属性";
+						return false;
+					}
+					Property property;
+					property.type = ParsePlyType(arg1);
+					property.offset = stride;
+					if (property.type == PlyType::Unknown) {
+						outError = "PLY 顶点中有未知类型的属性";
+						return false;
+					}
+					stride += PlyTypeSize(property.type);
+					const std::string name = arg2;
+					if (name == "x") xIndex = static_cast<int>(properties.size());
+					else if (name == "y") yIndex = static_cast<int>(properties.size());
+					else if (name == "z") zIndex = static_cast<int>(properties.size());
+					else if (name == "red" || name == "diffuse_red") rIndex = static_cast<int>(properties.size());
+					else if (name == "green" || name == "diffuse_green") gIndex = static_cast<int>(properties.size());
+					else if (name == "blue" || name == "diffuse_blue") bIndex = static_cast<int>(properties.size());
+					properties.push_back(property);
+				}
+			}
+			if (!in || xIndex < 0 || yIndex < 0 || zIndex < 0) {
+				outError = "PLY 文件头不完整或缺少 x/y/z";
+				return false;
+			}
+			dataOffset = static_cast<std::streamoff>(in.tellg());
+			return true;
+		}
+
+		UInt64 GetNumberOfPoints() const override { return vertexCount; }
+
+		bool DoStreaming(HBIMPointCloud::Callback& callback) override {
+			std::ifstream in(path, std::ios::binary);
+			if (!in.seekg(dataOffset)) {
+				error = "无法打开扫描文件";
+				return false;
+			}
+			ChunkBuffer chunk(callback);
+			const bool keepGoing = binary ? StreamBinary(in, chunk) : StreamAscii(in, chunk);
+			return keepGoing && chunk.Flush();
+		}
+
+	private:
+		struct Property {
+			PlyType type = PlyType::Unknown;
+			size_t offset = 0;
+		};
+
+		std::string path;
+		bool binary = false;
+		UInt64 vertexCount = 0;
+		std::vector<Property> properties;
+		size_t stride = 0;
+		int xIndex = -1, yIndex = -1, zIndex = -1;
+		int rIndex = -1, gIndex = -1, bIndex = -1;
+		std::streamoff dataOffset = 0;
+
+		bool HasColor() const { return rIndex >= 0 && gIndex >= 0 && bIndex >= 0; }
+
+		bool StreamBinary(std::ifstream& in, ChunkBuffer& chunk) {
+			std::vector<unsigned char> records(static_cast<size_t>(HBIMPointCloud::kChunkPoints) * stride);
+			UInt64 remaining = vertexCount;
+			while (remaining > 0) {
+				const size_t batch = static_cast<size_t>(std::min<UInt64>(remaining, HBIMPointCloud::kChunkPoints));
+				in.read(reinterpret_cast<char*>(records.data()), static_cast<std::streamsize>(batch * stride));
+				if (static_cast<size_t>(in.gcount()) != batch * stride) {
+					error = "PLY 文件在顶点数据中途结束";
+					return false;
+				}
+				for (size_t i = 0; i < batch; ++i) {
+					const unsigned char* record = records.data() + i * stride;
+					auto value = [&](int index) { return ReadPlyValue(record + properties[index].offset, properties[index].type); };
+					HBIMPointCloud::Point point;
+					point.x = value(xIndex);
+					point.y = value(yIndex);
+					point.z = value(zIndex);
+					if (HasColor())
+						point.argbColor = PackColor(value(rIndex), value(gIndex), value(bIndex));
+					if (!chunk.Push(point))
+						return false;
+				}
+				remaining -= batch;
+			}
+			return true;
+		}
+
+		bool StreamAscii(std::ifstream& in, ChunkBuffer& chunk) {
+			std::string line;
+			std::vector<double> values(properties.size());
+			for (UInt64 i = 0; i < vertexCount; ++i) {
+				if (!std::getline(in, line)) {
+					error = "PLY 文件在顶点数据中途结束";
+					return false;
+				}
+				const char* p = line.c_str();
+				for (size_t j = 0; j < values.size(); ++j) {
+					char* next = nullptr;
+					values[j] = std::strtod(p, &next);
+					p = next;
+				}
+				HBIMPointCloud::Point point;
+				point.x = values[xIndex];
+				point.y = values[yIndex];
+				point.z = values[zIndex];
+				if (HasColor())
+					point.argbColor = PackColor(values[rIndex], values[gIndex], values[bIndex]);
+				if (!chunk.Push(point))
+					return false;
+			}
+			return true;
+		}
+	};
+
+	// ---- LAS ------------------------------------------------------------------
+
+	template <typename T>
+	static T ReadLittle(const unsigned char* data) {
+		T value;
+		std::memcpy(&value, data, sizeof(T));
+		return value;
+	}
+
+	// LAS 1.0–1.4，点格式 0–10：坐标为整数乘比例加偏移，格式 2/3/5/7/8/10 带 16 位颜色。
+	// LAZ（压缩）不支持
+	class LasSource : public HBIMPointCloud::Source {
+	public:
+		explicit LasSource(const std::string& path) : path(path) {}
+
+		bool ReadHeader(GS::UniString& outError) {
+			std::ifstream in(path, std::ios::binary);
+			unsigned char header[kLasHeaderBytes] = {};
+			in.read(reinterpret_cast<char*>(header), sizeof(header));
+			const size_t headerRead = static_cast<size_t>(in.gcount());
+			if (headerRead < kLasMinHeaderBytes || std::memcmp(header, "LASF", 4) != 0) {
+				outError = "不是 LAS 文件";
+				return false;
+			}
+			const UInt16 headerSize = ReadLittle<UInt16>(header + 94);
+			pointOffset = ReadLittle<UInt32>(header + 96);
+			const UInt8 format = header[104];
+			if ((format & 0xC0) != 0) {
+				outError = "不支持 LAZ 压缩的点云，请先解压为 LAS";
+				return false;
+			}
+			pointFormat = format & 0x3F;
+			recordLength = ReadLittle<UInt16>(header + 105);
+			pointCount = ReadLittle<UInt32>(header + 107);
+			if (headerSize >= kLasHeaderBytes && headerRead >= kLasHeaderBytes) {
+				const UInt64 extendedCount = ReadLittle<UInt64>(header + 247);
+				if (extendedCount > 0)
+					pointCount = extendedCount;
+			}
+			for (int axis = 0; axis < 3; ++axis) {
+				scale[axis] = ReadLittle<double>(header + 131 + 8 * axis);
+				offset[axis] = ReadLittle<double>(header + 155 + 8 * axis);
+			}
+
+			switch (pointFormat) {
+				case 0: case 1: case 4: case 6: case 9: colorOffset = 0; break;
+				case 2: colorOffset = 20; break;
+				case 3: case 5: colorOffset = 28; break;
+				case 7: case 8: case 10: colorOffset = 30; break;
+				default:
+					outError = "不支持的 LAS 点格式";
+					return false;
+			}
+			if (recordLength < 12 || (colorOffset > 0 && recordLength < colorOffset + 6)) {
+				outError = "LAS 点记录长度与点格式不符";
+				return false;
+			}
+			return true;
+		}
+
+		UInt64 GetNumberOfPoints() const override { return pointCount; }
+
+		bool DoStreaming(HBIMPointCloud::Callback& callback) override {
+			std::ifstream in(path, std::ios::binary);
+			if (!in.seekg(pointOffset)) {
+				error = "无法打开扫描文件";
+				return false;
+			}
+			ChunkBuffer chunk(callback);
+			std::vector<unsigned char> records(static_cast<size_t>(HBIMPointCloud::kChunkPoints) * recordLength);
+			// 规范要求颜色为 16 位，但有的软件写 8 位：按第一块的最大值判断
+			int colorShift = -1;
+			UInt64 remaining = pointCount;
+			while (remaining > 0) {
+				const size_t batch = static_cast<size_t>(std::min<UInt64>(remaining, HBIMPointCloud::kChunkPoints));
+				in.read(reinterpret_cast<char*>(records.data()), static_cast<std::streamsize>(batch * recordLength));
+				if (static_cast<size_t>(in.gcount()) != batch * recordLength) {
+					error = "LAS 文件在点数据中途结束";
+					return false;
+				}
+				if (colorOffset > 0 && colorShift < 0) {
+					UInt16 maxChannel = 0;
+					for (size_t i = 0; i < batch; ++i) {
+						const unsigned char* color = records.data() + i * recordLength + colorOffset;
+						maxChannel = std::max({ maxChannel, ReadLittle<UInt16>(color), ReadLittle<UInt16>(color + 2), ReadLittle<UInt16>(color + 4) });
+					}
+					colorShift = maxChannel > 255 ? 8 : 0;
+				}
+				for (size_t i = 0; i < batch; ++i) {
+					const unsigned char* record = records.data() + i * recordLength;
+					HBIMPointCloud::Point point;
+					point.x = ReadLittle<Int32>(record) * scale[0] + offset[0];
+					point.y = ReadLittle<Int32>(record + 4) * scale[1] + offset[1];
+					point.z = ReadLittle<Int32>(record + 8) * scale[2] + offset[2];
+					if (colorOffset > 0) {
+						const unsigned char* color = record + colorOffset;
+						point.argbColor = PackColor(ReadLittle<UInt16>(color) >> colorShift, ReadLittle<UInt16>(color + 2) >> colorShift,
+													ReadLittle<UInt16>(color + 4) >> colorShift);
+					}
+					if (!chunk.Push(point))
+						return false;
+				}
+				remaining -= batch;
+			}
+			return chunk.Flush();
+		}
+
+	private:
+		std::string path;
+		UInt32 pointOffset = 0;
+		UInt8 pointFormat = 0;
+		UInt16 recordLength = 0;
+		UInt64 pointCount = 0;
+		size_t colorOffset = 0;			// 0 表示没有颜色
+		double scale[3] = { 1.0, 1.0, 1.0 };
+		double offset[3] = { 0.0, 0.0, 0.0 };
+	};
+
+}
+
+namespace HBIMPointCloud {
+
+Callback::~Callback() = default;
+
+Source::~Source() = default;
+
+std::unique_ptr<Source> OpenScan(const GS::UniString& path, GS::UniString& outError) {
+	const std::string filePath = path.ToCStr().Get();
+	std::error_code ec;
+	if (!std::filesystem::is_regular_file(filePath, ec)) {
+		outError = "扫描文件不存在";
+		return nullptr;
+	}
+	const std::string extension = ToLower(std::filesystem::path(filePath).extension().string());
+	if (extension == ".ply") {
+		auto source = std::make_unique<PlySource>(filePath);
+		if (!source->ReadHeader(outError))
+			return nullptr;
+		return source;
+	}
+	if (extension == ".las") {
+		auto source = std::make_unique<LasSource>(filePath);
+		if (!source->ReadHeader(outError))
+			return nullptr;
+		return source;
+	}
+	if (extension == ".xyz" || extension == ".txt" || extension == ".pts" || extension == ".csv")
+		return std::make_unique<AsciiSource>(filePath);
+	outError = "不支持的点云格式（支持 XYZ/TXT/PTS/CSV、PLY 与 LAS）";
+	return nullptr;
+}
+
+bool ChooseScanFile(const GS::UniString& title, GS::UniString& outPath) {
+	DG::FileDialog dlg(DG::FileDialog::OpenFile);
+	FTM::FileTypeManager mgr("HBIMPointCloud");
+	FTM::FileType typeLas("LAS", "las", 0, 0, 0);
+	FTM::FileType typePly("PLY", "ply", 0, 0, 0);
+	FTM::FileType typeXyz("XYZ", "xyz", 0, 0, 0);
+	FTM::FileType typePts("PTS", "pts", 0, 0, 0);
+	FTM::FileType typeTxt("TXT", "txt", 0, 0, 0);
+	FTM::FileType typeCsv("CSV", "csv", 0, 0, 0);
+	dlg.AddFilter(mgr.AddType(typeLas));
+	dlg.AddFilter(mgr.AddType(typePly));
+	dlg.AddFilter(mgr.AddType(typeXyz));
+	dlg.AddFilter(mgr.AddType(typePts));
+	dlg.AddFilter(mgr.AddType(typeTxt));
+	dlg.AddFilter(mgr.AddType(typeCsv));
+	dlg.SetTitle(title);
+	if (!dlg.Invoke() || dlg.GetSelectionCount() == 0)
+		return false;
+	return dlg.GetSelectedFile(0).ToPath(&outPath) == NoError && !outPath.IsEmpty();
+}
+
+}
@@ -0,0 +1,59 @@
+#ifndef HBIMPOINTCLOUD_HPP
+#define HBIMPOINTCLOUD_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+
+#include <memory>
+#include <string>
+
+// 激光扫描点云文件的流式读取。
+// SDK 的 PointCloud 模块（IPointCloud、IStreamingPointCloudSource）只提供头文件，插件无法链接，
+// 也没有读取项目中点云对象的 API，因此按 IStreamingPointCloudSource 的形式直接读取扫描文件：
+// 点按固定大小的块依次交给回调，内存只与块大小有关，与扫描文件大小无关。
+// 坐标按米读取，需已配准到项目坐标系。
+namespace HBIMPointCloud {
+
+	// 每块的点数（约 24 MB）
+	static const UInt32 kChunkPoints = 1u << 20;
+
+	struct Point {
+		double x = 0.0, y = 0.0, z = 0.0;
+		UInt32 argbColor = 0xFFFFFFFF;
+	};
+
+	class Callback {
+	public:
+		virtual ~Callback();
+
+		// 返回 false 时中止读取
+		virtual bool Append(const Point* points, UInt32 numberOfPoints) = 0;
+	};
+
+	class Source {
+	public:
+		virtual ~Source();
+
+		// 文件头给出的点数；未知时为 0
+		virtual UInt64 GetNumberOfPoints() const = 0;
+
+		// 从头读取一遍（后台线程）；读取出错或被回调中止时返回 false，错误信息见 GetError
+		virtual bool DoStreaming(Callback& callback) = 0;
+
+		const GS::UniString& GetError() const { return error; }
+
+	protected:
+		GS::UniString error;
+	};
+
+	// 按扩展名打开扫描文件：.xyz/.txt/.pts/.csv（每行 x y z [强度] [r g b]）、.ply（ascii、binary_little_endian）
+	// 与 .las（1.0–1.4，点格式 0–10）；
+	// 只读取文件头，失败时返回 nullptr 与错误信息
+	std::unique_ptr<Source> OpenScan(const GS::UniString& path, GS::UniString& outError);
+
+	// 弹出文件对话框选择扫描文件（主线程）；取消时返回 false
+	bool ChooseScanFile(const GS::UniString& title, GS::UniString& outPath);
+
+}
+
+#endif
@@ -0,0 +1,568 @@
+// *****************************************************************************
+// File:			HBIMPointCloudCache.cpp
+// Description:		扫描点云导入：流式读取、多线程体素降采样、项目内二进制缓存的写出与读取
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMPointCloudCache.hpp"
+#include "HBIMCommon.hpp"
+#include "HBIMEventLoop.hpp"
+#include "HBIMProject.hpp"
+#include "DGModule.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <limits>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+	static const unsigned kMaxWorkers = 8;
+	// 工作线程每次领取的点数
+	static const UInt32 kBlockPoints = 1u << 14;
+	// 体素按所在的 64 体素见方的区块散列到固定数量的桶中，同一区块的体素总在同一个桶里
+	static const int kTileShift = 6;
+	static const UInt32 kBucketCount = 64;
+	// 内存中的体素超过此数时，把最大的几个桶的部分和追加到磁盘上的溢出文件，降到一半以下
+	static const size_t kMaxVoxelsInMemory = 4u << 20;
+	static const char* kCacheFolderName = "HBIM_PointCloudCache";
+	static const char* kCacheExtension = ".hbpc";
+
+	static const UInt32 kCacheMagic = 0x48425056;		// 'HBPV'
+	static const UInt32 kCacheVersion = 1;
+
+	// 缓存文件：文件头、原扫描文件路径（UTF-8）、点
+	struct CacheHeader {
+		UInt32 magic = kCacheMagic;
+		UInt32 version = kCacheVersion;
+		double voxelSize = 0.0;
+		double origin[3] = { 0.0, 0.0, 0.0 };		// 点坐标相对此原点，单精度在千米范围内仍有亚毫米精度
+		UInt64 pointCount = 0;
+		UInt64 sourceSize = 0;
+		Int64 sourceTime = 0;
+		UInt32 pathBytes = 0;
+		UInt32 reserved = 0;
+	};
+	static_assert(sizeof(CacheHeader) == 72, "缓存文件头不能有填充");
+
+	struct CachePoint {
+		float x, y, z;
+		UInt32 argbColor;
+	};
+	static_assert(sizeof(CachePoint) == 16, "缓存点不能有填充");
+
+	// 原扫描文件的大小与修改时间，任一变化缓存即失效
+	struct SourceStamp {
+		UInt64 size = 0;
+		Int64 time = 0;
+	};
+
+	static bool GetSourceStamp(const std::string& path, SourceStamp& outStamp) {
+		std::error_code ec;
+		outStamp.size = std::filesystem::file_size(path, ec);
+		if (ec)
+			return false;
+		outStamp.time = static_cast<Int64>(std::filesystem::last_write_time(path, ec).time_since_epoch().count());
+		return !ec;
+	}
+
+	// 缓存文件名为扫描文件名加完整路径的散列（FNV-1a），不同目录下的同名文件互不覆盖
+	static std::filesystem::path GetCachePath(const std::filesystem::path& projectDir, const std::string& scanPath) {
+		UInt64 hash = 14695981039346656037ull;
+		for (unsigned char ch : scanPath) {
+			hash ^= ch;
+			hash *= 1099511628211ull;
+		}
+		char suffix[32];
+		std::snprintf(suffix, sizeof(suffix), "_%016llx", static_cast<unsigned long long>(hash));
+		return projectDir / kCacheFolderName / (std::filesystem::path(scanPath).stem().string() + suffix + kCacheExtension);
+	}
+
+	// ---- 读取缓存 ----------------------------------------------------------------
+
+	class CacheSource : public HBIMPointCloud::Source {
+	public:
+		CacheSource(const std::filesystem::path& path, const CacheHeader& header, long dataOffset)
+			: path(path), header(header), dataOffset(dataOffset) {}
+
+		UInt64 GetNumberOfPoints() const override { return header.pointCount; }
+
+		bool DoStreaming(HBIMPointCloud::Callback& callback) override {
+			std::FILE* file = std::fopen(path.string().c_str(), "rb");
+			if (file == nullptr || std::fseek(file, dataOffset, SEEK_SET) != 0) {
+				if (file != nullptr)
+					std::fclose(file);
+				error = "无法打开点云缓存";
+				return false;
+			}
+			std::vector<CachePoint> records(HBIMPointCloud::kChunkPoints);
+			std::vector<HBIMPointCloud::Point> points(HBIMPointCloud::kChunkPoints);
+			bool keepGoing = true;
+			for (UInt64 remaining = header.pointCount; remaining > 0 && keepGoing;) {
+				const size_t batch = static_cast<size_t>(std::min<UInt64>(remaining, HBIMPointCloud::kChunkPoints));
+				if (std::fread(records.data(), sizeof(CachePoint), batch, file) != batch) {
+					error = "点云缓存在点数据中途结束";
+					keepGoing = false;
+					break;
+				}
+				for (size_t i = 0; i < batch; ++i) {
+					points[i].x = header.origin[0] + records[i].x;
+					points[i].y = header.origin[1] + records[i].y;
+					points[i].z = header.origin[2] + records[i].z;
+					points[i].argbColor = records[i].argbColor;
+				}
+				keepGoing = callback.Append(points.data(), static_cast<UInt32>(batch));
+				remaining -= batch;
+			}
+			std::fclose(file);
+			return keepGoing;
+		}
+
+	private:
+		std::filesystem::path path;
+		CacheHeader header;
+		long dataOffset = 0;
+	};
+
+	// 缓存存在、完整且与扫描文件当前的大小和修改时间一致时打开
+	static std::unique_ptr<CacheSource> OpenCache(const std::filesystem::path& cachePath, const std::string& scanPath) {
+		SourceStamp stamp;
+		if (!GetSourceStamp(scanPath, stamp))
+			return nullptr;
+		std::FILE* file = std::fopen(cachePath.string().c_str(), "rb");
+		if (file == nullptr)
+			return nullptr;
+		CacheHeader header;
+		std::string storedPath;
+		bool valid = std::fread(&header, sizeof(header), 1, file) == 1 && header.magic == kCacheMagic && header.version == kCacheVersion;
+		if (valid) {
+			storedPath.resize(header.pathBytes);
+			valid = std::fread(&storedPath[0], 1, header.pathBytes, file) == header.pathBytes;
+		}
+		std::fclose(file);
+		if (!valid || storedPath != scanPath || header.sourceSize != stamp.size || header.sourceTime != stamp.time)
+			return nullptr;
+
+		const long dataOffset = static_cast<long>(sizeof(CacheHeader) + header.pathBytes);
+		std::error_code ec;
+		const UInt64 fileSize = std::filesystem::file_size(cachePath, ec);
+		if (ec || fileSize != dataOffset + header.pointCount * sizeof(CachePoint))
+			return nullptr;
+		return std::make_unique<CacheSource>(cachePath, header, dataOffset);
+	}
+
+	// ---- 体素降采样 ----------------------------------------------------------------
+
+	struct VoxelKey {
+		Int32 x, y, z;
+		bool operator== (const VoxelKey& other) const { return x == other.x && y == other.y && z == other.z; }
+	};
+
+	struct VoxelKeyHash {
+		size_t operator() (const VoxelKey& key) const {
+			UInt64 hash = static_cast<UInt32>(key.x);
+			hash = hash * 0x9E3779B97F4A7C15ull ^ static_cast<UInt32>(key.y);
+			hash = hash * 0x9E3779B97F4A7C15ull ^ static_cast<UInt32>(key.z);
+			return static_cast<size_t>(hash * 0x9E3779B97F4A7C15ull);
+		}
+	};
+
+	struct VoxelSum {
+		double x = 0.0, y = 0.0, z = 0.0;
+		UInt64 r = 0, g = 0, b = 0;
+		UInt32 count = 0;
+	};
+
+	using VoxelMap = std::unordered_map<VoxelKey, VoxelSum, VoxelKeyHash>;
+
+	// 溢出文件中的一条部分和；只在本次导入中读写，不需要固定布局
+	struct SpillRecord {
+		VoxelKey key;
+		VoxelSum sum;
+	};
+
+	static UInt32 BucketOf(const VoxelKey& key) {
+		const VoxelKey tile = { key.x >> kTileShift, key.y >> kTileShift, key.z >> kTileShift };
+		// 用散列的高位，低位留给体素表自己的分桶
+		return static_cast<UInt32>((VoxelKeyHash()(tile) >> 40) % kBucketCount);
+	}
+
+	struct Outcome {
+		std::filesystem::path cachePath;
+		UInt64 inputPoints = 0;
+		UInt64 outputPoints = 0;
+		UInt64 cacheBytes = 0;
+		UInt64 spilledBytes = 0;
+		unsigned workers = 0;
+		double seconds = 0.0;
+		bool completed = false;
+		GS::UniString error;
+	};
+
+	static std::future<void> s_worker;
+	static std::atomic<bool> s_stop(false);
+
+	template <typename Work>
+	static void RunParallel(unsigned threadCount, const Work& work) {
+		std::vector<std::thread> threads;
+		for (unsigned i = 1; i < threadCount; ++i)
+			threads.emplace_back(work, i);
+		work(0);
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+
+	// 体素按区块分到 kBucketCount 个桶，每个桶只属于一个工作线程，各线程的体素表互不重叠，不需要加锁。
+	// 每块分两步：先并行计算体素并按所属线程分组，再由各线程并行累加自己桶中的体素。
+	// 扫描大到内存放不下全部体素时，把最大的桶写入溢出文件后清空；写出缓存时逐桶合并溢出的部分和，
+	// 同一时刻只需容纳一个桶，内存上限与扫描大小无关
+	class VoxelCallback : public HBIMPointCloud::Callback {
+	public:
+		explicit VoxelCallback(const std::filesystem::path& spillDir) : spillDir(spillDir) {
+			const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+			workers = std::min(hardware, kMaxWorkers);
+			buckets.resize(kBucketCount);
+			spilled.assign(kBucketCount, false);
+			groups.assign(workers, std::vector<std::vector<UInt32>>(workers));
+			for (int axis = 0; axis < 3; ++axis)
+				minimum[axis] = std::numeric_limits<double>::infinity();
+		}
+
+		~VoxelCallback() {
+			std::error_code ec;
+			std::filesystem::remove_all(spillDir, ec);
+		}
+
+		unsigned GetWorkerCount() const { return workers; }
+		UInt64 GetInputPoints() const { return inputPoints; }
+		UInt64 GetSpilledBytes() const { return spilledBytes; }
+		bool HasSpillFailed() const { return spillFailed; }
+
+		bool Append(const HBIMPointCloud::Point* points, UInt32 numberOfPoints) override {
+			if (s_stop)
+				return false;
+			inputPoints += numberOfPoints;
+			keys.resize(numberOfPoints);
+			for (std::vector<std::vector<UInt32>>& producer : groups) {
+				for (std::vector<UInt32>& group : producer)
+					group.clear();
+			}
+
+			const double inverseVoxel = 1.0 / HBIMPointCloudCache::kVoxelSize;
+			std::atomic<UInt32> next(0);
+			const unsigned producers = static_cast<unsigned>(std::min<UInt64>(workers, (numberOfPoints + kBlockPoints - 1) / kBlockPoints));
+			std::vector<std::array<double, 3>> minimums(std::max(producers, 1u), { minimum[0], minimum[1], minimum[2] });
+			RunParallel(producers, [&](unsigned producer) {
+				std::array<double, 3>& low = minimums[producer];
+				for (UInt32 begin = next.fetch_add(kBlockPoints); begin < numberOfPoints; begin = next.fetch_add(kBlockPoints)) {
+					const UInt32 end = std::min(numberOfPoints, begin + kBlockPoints);
+					for (UInt32 i = begin; i < end; ++i) {
+						const HBIMPointCloud::Point& point = points[i];
+						if (!std::isfinite(point.x) || !std::isfinite(point.y) || !std::isfinite(point.z))
+							continue;
+						const VoxelKey key = {
+							static_cast<Int32>(std::floor(point.x * inverseVoxel)),
+							static_cast<Int32>(std::floor(point.y * inverseVoxel)),
+							static_cast<Int32>(std::floor(point.z * inverseVoxel))
+						};
+						keys[i] = key;
+						groups[producer][BucketOf(key) % workers].push_back(i);
+						low[0] = std::min(low[0], point.x);
+						low[1] = std::min(low[1], point.y);
+						low[2] = std::min(low[2], point.z);
+					}
+				}
+			});
+			for (const std::array<double, 3>& low : minimums) {
+				for (int axis = 0; axis < 3; ++axis)
+					minimum[axis] = std::min(minimum[axis], low[axis]);
+			}
+			RunParallel(workers, [&](unsigned owner) {
+				for (const std::vector<std::vector<UInt32>>& producer : groups) {
+					for (UInt32 i : producer[owner]) {
+						const HBIMPointCloud::Point& point = points[i];
+						VoxelSum& sum = buckets[BucketOf(keys[i])][keys[i]];
+						sum.x += point.x;
+						sum.y += point.y;
+						sum.z += point.z;
+						sum.r += (point.argbColor >> 16) & 0xFF;
+						sum.g += (point.argbColor >> 8) & 0xFF;
+						sum.b += point.argbColor & 0xFF;
+						sum.count += 1;
+					}
+				}
+			});
+			spillFailed = !SpillIfFull();
+			return !spillFailed && !s_stop;
+		}
+
+		// 每个体素输出点的重心与平均颜色，逐桶合并溢出的部分和后写出并释放。
+		// 原点取所有点的最小坐标；点数在写完后回填到文件头
+		bool WriteCache(const std::filesystem::path& cachePath, const std::string& scanPath, const SourceStamp& stamp, Outcome& outcome) {
+			CacheHeader header;
+			header.voxelSize = HBIMPointCloudCache::kVoxelSize;
+			header.sourceSize = stamp.size;
+			header.sourceTime = stamp.time;
+			header.pathBytes = static_cast<UInt32>(scanPath.size());
+			for (int axis = 0; axis < 3; ++axis)
+				header.origin[axis] = std::isfinite(minimum[axis]) ? minimum[axis] : 0.0;
+
+			std::error_code ec;
+			std::filesystem::create_directories(cachePath.parent_path(), ec);
+			// 先写临时文件再改名，写到一半中止时不会留下看似完整的缓存
+			std::filesystem::path tempPath = cachePath;
+			tempPath += ".tmp";
+			std::FILE* file = std::fopen(tempPath.string().c_str(), "wb");
+			if (file == nullptr) {
+				outcome.error = "无法创建点云缓存文件";
+				return false;
+			}
+			bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 && std::fwrite(scanPath.data(), 1, scanPath.size(), file) == scanPath.size();
+			std::vector<CachePoint> records;
+			records.reserve(HBIMPointCloud::kChunkPoints);
+			auto flush = [&]() {
+				ok = ok && std::fwrite(records.data(), sizeof(CachePoint), records.size(), file) == records.size();
+				records.clear();
+			};
+			for (UInt32 bucket = 0; bucket < kBucketCount && ok && !s_stop; ++bucket) {
+				VoxelMap& own = buckets[bucket];
+				if (spilled[bucket] && !MergeSpill(bucket, own)) {
+					outcome.error = "读取点云溢出文件失败";
+					ok = false;
+					break;
+				}
+				for (const auto& entry : own) {
+					const VoxelSum& sum = entry.second;
+					CachePoint record;
+					record.x = static_cast<float>(sum.x / sum.count - header.origin[0]);
+					record.y = static_cast<float>(sum.y / sum.count - header.origin[1]);
+					record.z = static_cast<float>(sum.z / sum.count - header.origin[2]);
+					record.argbColor = 0xFF000000u | static_cast<UInt32>(sum.r / sum.count) << 16 | static_cast<UInt32>(sum.g / sum.count) << 8 |
+									   static_cast<UInt32>(sum.b / sum.count);
+					records.push_back(record);
+					if (records.size() == HBIMPointCloud::kChunkPoints)
+						flush();
+				}
+				header.pointCount += own.size();
+				VoxelMap().swap(own);
+			}
+			flush();
+			ok = ok && !s_stop && std::fseek(file, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(header), 1, file) == 1;
+			ok = std::fclose(file) == 0 && ok;
+			if (ok) {
+				std::filesystem::rename(tempPath, cachePath, ec);
+				ok = !ec;
+			}
+			if (!ok) {
+				std::filesystem::remove(tempPath, ec);
+				if (outcome.error.IsEmpty())
+					outcome.error = "写入点云缓存失败";
+				return false;
+			}
+			outcome.outputPoints = header.pointCount;
+			outcome.cacheBytes = sizeof(CacheHeader) + header.pathBytes + header.pointCount * sizeof(CachePoint);
+			return true;
+		}
+
+	private:
+		std::filesystem::path SpillPath(UInt32 bucket) const {
+			return spillDir / ("bucket_" + std::to_string(bucket));
+		}
+
+		// 内存中的体素过多时，按大小从大到小把桶追加到各自的溢出文件，直到降到上限的一半
+		bool SpillIfFull() {
+			size_t total = 0;
+			for (const VoxelMap& own : buckets)
+				total += own.size();
+			if (total <= kMaxVoxelsInMemory)
+				return true;
+
+			std::vector<UInt32> order(kBucketCount);
+			for (UInt32 bucket = 0; bucket < kBucketCount; ++bucket)
+				order[bucket] = bucket;
+			std::sort(order.begin(), order.end(), [this](UInt32 a, UInt32 b) { return buckets[a].size() > buckets[b].size(); });
+
+			std::error_code ec;
+			std::filesystem::create_directories(spillDir, ec);
+			std::vector<SpillRecord> records;
+			for (UInt32 bucket : order) {
+				if (total <= kMaxVoxelsInMemory / 2)
+					break;
+				VoxelMap& own = buckets[bucket];
+				records.clear();
+				records.reserve(own.size());
+				for (const auto& entry : own)
+					records.push_back({ entry.first, entry.second });
+				std::FILE* file = std::fopen(SpillPath(bucket).string().c_str(), "ab");
+				const bool written = file != nullptr && std::fwrite(records.data(), sizeof(SpillRecord), records.size(), file) == records.size();
+				if (file != nullptr && std::fclose(file) != 0)
+					return false;
+				if (!written)
+					return false;
+				spilledBytes += records.size() * sizeof(SpillRecord);
+				spilled[bucket] = true;
+				total -= own.size();
+				VoxelMap().swap(own);
+			}
+			return true;
+		}
+
+		// 把溢出文件中的部分和并入桶中仍在内存的体素
+		bool MergeSpill(UInt32 bucket, VoxelMap& own) {
+			const std::filesystem::path path = SpillPath(bucket);
+			std::FILE* file = std::fopen(path.string().c_str(), "rb");
+			if (file == nullptr)
+				return false;
+			std::vector<SpillRecord> records(HBIMPointCloud::kChunkPoints / 4);
+			for (size_t read = 0; (read = std::fread(records.data(), sizeof(SpillRecord), records.size(), file)) > 0;) {
+				for (size_t i = 0; i < read; ++i) {
+					VoxelSum& sum = own[records[i].key];
+					sum.x += records[i].sum.x;
+					sum.y += records[i].sum.y;
+					sum.z += records[i].sum.z;
+					sum.r += records[i].sum.r;
+					sum.g += records[i].sum.g;
+					sum.b += records[i].sum.b;
+					sum.count += records[i].sum.count;
+				}
+			}
+			const bool ok = std::ferror(file) == 0;
+			std::fclose(file);
+			std::error_code ec;
+			std::filesystem::remove(path, ec);
+			return ok;
+		}
+
+		unsigned workers = 1;
+		std::filesystem::path spillDir;
+		std::vector<VoxelMap> buckets;							// 桶 b 由线程 b % workers 累加
+		std::vector<bool> spilled;
+		std::vector<std::vector<std::vector<UInt32>>> groups;	// [分组的线程][所属线程] 点序号
+		std::vector<VoxelKey> keys;
+		double minimum[3];
+		UInt64 inputPoints = 0;
+		UInt64 spilledBytes = 0;
+		bool spillFailed = false;
+	};
+
+	static void ApplyOutcome(const std::filesystem::path& projectDir, const GS::UniString& scanFile, const Outcome& outcome) {
+		ACAPI_WriteReport("HBIMPointCloudCache: %llu 点降采样为 %llu 点，%u 线程，%.3f 秒，溢出到磁盘 %.1f MB", false,
+						  static_cast<unsigned long long>(outcome.inputPoints), static_cast<unsigned long long>(outcome.outputPoints),
+						  outcome.workers, outcome.seconds, outcome.spilledBytes / (1024.0 * 1024.0));
+		if (!outcome.completed) {
+			GS::UniString msg = "导入扫描点云失败";
+			if (!outcome.error.IsEmpty()) {
+				msg.Append("：");
+				msg.Append(outcome.error);
+			}
+			DG::InformationAlert("导入扫描点云", msg, "确定");
+			return;
+		}
+		// 导入期间切换了项目，不再提示
+		const HBIMProject::Context& context = HBIMProject::GetContext();
+		if (!context.isSaved || context.projectDir != projectDir)
+			return;
+
+		GS::UniString msg = "已导入 ";
+		msg.Append(scanFile);
+		msg.Append(GS::UniString::Printf("：读取 %llu 点，按 %.0f cm 体素降采样为 %llu 点，缓存 %.1f MB，用时 %.1f 秒（%u 线程）。\n",
+										 static_cast<unsigned long long>(outcome.inputPoints), HBIMPointCloudCache::kVoxelSize * 100.0,
+										 static_cast<unsigned long long>(outcome.outputPoints), outcome.cacheBytes / (1024.0 * 1024.0),
+										 outcome.seconds, outcome.workers));
+		msg.Append("之后按构件统计点云与扫描偏差分析选择同一扫描文件时将直接读取缓存。\n缓存: ");
+		msg.Append(GS::UniString(outcome.cachePath.string().c_str(), CC_UTF8));
+		DG::InformationAlert("导入扫描点云", msg, "确定");
+	}
+
+	static void IngestInBackground(std::shared_ptr<HBIMPointCloud::Source> source, std::string scanPath, SourceStamp stamp,
+								   std::filesystem::path projectDir, GS::UniString scanFile) {
+		auto start = std::chrono::steady_clock::now();
+		auto outcome = std::make_shared<Outcome>();
+		outcome->cachePath = GetCachePath(projectDir, scanPath);
+
+		// 溢出文件放在缓存旁边，导入结束（包括中止）时随回调对象一起删除
+		std::filesystem::path spillDir = outcome->cachePath;
+		spillDir += ".spill";
+		VoxelCallback callback(spillDir);
+		outcome->workers = callback.GetWorkerCount();
+		outcome->completed = source->DoStreaming(callback);
+		outcome->error = source->GetError();
+		outcome->inputPoints = callback.GetInputPoints();
+		if (callback.HasSpillFailed())
+			outcome->error = "写入点云溢出文件失败";
+		if (s_stop)
+			return;
+		if (outcome->completed)
+			outcome->completed = callback.WriteCache(outcome->cachePath, scanPath, stamp, *outcome);
+		outcome->spilledBytes = callback.GetSpilledBytes();
+		outcome->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		HBIMEventLoop::Post([projectDir, scanFile, outcome]() { ApplyOutcome(projectDir, scanFile, *outcome); });
+	}
+
+}
+
+namespace HBIMPointCloudCache {
+
+std::unique_ptr<HBIMPointCloud::Source> OpenScan(const std::filesystem::path& projectDir, const GS::UniString& scanPath,
+												 bool& outFromCache, GS::UniString& outError) {
+	outFromCache = false;
+	if (!projectDir.empty()) {
+		const std::string path = scanPath.ToCStr().Get();
+		std::unique_ptr<CacheSource> cache = OpenCache(GetCachePath(projectDir, path), path);
+		if (cache != nullptr) {
+			outFromCache = true;
+			return cache;
+		}
+	}
+	return HBIMPointCloud::OpenScan(scanPath, outError);
+}
+
+void Shutdown() {
+	s_stop = true;
+	if (s_worker.valid())
+		s_worker.wait();
+}
+
+void RunIngestCommand() {
+	const HBIMProject::Context& context = HBIMProject::GetContext();
+	if (!context.isSaved) {
+		DG::InformationAlert("导入扫描点云", "项目未保存，无法在项目目录中写出点云缓存。", "确定");
+		return;
+	}
+	if (HBIM::IsWorkerRunning(s_worker)) {
+		DG::InformationAlert("导入扫描点云", "上一次导入尚未完成，请稍后再试。", "确定");
+		return;
+	}
+
+	GS::UniString scanPath;
+	if (!HBIMPointCloud::ChooseScanFile("选择要导入的扫描点云", scanPath))
+		return;
+	const std::string path = scanPath.ToCStr().Get();
+	if (OpenCache(GetCachePath(context.projectDir, path), path) != nullptr) {
+		DG::InformationAlert("导入扫描点云", "该扫描文件已导入，缓存与文件一致。", "确定");
+		return;
+	}
+	GS::UniString error;
+	std::shared_ptr<HBIMPointCloud::Source> source = HBIMPointCloud::OpenScan(scanPath, error);
+	SourceStamp stamp;
+	if (source == nullptr || !GetSourceStamp(path, stamp)) {
+		DG::InformationAlert("导入扫描点云", error.IsEmpty() ? GS::UniString("无法读取扫描文件") : error, "确定");
+		return;
+	}
+
+	const GS::UniString scanFile(std::filesystem::path(path).filename().string().c_str(), CC_UTF8);
+	ACAPI_WriteReport("HBIMPointCloudCache: 开始导入 %s", false, path.c_str());
+	s_stop = false;
+	s_worker = std::async(std::launch::async, IngestInBackground, source, path, stamp, context.projectDir, scanFile);
+}
+
+}
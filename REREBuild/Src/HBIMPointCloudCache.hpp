@@ -0,0 +1,34 @@
+#ifndef HBIMPOINTCLOUDCACHE_HPP
+#define HBIMPOINTCLOUDCACHE_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+#include "HBIMPointCloud.hpp"
+
+#include <filesystem>
+#include <memory>
+
+// 扫描点云导入为项目缓存。
+// 扫描文件按块流式读取（HBIMPointCloud），每块由多个线程按体素划分后同时体素降采样（每个体素保留点的重心与平均颜色）；
+// 体素按空间区块分桶，内存中体素过多时把最大的桶追加到溢出文件，写出时逐桶合并，内存占用与扫描大小无关。
+// 结果写入项目目录下 HBIM_PointCloudCache 中的紧凑二进制文件（相对原点的单精度坐标与颜色，每点 16 字节）。
+// 缓存记录原扫描文件的路径、大小与修改时间，原文件变化后自动失效；按构件的点云统计与偏差分析优先读取缓存。
+namespace HBIMPointCloudCache {
+
+	// 体素边长（m）
+	static const double kVoxelSize = 0.02;
+
+	// 扫描文件已导入且缓存与文件一致时打开缓存（outFromCache 为 true），否则打开扫描文件本身；
+	// 只读取文件头，失败时返回 nullptr 与错误信息
+	std::unique_ptr<HBIMPointCloud::Source> OpenScan(const std::filesystem::path& projectDir, const GS::UniString& scanPath,
+													 bool& outFromCache, GS::UniString& outError);
+
+	// 在 FreeData 中调用：中止正在进行的导入并等待后台线程结束
+	void Shutdown();
+
+	// 菜单入口：选择扫描文件，后台降采样并写出缓存，完成后提示
+	void RunIngestCommand();
+
+}
+
+#endif
@@ -0,0 +1,573 @@
+// *****************************************************************************
+// File:			HBIMPointCloudStats.cpp
+// Description:		按构件统计扫描点云：包围盒裁剪、分块并行归属、密度/残差/颜色直方图、
+//					项目数据保存与CSV表格
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMPointCloudStats.hpp"
+#include "HBIMCommon.hpp"
+#include "HBIMEventLoop.hpp"
+#include "HBIMGlobalIdIndex.hpp"
+#include "HBIMNotifications.hpp"
+#include "HBIMPointCloud.hpp"
+#include "HBIMPointCloudCache.hpp"
+#include "HBIMProject.hpp"
+#include "HBIMSpatialIndex.hpp"
+#include "DGModule.hpp"
+#include "HashTable.hpp"
+#include "MemoryIChannel32.hpp"
+#include "MemoryOChannel32.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+	static const unsigned kMaxWorkers = 8;
+	static const USize kMaxReportedElements = 10;
+	static const char* kTableFileName = "HBIM_PointCloudStats.csv";
+
+	// 裁剪盒在构件包围盒外扩的距离（m）：扫描噪声与配准误差
+	static const double kClipTolerance = 0.05;
+
+	// 工作线程每次领取的点数
+	static const UInt32 kBlockPoints = 1u << 14;
+
+	// 按构件保存的统计结果
+	static const GS::UniString kStatsModulName = "HBIMPointCloudStats";
+	static const Int32 kStatsModulVersion = 2;		// 版本 2 增加 voxelSize
+	static const UInt32 kStatsMagic = 0x48425043;		// 'HBPC'
+
+	using StatsTable = GS::HashTable<API_Guid, HBIMPointCloudStats::ElementStats>;
+
+	// 一个工作线程对一个构件的累计
+	struct Accumulator {
+		UInt64 count = 0;
+		UInt64 outside = 0;
+		double sumSquares = 0.0;
+		double maxResidual = 0.0;
+		UInt32 histogram[HBIMPointCloudStats::kColorBins] = {};
+	};
+
+	struct Job {
+		std::vector<API_Guid> guids;
+		std::vector<HBIMSpatialIndex::Box> boxes;		// 构件包围盒
+		HBIMSpatialIndex::BoxTree clipTree;				// 外扩后的裁剪盒
+		HBIMSpatialIndex::Box clipBounds;				// 全部裁剪盒的外包盒，先用它排除大部分点
+		std::unique_ptr<HBIMPointCloud::Source> source;
+		GS::UniString scanFile;
+		double voxelSize = 0.0;							// 读取导入缓存时为降采样体素边长（m）
+		std::filesystem::path projectDir;
+	};
+
+	struct Outcome {
+		std::vector<HBIMPointCloudStats::ElementStats> stats;
+		UInt64 totalPoints = 0;
+		UInt64 clippedPoints = 0;
+		bool completed = false;
+		GS::UniString error;
+		double seconds = 0.0;
+		double voxelSize = 0.0;
+	};
+
+	// 主线程访问
+	static StatsTable s_stats;
+	static bool s_statsLoaded = false;
+
+	static std::future<void> s_worker;
+	static std::atomic<bool> s_stop(false);
+
+	// ---- 几何 ----------------------------------------------------------------
+
+	static HBIMSpatialIndex::Box Expand(const HBIMSpatialIndex::Box& box, double distance) {
+		HBIMSpatialIndex::Box expanded = box;
+		expanded.xMin -= distance;
+		expanded.yMin -= distance;
+		expanded.zMin -= distance;
+		expanded.xMax += distance;
+		expanded.yMax += distance;
+		expanded.zMax += distance;
+		return expanded;
+	}
+
+	static bool Contains(const HBIMSpatialIndex::Box& box, const HBIMPointCloud::Point& point) {
+		return point.x >= box.xMin && point.x <= box.xMax &&
+			   point.y >= box.yMin && point.y <= box.yMax &&
+			   point.z >= box.zMin && point.z <= box.zMax;
+	}
+
+	// 点到包围盒表面的有符号距离：盒外为正，盒内为负
+	static double SignedDistance(const HBIMSpatialIndex::Box& box, const HBIMPointCloud::Point& point) {
+		const double dx = std::max({ box.xMin - point.x, 0.0, point.x - box.xMax });
+		const double dy = std::max({ box.yMin - point.y, 0.0, point.y - box.yMax });
+		const double dz = std::max({ box.zMin - point.z, 0.0, point.z - box.zMax });
+		if (dx > 0.0 || dy > 0.0 || dz > 0.0)
+			return std::sqrt(dx * dx + dy * dy + dz * dz);
+		return -std::min({ point.x - box.xMin, box.xMax - point.x,
+						   point.y - box.yMin, box.yMax - point.y,
+						   point.z - box.zMin, box.zMax - point.z });
+	}
+
+	static double SurfaceArea(const HBIMSpatialIndex::Box& box) {
+		const double a = box.xMax - box.xMin, b = box.yMax - box.yMin, c = box.zMax - box.zMin;
+		return 2.0 * (a * b + b * c + c * a);
+	}
+
+	static UInt32 ColorBin(UInt32 argbColor) {
+		const UInt32 r = (argbColor >> 22) & 0x3, g = (argbColor >> 14) & 0x3, b = (argbColor >> 6) & 0x3;
+		return r * 16 + g * 4 + b;
+	}
+
+	// ---- 分块并行归属 ----------------------------------------------------------------
+
+	class ClipCallback : public HBIMPointCloud::Callback {
+	public:
+		explicit ClipCallback(const Job& job) : job(job) {
+			const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+			workers = std::min(hardware, kMaxWorkers);
+			accumulators.assign(workers, std::vector<Accumulator>(job.boxes.size()));
+			clipped.assign(workers, 0);
+		}
+
+		bool Append(const HBIMPointCloud::Point* points, UInt32 numberOfPoints) override {
+			if (s_stop)
+				return false;
+			total += numberOfPoints;
+			std::atomic<UInt32> next(0);
+			auto work = [&](unsigned worker) {
+				std::vector<UInt32> candidates;
+				std::vector<Accumulator>& own = accumulators[worker];
+				UInt64 ownClipped = 0;
+				for (UInt32 begin = next.fetch_add(kBlockPoints); begin < numberOfPoints; begin = next.fetch_add(kBlockPoints)) {
+					const UInt32 end = std::min(numberOfPoints, begin + kBlockPoints);
+					for (UInt32 i = begin; i < end; ++i)
+						ownClipped += ClipPoint(points[i], candidates, own) ? 1 : 0;
+				}
+				clipped[worker] += ownClipped;
+			};
+			const unsigned threadCount = static_cast<unsigned>(std::min<UInt64>(workers, (numberOfPoints + kBlockPoints - 1) / kBlockPoints));
+			std::vector<std::thread> threads;
+			for (unsigned i = 1; i < threadCount; ++i)
+				threads.emplace_back(work, i);
+			work(0);
+			for (std::thread& thread : threads)
+				thread.join();
+			return !s_stop;
+		}
+
+		void Merge(Outcome& outcome) const {
+			outcome.totalPoints = total;
+			for (UInt64 count : clipped)
+				outcome.clippedPoints += count;
+
+			const Int64 now = static_cast<Int64>(std::time(nullptr));
+			for (size_t element = 0; element < job.boxes.size(); ++element) {
+				Accumulator sum;
+				for (const std::vector<Accumulator>& own : accumulators) {
+					const Accumulator& part = own[element];
+					sum.count += part.count;
+					sum.outside += part.outside;
+					sum.sumSquares += part.sumSquares;
+					sum.maxResidual = std::max(sum.maxResidual, part.maxResidual);
+					for (UInt32 bin = 0; bin < HBIMPointCloudStats::kColorBins; ++bin)
+						sum.histogram[bin] += part.histogram[bin];
+				}
+
+				HBIMPointCloudStats::ElementStats stats;
+				stats.elemGuid = job.guids[element];
+				stats.scanFile = job.scanFile;
+				stats.voxelSize = job.voxelSize;
+				stats.time = now;
+				stats.pointCount = sum.count;
+				stats.outsideCount = sum.outside;
+				const double area = SurfaceArea(job.boxes[element]);
+				stats.density = area > 0.0 ? sum.count / area : 0.0;
+				stats.rmsResidual = sum.count > 0 ? std::sqrt(sum.sumSquares / sum.count) : 0.0;
+				stats.maxResidual = sum.maxResidual;
+				std::copy(std::begin(sum.histogram), std::end(sum.histogram), std::begin(stats.colorHistogram));
+				outcome.stats.push_back(stats);
+			}
+		}
+
+	private:
+		const Job& job;
+		unsigned workers = 1;
+		std::vector<std::vector<Accumulator>> accumulators;		// 每个工作线程一份，最后合并，归属时不加锁
+		std::vector<UInt64> clipped;
+		UInt64 total = 0;
+
+		// 点归入离包围盒表面最近的构件；不在任何裁剪盒内时返回 false
+		bool ClipPoint(const HBIMPointCloud::Point& point, std::vector<UInt32>& candidates, std::vector<Accumulator>& own) const {
+			if (!Contains(job.clipBounds, point))
+				return false;
+			HBIMSpatialIndex::Box query;
+			query.xMin = query.xMax = point.x;
+			query.yMin = query.yMax = point.y;
+			query.zMin = query.zMax = point.z;
+			job.clipTree.Intersecting(query, candidates);
+			if (candidates.empty())
+				return false;
+
+			UInt32 best = candidates[0];
+			double bestDistance = SignedDistance(job.boxes[best], point);
+			for (size_t i = 1; i < candidates.size(); ++i) {
+				const double distance = SignedDistance(job.boxes[candidates[i]], point);
+				if (std::fabs(distance) < std::fabs(bestDistance)) {
+					best = candidates[i];
+					bestDistance = distance;
+				}
+			}
+
+			Accumulator& acc = own[best];
+			const double residual = std::fabs(bestDistance);
+			acc.count += 1;
+			acc.outside += bestDistance > 0.0 ? 1 : 0;
+			acc.sumSquares += residual * residual;
+			acc.maxResidual = std::max(acc.maxResidual, residual);
+			acc.histogram[ColorBin(point.argbColor)] += 1;
+			return true;
+		}
+	};
+
+	// ---- 项目数据 ----------------------------------------------------------------
+
+	static GSErrCode LoadStats(StatsTable& outStats) {
+		outStats.Clear();
+		API_ModulData modulData {};
+		GSErrCode err = ACAPI_ModulData_Get(&modulData, kStatsModulName);
+		if (err == APIERR_NOMODULEDATA)
+			return NoError;
+		if (err != NoError)
+			return err;
+		if (modulData.dataVersion != 1 && modulData.dataVersion != kStatsModulVersion) {
+			ACAPI_WriteReport("HBIMPointCloudStats: 不支持的项目数据版本 %d", true, modulData.dataVersion);
+			BMKillHandle(&modulData.dataHdl);
+			return APIERR_BADPARS;
+		}
+
+		GS::MemoryIChannel32 ic(*modulData.dataHdl, BMGetHandleSize(modulData.dataHdl));
+		UInt32 magic = 0, count = 0;
+		err = ic.Read(magic);
+		if (err == NoError && magic != kStatsMagic)
+			err = APIERR_BADPARS;
+		if (err == NoError)
+			err = ic.Read(count);
+		for (UInt32 i = 0; i < count && err == NoError; ++i) {
+			GS::Guid guid;
+			HBIMPointCloudStats::ElementStats stats;
+			err = ic.Read(guid);
+			if (err == NoError) err = stats.scanFile.Read(ic);
+			if (err == NoError) err = ic.Read(stats.time);
+			if (err == NoError) err = ic.Read(stats.pointCount);
+			if (err == NoError) err = ic.Read(stats.outsideCount);
+			if (err == NoError) err = ic.Read(stats.density);
+			if (err == NoError) err = ic.Read(stats.rmsResidual);
+			if (err == NoError) err = ic.Read(stats.maxResidual);
+			for (UInt32 bin = 0; bin < HBIMPointCloudStats::kColorBins && err == NoError; ++bin)
+				err = ic.Read(stats.colorHistogram[bin]);
+			if (err == NoError && modulData.dataVersion >= 2)
+				err = ic.Read(stats.voxelSize);
+			if (err == NoError) {
+				stats.elemGuid = GSGuid2APIGuid(guid);
+				outStats.Put(stats.elemGuid, stats);
+			}
+		}
+		BMKillHandle(&modulData.dataHdl);
+		if (err != NoError) {
+			ACAPI_WriteReport("HBIMPointCloudStats: 解析项目数据失败: %d", true, err);
+			outStats.Clear();
+		}
+		return err;
+	}
+
+	static GSErrCode StoreStats(const StatsTable& stats) {
+		GS::MemoryOChannel32 oc(GS::MemoryOChannel32::BMAllocation);
+		GSErrCode err = oc.Write(kStatsMagic);
+		if (err == NoError) err = oc.Write(static_cast<UInt32>(stats.GetSize()));
+		for (auto it = stats.EnumerateValues(); it != nullptr && err == NoError; ++it) {
+			const HBIMPointCloudStats::ElementStats& row = *it;
+			err = oc.Write(APIGuid2GSGuid(row.elemGuid));
+			if (err == NoError) err = row.scanFile.Write(oc);
+			if (err == NoError) err = oc.Write(row.time);
+			if (err == NoError) err = oc.Write(row.pointCount);
+			if (err == NoError) err = oc.Write(row.outsideCount);
+			if (err == NoError) err = oc.Write(row.density);
+			if (err == NoError) err = oc.Write(row.rmsResidual);
+			if (err == NoError) err = oc.Write(row.maxResidual);
+			for (UInt32 bin = 0; bin < HBIMPointCloudStats::kColorBins && err == NoError; ++bin)
+				err = oc.Write(row.colorHistogram[bin]);
+			if (err == NoError) err = oc.Write(row.voxelSize);
+		}
+		if (err != NoError)
+			return err;
+
+		API_ModulData modulData {};
+		modulData.dataVersion = kStatsModulVersion;
+		modulData.platformSign = GS::Act_Platform_Sign;
+		modulData.dataHdl = BMAllocateHandle(oc.GetDataSize(), ALLOCATE_CLEAR, 0);
+		if (modulData.dataHdl == nullptr)
+			return APIERR_MEMFULL;
+		BNCopyMemory(*modulData.dataHdl, oc.GetDestination(), oc.GetDataSize());
+		err = ACAPI_ModulData_Store(&modulData, kStatsModulName);
+		BMKillHandle(&modulData.dataHdl);
+		return err;
+	}
+
+	static bool EnsureLoaded() {
+		if (!s_statsLoaded && LoadStats(s_stats) == NoError)
+			s_statsLoaded = true;
+		return s_statsLoaded;
+	}
+
+	// ---- 表格与报告 ----------------------------------------------------------------
+
+	// 点数、点密度按哪种点云计算
+	static std::string FormatSource(double voxelSize) {
+		if (voxelSize <= 0.0)
+			return "原扫描";
+		return GS::UniString::Printf("导入缓存(%.0f cm体素降采样)", voxelSize * 100.0).ToCStr().Get();
+	}
+
+	static std::string FormatColor(UInt32 argbColor) {
+		return GS::UniString::Printf("#%06X", static_cast<unsigned>(argbColor & 0xFFFFFF)).ToCStr().Get();
+	}
+
+	// UTF-8 带 BOM，Excel 可直接打开
+	static bool WriteTable(const std::filesystem::path& tablePath, const std::vector<HBIMPointCloudStats::ElementStats>& stats) {
+		return HBIM::WriteCsvTable(tablePath, "GlobalId,扫描文件,数据来源,点数,包围盒外点数,点密度(点/m²),残差RMS(mm),最大残差(mm),主色",
+			[&](std::ostream& out) {
+				for (const HBIMPointCloudStats::ElementStats& row : stats) {
+					out << HBIM::CsvField(HBIMGlobalIdIndex::GetGlobalId(row.elemGuid)) << ',' << HBIM::CsvField(row.scanFile) << ','
+						<< FormatSource(row.voxelSize) << ','
+						<< row.pointCount << ',' << row.outsideCount << ','
+						<< GS::UniString::Printf("%.1f", row.density).ToCStr().Get() << ','
+						<< GS::UniString::Printf("%.1f", row.rmsResidual * 1000.0).ToCStr().Get() << ','
+						<< GS::UniString::Printf("%.1f", row.maxResidual * 1000.0).ToCStr().Get() << ','
+						<< (row.pointCount > 0 ? FormatColor(HBIMPointCloudStats::GetDominantColor(row)) : std::string()) << '\n';
+				}
+			}
+		);
+	}
+
+	static GS::UniString FormatReport(const Outcome& outcome, const std::filesystem::path& tablePath, bool tableWritten) {
+		std::vector<const HBIMPointCloudStats::ElementStats*> ranked;
+		UInt32 emptyElements = 0;
+		for (const HBIMPointCloudStats::ElementStats& row : outcome.stats) {
+			if (row.pointCount == 0)
+				++emptyElements;
+			else
+				ranked.push_back(&row);
+		}
+		// 残差最大的构件排在前面，多为点云与模型不符或包围盒过大
+		std::sort(ranked.begin(), ranked.end(), [](const HBIMPointCloudStats::ElementStats* a, const HBIMPointCloudStats::ElementStats* b) {
+			return a->rmsResidual > b->rmsResidual;
+		});
+
+		GS::UniString msg = GS::UniString::Printf("扫描点 %llu 个，落入构件裁剪盒 %llu 个，耗时 %.1f 秒。\n",
+												  static_cast<unsigned long long>(outcome.totalPoints),
+												  static_cast<unsigned long long>(outcome.clippedPoints), outcome.seconds);
+		msg.Append(GS::UniString::Printf("构件 %u 个，其中没有点的 %u 个。\n",
+										 static_cast<unsigned>(outcome.stats.size()), emptyElements));
+		if (outcome.voxelSize > 0.0) {
+			msg.Append(GS::UniString::Printf("读取的是导入缓存（%.0f cm 体素降采样，每个体素一个点），点数与点密度是降采样后的值，"
+											 "不能与原扫描的统计直接比较。\n", outcome.voxelSize * 100.0));
+		}
+		if (tableWritten) {
+			msg.Append("表格: ");
+			msg.Append(GS::UniString(tablePath.string().c_str(), CC_UTF8));
+		} else {
+			msg.Append("表格写入失败");
+		}
+
+		for (size_t i = 0; i < ranked.size() && i < kMaxReportedElements; ++i) {
+			if (i == 0)
+				msg.Append("\n\n残差最大的构件:");
+			msg.Append("\n  ");
+			msg.Append(HBIMGlobalIdIndex::GetGlobalId(ranked[i]->elemGuid));
+			msg.Append(GS::UniString::Printf(": %llu 点，RMS %.1f mm，最大 %.1f mm",
+											 static_cast<unsigned long long>(ranked[i]->pointCount),
+											 ranked[i]->rmsResidual * 1000.0, ranked[i]->maxResidual * 1000.0));
+		}
+		return msg;
+	}
+
+	// ---- 后台统计 ----------------------------------------------------------------
+
+	static void ApplyOutcome(const std::filesystem::path& projectDir, const Outcome& outcome) {
+		ACAPI_WriteReport("HBIMPointCloudStats: %llu 点，裁剪 %llu 点，%d 个构件，耗时 %.3f 秒", false,
+						  static_cast<unsigned long long>(outcome.totalPoints), static_cast<unsigned long long>(outcome.clippedPoints),
+						  static_cast<int>(outcome.stats.size()), outcome.seconds);
+		if (!outcome.completed) {
+			GS::UniString msg = "读取扫描文件失败";
+			if (!outcome.error.IsEmpty()) {
+				msg.Append("：");
+				msg.Append(outcome.error);
+			}
+			DG::InformationAlert("点云按构件统计", msg, "确定");
+			return;
+		}
+		// 统计期间切换了项目，结果作废
+		const HBIMProject::Context& context = HBIMProject::GetContext();
+		if (!context.isSaved || context.projectDir != projectDir)
+			return;
+
+		StatsTable merged;
+		GSErrCode err = LoadStats(merged);
+		if (err == NoError) {
+			for (const HBIMPointCloudStats::ElementStats& row : outcome.stats)
+				merged.Put(row.elemGuid, row);
+			err = ACAPI_CallUndoableCommand("保存点云统计",
+				[&]() -> GSErrCode {
+					return StoreStats(merged);
+				}
+			);
+		}
+		if (err == NoError) {
+			s_stats = merged;
+			s_statsLoaded = true;
+		} else {
+			ACAPI_WriteReport("HBIMPointCloudStats: 保存统计结果失败，错误码=%d", true, err);
+		}
+
+		const std::filesystem::path tablePath = projectDir / kTableFileName;
+		const bool tableWritten = WriteTable(tablePath, outcome.stats);
+		if (!tableWritten)
+			ACAPI_WriteReport("HBIMPointCloudStats: 写入表格失败: %s", true, tablePath.string().c_str());
+
+		GS::UniString msg = FormatReport(outcome, tablePath, tableWritten);
+		if (err != NoError)
+			msg.Append(GS::UniString::Printf("\n\n保存到项目数据失败 (错误码: %d)", err));
+		DG::InformationAlert("点云按构件统计", msg, "确定");
+	}
+
+	static void StatisticsInBackground(std::shared_ptr<Job> job) {
+		auto start = std::chrono::steady_clock::now();
+		auto outcome = std::make_shared<Outcome>();
+		ClipCallback callback(*job);
+		outcome->completed = job->source->DoStreaming(callback);
+		outcome->error = job->source->GetError();
+		if (s_stop)
+			return;
+		if (outcome->completed)
+			callback.Merge(*outcome);
+		outcome->voxelSize = job->voxelSize;
+		outcome->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		const std::filesystem::path projectDir = job->projectDir;
+		HBIMEventLoop::Post([projectDir, outcome]() { ApplyOutcome(projectDir, *outcome); });
+	}
+
+	static void OnProjectEvent(API_NotifyEventID notifID) {
+		switch (notifID) {
+			case APINotify_New:
+			case APINotify_NewAndReset:
+			case APINotify_Open:
+			case APINotify_Close:
+			case APINotify_Quit:
+				s_stats.Clear();
+				s_statsLoaded = false;
+				break;
+			default:
+				break;
+		}
+	}
+
+}
+
+namespace HBIMPointCloudStats {
+
+void Initialize() {
+	HBIMNotifications::AddProjectListener(OnProjectEvent);
+}
+
+void Shutdown() {
+	s_stop = true;
+	if (s_worker.valid())
+		s_worker.wait();
+}
+
+bool GetElementStats(const API_Guid& elemGuid, ElementStats& outStats) {
+	if (!EnsureLoaded())
+		return false;
+	const ElementStats* stats = s_stats.GetPtr(elemGuid);
+	if (stats == nullptr)
+		return false;
+	outStats = *stats;
+	return true;
+}
+
+UInt32 GetDominantColor(const ElementStats& stats) {
+	const UInt32* best = std::max_element(std::begin(stats.colorHistogram), std::end(stats.colorHistogram));
+	if (*best == 0)
+		return 0;
+	const UInt32 bin = static_cast<UInt32>(best - std::begin(stats.colorHistogram));
+	// 每档 64 级，取档中心
+	const UInt32 r = (bin / 16) * 64 + 32, g = ((bin / 4) % 4) * 64 + 32, b = (bin % 4) * 64 + 32;
+	return 0xFF000000u | (r << 16) | (g << 8) | b;
+}
+
+void RunStatisticsCommand() {
+	const HBIMProject::Context& context = HBIMProject::GetContext();
+	if (!context.isSaved) {
+		DG::InformationAlert("点云按构件统计", "项目未保存，无法写出统计表格。", "确定");
+		return;
+	}
+	if (HBIM::IsWorkerRunning(s_worker)) {
+		DG::InformationAlert("点云按构件统计", "上一次统计尚未完成，请稍后再试。", "确定");
+		return;
+	}
+
+	auto job = std::make_shared<Job>();
+	HBIM::CollectTargetElements(job->guids, job->boxes);
+	if (job->guids.empty()) {
+		DG::InformationAlert("点云按构件统计", "没有可统计的三维构件。", "确定");
+		return;
+	}
+
+	GS::UniString scanPath;
+	if (!HBIMPointCloud::ChooseScanFile("选择已配准到项目坐标的扫描点云", scanPath))
+		return;
+	GS::UniString error;
+	bool fromCache = false;
+	job->source = HBIMPointCloudCache::OpenScan(context.projectDir, scanPath, fromCache, error);
+	if (job->source == nullptr) {
+		DG::InformationAlert("点云按构件统计", error, "确定");
+		return;
+	}
+
+	std::vector<HBIMSpatialIndex::Box> clipBoxes;
+	clipBoxes.reserve(job->boxes.size());
+	for (const HBIMSpatialIndex::Box& box : job->boxes)
+		clipBoxes.push_back(Expand(box, kClipTolerance));
+	job->clipBounds = clipBoxes[0];
+	for (const HBIMSpatialIndex::Box& box : clipBoxes) {
+		job->clipBounds.xMin = std::min(job->clipBounds.xMin, box.xMin);
+		job->clipBounds.yMin = std::min(job->clipBounds.yMin, box.yMin);
+		job->clipBounds.zMin = std::min(job->clipBounds.zMin, box.zMin);
+		job->clipBounds.xMax = std::max(job->clipBounds.xMax, box.xMax);
+		job->clipBounds.yMax = std::max(job->clipBounds.yMax, box.yMax);
+		job->clipBounds.zMax = std::max(job->clipBounds.zMax, box.zMax);
+	}
+	job->clipTree.Build(clipBoxes);
+	job->scanFile = GS::UniString(std::filesystem::path(scanPath.ToCStr().Get()).filename().string().c_str(), CC_UTF8);
+	job->voxelSize = fromCache ? HBIMPointCloudCache::kVoxelSize : 0.0;
+	job->projectDir = context.projectDir;
+
+	ACAPI_WriteReport("HBIMPointCloudStats: 开始统计 %d 个构件，扫描文件 %s%s", false,
+					  static_cast<int>(job->guids.size()), scanPath.ToCStr().Get(), fromCache ? "（读取缓存）" : "");
+	s_stop = false;
+	s_worker = std::async(std::launch::async, StatisticsInBackground, job);
+}
+
+}
@@ -0,0 +1,46 @@
+#ifndef HBIMPOINTCLOUDSTATS_HPP
+#define HBIMPOINTCLOUDSTATS_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+
+// 按构件统计扫描点云：每个构件的三维包围盒外扩一个容差作为裁剪盒（相当于 IPointCloud::CreateClip 的六个平面），
+// 扫描文件按块流式读取，每块由工作线程并行归入裁剪盒（HBIMSpatialIndex），同一点落在多个裁剪盒中时
+// 只归入离包围盒表面最近的构件。每个构件统计点数、点密度、点到包围盒表面的残差与颜色直方图，
+// 结果保存在项目数据（ModulData）中，并写出表格。
+namespace HBIMPointCloudStats {
+
+	// 颜色直方图：RGB 各分 4 档，共 64 格；下标 = r档 * 16 + g档 * 4 + b档
+	static const UInt32 kColorBins = 64;
+
+	struct ElementStats {
+		API_Guid elemGuid = APINULLGuid;
+		GS::UniString scanFile;			// 扫描文件名（不含目录）
+		Int64 time = 0;					// 统计时间（UTC 秒）
+		double voxelSize = 0.0;			// 读取导入缓存时为降采样体素边长（m），此时点数与点密度按体素计；0 为原扫描
+		UInt64 pointCount = 0;
+		UInt64 outsideCount = 0;		// 落在包围盒外、容差内的点数
+		double density = 0.0;			// 点数 / 包围盒表面积（点/m²）
+		double rmsResidual = 0.0;		// 点到包围盒表面距离的均方根（m）
+		double maxResidual = 0.0;		// 点到包围盒表面的最大距离（m）
+		UInt32 colorHistogram[kColorBins] = {};
+	};
+
+	// 在 Initialize 中调用（需在 HBIMNotifications::Initialize 之后）
+	void Initialize();
+
+	// 在 FreeData 中调用：中止正在进行的统计并等待后台线程结束
+	void Shutdown();
+
+	// 已保存的一个构件的统计结果（主线程）
+	bool GetElementStats(const API_Guid& elemGuid, ElementStats& outStats);
+
+	// 直方图中点数最多一格的中心颜色（0xAARRGGBB）；没有点时返回 0
+	UInt32 GetDominantColor(const ElementStats& stats);
+
+	// 菜单入口：对选中的构件（未选中时为全部三维构件）选择扫描文件，后台统计，完成后保存结果并写出表格
+	void RunStatisticsCommand();
+
+}
+
+#endif
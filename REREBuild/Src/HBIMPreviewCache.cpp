@@ -0,0 +1,439 @@
+// *****************************************************************************
+// File:			HBIMPreviewCache.cpp
+// Description:		面板预览缩略图缓存：后台解码缩放、标注变换到缩略图坐标并绘制
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMPreviewCache.hpp"
+#include "HBIMAnnotations.hpp"
+#include "HBIMImageDerivatives.hpp"
+#include "HBIMEventLoop.hpp"
+#include "HBIMNotifications.hpp"
+#include "GXImage.hpp"
+#include "NativeContext.hpp"
+#include "NativeImage.hpp"
+#include "Font.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+	// 360×180 的缩略图约 250KB，缓存图与叠加后的图各一份
+	static const size_t kMaxEntries = 32;
+	static const int kCircleSegments = 32;
+	static const float kPointHalfSize = 2.5f;
+	static const float kLineWidth = 1.5f;
+	static const double kLabelFontSize = 10.0;
+	static const double kPi = 3.14159265358979323846;
+
+	// 按标注名散列取色，同一标注名在不同照片中颜色一致
+	static const unsigned char kLabelColors[][3] = {
+		{ 230,  40,  40 },
+		{ 255, 150,   0 },
+		{ 240, 220,   0 },
+		{  40, 200,  60 },
+		{   0, 180, 230 },
+		{  60,  90, 240 },
+		{ 200,  60, 220 },
+		{ 255, 255, 255 }
+	};
+
+	struct OverlayPoint {
+		float x = 0.0f;
+		float y = 0.0f;
+	};
+
+	// 已变换到缩略图像素坐标的标注；矩形、圆也转为折线
+	struct OverlayShape {
+		std::vector<OverlayPoint> points;
+		bool closed = true;
+		size_t color = 0;
+		std::string label;
+	};
+
+	// 交给后台线程的标注副本（不含 GS 类型）
+	struct SourceShape {
+		std::string label;
+		std::string shapeType;
+		std::vector<OverlayPoint> points;		// 原图像素坐标
+	};
+
+	struct Entry {
+		Int64 writeTime = 0;
+		UInt64 fileSize = 0;
+		UInt32 maxWidth = 0;
+		UInt32 maxHeight = 0;
+		NewDisplay::NativeImage base;			// 缩放后的缩略图
+		UInt32 sourceWidth = 0;					// 原图尺寸（像素）
+		UInt32 sourceHeight = 0;
+		UInt64 annotationRevision = 0;
+		NewDisplay::NativeImage composed;		// 缩略图 + 标注
+		std::list<std::string>::iterator lruIt;
+	};
+
+	struct Job {
+		UInt32 ticket = 0;
+		std::string fullPath;
+		Int64 writeTime = 0;
+		UInt64 fileSize = 0;
+		UInt32 maxWidth = 0;
+		UInt32 maxHeight = 0;
+		bool hasBase = false;
+		NewDisplay::NativeImage base;
+		UInt32 sourceWidth = 0;
+		UInt32 sourceHeight = 0;
+		UInt64 annotationRevision = 0;
+		UInt32 annotationWidth = 0;				// 标注文件记录的原图尺寸，与实际不同时按比例换算
+		UInt32 annotationHeight = 0;
+		std::vector<SourceShape> shapes;
+	};
+
+	struct Result {
+		bool ok = false;
+		NewDisplay::NativeImage base;
+		UInt32 sourceWidth = 0;
+		UInt32 sourceHeight = 0;
+		NewDisplay::NativeImage composed;
+	};
+
+	// 只在主线程访问
+	static std::unordered_map<std::string, Entry> s_entries;
+	static std::list<std::string> s_lru;		// 最近使用的在前
+	static UInt32 s_ticket = 0;
+	static HBIMPreviewCache::ReadyCallback s_onReady;
+
+	// 后台线程：只保留最新的一个请求
+	static std::mutex s_mutex;
+	static std::condition_variable s_wake;
+	static std::unique_ptr<Job> s_pending;
+	static bool s_stop = false;
+	static std::thread s_worker;
+
+	static std::string ToStdString(const GS::UniString& text) {
+		return std::string(text.ToCStr().Get());
+	}
+
+	static size_t ColorIndex(const std::string& label) {
+		return std::hash<std::string>()(label) % (sizeof(kLabelColors) / sizeof(kLabelColors[0]));
+	}
+
+	static bool GetFileStamp(const std::string& fullPath, Int64& outWriteTime, UInt64& outFileSize) {
+		std::error_code ec;
+		const std::filesystem::path path(fullPath);
+		outWriteTime = static_cast<Int64>(std::filesystem::last_write_time(path, ec).time_since_epoch().count());
+		if (ec)
+			return false;
+		outFileSize = static_cast<UInt64>(std::filesystem::file_size(path, ec));
+		return !ec;
+	}
+
+	static void Touch(const std::string& key, Entry& entry) {
+		s_lru.erase(entry.lruIt);
+		s_lru.push_front(key);
+		entry.lruIt = s_lru.begin();
+	}
+
+	static void ClearEntries() {
+		s_entries.clear();
+		s_lru.clear();
+	}
+
+	// ---- 后台线程 ----------------------------------------------------------------
+
+	// 缩放到 maxWidth×maxHeight 内，保持宽高比
+	static bool DecodeThumbnail(const Job& job, NewDisplay::NativeImage& outBase, UInt32& outWidth, UInt32& outHeight) {
+		GX::Image image{IO::Location(GS::UniString(job.fullPath.c_str(), CC_UTF8))};
+		if (image.IsEmpty())
+			return false;
+		const UInt32 width = image.GetWidth();
+		const UInt32 height = image.GetHeight();
+		if (width == 0 || height == 0)
+			return false;
+		const double scale = std::min(static_cast<double>(job.maxWidth) / width, static_cast<double>(job.maxHeight) / height);
+		const UInt32 newWidth = std::max<UInt32>(1, static_cast<UInt32>(width * scale));
+		const UInt32 newHeight = std::max<UInt32>(1, static_cast<UInt32>(height * scale));
+		outBase = image.ToNativeImage(1.0, false).Resize(newWidth, newHeight);
+		outWidth = width;
+		outHeight = height;
+		return outBase != nullptr;
+	}
+
+	// 标注坐标以标注文件记录的原图尺寸为准（图片可能在标注后被缩小过），没有记录时用原图实际尺寸，
+	// 两个方向分别按缩略图实际像素尺寸换算
+	static std::vector<OverlayShape> TransformShapes(const Job& job, UInt32 sourceWidth, UInt32 sourceHeight, const NewDisplay::NativeImage& base) {
+		std::vector<OverlayShape> overlay;
+		const bool annotated = job.annotationWidth > 0 && job.annotationHeight > 0;
+		const UInt32 referenceWidth = annotated ? job.annotationWidth : sourceWidth;
+		const UInt32 referenceHeight = annotated ? job.annotationHeight : sourceHeight;
+		if (referenceWidth == 0 || referenceHeight == 0)
+			return overlay;
+		const double scaleX = static_cast<double>(base.GetWidth()) / referenceWidth;
+		const double scaleY = static_cast<double>(base.GetHeight()) / referenceHeight;
+		auto toThumb = [&](const OverlayPoint& p) {
+			return OverlayPoint{ static_cast<float>(p.x * scaleX), static_cast<float>(p.y * scaleY) };
+		};
+
+		for (const SourceShape& source : job.shapes) {
+			if (source.points.empty())
+				continue;
+			OverlayShape shape;
+			shape.label = source.label;
+			shape.color = ColorIndex(source.label);
+			const OverlayPoint first = toThumb(source.points[0]);
+			if (source.shapeType == "rectangle" && source.points.size() >= 2) {
+				const OverlayPoint second = toThumb(source.points[1]);
+				shape.points = { first, { second.x, first.y }, second, { first.x, second.y } };
+			} else if (source.shapeType == "circle" && source.points.size() >= 2) {
+				const OverlayPoint edge = toThumb(source.points[1]);
+				const float radius = std::hypot(edge.x - first.x, edge.y - first.y);
+				for (int i = 0; i < kCircleSegments; ++i) {
+					const double angle = 2.0 * kPi * i / kCircleSegments;
+					shape.points.push_back({ first.x + radius * static_cast<float>(std::cos(angle)),
+											 first.y + radius * static_cast<float>(std::sin(angle)) });
+				}
+			} else if (source.shapeType == "point" || source.points.size() == 1) {
+				shape.points = { { first.x - kPointHalfSize, first.y - kPointHalfSize }, { first.x + kPointHalfSize, first.y - kPointHalfSize },
+								 { first.x + kPointHalfSize, first.y + kPointHalfSize }, { first.x - kPointHalfSize, first.y + kPointHalfSize } };
+			} else {
+				for (const OverlayPoint& point : source.points)
+					shape.points.push_back(toThumb(point));
+				shape.closed = source.shapeType != "line" && source.shapeType != "linestrip";
+			}
+			overlay.push_back(std::move(shape));
+		}
+		return overlay;
+	}
+
+	static NewDisplay::NativeImage Compose(const NewDisplay::NativeImage& base, const std::vector<OverlayShape>& overlay) {
+		if (overlay.empty())
+			return base;
+		NewDisplay::NativeImage composed = base.CreateCopy();
+		NewDisplay::NativeContext context = composed.GetContext();
+		context.SetLineWidth(kLineWidth);
+
+		TE::Font font;
+		font.Set(kLabelFontSize, 0, "Helvetica");
+		for (const OverlayShape& shape : overlay) {
+			const unsigned char* color = kLabelColors[shape.color];
+			context.SetForeColor(color[0], color[1], color[2]);
+			context.MoveTo(shape.points[0].x, shape.points[0].y);
+			for (size_t i = 1; i < shape.points.size(); ++i)
+				context.LineTo(shape.points[i].x, shape.points[i].y);
+			if (shape.closed)
+				context.LineTo(shape.points[0].x, shape.points[0].y);
+
+			// 标注名写在最上方的顶点上方，先画黑色阴影保证浅色照片上可读
+			if (shape.label.empty())
+				continue;
+			const OverlayPoint& top = *std::min_element(shape.points.begin(), shape.points.end(),
+				[](const OverlayPoint& a, const OverlayPoint& b) { return a.y < b.y; });
+			const double baseLineY = std::max(top.y - 3.0, kLabelFontSize);
+			const GS::UniString label(shape.label.c_str(), CC_UTF8);
+			context.SetForeColor(0, 0, 0, 180);
+			context.DrawPlainText(label, font, top.x + 1.0, baseLineY + 1.0, 0.0);
+			context.SetForeColor(color[0], color[1], color[2]);
+			context.DrawPlainText(label, font, top.x, baseLineY, 0.0);
+		}
+		composed.ReleaseContext(context);
+		return composed;
+	}
+
+	static Result Render(const Job& job) {
+		Result result;
+		try {
+			result.base = job.base;
+			result.sourceWidth = job.sourceWidth;
+			result.sourceHeight = job.sourceHeight;
+			if (!job.hasBase && !DecodeThumbnail(job, result.base, result.sourceWidth, result.sourceHeight))
+				return result;
+			const std::vector<OverlayShape> overlay = TransformShapes(job, result.sourceWidth, result.sourceHeight, result.base);
+			result.composed = Compose(result.base, overlay);
+			result.ok = result.composed != nullptr;
+		} catch (...) {
+			HBIMEventLoop::PostReport(false, "HBIMPreviewCache: 生成预览时捕获到异常: %s", job.fullPath.c_str());
+			result.ok = false;
+		}
+		return result;
+	}
+
+	static void Deliver(std::shared_ptr<Job> job, std::shared_ptr<Result> result);
+
+	static void WorkerLoop() {
+		while (true) {
+			std::unique_ptr<Job> job;
+			{
+				std::unique_lock<std::mutex> lock(s_mutex);
+				s_wake.wait(lock, []() { return s_stop || s_pending != nullptr; });
+				if (s_stop)
+					return;
+				job = std::move(s_pending);
+			}
+			auto result = std::make_shared<Result>(Render(*job));
+			std::shared_ptr<Job> finished(std::move(job));
+			HBIMEventLoop::Post([finished, result]() { Deliver(finished, result); });
+		}
+	}
+
+	// ---- 主线程 ----------------------------------------------------------------
+
+	static DG::Picture ToPicture(const NewDisplay::NativeImage& image) {
+		void* dgData = GX::Image(image).ToDGPicture();
+		return dgData != nullptr ? DG::Picture(dgData) : DG::Picture();
+	}
+
+	// 结果先存入缓存（即使已有更新的请求，之后浏览回来也可直接使用），只有最新请求才回调
+	static void Deliver(std::shared_ptr<Job> job, std::shared_ptr<Result> result) {
+		if (result->ok) {
+			auto found = s_entries.find(job->fullPath);
+			if (found == s_entries.end()) {
+				s_lru.push_front(job->fullPath);
+				found = s_entries.emplace(job->fullPath, Entry()).first;
+				found->second.lruIt = s_lru.begin();
+				if (s_entries.size() > kMaxEntries) {
+					s_entries.erase(s_lru.back());
+					s_lru.pop_back();
+				}
+			} else {
+				Touch(job->fullPath, found->second);
+			}
+			Entry& entry = found->second;
+			entry.writeTime = job->writeTime;
+			entry.fileSize = job->fileSize;
+			entry.maxWidth = job->maxWidth;
+			entry.maxHeight = job->maxHeight;
+			entry.base = result->base;
+			entry.sourceWidth = result->sourceWidth;
+			entry.sourceHeight = result->sourceHeight;
+			entry.annotationRevision = job->annotationRevision;
+			entry.composed = result->composed;
+		}
+		if (job->ticket != s_ticket || !s_onReady)
+			return;
+		HBIMPreviewCache::ReadyCallback onReady = std::move(s_onReady);
+		s_onReady = nullptr;
+		if (!result->ok)
+			ACAPI_WriteReport("HBIMPreviewCache: 图片加载失败: %s", false, job->fullPath.c_str());
+		onReady(result->ok ? ToPicture(result->composed) : DG::Picture());
+	}
+
+	static void OnProjectEvent(API_NotifyEventID notifID) {
+		switch (notifID) {
+			case APINotify_New:
+			case APINotify_NewAndReset:
+			case APINotify_Open:
+			case APINotify_Close:
+			case APINotify_Quit:
+				HBIMPreviewCache::Cancel();
+				ClearEntries();
+				break;
+			default:
+				break;
+		}
+	}
+
+}
+
+namespace HBIMPreviewCache {
+
+void Initialize() {
+	HBIMNotifications::AddProjectListener(OnProjectEvent);
+}
+
+void Shutdown() {
+	{
+		std::lock_guard<std::mutex> lock(s_mutex);
+		s_stop = true;
+		s_pending.reset();
+	}
+	s_wake.notify_all();
+	if (s_worker.joinable())
+		s_worker.join();
+	s_onReady = nullptr;
+	ClearEntries();
+}
+
+void Request(const GS::UniString& fullPath, const GS::UniString& relativePath, UInt32 maxWidth, UInt32 maxHeight,
+			 const ReadyCallback& onReady) {
+	auto job = std::make_unique<Job>();
+	job->ticket = ++s_ticket;
+	job->fullPath = ToStdString(fullPath);
+	// HEIC/DNG/TIFF 使用派生缩略图；尚未生成（例如缓存被清理）时先解码原图并补排转码
+	GS::UniString derivedPath;
+	if (HBIMImageDerivatives::GetPath(relativePath, HBIMImageDerivatives::Kind::Thumbnail, derivedPath))
+		job->fullPath = ToStdString(derivedPath);
+	else if (HBIMImageDerivatives::NeedsDerivatives(relativePath))
+		HBIMImageDerivatives::Enqueue({ relativePath });
+	job->maxWidth = maxWidth;
+	job->maxHeight = maxHeight;
+	if (!GetFileStamp(job->fullPath, job->writeTime, job->fileSize)) {
+		ACAPI_WriteReport("HBIMPreviewCache: 文件无法访问: %s", false, job->fullPath.c_str());
+		Cancel();
+		onReady(DG::Picture());
+		return;
+	}
+	job->annotationRevision = HBIMAnnotations::GetRevision(relativePath);
+
+	auto found = s_entries.find(job->fullPath);
+	if (found != s_entries.end()) {
+		Entry& entry = found->second;
+		const bool baseValid = entry.writeTime == job->writeTime && entry.fileSize == job->fileSize &&
+							   entry.maxWidth == maxWidth && entry.maxHeight == maxHeight;
+		if (baseValid && entry.annotationRevision == job->annotationRevision) {
+			Touch(found->first, entry);
+			Cancel();
+			onReady(ToPicture(entry.composed));
+			return;
+		}
+		// 只有标注变化：沿用缓存的缩略图，只重新变换和绘制标注
+		if (baseValid) {
+			job->hasBase = true;
+			job->base = entry.base;
+			job->sourceWidth = entry.sourceWidth;
+			job->sourceHeight = entry.sourceHeight;
+		}
+	}
+
+	HBIMAnnotations::PhotoAnnotations annotations;
+	if (job->annotationRevision != 0 && HBIMAnnotations::GetPhotoAnnotations(relativePath, annotations)) {
+		job->annotationWidth = annotations.imageWidth;
+		job->annotationHeight = annotations.imageHeight;
+		for (const HBIMAnnotations::Shape& shape : annotations.shapes) {
+			SourceShape source;
+			source.label = ToStdString(shape.label);
+			source.shapeType = ToStdString(shape.shapeType);
+			for (const API_Coord& point : shape.points)
+				source.points.push_back({ static_cast<float>(point.x), static_cast<float>(point.y) });
+			job->shapes.push_back(std::move(source));
+		}
+	}
+
+	s_onReady = onReady;
+	{
+		std::lock_guard<std::mutex> lock(s_mutex);
+		if (s_stop)
+			return;
+		s_pending = std::move(job);
+		if (!s_worker.joinable())
+			s_worker = std::thread(WorkerLoop);
+	}
+	s_wake.notify_all();
+}
+
+void Cancel() {
+	++s_ticket;
+	s_onReady = nullptr;
+	std::lock_guard<std::mutex> lock(s_mutex);
+	s_pending.reset();
+}
+
+}
@@ -0,0 +1,35 @@
+#ifndef HBIMPREVIEWCACHE_HPP
+#define HBIMPREVIEWCACHE_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+#include "DGModule.hpp"
+
+#include <functional>
+
+// 面板图片预览的缩略图缓存。
+// 解码、缩放和标注绘制都在后台线程完成：labelme 标注的多边形先变换到缩略图坐标，与缩略图一起缓存；
+// 标注变化时只在缓存的缩略图上重新绘制，不再解码原图。缓存命中（图片与标注都未变）时直接返回，
+// 浏览有标注的照片与无标注的照片开销相同。
+namespace HBIMPreviewCache {
+
+	// 主线程调用；失败时 picture 为空
+	using ReadyCallback = std::function<void(const DG::Picture& picture)>;
+
+	// 在 Initialize 中调用
+	void Initialize();
+
+	// 在 FreeData 中调用：停止后台线程
+	void Shutdown();
+
+	// 主线程调用：请求一张图片（完整路径；relativePath 相对项目目录，用于查找标注）缩放到 maxWidth×maxHeight 内的预览。
+	// 缓存命中时立即调用 onReady；否则后台生成后经主事件循环调用，之前尚未完成的请求不再回调
+	void Request(const GS::UniString& fullPath, const GS::UniString& relativePath, UInt32 maxWidth, UInt32 maxHeight,
+				 const ReadyCallback& onReady);
+
+	// 取消尚未完成的请求（不回调）
+	void Cancel();
+
+}
+
+#endif
@@ -0,0 +1,402 @@
+// *****************************************************************************
+// File:			HBIMProject.cpp
+// Description:		项目标识（UUID，存于项目信息keywords）与项目目录
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMProject.hpp"
+#include "HBIMEventLoop.hpp"
+#include "HBIMNotifications.hpp"
+
+#include <cstring>
+#include <random>
+
+namespace HBIMProject {
+	// 验证UUID格式
+	bool IsValidUUIDFormat(const GS::UniString& uuid) {
+		// 标准格式：xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx (36个字符)
+		if (uuid.GetLength() != 36) return false;
+		
+		for (Int32 i = 0; i < 36; i++) {
+			GS::uchar_t ch = uuid.GetChar(i);
+			// 检查连字符位置
+			if (i == 8 || i == 13 || i == 18 || i == 23) {
+				if (ch != '-') return false;
+			} else {
+				// 必须是十六进制字符
+				if (!((ch >= '0' && ch <= '9') || (ch >= 'A' && ch <= 'F') || (ch >= 'a' && ch <= 'f'))) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+}
+
+namespace {
+	// 生成随机UUID字符串 (格式: xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx)
+	static GS::UniString GenerateUUID()
+	{
+		std::random_device rd;
+		std::mt19937 gen(rd());
+		std::uniform_int_distribution<> dis(0, 15);
+		
+		const char* hexChars = "0123456789ABCDEF";
+		char uuid[37];
+		
+		// 生成32个十六进制字符
+		for (int i = 0; i < 32; i++) {
+			uuid[i] = hexChars[dis(gen)];
+		}
+		
+		// 直接构建格式化字符串：xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx
+		char formatted[37];
+		// 第一部分：8个字符
+		std::memcpy(formatted, uuid, 8);
+		formatted[8] = '-';
+		// 第二部分：4个字符
+		std::memcpy(formatted + 9, uuid + 8, 4);
+		formatted[13] = '-';
+		// 第三部分：4个字符
+		std::memcpy(formatted + 14, uuid + 12, 4);
+		formatted[18] = '-';
+		// 第四部分：4个字符
+		std::memcpy(formatted + 19, uuid + 16, 4);
+		formatted[23] = '-';
+		// 第五部分：12个字符
+		std::memcpy(formatted + 24, uuid + 20, 12);
+		formatted[36] = '\0';
+		
+		return GS::UniString(formatted);
+	}
+	
+	// Preferences 版本2：存储 uuid + path，用于检测"另存为"副本
+	// 数据格式: [version=2][uuidLen][uuid][pathLen][path]
+	const Int32 kPreferencesVersionV2 = 2;
+	static const size_t kMaxPrefDataSize = 600;
+	
+	static bool ReadProjectMappingFromPreferences(GS::UniString& outUuid, GS::UniString& outPath)
+	{
+		Int32 version = 0;
+		GSSize bytes = 0;
+		GSErrCode err = ACAPI_GetPreferences(&version, &bytes, nullptr);
+		if (err != NoError || version != kPreferencesVersionV2 || bytes < 8 || bytes > kMaxPrefDataSize)
+			return false;
+		char* data = new char[bytes];
+		err = ACAPI_GetPreferences(&version, &bytes, data);
+		if (err != NoError) {
+			delete[] data;
+			return false;
+		}
+		Int32 uuidLen = *reinterpret_cast<Int32*>(data);
+		if (uuidLen <= 0 || uuidLen > 40 || bytes < 8 + uuidLen) {
+			delete[] data;
+			return false;
+		}
+		outUuid = GS::UniString(data + 4, uuidLen);
+		Int32 pathLen = *reinterpret_cast<Int32*>(data + 4 + uuidLen);
+		if (pathLen < 0 || pathLen > 400 || bytes < 8 + uuidLen + pathLen) {
+			delete[] data;
+			return false;
+		}
+		if (pathLen > 0)
+			outPath = GS::UniString(data + 8 + uuidLen, pathLen);
+		delete[] data;
+		return true;
+	}
+	
+	static GSErrCode SaveProjectMappingToPreferences(const GS::UniString& uuid, const GS::UniString& path)
+	{
+		Int32 uuidLen = static_cast<Int32>(uuid.GetLength());
+		Int32 pathLen = static_cast<Int32>(path.GetLength());
+		if (8 + uuidLen + pathLen > static_cast<GSSize>(kMaxPrefDataSize))
+			return APIERR_GENERAL;
+		char data[kMaxPrefDataSize];
+		*reinterpret_cast<Int32*>(data) = uuidLen;
+		std::memcpy(data + 4, uuid.ToCStr().Get(), uuidLen);
+		*reinterpret_cast<Int32*>(data + 4 + uuidLen) = pathLen;
+		if (pathLen > 0)
+			std::memcpy(data + 8 + uuidLen, path.ToCStr().Get(), pathLen);
+		return ACAPI_SetPreferences(kPreferencesVersionV2, 8 + uuidLen + pathLen, data);
+	}
+	
+	// 从项目信息读取项目UUID (使用keywords字段)
+	static GS::UniString ReadProjectUUIDFromProjectNotes()
+	{
+		API_ProjectNoteInfo projectNotes;
+		std::memset(&projectNotes, 0, sizeof(API_ProjectNoteInfo));
+		
+		GSErrCode err = ACAPI_ProjectSetting_GetProjectNotes(&projectNotes);
+		if (err != NoError) {
+			return GS::UniString();
+		}
+		
+		// 在keywords字段中查找UUID (格式: "HBIM_UUID=xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx")
+		const char* keywords = projectNotes.keywords;
+		const char* uuidPrefix = "HBIM_UUID=";
+		size_t prefixLen = std::strlen(uuidPrefix);
+		
+		if (std::strncmp(keywords, uuidPrefix, prefixLen) == 0) {
+			return GS::UniString(keywords + prefixLen);
+		}
+		
+		return GS::UniString();
+	}
+	
+	// 保存项目UUID到项目信息 (使用keywords字段)
+	static GSErrCode SaveProjectUUIDToProjectNotes(const GS::UniString& uuid)
+	{
+		API_ProjectNoteInfo projectNotes;
+		std::memset(&projectNotes, 0, sizeof(API_ProjectNoteInfo));
+		
+		// 先读取现有项目信息
+		GSErrCode err = ACAPI_ProjectSetting_GetProjectNotes(&projectNotes);
+		if (err != NoError) {
+			return err;
+		}
+		
+		// 准备keywords字符串: 保留原有内容，添加HBIM_UUID
+		char newKeywords[256];
+		std::string uuidStr = std::string(uuid.ToCStr().Get());
+		std::snprintf(newKeywords, sizeof(newKeywords), "HBIM_UUID=%s", uuidStr.c_str());
+		
+		// 复制回结构体
+		std::strncpy(projectNotes.keywords, newKeywords, sizeof(projectNotes.keywords) - 1);
+		projectNotes.keywords[sizeof(projectNotes.keywords) - 1] = '\0';
+		
+		// 保存修改
+		return ACAPI_ProjectSetting_ChangeProjectNotes(&projectNotes);
+	}
+	
+	// 修复UUID格式（如果格式不正确）
+	static GS::UniString FixUUIDFormat(const GS::UniString& uuid)
+	{
+		GS::UniString result = uuid;
+		
+		// 如果已经是标准格式，直接返回
+		if (HBIMProject::IsValidUUIDFormat(result)) {
+			return result;
+		}
+		
+		// 移除所有非十六进制字符（保留连字符）
+		GS::UniString clean;
+		for (UInt32 i = 0; i < result.GetLength(); ++i) {
+			GS::uchar_t ch = result.GetChar(i);
+			if ((ch >= '0' && ch <= '9') || (ch >= 'A' && ch <= 'F') || (ch >= 'a' && ch <= 'f') || ch == '-') {
+				clean.Append(ch);
+			}
+		}
+		
+		// 如果长度正确且有正确的连字符位置，尝试修复
+		if (clean.GetLength() == 32) {
+			// 32个十六进制字符，添加连字符
+			char fixed[37];
+			std::memcpy(fixed, clean.ToCStr().Get(), 8);
+			fixed[8] = '-';
+			std::memcpy(fixed + 9, clean.ToCStr().Get() + 8, 4);
+			fixed[13] = '-';
+			std::memcpy(fixed + 14, clean.ToCStr().Get() + 12, 4);
+			fixed[18] = '-';
+			std::memcpy(fixed + 19, clean.ToCStr().Get() + 16, 4);
+			fixed[23] = '-';
+			std::memcpy(fixed + 24, clean.ToCStr().Get() + 20, 12);
+			fixed[36] = '\0';
+			
+			GS::UniString fixedUuid(fixed);
+			if (HBIMProject::IsValidUUIDFormat(fixedUuid)) {
+				ACAPI_WriteReport("FixUUIDFormat: 已修复UUID格式: %s → %s", false, 
+								uuid.ToCStr().Get(), fixedUuid.ToCStr().Get());
+				return fixedUuid;
+			}
+		}
+		
+		// 无法修复，生成新的UUID
+		ACAPI_WriteReport("FixUUIDFormat: 无法修复UUID格式，生成新的: %s", true, uuid.ToCStr().Get());
+		return GenerateUUID();
+	}
+	
+	// 获取或创建项目UUID (主要函数)
+	// 策略：项目文件(project notes)为唯一权威来源；preferences仅用于检测"另存为"副本
+	// - 同一项目重命名/移动：UUID 不变，照片仍可读（相对路径解析到新目录）
+	// - 多项目同目录：每个项目有独立 UUID，照片文件夹分开
+	// - 另存为副本：检测到同一 UUID 对应不同路径且原路径仍存在，则为副本，生成新 UUID
+	static GS::UniString GetOrCreateProjectUUID(const GS::UniString& currentPath)
+	{
+		GS::UniString uuid = ReadProjectUUIDFromProjectNotes();
+		if (!uuid.IsEmpty())
+			uuid = FixUUIDFormat(uuid);
+		
+		if (!uuid.IsEmpty()) {
+			// 项目已有 UUID，检查是否为"另存为"副本
+			GS::UniString lastUuid, lastPath;
+			if (ReadProjectMappingFromPreferences(lastUuid, lastPath)) {
+				if (currentPath == lastPath) {
+					// 同一项目
+					ACAPI_WriteReport("GetOrCreateProjectUUID: 同一项目，使用UUID: %s", false, uuid.ToCStr().Get());
+					return uuid;
+				}
+				if (uuid == lastUuid && !lastPath.IsEmpty()) {
+					// 同一 UUID、不同路径：判断是副本还是重命名
+					bool oldPathExists = false;
+					try {
+						oldPathExists = std::filesystem::exists(std::filesystem::path(lastPath.ToCStr().Get()));
+					} catch (...) {}
+					if (oldPathExists) {
+						// 原文件仍存在 → 当前为副本（另存为）
+						uuid = GenerateUUID();
+						GSErrCode err = SaveProjectUUIDToProjectNotes(uuid);
+						if (err == NoError) {
+							ACAPI_WriteReport("GetOrCreateProjectUUID: 检测到另存为副本，生成新UUID: %s", false, uuid.ToCStr().Get());
+						}
+						SaveProjectMappingToPreferences(uuid, currentPath);
+						return uuid;
+					}
+					// 原路径不存在 → 视为重命名/移动，保持 UUID
+					ACAPI_WriteReport("GetOrCreateProjectUUID: 视为重命名/移动，保持UUID: %s", false, uuid.ToCStr().Get());
+				}
+			}
+			SaveProjectMappingToPreferences(uuid, currentPath);
+			ACAPI_WriteReport("GetOrCreateProjectUUID: 从项目信息读取UUID: %s", false, uuid.ToCStr().Get());
+			return uuid;
+		}
+		
+		// 项目无 UUID，生成并保存
+		uuid = GenerateUUID();
+		ACAPI_WriteReport("GetOrCreateProjectUUID: 生成新UUID: %s", false, uuid.ToCStr().Get());
+		GSErrCode notesErr = SaveProjectUUIDToProjectNotes(uuid);
+		if (notesErr == NoError) {
+			ACAPI_WriteReport("GetOrCreateProjectUUID: UUID已保存到项目信息", false);
+		} else {
+			ACAPI_WriteReport("GetOrCreateProjectUUID: 保存到项目信息失败: %d (可接受)", true, notesErr);
+		}
+		SaveProjectMappingToPreferences(uuid, currentPath);
+		return uuid;
+	}
+}
+
+namespace HBIMProject {
+
+// 项目标识：优先UUID，失败时回退到路径哈希
+static GS::UniString ComputeProjectHash(const API_ProjectInfo& projectInfo, const GS::UniString& projectPath) {
+	// 使用新的UUID方案替代路径哈希
+	// 该方法生成的项目标识符在文件重命名/移动时保持稳定
+	
+	try {
+		GS::UniString projectUuid = GetOrCreateProjectUUID(projectPath);
+		if (!projectUuid.IsEmpty()) {
+			// 使用UUID作为项目标识符
+			ACAPI_WriteReport("CalculateProjectHash: 使用项目UUID: %s", false, projectUuid.ToCStr().Get());
+			return projectUuid;
+		}
+	} catch (...) {
+		ACAPI_WriteReport("CalculateProjectHash: UUID方案失败，回退到路径哈希", true);
+	}
+	
+	// 检查项目是否已保存
+	if (projectInfo.untitled) {
+		ACAPI_WriteReport("CalculateProjectHash: 项目未保存，使用临时标识符", false);
+		return "unsaved_project";
+	}
+	
+	// 使用项目路径计算哈希
+	ACAPI_WriteReport("CalculateProjectHash: 回退到路径哈希，项目路径='%s'", false, projectPath.ToCStr().Get());
+	
+	UInt32 hashValue = GS::CalculateHashValue(projectPath);
+	GS::UniString hashStr;
+	hashStr.Printf("%08X", hashValue);
+	ACAPI_WriteReport("CalculateProjectHash: 哈希值=0x%08X", false, hashValue);
+	return hashStr;
+}
+
+static Context s_context;
+static bool s_contextValid = false;
+
+static void ComputeContext() {
+	s_context = Context();
+	s_contextValid = true;
+
+	API_ProjectInfo projectInfo;
+	GSErrCode err = ACAPI_ProjectOperation_Project(&projectInfo);
+	if (err != NoError) {
+		ACAPI_WriteReport("HBIMProject: 获取项目信息失败: %d", true, err);
+		s_context.projectHash = "unknown";
+		return;
+	}
+
+	if (!projectInfo.untitled && projectInfo.location != nullptr) {
+		projectInfo.location->ToPath(&s_context.projectPath);
+		s_context.isSaved = true;
+		s_context.projectDir = std::filesystem::path(s_context.projectPath.ToCStr().Get()).parent_path();
+		s_context.projectDirPrefix = s_context.projectDir.string() + "/";
+	}
+
+	s_context.projectHash = ComputeProjectHash(projectInfo, s_context.projectPath);
+	s_context.imageFolderName = GetImageFolderName(s_context.projectHash);
+	if (s_context.isSaved)
+		s_context.imageRoot = s_context.projectDir / s_context.imageFolderName.ToCStr().Get();
+}
+
+static void OnProjectEvent(API_NotifyEventID notifID) {
+	switch (notifID) {
+		case APINotify_New:
+		case APINotify_NewAndReset:
+		case APINotify_Open:
+		case APINotify_Save:
+			// 打开、另存为、重命名后路径/UUID可能变化：事件中只作废，回到事件循环后重新计算
+			InvalidateContext();
+			HBIMEventLoop::Post([]() {
+				if (!s_contextValid)
+					ComputeContext();
+			});
+			break;
+		case APINotify_Close:
+		case APINotify_Quit:
+			InvalidateContext();
+			break;
+		default:
+			break;
+	}
+}
+
+void Initialize() {
+	HBIMNotifications::AddProjectListener(OnProjectEvent);
+}
+
+const Context& GetContext() {
+	if (!s_contextValid)
+		ComputeContext();
+	return s_context;
+}
+
+void InvalidateContext() {
+	s_contextValid = false;
+}
+
+GS::UniString CalculateProjectHash() {
+	return GetContext().projectHash;
+}
+
+bool GetProjectDirectory(std::filesystem::path& outProjectDir) {
+	const Context& context = GetContext();
+	if (!context.isSaved)
+		return false;
+	outProjectDir = context.projectDir;
+	return true;
+}
+
+bool BuildFullPath(const GS::UniString& relativePath, std::string& outFullPath) {
+	const Context& context = GetContext();
+	if (!context.isSaved || relativePath.IsEmpty())
+		return false;
+	outFullPath = context.projectDirPrefix;
+	outFullPath += relativePath.ToCStr().Get();
+	return true;
+}
+
+GS::UniString GetImageFolderName(const GS::UniString& projectHash) {
+	GS::UniString folderName("HBIM_Images_");
+	folderName.Append(projectHash);
+	return folderName;
+}
+
+}
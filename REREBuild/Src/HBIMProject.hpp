@@ -0,0 +1,49 @@
+#ifndef HBIMPROJECT_HPP
+#define HBIMPROJECT_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+
+#include <filesystem>
+#include <string>
+
+namespace HBIMProject {
+
+	// 当前项目的路径信息。打开、另存为、重命名（保存事件）时作废并重新计算一次，
+	// 各处拼接图片路径直接使用，不再逐次调用 ACAPI_ProjectOperation_Project。
+	struct Context {
+		bool isSaved = false;
+		GS::UniString projectPath;				// 项目文件完整路径（未保存为空）
+		std::filesystem::path projectDir;		// 项目文件所在目录
+		std::string projectDirPrefix;			// projectDir 的已编码字符串，以 '/' 结尾，直接与相对路径拼接
+		GS::UniString projectHash;				// 项目UUID，失败时为路径哈希或 "unsaved_project"
+		GS::UniString imageFolderName;			// HBIM_Images_{projectHash}
+		std::filesystem::path imageRoot;		// projectDir / imageFolderName
+	};
+
+	// 在 Initialize 中调用（需在 HBIMNotifications::Initialize 之后）
+	void Initialize();
+
+	// 主线程调用；已作废时立即重新计算
+	const Context& GetContext();
+	void InvalidateContext();
+
+	// 标准UUID格式：xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx
+	bool IsValidUUIDFormat(const GS::UniString& uuid);
+
+	// 项目标识：优先使用项目信息中的UUID（另存为副本会生成新UUID），失败时回退到路径哈希；
+	// 未保存项目返回 "unsaved_project"
+	GS::UniString CalculateProjectHash();
+
+	// 项目文件所在目录；未保存项目返回 false
+	bool GetProjectDirectory(std::filesystem::path& outProjectDir);
+
+	// 相对项目目录的路径 → 完整路径（仅拼接，不检查文件是否存在）；未保存项目返回 false
+	bool BuildFullPath(const GS::UniString& relativePath, std::string& outFullPath);
+
+	// 图片根文件夹名（相对项目目录）：HBIM_Images_{projectHash}
+	GS::UniString GetImageFolderName(const GS::UniString& projectHash);
+
+}
+
+#endif
@@ -0,0 +1,581 @@
+// *****************************************************************************
+// File:			HBIMRegisterImport.cpp
+// Description:		HBIM登记表批量导入：流式读取CSV/XLSX，按GlobalId匹配构件，
+//					与当前属性值比较后在一个可撤销命令中只写入有变化的属性
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMRegisterImport.hpp"
+#include "HBIMCommon.hpp"
+#include "HBIMGlobalIdIndex.hpp"
+#include "HBIMStatusOverlay.hpp"
+#include "APIdefs_Properties.h"
+#include "DGModule.hpp"
+#include "DGFileDialog.hpp"
+#include "FileTypeManager.hpp"
+#include "HashTable.hpp"
+#include "LibXL/libxl.h"
+
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef WINDOWS
+#define UNISTR_TO_LIBXLSTR(str) (str.ToUStr())
+#else
+#define UNISTR_TO_LIBXLSTR(str) (str.ToCStr())
+#endif
+
+namespace {
+
+	// 列映射：-1 表示登记表中没有该列
+	struct ColumnMap {
+		Int32 globalIdCol = -1;
+		Int32 idCol = -1;
+		Int32 descCol = -1;
+	};
+
+	static const size_t kCsvChunkSize = 64 * 1024;
+	static const char kCsvDelimiters[] = { ',', ';', '\t' };
+	static const USize kMaxReportedUnmatched = 20;
+	static const USize kMaxReportedChanges = 10;
+
+	static GS::UniString Utf8ToUniString(const std::string& str) {
+		return GS::UniString(str.c_str(), CC_UTF8);
+	}
+
+	// 表头匹配：去除空白后不区分大小写比较
+	static bool HeaderMatches(const GS::UniString& header, std::initializer_list<const char*> candidates) {
+		GS::UniString normalized = HBIM::NormalizeUniString(header);
+		for (const char* candidate : candidates) {
+			if (normalized.IsEqual(GS::UniString(candidate, CC_UTF8), GS::CaseInsensitive))
+				return true;
+		}
+		return false;
+	}
+
+	static const char* kMissingGlobalIdError = "登记表表头中没有GlobalId列";
+
+	// 根据首行确定列：含任一已知列名即视为表头（表头中没有 GlobalId 列时 globalIdCol 为 -1，由调用方报错）；
+	// 否则首行也是数据，按 GlobalId, HBIM构件编号, HBIM构件说明 的顺序处理
+	static bool DetectColumns(const std::vector<GS::UniString>& firstRow, ColumnMap& outMap) {
+		ColumnMap map;
+		for (Int32 i = 0; i < static_cast<Int32>(firstRow.size()); ++i) {
+			const GS::UniString& cell = firstRow[i];
+			if (map.globalIdCol < 0 && HeaderMatches(cell, { "GlobalId", "IfcGlobalId", "IFC GlobalId", "GUID", "构件GlobalId" }))
+				map.globalIdCol = i;
+			else if (map.idCol < 0 && HeaderMatches(cell, { "HBIM构件编号", "构件编号" }))
+				map.idCol = i;
+			else if (map.descCol < 0 && HeaderMatches(cell, { "HBIM构件说明", "构件说明" }))
+				map.descCol = i;
+		}
+
+		if (map.globalIdCol >= 0 || map.idCol >= 0 || map.descCol >= 0) {
+			outMap = map;
+			return true;	// 首行是表头
+		}
+
+		outMap.globalIdCol = 0;
+		outMap.idCol = 1;
+		outMap.descCol = 2;
+		return false;
+	}
+
+	static bool RowFromCells(const std::vector<GS::UniString>& cells, const ColumnMap& map, UInt32 lineNumber, HBIMRegisterImport::RegisterRow& outRow) {
+		auto cellAt = [&cells](Int32 col, GS::UniString& outCell) -> bool {
+			if (col < 0 || col >= static_cast<Int32>(cells.size()))
+				return false;
+			outCell = cells[col];
+			outCell.Trim();
+			return !outCell.IsEmpty();
+		};
+
+		outRow = HBIMRegisterImport::RegisterRow();
+		outRow.lineNumber = lineNumber;
+		if (!cellAt(map.globalIdCol, outRow.globalId))
+			return false;
+		outRow.hasId = cellAt(map.idCol, outRow.hbimId);
+		outRow.hasDesc = cellAt(map.descCol, outRow.hbimDesc);
+		return true;
+	}
+
+	// 由首行引号外出现次数最多的分隔符确定整个文件的分隔符（并列时依次优先逗号、分号），没有时为逗号；
+	// 其余两种字符在字段中按普通字符保留，如 "12,5" 在分号分隔的文件中不会被拆开
+	static char DetectDelimiter(const char* data, size_t size) {
+		size_t counts[sizeof(kCsvDelimiters)] = {};
+		bool inQuotes = false;
+		for (size_t i = 0; i < size; ++i) {
+			const char ch = data[i];
+			if (ch == '"') {
+				inQuotes = !inQuotes;	// 转义的 "" 翻转两次，不影响判断
+				continue;
+			}
+			if (inQuotes)
+				continue;
+			if (ch == '\n')
+				break;
+			for (size_t k = 0; k < sizeof(kCsvDelimiters); ++k) {
+				if (ch == kCsvDelimiters[k])
+					++counts[k];
+			}
+		}
+		size_t best = 0;
+		for (size_t k = 1; k < sizeof(kCsvDelimiters); ++k) {
+			if (counts[k] > counts[best])
+				best = k;
+		}
+		return kCsvDelimiters[best];
+	}
+
+	// CSV 流式读取：按块读入，逐字符解析引号/转义，支持字段内换行
+	static GSErrCode ReadCsvFile(const std::filesystem::path& filePath, const HBIMRegisterImport::RowCallback& onRow, GS::UniString* outError) {
+		std::ifstream in(filePath, std::ios::binary);
+		if (!in.is_open()) {
+			if (outError != nullptr) *outError = "无法打开CSV文件";
+			return APIERR_GENERAL;
+		}
+
+		std::vector<char> buffer(kCsvChunkSize);
+		std::vector<GS::UniString> cells;
+		std::string field;
+		bool inQuotes = false;
+		bool pendingQuote = false;	// 引号内遇到 '"'，等待判断是否为转义 ""
+		bool firstChunk = true;
+		bool headerChecked = false;
+		bool fieldStarted = false;
+		bool missingGlobalId = false;
+		char delimiter = ',';
+		ColumnMap columns;
+		UInt32 lineNumber = 1;
+		UInt32 rowStartLine = 1;
+
+		auto endField = [&]() {
+			cells.push_back(Utf8ToUniString(field));
+			field.clear();
+			fieldStarted = false;
+		};
+
+		auto endRow = [&]() {
+			endField();
+			bool isBlank = (cells.size() == 1 && cells[0].IsEmpty());
+			if (!isBlank) {
+				if (!headerChecked) {
+					headerChecked = true;
+					if (DetectColumns(cells, columns)) {
+						missingGlobalId = (columns.globalIdCol < 0);
+						cells.clear();
+						return;
+					}
+				}
+				HBIMRegisterImport::RegisterRow row;
+				if (RowFromCells(cells, columns, rowStartLine, row))
+					onRow(row);
+			}
+			cells.clear();
+		};
+
+		while (in && !missingGlobalId) {
+			in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+			std::streamsize count = in.gcount();
+			if (count <= 0)
+				break;
+
+			std::streamsize start = 0;
+			if (firstChunk) {
+				firstChunk = false;
+				// 跳过 UTF-8 BOM（Excel 导出的CSV常带BOM）
+				if (count >= 3 && static_cast<unsigned char>(buffer[0]) == 0xEF &&
+					static_cast<unsigned char>(buffer[1]) == 0xBB && static_cast<unsigned char>(buffer[2]) == 0xBF) {
+					start = 3;
+				}
+				delimiter = DetectDelimiter(buffer.data() + start, static_cast<size_t>(count - start));
+			}
+
+			for (std::streamsize i = start; i < count; ++i) {
+				char ch = buffer[i];
+				if (pendingQuote) {
+					pendingQuote = false;
+					if (ch == '"') {
+						field.push_back('"');
+						continue;
+					}
+					inQuotes = false;
+				}
+
+				if (inQuotes) {
+					if (ch == '"') {
+						pendingQuote = true;
+					} else {
+						if (ch == '\n') ++lineNumber;
+						field.push_back(ch);
+					}
+					continue;
+				}
+
+				if (ch == '"' && !fieldStarted) {
+					inQuotes = true;
+					fieldStarted = true;
+				} else if (ch == delimiter) {
+					endField();
+				} else if (ch == '\n') {
+					endRow();
+					++lineNumber;
+					rowStartLine = lineNumber;
+				} else if (ch != '\r') {
+					field.push_back(ch);
+					fieldStarted = true;
+				}
+			}
+		}
+
+		if (!missingGlobalId && (!field.empty() || !cells.empty()))
+			endRow();
+
+		if (missingGlobalId) {
+			if (outError != nullptr) *outError = kMissingGlobalIdError;
+			return APIERR_GENERAL;
+		}
+		return NoError;
+	}
+
+	static GS::UniString ReadXlsxCell(libxl::Sheet* sheet, int row, int col) {
+		if (col < 0)
+			return GS::UniString();
+
+		libxl::CellType cellType = sheet->cellType(row, col);
+		if (cellType == libxl::CELLTYPE_NUMBER) {
+			double num = sheet->readNum(row, col);
+			return GS::UniString::Printf("%.15g", num);
+		}
+		if (cellType != libxl::CELLTYPE_STRING)
+			return GS::UniString();
+
+		const auto* str = sheet->readStr(row, col);
+		if (str == nullptr)
+			return GS::UniString();
+#ifdef WINDOWS
+		return GS::UniString(reinterpret_cast<const GS::UniChar::Layout*>(str));
+#else
+		return GS::UniString(str, CC_UTF8);
+#endif
+	}
+
+	// XLSX：读取第一个工作表，逐行回调
+	static GSErrCode ReadXlsxFile(const GS::UniString& filePath, const HBIMRegisterImport::RowCallback& onRow, GS::UniString* outError) {
+		libxl::Book* book = xlCreateXMLBook();
+		if (book == nullptr) {
+			if (outError != nullptr) *outError = "无法创建XLSX读取器";
+			return APIERR_GENERAL;
+		}
+#ifdef macintosh
+		book->setLocale("UTF-8");
+#endif
+
+		if (!book->load(UNISTR_TO_LIBXLSTR(filePath))) {
+			book->release();
+			if (outError != nullptr) *outError = "无法读取XLSX文件";
+			return APIERR_GENERAL;
+		}
+
+		libxl::Sheet* sheet = book->getSheet(0);
+		if (sheet == nullptr) {
+			book->release();
+			if (outError != nullptr) *outError = "XLSX文件中没有工作表";
+			return APIERR_GENERAL;
+		}
+
+		const int firstRow = sheet->firstRow();
+		const int lastRow = sheet->lastRow();
+		const int lastCol = sheet->lastCol();
+
+		if (firstRow >= lastRow) {
+			book->release();
+			return NoError;		// 空工作表
+		}
+
+		// 只有一行时同样按首行判断是表头还是数据
+		ColumnMap columns;
+		int dataStartRow = firstRow;
+		std::vector<GS::UniString> headerCells;
+		for (int col = 0; col < lastCol; ++col)
+			headerCells.push_back(ReadXlsxCell(sheet, firstRow, col));
+		if (DetectColumns(headerCells, columns))
+			dataStartRow = firstRow + 1;
+		if (columns.globalIdCol < 0) {
+			book->release();
+			if (outError != nullptr) *outError = kMissingGlobalIdError;
+			return APIERR_GENERAL;
+		}
+
+		for (int row = dataStartRow; row < lastRow; ++row) {
+			HBIMRegisterImport::RegisterRow registerRow;
+			registerRow.lineNumber = static_cast<UInt32>(row + 1);
+			registerRow.globalId = ReadXlsxCell(sheet, row, columns.globalIdCol);
+			registerRow.globalId.Trim();
+			if (registerRow.globalId.IsEmpty())
+				continue;
+			registerRow.hbimId = ReadXlsxCell(sheet, row, columns.idCol);
+			registerRow.hbimId.Trim();
+			registerRow.hasId = !registerRow.hbimId.IsEmpty();
+			registerRow.hbimDesc = ReadXlsxCell(sheet, row, columns.descCol);
+			registerRow.hbimDesc.Trim();
+			registerRow.hasDesc = !registerRow.hbimDesc.IsEmpty();
+			onRow(registerRow);
+		}
+
+		book->release();
+		return NoError;
+	}
+
+	static GSErrCode GetPropertyDefinition(const API_Guid& defGuid, API_PropertyDefinition& outDef) {
+		outDef = {};
+		outDef.guid = defGuid;
+		return ACAPI_Property_GetPropertyDefinition(outDef);
+	}
+
+	static GS::UniString StringValueOf(const API_Property& property) {
+		if (property.status != API_Property_HasValue || property.value.variantStatus != API_VariantStatusNormal)
+			return GS::UniString();
+		return property.value.singleVariant.variant.uniStringValue;
+	}
+
+	static API_Property MakeStringProperty(const API_PropertyDefinition& def, const GS::UniString& value) {
+		API_Property p = {};
+		p.definition = def;
+		p.status = API_Property_HasValue;
+		p.isDefault = false;
+		p.value.variantStatus = API_VariantStatusNormal;
+		p.value.singleVariant.variant.type = API_PropertyStringValueType;
+		p.value.singleVariant.variant.uniStringValue = value;
+		return p;
+	}
+
+	static GS::UniString FormatReport(const HBIMRegisterImport::ImportReport& report) {
+		GS::UniString msg;
+		msg.Append("登记表行数: ");
+		msg.Append(GS::ValueToUniString(static_cast<Int32>(report.totalRows)));
+		msg.Append("\n匹配构件: ");
+		msg.Append(GS::ValueToUniString(static_cast<Int32>(report.matchedRows)));
+		msg.Append("\n未匹配GlobalId: ");
+		msg.Append(GS::ValueToUniString(static_cast<Int32>(report.unmatchedGlobalIds.GetSize())));
+		msg.Append("\n重复行(以最后一行为准): ");
+		msg.Append(GS::ValueToUniString(static_cast<Int32>(report.duplicateRows)));
+		msg.Append("\n无变化: ");
+		msg.Append(GS::ValueToUniString(static_cast<Int32>(report.unchangedRows)));
+		msg.Append("\n需要修改的构件: ");
+		msg.Append(GS::ValueToUniString(static_cast<Int32>(report.changes.GetSize())));
+		msg.Append(GS::UniString::Printf("\n\n建立索引 %.2f 秒，读取并匹配 %.3f 秒", report.indexSeconds, report.matchSeconds));
+		if (report.matchSeconds > 0.0)
+			msg.Append(GS::UniString::Printf("（%.0f 行/秒）", report.totalRows / report.matchSeconds));
+
+		if (!report.changes.IsEmpty()) {
+			msg.Append("\n\n修改示例:");
+			for (UIndex i = 0; i < report.changes.GetSize() && i < kMaxReportedChanges; ++i) {
+				const HBIMRegisterImport::ChangeEntry& change = report.changes[i];
+				msg.Append("\n  ");
+				msg.Append(change.globalId);
+				if (change.idChanged) {
+					msg.Append(" 编号: ");
+					msg.Append(change.oldId.IsEmpty() ? GS::UniString("(空)") : change.oldId);
+					msg.Append(" → ");
+					msg.Append(change.newId);
+				}
+				if (change.descChanged)
+					msg.Append(" 说明已修改");
+			}
+		}
+		return msg;
+	}
+
+}
+
+namespace HBIMRegisterImport {
+
+GSErrCode ReadRegisterFile(const IO::Location& fileLocation, const RowCallback& onRow, GS::UniString* outError) {
+	GS::UniString filePath;
+	fileLocation.ToPath(&filePath);
+	if (filePath.IsEmpty()) {
+		if (outError != nullptr) *outError = "文件路径为空";
+		return APIERR_BADPARS;
+	}
+
+	try {
+		std::filesystem::path fsPath(filePath.ToCStr().Get());
+		std::string ext = fsPath.extension().string();
+		for (char& ch : ext) ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+
+		if (ext == ".xlsx")
+			return ReadXlsxFile(filePath, onRow, outError);
+		return ReadCsvFile(fsPath, onRow, outError);
+	} catch (const std::exception& e) {
+		if (outError != nullptr) *outError = GS::UniString::Printf("读取登记表失败: %s", e.what());
+		return APIERR_GENERAL;
+	}
+}
+
+GSErrCode BuildImportReport(const IO::Location& fileLocation, ImportReport& outReport, GS::UniString* outError) {
+	outReport = ImportReport();
+
+	// 属性定义尚不存在时所有构件的当前值都为空；定义在确认后随写入一起创建
+	API_Guid groupGuid, idDefGuid, descDefGuid;
+	const bool hasDefinitions = HBIM::FindExistingHBIMPropertyGroupAndDefinitions(groupGuid, idDefGuid, descDefGuid) == NoError;
+	GS::Array<API_PropertyDefinition> defs;
+	if (hasDefinitions) {
+		API_PropertyDefinition idDef, descDef;
+		GSErrCode err = GetPropertyDefinition(idDefGuid, idDef);
+		if (err == NoError)
+			err = GetPropertyDefinition(descDefGuid, descDef);
+		if (err != NoError) {
+			if (outError != nullptr) *outError = "无法获取HBIM属性定义";
+			return err;
+		}
+		defs.Push(idDef);
+		defs.Push(descDef);
+	}
+
+	// GlobalId索引通常已在后台建好，这里只在尚未完成时补齐
+	auto indexStart = std::chrono::steady_clock::now();
+	HBIMGlobalIdIndex::EnsureBuilt();
+	outReport.indexSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - indexStart).count();
+	ACAPI_WriteReport("HBIMRegisterImport: GlobalId索引 %d 个构件，等待 %.2f 秒", false,
+					  static_cast<int>(HBIMGlobalIdIndex::GetSize()), outReport.indexSeconds);
+
+	// 第一遍：流式读取并匹配，同一构件多行时以最后一行为准
+	GS::HashTable<API_Guid, RegisterRow> matchedRows;
+	auto matchStart = std::chrono::steady_clock::now();
+	GSErrCode err = ReadRegisterFile(fileLocation, [&](const RegisterRow& row) {
+		++outReport.totalRows;
+		API_Guid elemGuid;
+		if (!HBIMGlobalIdIndex::FindElement(row.globalId, elemGuid)) {
+			outReport.unmatchedGlobalIds.Push(row.globalId);
+		} else {
+			if (matchedRows.ContainsKey(elemGuid))
+				++outReport.duplicateRows;
+			matchedRows.Put(elemGuid, row);
+		}
+	}, outError);
+	outReport.matchSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - matchStart).count();
+	if (err != NoError)
+		return err;
+
+	outReport.matchedRows = matchedRows.GetSize();
+
+	// 第二遍：读取当前值并计算差异
+	for (auto it = matchedRows.EnumeratePairs(); it != nullptr; ++it) {
+		const API_Guid& elemGuid = it->key;
+		const RegisterRow& row = it->value;
+
+		ChangeEntry change;
+		change.elemGuid = elemGuid;
+		change.globalId = row.globalId;
+		if (hasDefinitions) {
+			GS::Array<API_Property> properties;
+			if (ACAPI_Element_GetPropertyValues(elemGuid, defs, properties) != NoError || properties.GetSize() != 2)
+				continue;
+			change.oldId = StringValueOf(properties[0]);
+			change.oldDesc = StringValueOf(properties[1]);
+		}
+		change.newId = row.hasId ? row.hbimId : change.oldId;
+		change.newDesc = row.hasDesc ? row.hbimDesc : change.oldDesc;
+		change.idChanged = row.hasId && change.newId != change.oldId;
+		change.descChanged = row.hasDesc && change.newDesc != change.oldDesc;
+
+		if (change.idChanged || change.descChanged)
+			outReport.changes.Push(change);
+		else
+			++outReport.unchangedRows;
+	}
+
+	return NoError;
+}
+
+GSErrCode ApplyImportReport(const ImportReport& report) {
+	if (report.changes.IsEmpty())
+		return NoError;
+
+	return ACAPI_CallUndoableCommand("导入HBIM登记表",
+		[&]() -> GSErrCode {
+			// 属性定义不存在时与写入同在这一个撤销命令中创建，取消预览则不会留下空定义
+			API_Guid groupGuid, idDefGuid, descDefGuid;
+			API_PropertyDefinition idDef, descDef;
+			GSErrCode err = HBIM::EnsureHBIMPropertyGroupAndDefinitions(groupGuid, idDefGuid, descDefGuid);
+			if (err == NoError)
+				err = GetPropertyDefinition(idDefGuid, idDef);
+			if (err == NoError)
+				err = GetPropertyDefinition(descDefGuid, descDef);
+			if (err != NoError) {
+				ACAPI_WriteReport("HBIMRegisterImport: 无法创建HBIM属性定义，错误码=%d", true, err);
+				return err;
+			}
+
+			GS::Array<API_Guid> changedElements;
+			for (const ChangeEntry& change : report.changes) {
+				GS::Array<API_Property> properties;
+				if (change.idChanged)
+					properties.Push(MakeStringProperty(idDef, change.newId));
+				if (change.descChanged)
+					properties.Push(MakeStringProperty(descDef, change.newDesc));
+
+				GSErrCode setErr = ACAPI_Element_SetProperties(change.elemGuid, properties);
+				if (setErr != NoError) {
+					ACAPI_WriteReport("HBIMRegisterImport: 写入构件 %s 失败，错误码=%d", true, change.globalId.ToCStr().Get(), setErr);
+					return setErr;
+				}
+				changedElements.Push(change.elemGuid);
+			}
+			HBIMStatusOverlay::UpdateStatuses(changedElements);
+			return NoError;
+		}
+	);
+}
+
+void RunImportCommand() {
+	DG::FileDialog dlg(DG::FileDialog::OpenFile);
+	FTM::FileTypeManager mgr("HBIMComponentEntryRegister");
+	FTM::FileType typeCsv("CSV", "csv", 0, 0, 0);
+	FTM::FileType typeXlsx("Excel", "xlsx", 0, 0, 0);
+	dlg.AddFilter(mgr.AddType(typeCsv));
+	dlg.AddFilter(mgr.AddType(typeXlsx));
+	dlg.SetTitle("选择HBIM登记表");
+	if (!dlg.Invoke() || dlg.GetSelectionCount() == 0)
+		return;
+
+	ImportReport report;
+	GS::UniString error;
+	GSErrCode err = BuildImportReport(dlg.GetSelectedFile(0), report, &error);
+	if (err != NoError) {
+		DG::InformationAlert("导入失败", error, "确定");
+		return;
+	}
+
+	for (UIndex i = 0; i < report.unmatchedGlobalIds.GetSize(); ++i) {
+		if (i >= kMaxReportedUnmatched) {
+			ACAPI_WriteReport("HBIMRegisterImport: ……其余 %d 个未匹配GlobalId省略", false,
+							   static_cast<int>(report.unmatchedGlobalIds.GetSize() - kMaxReportedUnmatched));
+			break;
+		}
+		ACAPI_WriteReport("HBIMRegisterImport: 未匹配GlobalId: %s", false, report.unmatchedGlobalIds[i].ToCStr().Get());
+	}
+
+	GS::UniString summary = FormatReport(report);
+	if (report.changes.IsEmpty()) {
+		DG::InformationAlert("HBIM登记表导入（预览）", summary, "确定");
+		return;
+	}
+
+	if (DG::InformationAlert("HBIM登记表导入（预览）", summary, "应用修改", "取消") != DG::Accept)
+		return;
+
+	err = ApplyImportReport(report);
+	if (err != NoError) {
+		DG::InformationAlert("导入失败", "写入HBIM属性失败。错误代码: " + GS::UniString::Printf("%d", err), "确定");
+		return;
+	}
+
+	ACAPI_WriteReport("HBIMRegisterImport: 已更新 %d 个构件", false, static_cast<int>(report.changes.GetSize()));
+}
+
+}
@@ -0,0 +1,62 @@
+#ifndef HBIMREGISTERIMPORT_HPP
+#define HBIMREGISTERIMPORT_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+#include "Location.hpp"
+
+#include <functional>
+
+namespace HBIMRegisterImport {
+
+	// 登记表中的一行（空单元格表示该字段不修改）
+	struct RegisterRow {
+		UInt32 lineNumber = 0;
+		GS::UniString globalId;
+		GS::UniString hbimId;
+		GS::UniString hbimDesc;
+		bool hasId = false;
+		bool hasDesc = false;
+	};
+
+	// 某构件需要修改的属性
+	struct ChangeEntry {
+		API_Guid elemGuid = APINULLGuid;
+		GS::UniString globalId;
+		GS::UniString oldId;
+		GS::UniString newId;
+		GS::UniString oldDesc;
+		GS::UniString newDesc;
+		bool idChanged = false;
+		bool descChanged = false;
+	};
+
+	// 干运行报告：差异计算结果
+	struct ImportReport {
+		UInt32 totalRows = 0;
+		UInt32 matchedRows = 0;
+		UInt32 unchangedRows = 0;
+		UInt32 duplicateRows = 0;
+		GS::Array<GS::UniString> unmatchedGlobalIds;
+		GS::Array<ChangeEntry> changes;
+		double indexSeconds = 0.0;
+		double matchSeconds = 0.0;
+	};
+
+	using RowCallback = std::function<void(const RegisterRow& row)>;
+
+	// 逐行读取 CSV (UTF-8, RFC 4180 引号规则，分隔符由首行确定) 或 XLSX 登记表；表头中没有 GlobalId 列时报错
+	GSErrCode ReadRegisterFile(const IO::Location& fileLocation, const RowCallback& onRow, GS::UniString* outError = nullptr);
+
+	// 读取登记表并与当前属性值比较，只记录有变化的字段；只读，属性定义不存在时当前值视为空
+	GSErrCode BuildImportReport(const IO::Location& fileLocation, ImportReport& outReport, GS::UniString* outError = nullptr);
+
+	// 在一个可撤销命令中（必要时先创建HBIM属性定义）写入所有差异
+	GSErrCode ApplyImportReport(const ImportReport& report);
+
+	// 菜单入口：选择文件 → 干运行报告 → 确认后应用
+	void RunImportCommand();
+
+}
+
+#endif
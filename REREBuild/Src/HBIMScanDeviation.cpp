@@ -0,0 +1,934 @@
+// *****************************************************************************
+// File:			HBIMScanDeviation.cpp
+// Description:		扫描点云与构件模型的偏差：三角形 BVH、成组的点到三角形距离、
+//					分块并行查询、偏差属性写入、CSV表格与合成数据性能测试
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMScanDeviation.hpp"
+#include "HBIMCommon.hpp"
+#include "HBIMElementMesh.hpp"
+#include "HBIMEventLoop.hpp"
+#include "HBIMGlobalIdIndex.hpp"
+#include "HBIMPointCloud.hpp"
+#include "HBIMPointCloudCache.hpp"
+#include "HBIMProject.hpp"
+#include "HBIMSpatialIndex.hpp"
+#include "DGModule.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+	// 查询是纯计算，使用全部核心
+	static const unsigned kMaxWorkers = 64;
+	static const USize kMaxReportedElements = 10;
+	static const char* kTableFileName = "HBIM_ScanDeviation.csv";
+
+	// 离所有构件表面超过此距离（m）的点不计入：地面、植被、脚手架等不在模型中的物体
+	static const double kMaxDeviation = 0.10;
+
+	// 叶节点中的三角形按 kPacketWidth 个一组计算距离
+	static const UInt32 kPacketWidth = 4;
+	static const UInt32 kLeafTriangles = 8;
+	// 深度小于此值的左子树在新线程中建立（至多 2^4 个线程）
+	static const int kParallelBuildDepth = 4;
+	static const size_t kParallelBuildMinTriangles = 1u << 14;
+	// 工作线程每次领取的点数
+	static const UInt32 kBlockPoints = 1u << 12;
+	static const int kMaxTraversalDepth = 128;
+
+	// 性能测试：kBenchGrid × kBenchGrid × kBenchLevels 个 1 m 立方体，每个面分成 kBenchFaceDivisions² 个方格
+	static const UInt32 kBenchGrid = 20;
+	static const UInt32 kBenchLevels = 5;
+	static const UInt32 kBenchFaceDivisions = 4;
+	static const double kBenchSpacing = 1.5;
+	static const UInt64 kBenchPoints = 20000000;
+	static const double kBenchNoise = 0.002;		// 沿面法向的高斯噪声标准差（m）
+	static const double kNightlyPoints = 500e6;
+
+	struct Aabb {
+		double lo[3] = { 0.0, 0.0, 0.0 };
+		double hi[3] = { 0.0, 0.0, 0.0 };
+	};
+
+	static Aabb EmptyAabb() {
+		Aabb box;
+		for (int axis = 0; axis < 3; ++axis) {
+			box.lo[axis] = std::numeric_limits<double>::max();
+			box.hi[axis] = -std::numeric_limits<double>::max();
+		}
+		return box;
+	}
+
+	static void Extend(Aabb& box, const Aabb& other) {
+		for (int axis = 0; axis < 3; ++axis) {
+			box.lo[axis] = std::min(box.lo[axis], other.lo[axis]);
+			box.hi[axis] = std::max(box.hi[axis], other.hi[axis]);
+		}
+	}
+
+	static double Distance2(const Aabb& box, double x, double y, double z) {
+		const double dx = std::max({ box.lo[0] - x, 0.0, x - box.hi[0] });
+		const double dy = std::max({ box.lo[1] - y, 0.0, y - box.hi[1] });
+		const double dz = std::max({ box.lo[2] - z, 0.0, z - box.hi[2] });
+		return dx * dx + dy * dy + dz * dz;
+	}
+
+	// ---- 点到三角形距离 ----------------------------------------------------------------
+
+	// 一组三角形按列存放；不足一组时用最后一个三角形补齐
+	struct alignas(32) TrianglePacket {
+		double ax[kPacketWidth], ay[kPacketWidth], az[kPacketWidth];
+		double abx[kPacketWidth], aby[kPacketWidth], abz[kPacketWidth];		// b - a
+		double acx[kPacketWidth], acy[kPacketWidth], acz[kPacketWidth];		// c - a
+		double nx[kPacketWidth], ny[kPacketWidth], nz[kPacketWidth];			// (b - a) × (c - a)
+		double invNormal2[kPacketWidth];		// 1 / |n|²，退化三角形为 0
+		double invAb2[kPacketWidth], invBc2[kPacketWidth], invCa2[kPacketWidth];
+		UInt32 element[kPacketWidth];
+	};
+
+	static inline double Triple(double ux, double uy, double uz, double vx, double vy, double vz, double nx, double ny, double nz) {
+		return (uy * vz - uz * vy) * nx + (uz * vx - ux * vz) * ny + (ux * vy - uy * vx) * nz;
+	}
+
+	// w 为点相对线段起点的向量，e 为线段方向
+	static inline double SegmentDistance2(double wx, double wy, double wz, double ex, double ey, double ez, double invLength2) {
+		const double t = std::min(1.0, std::max(0.0, (wx * ex + wy * ey + wz * ez) * invLength2));
+		const double dx = wx - t * ex, dy = wy - t * ey, dz = wz - t * ez;
+		return dx * dx + dy * dy + dz * dz;
+	}
+
+	// 一组三角形到点的距离²。投影落在三角形内取到平面的距离，否则取到三条边的最短距离；
+	// 两种都算出后再选择，循环体无分支
+	static inline void PacketDistances(const TrianglePacket& t, double px, double py, double pz, double outDistance2[kPacketWidth]) {
+		for (UInt32 k = 0; k < kPacketWidth; ++k) {
+			const double wx = px - t.ax[k], wy = py - t.ay[k], wz = pz - t.az[k];		// p - a
+			const double wbx = wx - t.abx[k], wby = wy - t.aby[k], wbz = wz - t.abz[k];	// p - b
+			const double wcx = wx - t.acx[k], wcy = wy - t.acy[k], wcz = wz - t.acz[k];	// p - c
+			const double bcx = t.acx[k] - t.abx[k], bcy = t.acy[k] - t.aby[k], bcz = t.acz[k] - t.abz[k];
+
+			const double s0 = Triple(t.abx[k], t.aby[k], t.abz[k], wx, wy, wz, t.nx[k], t.ny[k], t.nz[k]);
+			const double s1 = Triple(bcx, bcy, bcz, wbx, wby, wbz, t.nx[k], t.ny[k], t.nz[k]);
+			const double s2 = Triple(-t.acx[k], -t.acy[k], -t.acz[k], wcx, wcy, wcz, t.nx[k], t.ny[k], t.nz[k]);
+			const double plane = wx * t.nx[k] + wy * t.ny[k] + wz * t.nz[k];
+			const double planeDistance2 = plane * plane * t.invNormal2[k];
+
+			const double e0 = SegmentDistance2(wx, wy, wz, t.abx[k], t.aby[k], t.abz[k], t.invAb2[k]);
+			const double e1 = SegmentDistance2(wbx, wby, wbz, bcx, bcy, bcz, t.invBc2[k]);
+			const double e2 = SegmentDistance2(wcx, wcy, wcz, -t.acx[k], -t.acy[k], -t.acz[k], t.invCa2[k]);
+
+			const bool inside = s0 >= 0.0 && s1 >= 0.0 && s2 >= 0.0 && t.invNormal2[k] > 0.0;
+			outDistance2[k] = inside ? planeDistance2 : std::min(e0, std::min(e1, e2));
+		}
+	}
+
+	// ---- 内外判断 ----------------------------------------------------------------
+
+	// 三角形顶点与边的角度加权伪法向（Bærentzen 与 Aanæs）。最近点落在顶点或边上时，
+	// 只看所在三角形的法向会在凸角、凹角附近给出错误的符号；伪法向由共用该顶点/边的全部三角形决定
+	struct TriangleNormals {
+		float vertex[3][3];			// 顶点 a、b、c
+		float edge[3][3];			// 边 ab、bc、ca
+	};
+
+	// 同一网格中按顶点序号识别共用的顶点和边（ModelerAPI 的一个 MeshBody 内顶点是共用的）
+	static std::vector<TriangleNormals> ComputePseudonormals(const HBIMElementMesh::Mesh& mesh) {
+		const size_t triangleCount = mesh.triangles.size() / 3;
+		std::vector<double> vertexSums(mesh.positions.size(), 0.0);
+		std::unordered_map<UInt64, std::array<double, 3>> edgeSums;
+		std::vector<std::array<double, 3>> faceNormals(triangleCount);
+		auto edgeKey = [](UInt32 i, UInt32 j) { return (static_cast<UInt64>(std::min(i, j)) << 32) | std::max(i, j); };
+
+		for (size_t t = 0; t < triangleCount; ++t) {
+			const UInt32* corner = &mesh.triangles[t * 3];
+			const double* p[3];
+			for (int c = 0; c < 3; ++c)
+				p[c] = &mesh.positions[static_cast<size_t>(corner[c]) * 3];
+			const double u[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+			const double v[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+			std::array<double, 3> n = { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+			const double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (length == 0.0)
+				continue;
+			for (double& value : n)
+				value /= length;
+			faceNormals[t] = n;
+
+			for (int c = 0; c < 3; ++c) {
+				const double* o = p[c];
+				const double* q = p[(c + 1) % 3];
+				const double* r = p[(c + 2) % 3];
+				const double e1[3] = { q[0] - o[0], q[1] - o[1], q[2] - o[2] };
+				const double e2[3] = { r[0] - o[0], r[1] - o[1], r[2] - o[2] };
+				const double cx = e1[1] * e2[2] - e1[2] * e2[1], cy = e1[2] * e2[0] - e1[0] * e2[2], cz = e1[0] * e2[1] - e1[1] * e2[0];
+				const double angle = std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), e1[0] * e2[0] + e1[1] * e2[1] + e1[2] * e2[2]);
+				for (int axis = 0; axis < 3; ++axis)
+					vertexSums[static_cast<size_t>(corner[c]) * 3 + axis] += angle * n[axis];
+
+				std::array<double, 3>& edge = edgeSums.emplace(edgeKey(corner[c], corner[(c + 1) % 3]), std::array<double, 3>{ 0.0, 0.0, 0.0 }).first->second;
+				for (int axis = 0; axis < 3; ++axis)
+					edge[axis] += n[axis];
+			}
+		}
+
+		std::vector<TriangleNormals> normals(triangleCount);
+		for (size_t t = 0; t < triangleCount; ++t) {
+			const UInt32* corner = &mesh.triangles[t * 3];
+			for (int c = 0; c < 3; ++c) {
+				const auto found = edgeSums.find(edgeKey(corner[c], corner[(c + 1) % 3]));
+				for (int axis = 0; axis < 3; ++axis) {
+					normals[t].vertex[c][axis] = static_cast<float>(vertexSums[static_cast<size_t>(corner[c]) * 3 + axis]);
+					normals[t].edge[c][axis] = static_cast<float>(found != edgeSums.end() ? found->second[axis] : faceNormals[t][axis]);
+				}
+			}
+		}
+		return normals;
+	}
+
+	// 点在三角形所在表面哪一侧（正为外侧）：求最近点所在的区域（顶点、边或面内，Ericson 的区域划分），
+	// 用该区域的伪法向与 p - 最近点的点积判断
+	static double SurfaceSide(const TrianglePacket& t, UInt32 k, const TriangleNormals& normals, double px, double py, double pz) {
+		const double ab[3] = { t.abx[k], t.aby[k], t.abz[k] };
+		const double ac[3] = { t.acx[k], t.acy[k], t.acz[k] };
+		const double ap[3] = { px - t.ax[k], py - t.ay[k], pz - t.az[k] };
+		auto dot = [](const double* u, const double* v) { return u[0] * v[0] + u[1] * v[1] + u[2] * v[2]; };
+		auto side = [&](const float* normal, double s, double r) {
+			// 最近点 = a + s·ab + r·ac
+			double sum = 0.0;
+			for (int axis = 0; axis < 3; ++axis)
+				sum += (ap[axis] - s * ab[axis] - r * ac[axis]) * normal[axis];
+			return sum;
+		};
+
+		const double d1 = dot(ab, ap), d2 = dot(ac, ap);
+		if (d1 <= 0.0 && d2 <= 0.0)
+			return side(normals.vertex[0], 0.0, 0.0);
+		const double bp[3] = { ap[0] - ab[0], ap[1] - ab[1], ap[2] - ab[2] };
+		const double d3 = dot(ab, bp), d4 = dot(ac, bp);
+		if (d3 >= 0.0 && d4 <= d3)
+			return side(normals.vertex[1], 1.0, 0.0);
+		const double vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+			return side(normals.edge[0], d1 / (d1 - d3), 0.0);
+		const double cp[3] = { ap[0] - ac[0], ap[1] - ac[1], ap[2] - ac[2] };
+		const double d5 = dot(ab, cp), d6 = dot(ac, cp);
+		if (d6 >= 0.0 && d5 <= d6)
+			return side(normals.vertex[2], 0.0, 1.0);
+		const double vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+			return side(normals.edge[2], 0.0, d2 / (d2 - d6));
+		const double va = d3 * d6 - d5 * d4;
+		if (va <= 0.0 && d4 - d3 >= 0.0 && d5 - d6 >= 0.0) {
+			const double w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+			return side(normals.edge[1], 1.0 - w, w);
+		}
+		// 面内：伪法向即面法向
+		return ap[0] * t.nx[k] + ap[1] * t.ny[k] + ap[2] * t.nz[k];
+	}
+
+	// ---- BVH ----------------------------------------------------------------
+
+	struct BvhNode {
+		Aabb box;
+		UInt32 left = 0;			// 内部节点：子节点
+		UInt32 right = 0;
+		UInt32 first = 0;			// 叶节点：packets 中的起点
+		UInt32 count = 0;
+		bool leaf = false;
+	};
+
+	struct TriangleRef {
+		UInt32 element = 0;			// meshes 中的下标
+		UInt32 triangle = 0;		// 网格中的三角形序号
+		UInt32 corner[3] = { 0, 0, 0 };
+		double centroid[3] = { 0.0, 0.0, 0.0 };
+		Aabb box;
+	};
+
+	// 静态三角形 BVH；建立后只读，可在多个工作线程中同时查询
+	class TriangleBvh {
+	public:
+		void Build(const std::vector<HBIMElementMesh::Mesh>& meshes) {
+			nodes.clear();
+			packets.clear();
+			normals.clear();
+			triangleCount = 0;
+			std::vector<TriangleRef> refs;
+			std::vector<std::vector<TriangleNormals>> meshNormals(meshes.size());
+			for (size_t element = 0; element < meshes.size(); ++element) {
+				const HBIMElementMesh::Mesh& mesh = meshes[element];
+				meshNormals[element] = ComputePseudonormals(mesh);
+				for (size_t i = 0; i + 2 < mesh.triangles.size(); i += 3) {
+					TriangleRef ref;
+					ref.element = static_cast<UInt32>(element);
+					ref.triangle = static_cast<UInt32>(i / 3);
+					ref.box = EmptyAabb();
+					for (int c = 0; c < 3; ++c) {
+						ref.corner[c] = mesh.triangles[i + c];
+						const double* p = &mesh.positions[static_cast<size_t>(ref.corner[c]) * 3];
+						for (int axis = 0; axis < 3; ++axis) {
+							ref.box.lo[axis] = std::min(ref.box.lo[axis], p[axis]);
+							ref.box.hi[axis] = std::max(ref.box.hi[axis], p[axis]);
+							ref.centroid[axis] += p[axis] / 3.0;
+						}
+					}
+					refs.push_back(ref);
+				}
+			}
+			triangleCount = refs.size();
+			if (refs.empty())
+				return;
+
+			nodes = BuildRange(refs, 0, refs.size(), 0);
+			for (BvhNode& node : nodes) {
+				if (!node.leaf)
+					continue;
+				const UInt32 begin = node.first, end = node.first + node.count;
+				node.first = static_cast<UInt32>(packets.size());
+				node.count = 0;
+				for (UInt32 i = begin; i < end; i += kPacketWidth) {
+					packets.push_back(MakePacket(meshes, refs, i, std::min(end, i + kPacketWidth)));
+					for (UInt32 k = 0; k < kPacketWidth; ++k) {
+						const TriangleRef& ref = refs[std::min(i + k, std::min(end, i + kPacketWidth) - 1)];
+						normals.push_back(meshNormals[ref.element][ref.triangle]);
+					}
+					++node.count;
+				}
+			}
+		}
+
+		size_t GetTriangleCount() const { return triangleCount; }
+		size_t GetNodeCount() const { return nodes.size(); }
+
+		// 距离点不超过 maxDistance 的最近三角形所属构件与有符号距离
+		bool Nearest(double x, double y, double z, double maxDistance, UInt32& outElement, double& outSigned) const {
+			if (nodes.empty())
+				return false;
+			double best2 = maxDistance * maxDistance;
+			UInt32 bestPacket = 0, bestSlot = 0;
+			bool found = false;
+
+			UInt32 stack[kMaxTraversalDepth];
+			int top = 0;
+			stack[top++] = 0;
+			while (top > 0) {
+				const BvhNode& node = nodes[stack[--top]];
+				if (Distance2(node.box, x, y, z) >= best2)
+					continue;
+				if (node.leaf) {
+					double distance2[kPacketWidth];
+					for (UInt32 i = node.first; i < node.first + node.count; ++i) {
+						const TrianglePacket& packet = packets[i];
+						PacketDistances(packet, x, y, z, distance2);
+						for (UInt32 k = 0; k < kPacketWidth; ++k) {
+							if (distance2[k] < best2) {
+								best2 = distance2[k];
+								bestPacket = i;
+								bestSlot = k;
+								outElement = packet.element[k];
+								found = true;
+							}
+						}
+					}
+					continue;
+				}
+				// 近的子节点后入栈、先处理，尽早缩小搜索半径
+				const double leftDistance2 = Distance2(nodes[node.left].box, x, y, z);
+				const double rightDistance2 = Distance2(nodes[node.right].box, x, y, z);
+				const UInt32 nearChild = leftDistance2 <= rightDistance2 ? node.left : node.right;
+				const UInt32 farChild = leftDistance2 <= rightDistance2 ? node.right : node.left;
+				if (std::max(leftDistance2, rightDistance2) < best2 && top < kMaxTraversalDepth)
+					stack[top++] = farChild;
+				if (std::min(leftDistance2, rightDistance2) < best2 && top < kMaxTraversalDepth)
+					stack[top++] = nearChild;
+			}
+			// 只为最终的最近三角形判断内外
+			if (found) {
+				const double side = SurfaceSide(packets[bestPacket], bestSlot, normals[bestPacket * kPacketWidth + bestSlot], x, y, z);
+				outSigned = side >= 0.0 ? std::sqrt(best2) : -std::sqrt(best2);
+			}
+			return found;
+		}
+
+	private:
+		std::vector<BvhNode> nodes;
+		std::vector<TrianglePacket> packets;
+		std::vector<TriangleNormals> normals;		// 与 packets 中的三角形一一对应（packet 序号 * kPacketWidth + 槽位）
+		size_t triangleCount = 0;
+
+		// 建立 refs[begin, end) 的子树，返回的节点数组中第一个为子树根，子节点序号相对该数组；
+		// 叶节点暂存 refs 中的范围。各子树只重排自己范围内的 refs，可在不同线程中同时建立
+		static std::vector<BvhNode> BuildRange(std::vector<TriangleRef>& refs, size_t begin, size_t end, int depth) {
+			BvhNode root;
+			root.box = EmptyAabb();
+			Aabb centroids = EmptyAabb();
+			for (size_t i = begin; i < end; ++i) {
+				Extend(root.box, refs[i].box);
+				for (int axis = 0; axis < 3; ++axis) {
+					centroids.lo[axis] = std::min(centroids.lo[axis], refs[i].centroid[axis]);
+					centroids.hi[axis] = std::max(centroids.hi[axis], refs[i].centroid[axis]);
+				}
+			}
+			if (end - begin <= kLeafTriangles || depth >= kMaxTraversalDepth / 2 - 1) {
+				root.leaf = true;
+				root.first = static_cast<UInt32>(begin);
+				root.count = static_cast<UInt32>(end - begin);
+				return { root };
+			}
+
+			// 按重心范围最长的轴取中位数划分
+			int axis = 0;
+			for (int candidate = 1; candidate < 3; ++candidate) {
+				if (centroids.hi[candidate] - centroids.lo[candidate] > centroids.hi[axis] - centroids.lo[axis])
+					axis = candidate;
+			}
+			const size_t mid = begin + (end - begin) / 2;
+			std::nth_element(refs.begin() + begin, refs.begin() + mid, refs.begin() + end,
+							 [axis](const TriangleRef& a, const TriangleRef& b) { return a.centroid[axis] < b.centroid[axis]; });
+
+			std::vector<BvhNode> left, right;
+			if (depth < kParallelBuildDepth && end - begin >= kParallelBuildMinTriangles) {
+				std::future<std::vector<BvhNode>> leftFuture = std::async(std::launch::async, BuildRange, std::ref(refs), begin, mid, depth + 1);
+				right = BuildRange(refs, mid, end, depth + 1);
+				left = leftFuture.get();
+			} else {
+				left = BuildRange(refs, begin, mid, depth + 1);
+				right = BuildRange(refs, mid, end, depth + 1);
+			}
+
+			std::vector<BvhNode> result;
+			result.reserve(1 + left.size() + right.size());
+			root.left = 1;
+			root.right = static_cast<UInt32>(1 + left.size());
+			result.push_back(root);
+			for (BvhNode node : left) {
+				if (!node.leaf) {
+					node.left += root.left;
+					node.right += root.left;
+				}
+				result.push_back(node);
+			}
+			for (BvhNode node : right) {
+				if (!node.leaf) {
+					node.left += root.right;
+					node.right += root.right;
+				}
+				result.push_back(node);
+			}
+			return result;
+		}
+
+		static TrianglePacket MakePacket(const std::vector<HBIMElementMesh::Mesh>& meshes, const std::vector<TriangleRef>& refs, UInt32 begin, UInt32 end) {
+			auto inverse = [](double value) { return value > 0.0 ? 1.0 / value : 0.0; };
+			TrianglePacket packet;
+			for (UInt32 k = 0; k < kPacketWidth; ++k) {
+				const TriangleRef& ref = refs[std::min(begin + k, end - 1)];
+				const std::vector<double>& positions = meshes[ref.element].positions;
+				const double* a = &positions[static_cast<size_t>(ref.corner[0]) * 3];
+				const double* b = &positions[static_cast<size_t>(ref.corner[1]) * 3];
+				const double* c = &positions[static_cast<size_t>(ref.corner[2]) * 3];
+				packet.ax[k] = a[0];
+				packet.ay[k] = a[1];
+				packet.az[k] = a[2];
+				packet.abx[k] = b[0] - a[0];
+				packet.aby[k] = b[1] - a[1];
+				packet.abz[k] = b[2] - a[2];
+				packet.acx[k] = c[0] - a[0];
+				packet.acy[k] = c[1] - a[1];
+				packet.acz[k] = c[2] - a[2];
+				packet.nx[k] = packet.aby[k] * packet.acz[k] - packet.abz[k] * packet.acy[k];
+				packet.ny[k] = packet.abz[k] * packet.acx[k] - packet.abx[k] * packet.acz[k];
+				packet.nz[k] = packet.abx[k] * packet.acy[k] - packet.aby[k] * packet.acx[k];
+				packet.invNormal2[k] = inverse(packet.nx[k] * packet.nx[k] + packet.ny[k] * packet.ny[k] + packet.nz[k] * packet.nz[k]);
+				const double bcx = c[0] - b[0], bcy = c[1] - b[1], bcz = c[2] - b[2];
+				packet.invAb2[k] = inverse(packet.abx[k] * packet.abx[k] + packet.aby[k] * packet.aby[k] + packet.abz[k] * packet.abz[k]);
+				packet.invBc2[k] = inverse(bcx * bcx + bcy * bcy + bcz * bcz);
+				packet.invCa2[k] = inverse(packet.acx[k] * packet.acx[k] + packet.acy[k] * packet.acy[k] + packet.acz[k] * packet.acz[k]);
+				packet.element[k] = ref.element;
+			}
+			return packet;
+		}
+	};
+
+	// ---- 分块并行查询 ----------------------------------------------------------------
+
+	struct Accumulator {
+		UInt64 count = 0;
+		double sum = 0.0;
+		double sumSquares = 0.0;
+		double maxDeviation = 0.0;		// 绝对值最大的有符号偏差
+	};
+
+	struct ElementDeviation {
+		API_Guid elemGuid = APINULLGuid;
+		UInt64 pointCount = 0;
+		double mean = 0.0;				// m
+		double rms = 0.0;
+		double maxDeviation = 0.0;
+	};
+
+	struct Outcome {
+		std::vector<ElementDeviation> elements;
+		UInt64 totalPoints = 0;
+		UInt64 matchedPoints = 0;
+		size_t triangles = 0;
+		unsigned workers = 0;
+		double buildSeconds = 0.0;
+		double querySeconds = 0.0;		// 只计点查询，不含读取文件
+		double seconds = 0.0;
+		bool completed = false;
+		GS::UniString error;
+	};
+
+	static std::future<void> s_worker;
+	static std::atomic<bool> s_stop(false);
+
+	class DeviationCallback : public HBIMPointCloud::Callback {
+	public:
+		DeviationCallback(const TriangleBvh& bvh, size_t elementCount) : bvh(bvh) {
+			const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+			workers = std::min(hardware, kMaxWorkers);
+			accumulators.assign(workers, std::vector<Accumulator>(elementCount));
+		}
+
+		unsigned GetWorkerCount() const { return workers; }
+
+		bool Append(const HBIMPointCloud::Point* points, UInt32 numberOfPoints) override {
+			if (s_stop)
+				return false;
+			auto start = std::chrono::steady_clock::now();
+			total += numberOfPoints;
+			std::atomic<UInt32> next(0);
+			auto work = [&](unsigned worker) {
+				std::vector<Accumulator>& own = accumulators[worker];
+				for (UInt32 begin = next.fetch_add(kBlockPoints); begin < numberOfPoints; begin = next.fetch_add(kBlockPoints)) {
+					const UInt32 end = std::min(numberOfPoints, begin + kBlockPoints);
+					for (UInt32 i = begin; i < end; ++i) {
+						UInt32 element = 0;
+						double deviation = 0.0;
+						if (!bvh.Nearest(points[i].x, points[i].y, points[i].z, kMaxDeviation, element, deviation))
+							continue;
+						Accumulator& acc = own[element];
+						acc.count += 1;
+						acc.sum += deviation;
+						acc.sumSquares += deviation * deviation;
+						if (std::fabs(deviation) > std::fabs(acc.maxDeviation))
+							acc.maxDeviation = deviation;
+					}
+				}
+			};
+			const unsigned threadCount = static_cast<unsigned>(std::min<UInt64>(workers, (numberOfPoints + kBlockPoints - 1) / kBlockPoints));
+			std::vector<std::thread> threads;
+			for (unsigned i = 1; i < threadCount; ++i)
+				threads.emplace_back(work, i);
+			work(0);
+			for (std::thread& thread : threads)
+				thread.join();
+			querySeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			return !s_stop;
+		}
+
+		void Merge(const std::vector<API_Guid>& elemGuids, Outcome& outcome) const {
+			outcome.totalPoints = total;
+			outcome.querySeconds = querySeconds;
+			outcome.workers = workers;
+			for (size_t element = 0; element < elemGuids.size(); ++element) {
+				Accumulator sum;
+				for (const std::vector<Accumulator>& own : accumulators) {
+					const Accumulator& part = own[element];
+					sum.count += part.count;
+					sum.sum += part.sum;
+					sum.sumSquares += part.sumSquares;
+					if (std::fabs(part.maxDeviation) > std::fabs(sum.maxDeviation))
+						sum.maxDeviation = part.maxDeviation;
+				}
+				ElementDeviation row;
+				row.elemGuid = elemGuids[element];
+				row.pointCount = sum.count;
+				if (sum.count > 0) {
+					row.mean = sum.sum / sum.count;
+					row.rms = std::sqrt(sum.sumSquares / sum.count);
+					row.maxDeviation = sum.maxDeviation;
+				}
+				outcome.matchedPoints += sum.count;
+				outcome.elements.push_back(row);
+			}
+		}
+
+	private:
+		const TriangleBvh& bvh;
+		unsigned workers = 1;
+		std::vector<std::vector<Accumulator>> accumulators;		// 每个工作线程一份，最后合并
+		UInt64 total = 0;
+		double querySeconds = 0.0;
+	};
+
+	// 建立 BVH 后流式查询；meshes 与 elemGuids 一一对应
+	static void Analyze(const std::vector<HBIMElementMesh::Mesh>& meshes, const std::vector<API_Guid>& elemGuids,
+						HBIMPointCloud::Source& source, Outcome& outcome) {
+		auto start = std::chrono::steady_clock::now();
+		TriangleBvh bvh;
+		bvh.Build(meshes);
+		outcome.triangles = bvh.GetTriangleCount();
+		outcome.buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		DeviationCallback callback(bvh, meshes.size());
+		outcome.completed = source.DoStreaming(callback);
+		outcome.error = source.GetError();
+		if (outcome.completed)
+			callback.Merge(elemGuids, outcome);
+		else
+			outcome.workers = callback.GetWorkerCount();
+		outcome.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// ---- 属性与表格 ----------------------------------------------------------------
+
+	static GS::UniString FormatMillimeters(double meters) {
+		return GS::UniString::Printf("%.1f", meters * 1000.0);
+	}
+
+	// 需在 ACAPI_CallUndoableCommand 作用域内调用；长度属性以米写入。没有点的构件不改写
+	static GSErrCode WriteDeviationProperties(const std::vector<ElementDeviation>& rows, UInt32& outWritten) {
+		outWritten = 0;
+		API_Guid rmsGuid, maxGuid;
+		GSErrCode err = HBIM::EnsureHBIMDeviationPropertyDefinitions(rmsGuid, maxGuid);
+		if (err != NoError)
+			return err;
+
+		API_Property rmsProperty = {}, maxProperty = {};
+		rmsProperty.definition.guid = rmsGuid;
+		maxProperty.definition.guid = maxGuid;
+		err = ACAPI_Property_GetPropertyDefinition(rmsProperty.definition);
+		if (err == NoError)
+			err = ACAPI_Property_GetPropertyDefinition(maxProperty.definition);
+		if (err != NoError)
+			return err;
+		for (API_Property* property : { &rmsProperty, &maxProperty }) {
+			property->status = API_Property_HasValue;
+			property->isDefault = false;
+			property->value.variantStatus = API_VariantStatusNormal;
+			property->value.singleVariant.variant.type = API_PropertyRealValueType;
+		}
+
+		for (const ElementDeviation& row : rows) {
+			if (row.pointCount == 0)
+				continue;
+			rmsProperty.value.singleVariant.variant.doubleValue = row.rms;
+			maxProperty.value.singleVariant.variant.doubleValue = row.maxDeviation;
+			GSErrCode writeErr = ACAPI_Element_SetProperty(row.elemGuid, rmsProperty);
+			if (writeErr == NoError)
+				writeErr = ACAPI_Element_SetProperty(row.elemGuid, maxProperty);
+			if (writeErr != NoError) {
+				ACAPI_WriteReport("HBIMScanDeviation: 写入偏差属性失败，错误码=%d", true, writeErr);
+				continue;
+			}
+			++outWritten;
+		}
+		return NoError;
+	}
+
+	static bool WriteTable(const std::filesystem::path& tablePath, const GS::UniString& scanFile, const std::vector<ElementDeviation>& rows) {
+		return HBIM::WriteCsvTable(tablePath, "GlobalId,扫描文件,点数,平均偏差(mm),偏差RMS(mm),最大偏差(mm)",
+			[&](std::ostream& out) {
+				for (const ElementDeviation& row : rows) {
+					out << HBIM::CsvField(HBIMGlobalIdIndex::GetGlobalId(row.elemGuid)) << ',' << HBIM::CsvField(scanFile) << ',' << row.pointCount << ',';
+					if (row.pointCount > 0) {
+						out << FormatMillimeters(row.mean).ToCStr().Get() << ',' << FormatMillimeters(row.rms).ToCStr().Get() << ','
+							<< FormatMillimeters(row.maxDeviation).ToCStr().Get();
+					} else {
+						out << ",,";
+					}
+					out << '\n';
+				}
+			}
+		);
+	}
+
+	static GS::UniString FormatReport(const Outcome& outcome, UInt32 written, const std::filesystem::path& tablePath, bool tableWritten) {
+		std::vector<const ElementDeviation*> ranked;
+		for (const ElementDeviation& row : outcome.elements) {
+			if (row.pointCount > 0)
+				ranked.push_back(&row);
+		}
+		std::sort(ranked.begin(), ranked.end(), [](const ElementDeviation* a, const ElementDeviation* b) { return a->rms > b->rms; });
+
+		GS::UniString msg = GS::UniString::Printf("扫描点 %llu 个，距构件表面 %.0f cm 以内 %llu 个。\n",
+												  static_cast<unsigned long long>(outcome.totalPoints), kMaxDeviation * 100.0,
+												  static_cast<unsigned long long>(outcome.matchedPoints));
+		msg.Append(GS::UniString::Printf("三角形 %u 个，建立索引 %.2f 秒，查询 %.1f 秒（%u 线程），共 %.1f 秒。\n",
+										 static_cast<unsigned>(outcome.triangles), outcome.buildSeconds, outcome.querySeconds,
+										 outcome.workers, outcome.seconds));
+		msg.Append(GS::UniString::Printf("已为 %u 个构件写入扫描偏差属性（共 %u 个构件）。\n", written, static_cast<unsigned>(outcome.elements.size())));
+		if (tableWritten) {
+			msg.Append("表格: ");
+			msg.Append(GS::UniString(tablePath.string().c_str(), CC_UTF8));
+		} else {
+			msg.Append("表格写入失败");
+		}
+
+		for (size_t i = 0; i < ranked.size() && i < kMaxReportedElements; ++i) {
+			if (i == 0)
+				msg.Append("\n\n偏差最大的构件:");
+			msg.Append("\n  ");
+			msg.Append(HBIMGlobalIdIndex::GetGlobalId(ranked[i]->elemGuid));
+			msg.Append(GS::UniString::Printf(": RMS %.1f mm，最大 %+.1f mm（%llu 点）", ranked[i]->rms * 1000.0,
+											 ranked[i]->maxDeviation * 1000.0, static_cast<unsigned long long>(ranked[i]->pointCount)));
+		}
+		return msg;
+	}
+
+	static void ApplyOutcome(const std::filesystem::path& projectDir, const GS::UniString& scanFile, const Outcome& outcome) {
+		ACAPI_WriteReport("HBIMScanDeviation: %llu 点，匹配 %llu 点，%d 个三角形，索引 %.3f 秒，查询 %.3f 秒，共 %.3f 秒", false,
+						  static_cast<unsigned long long>(outcome.totalPoints), static_cast<unsigned long long>(outcome.matchedPoints),
+						  static_cast<int>(outcome.triangles), outcome.buildSeconds, outcome.querySeconds, outcome.seconds);
+		if (!outcome.completed) {
+			GS::UniString msg = "读取扫描文件失败";
+			if (!outcome.error.IsEmpty()) {
+				msg.Append("：");
+				msg.Append(outcome.error);
+			}
+			DG::InformationAlert("扫描与模型偏差", msg, "确定");
+			return;
+		}
+		// 分析期间切换了项目，结果作废
+		const HBIMProject::Context& context = HBIMProject::GetContext();
+		if (!context.isSaved || context.projectDir != projectDir)
+			return;
+
+		UInt32 written = 0;
+		GSErrCode err = ACAPI_CallUndoableCommand("写入扫描偏差",
+			[&]() -> GSErrCode {
+				return WriteDeviationProperties(outcome.elements, written);
+			}
+		);
+		if (err != NoError)
+			ACAPI_WriteReport("HBIMScanDeviation: 写入偏差属性失败，错误码=%d", true, err);
+
+		const std::filesystem::path tablePath = projectDir / kTableFileName;
+		const bool tableWritten = WriteTable(tablePath, scanFile, outcome.elements);
+		if (!tableWritten)
+			ACAPI_WriteReport("HBIMScanDeviation: 写入表格失败: %s", true, tablePath.string().c_str());
+
+		GS::UniString msg = FormatReport(outcome, written, tablePath, tableWritten);
+		if (err != NoError)
+			msg.Append(GS::UniString::Printf("\n\n写入属性失败 (错误码: %d)", err));
+		DG::InformationAlert("扫描与模型偏差", msg, "确定");
+	}
+
+	// ---- 性能测试 ----------------------------------------------------------------
+
+	struct BenchFace {
+		double origin[3];
+		double u[3];		// u × v 为外法向
+		double v[3];
+	};
+
+	// 单位立方体的六个面
+	static const BenchFace kBenchFaces[6] = {
+		{ { 0, 0, 0 }, { 0, 1, 0 }, { 1, 0, 0 } },		// -z
+		{ { 0, 0, 1 }, { 1, 0, 0 }, { 0, 1, 0 } },		// +z
+		{ { 0, 0, 0 }, { 1, 0, 0 }, { 0, 0, 1 } },		// -y
+		{ { 0, 1, 0 }, { 0, 0, 1 }, { 1, 0, 0 } },		// +y
+		{ { 0, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 } },		// -x
+		{ { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } }		// +x
+	};
+
+	static void BenchCubeOrigin(UInt32 cube, double origin[3]) {
+		origin[0] = (cube % kBenchGrid) * kBenchSpacing;
+		origin[1] = ((cube / kBenchGrid) % kBenchGrid) * kBenchSpacing;
+		origin[2] = (cube / (kBenchGrid * kBenchGrid)) * kBenchSpacing;
+	}
+
+	static std::vector<HBIMElementMesh::Mesh> MakeBenchMeshes() {
+		const UInt32 n = kBenchFaceDivisions;
+		std::vector<HBIMElementMesh::Mesh> meshes(kBenchGrid * kBenchGrid * kBenchLevels);
+		for (UInt32 cube = 0; cube < meshes.size(); ++cube) {
+			HBIMElementMesh::Mesh& mesh = meshes[cube];
+			double origin[3];
+			BenchCubeOrigin(cube, origin);
+			for (const BenchFace& face : kBenchFaces) {
+				const UInt32 base = static_cast<UInt32>(mesh.positions.size() / 3);
+				for (UInt32 j = 0; j <= n; ++j) {
+					for (UInt32 i = 0; i <= n; ++i) {
+						for (int axis = 0; axis < 3; ++axis)
+							mesh.positions.push_back(origin[axis] + face.origin[axis] + face.u[axis] * i / n + face.v[axis] * j / n);
+					}
+				}
+				for (UInt32 j = 0; j < n; ++j) {
+					for (UInt32 i = 0; i < n; ++i) {
+						const UInt32 p00 = base + j * (n + 1) + i, p10 = p00 + 1, p01 = p00 + n + 1, p11 = p01 + 1;
+						mesh.triangles.insert(mesh.triangles.end(), { p00, p10, p11, p00, p11, p01 });
+					}
+				}
+			}
+		}
+		return meshes;
+	}
+
+	// 在立方体表面均匀取点，沿外法向加高斯噪声；结果的 RMS 应接近 kBenchNoise
+	class BenchSource : public HBIMPointCloud::Source {
+	public:
+		UInt64 GetNumberOfPoints() const override { return kBenchPoints; }
+
+		bool DoStreaming(HBIMPointCloud::Callback& callback) override {
+			std::mt19937_64 random(20240501);
+			std::uniform_int_distribution<UInt32> pickCube(0, kBenchGrid * kBenchGrid * kBenchLevels - 1);
+			std::uniform_int_distribution<int> pickFace(0, 5);
+			std::uniform_real_distribution<double> pickCoordinate(0.0, 1.0);
+			std::normal_distribution<double> noise(0.0, kBenchNoise);
+
+			std::vector<HBIMPointCloud::Point> chunk(HBIMPointCloud::kChunkPoints);
+			for (UInt64 produced = 0; produced < kBenchPoints;) {
+				const UInt32 count = static_cast<UInt32>(std::min<UInt64>(HBIMPointCloud::kChunkPoints, kBenchPoints - produced));
+				for (UInt32 i = 0; i < count; ++i) {
+					double origin[3];
+					BenchCubeOrigin(pickCube(random), origin);
+					const BenchFace& face = kBenchFaces[pickFace(random)];
+					const double s = pickCoordinate(random), t = pickCoordinate(random), offset = noise(random);
+					const double normal[3] = {
+						face.u[1] * face.v[2] - face.u[2] * face.v[1],
+						face.u[2] * face.v[0] - face.u[0] * face.v[2],
+						face.u[0] * face.v[1] - face.u[1] * face.v[0]
+					};
+					double p[3];
+					for (int axis = 0; axis < 3; ++axis)
+						p[axis] = origin[axis] + face.origin[axis] + face.u[axis] * s + face.v[axis] * t + normal[axis] * offset;
+					chunk[i].x = p[0];
+					chunk[i].y = p[1];
+					chunk[i].z = p[2];
+				}
+				if (!callback.Append(chunk.data(), count))
+					return false;
+				produced += count;
+			}
+			return true;
+		}
+	};
+
+	static void BenchmarkInBackground() {
+		const std::vector<HBIMElementMesh::Mesh> meshes = MakeBenchMeshes();
+		const std::vector<API_Guid> elemGuids(meshes.size(), APINULLGuid);
+		BenchSource source;
+		auto outcome = std::make_shared<Outcome>();
+		Analyze(meshes, elemGuids, source, *outcome);
+		if (s_stop)
+			return;
+
+		HBIMEventLoop::Post([outcome]() {
+			double sumSquares = 0.0;
+			for (const ElementDeviation& row : outcome->elements)
+				sumSquares += row.rms * row.rms * row.pointCount;
+			const double rms = outcome->matchedPoints > 0 ? std::sqrt(sumSquares / outcome->matchedPoints) : 0.0;
+			const double pointsPerSecond = outcome->querySeconds > 0.0 ? outcome->totalPoints / outcome->querySeconds : 0.0;
+
+			GS::UniString summary = GS::UniString::Printf("合成模型：%u 个立方体，%u 个三角形\n", static_cast<unsigned>(outcome->elements.size()),
+														  static_cast<unsigned>(outcome->triangles));
+			summary.Append(GS::UniString::Printf("合成点云：%llu 点，沿法向噪声 %.1f mm\n\n", static_cast<unsigned long long>(outcome->totalPoints),
+												 kBenchNoise * 1000.0));
+			summary.Append(GS::UniString::Printf("建立索引：%.3f 秒\n", outcome->buildSeconds));
+			summary.Append(GS::UniString::Printf("点查询：%.2f 秒，%u 线程，%.2f 百万点/秒\n", outcome->querySeconds, outcome->workers, pointsPerSecond / 1e6));
+			summary.Append(GS::UniString::Printf("匹配 %llu 点，偏差 RMS %.2f mm（应接近噪声）\n", static_cast<unsigned long long>(outcome->matchedPoints), rms * 1000.0));
+			if (pointsPerSecond > 0.0)
+				summary.Append(GS::UniString::Printf("\n按此速度查询 5 亿点约需 %.1f 分钟（不含读取文件）", kNightlyPoints / pointsPerSecond / 60.0));
+
+			ACAPI_WriteReport("HBIMScanDeviation: 性能测试\n%s", false, summary.ToCStr().Get());
+			DG::InformationAlert("点云偏差分析性能", summary, "确定");
+		});
+	}
+
+	static void DeviationInBackground(std::shared_ptr<std::vector<HBIMElementMesh::Mesh>> meshes, std::shared_ptr<HBIMPointCloud::Source> source,
+									  GS::UniString scanFile, std::filesystem::path projectDir) {
+		std::vector<API_Guid> elemGuids;
+		for (const HBIMElementMesh::Mesh& mesh : *meshes)
+			elemGuids.push_back(mesh.elemGuid);
+		auto outcome = std::make_shared<Outcome>();
+		Analyze(*meshes, elemGuids, *source, *outcome);
+		if (s_stop)
+			return;
+		HBIMEventLoop::Post([projectDir, scanFile, outcome]() { ApplyOutcome(projectDir, scanFile, *outcome); });
+	}
+
+}
+
+namespace HBIMScanDeviation {
+
+void Shutdown() {
+	s_stop = true;
+	if (s_worker.valid())
+		s_worker.wait();
+}
+
+void RunDeviationCommand() {
+	const HBIMProject::Context& context = HBIMProject::GetContext();
+	if (!context.isSaved) {
+		DG::InformationAlert("扫描与模型偏差", "项目未保存，无法写出偏差表格。", "确定");
+		return;
+	}
+	if (HBIM::IsWorkerRunning(s_worker)) {
+		DG::InformationAlert("扫描与模型偏差", "上一次分析尚未完成，请稍后再试。", "确定");
+		return;
+	}
+
+	std::vector<API_Guid> targetGuids;
+	std::vector<HBIMSpatialIndex::Box> targetBoxes;
+	HBIM::CollectTargetElements(targetGuids, targetBoxes);
+	GS::Array<API_Guid> elemGuids;
+	for (const API_Guid& guid : targetGuids)
+		elemGuids.Push(guid);
+	if (elemGuids.IsEmpty()) {
+		DG::InformationAlert("扫描与模型偏差", "没有可分析的三维构件。", "确定");
+		return;
+	}
+
+	GS::UniString scanPath;
+	if (!HBIMPointCloud::ChooseScanFile("选择已配准到项目坐标的扫描点云", scanPath))
+		return;
+	GS::UniString error;
+	bool fromCache = false;
+	std::shared_ptr<HBIMPointCloud::Source> source = HBIMPointCloudCache::OpenScan(context.projectDir, scanPath, fromCache, error);
+	if (source == nullptr) {
+		DG::InformationAlert("扫描与模型偏差", error, "确定");
+		return;
+	}
+
+	auto meshes = std::make_shared<std::vector<HBIMElementMesh::Mesh>>();
+	GSErrCode err = HBIMElementMesh::GetMeshes(elemGuids, *meshes);
+	if (err != NoError || meshes->empty()) {
+		DG::InformationAlert("扫描与模型偏差", GS::UniString::Printf("无法取得构件的三维模型 (错误码: %d)", err), "确定");
+		return;
+	}
+
+	const GS::UniString scanFile(std::filesystem::path(scanPath.ToCStr().Get()).filename().string().c_str(), CC_UTF8);
+	ACAPI_WriteReport("HBIMScanDeviation: 开始分析 %d 个构件，扫描文件 %s%s", false, static_cast<int>(meshes->size()), scanPath.ToCStr().Get(),
+					  fromCache ? "（读取缓存）" : "");
+	s_stop = false;
+	s_worker = std::async(std::launch::async, DeviationInBackground, meshes, source, scanFile, context.projectDir);
+}
+
+void RunBenchmarkCommand() {
+	if (HBIM::IsWorkerRunning(s_worker)) {
+		DG::InformationAlert("点云偏差分析性能", "上一次分析尚未完成，请稍后再试。", "确定");
+		return;
+	}
+	ACAPI_WriteReport("HBIMScanDeviation: 开始性能测试", false);
+	s_stop = false;
+	s_worker = std::async(std::launch::async, BenchmarkInBackground);
+}
+
+}
@@ -0,0 +1,26 @@
+#ifndef HBIMSCANDEVIATION_HPP
+#define HBIMSCANDEVIATION_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+
+// 扫描点云与构件模型的偏差分析（Scan-to-BIM）。
+// 构件三角网格（HBIMElementMesh）建立 BVH：多线程按最长轴中位数划分，叶节点中的三角形按 4 个一组
+// 按列存放，点到三角形距离的计算对一组三角形无分支进行，可由编译器向量化。扫描文件按块流式读取
+// （HBIMPointCloud），每块由全部核心并行查询最近的三角形，点归入该三角形所属的构件，
+// 有符号距离以点在构件表面外侧为正、内侧为负，最近点在边或顶点上时按角度加权伪法向判断。
+// 每个构件的 RMS 与最大偏差写入HBIM属性组中的扫描偏差长度属性，并写出表格。
+namespace HBIMScanDeviation {
+
+	// 在 FreeData 中调用：中止正在进行的分析并等待后台线程结束
+	void Shutdown();
+
+	// 菜单入口：对选中的构件（未选中时为全部三维构件）选择扫描文件，后台分析，完成后写入属性并写出表格
+	void RunDeviationCommand();
+
+	// 菜单入口：合成构件网格与点云（不读取项目），测量 BVH 建立与点查询的速度
+	void RunBenchmarkCommand();
+
+}
+
+#endif
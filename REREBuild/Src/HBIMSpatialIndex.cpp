@@ -0,0 +1,313 @@
+// *****************************************************************************
+// File:			HBIMSpatialIndex.cpp
+// Description:		STR 打包的静态 R 树：多线程批量建立、最近邻与相交查询；构件包围盒的读取
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMSpatialIndex.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <thread>
+
+namespace {
+
+	// 每个节点的子项数；16 使一个叶节点的包围盒正好落在几条缓存行内
+	static const UInt32 kNodeCapacity = 16;
+
+	static const API_ElemTypeID kIndexedTypes[] = {
+		API_WallID, API_ColumnID, API_BeamID, API_WindowID, API_DoorID, API_ObjectID, API_LampID,
+		API_SlabID, API_RoofID, API_MeshID, API_ShellID, API_SkylightID, API_MorphID,
+		API_CurtainWallID, API_StairID, API_RailingID
+	};
+
+	using HBIMSpatialIndex::Box;
+
+	static Box Union(const Box& a, const Box& b) {
+		Box result;
+		result.xMin = std::min(a.xMin, b.xMin);
+		result.yMin = std::min(a.yMin, b.yMin);
+		result.zMin = std::min(a.zMin, b.zMin);
+		result.xMax = std::max(a.xMax, b.xMax);
+		result.yMax = std::max(a.yMax, b.yMax);
+		result.zMax = std::max(a.zMax, b.zMax);
+		return result;
+	}
+
+	static bool Overlaps(const Box& a, const Box& b) {
+		return a.xMin <= b.xMax && b.xMin <= a.xMax &&
+			   a.yMin <= b.yMax && b.yMin <= a.yMax &&
+			   a.zMin <= b.zMax && b.zMin <= a.zMax;
+	}
+
+	static double AxisGap(double value, double lo, double hi) {
+		if (value < lo)
+			return lo - value;
+		if (value > hi)
+			return value - hi;
+		return 0.0;
+	}
+
+	static double DistanceSquared(const Box& box, double x, double y, double z, bool ignoreZ) {
+		const double dx = AxisGap(x, box.xMin, box.xMax);
+		const double dy = AxisGap(y, box.yMin, box.yMax);
+		const double dz = ignoreZ ? 0.0 : AxisGap(z, box.zMin, box.zMax);
+		return dx * dx + dy * dy + dz * dz;
+	}
+
+	// 少于此数的排序与打包在调用线程中完成，启动线程的开销不值得
+	static const size_t kParallelThreshold = 16384;
+
+	// 下标 [0, count) 由至多 workers 个线程按原子计数领取，调用线程也参与
+	template <typename Work>
+	static void RunParallel(size_t count, unsigned workers, Work work) {
+		std::atomic<size_t> next(0);
+		auto loop = [&]() {
+			for (size_t i = next++; i < count; i = next++)
+				work(i);
+		};
+		const size_t threadCount = std::min<size_t>(workers, count);
+		std::vector<std::thread> threads;
+		for (size_t i = 1; i < threadCount; ++i)
+			threads.emplace_back(loop);
+		loop();
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+
+	// 多线程排序：每个线程排一段，再逐轮两两归并（同一轮的归并互不相干，也并行）
+	template <typename Less>
+	static void ParallelSort(std::vector<UInt32>& order, unsigned workers, Less less) {
+		const size_t count = order.size();
+		if (workers <= 1 || count < kParallelThreshold) {
+			std::sort(order.begin(), order.end(), less);
+			return;
+		}
+		const size_t runSize = (count + workers - 1) / workers;
+		RunParallel(workers, workers, [&](size_t run) {
+			const size_t start = std::min(count, run * runSize);
+			std::sort(order.begin() + start, order.begin() + std::min(count, start + runSize), less);
+		});
+		for (size_t width = runSize; width < count; width *= 2) {
+			const size_t pairs = (count + 2 * width - 1) / (2 * width);
+			RunParallel(pairs, workers, [&](size_t pair) {
+				const size_t start = pair * 2 * width;
+				if (start + width >= count)
+					return;
+				std::inplace_merge(order.begin() + start, order.begin() + start + width, order.begin() + std::min(count, start + 2 * width), less);
+			});
+		}
+	}
+
+	// STR：先按 x 中心切成 √P 条，每条内按 y 中心排序，再每 kNodeCapacity 个一组。
+	// 房屋模型在高度方向很薄，按平面两轴分组已足够
+	template <typename CenterX, typename CenterY>
+	static void SortTileRecursive(std::vector<UInt32>& order, unsigned workers, CenterX centerX, CenterY centerY) {
+		const size_t count = order.size();
+		const size_t pages = (count + kNodeCapacity - 1) / kNodeCapacity;
+		const size_t slices = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(pages))));
+		const size_t sliceSize = slices * kNodeCapacity;
+
+		ParallelSort(order, workers, [&](UInt32 a, UInt32 b) { return centerX(a) < centerX(b); });
+		RunParallel((count + sliceSize - 1) / sliceSize, count < kParallelThreshold ? 1 : workers, [&](size_t slice) {
+			const size_t start = slice * sliceSize;
+			const size_t end = std::min(count, start + sliceSize);
+			std::sort(order.begin() + start, order.begin() + end, [&](UInt32 a, UInt32 b) { return centerY(a) < centerY(b); });
+		});
+	}
+
+	static bool IsRemoved(const std::vector<bool>* removed, UInt32 item) {
+		return removed != nullptr && item < removed->size() && (*removed)[item];
+	}
+
+}
+
+namespace HBIMSpatialIndex {
+
+void BoxTree::Build(const std::vector<Box>& inputBoxes, unsigned workers) {
+	boxes = inputBoxes;
+	itemOrder.resize(boxes.size());
+	nodes.clear();
+	root = 0;
+	if (boxes.empty())
+		return;
+
+	for (UInt32 i = 0; i < itemOrder.size(); ++i)
+		itemOrder[i] = i;
+	SortTileRecursive(itemOrder, workers,
+		[this](UInt32 i) { return boxes[i].xMin + boxes[i].xMax; },
+		[this](UInt32 i) { return boxes[i].yMin + boxes[i].yMax; });
+
+	// 叶节点层：各叶节点互不相干，分段并行
+	std::vector<Node> level((itemOrder.size() + kNodeCapacity - 1) / kNodeCapacity);
+	const size_t leavesPerRun = 256;
+	RunParallel((level.size() + leavesPerRun - 1) / leavesPerRun, itemOrder.size() < kParallelThreshold ? 1 : workers, [&](size_t run) {
+		const size_t end = std::min(level.size(), (run + 1) * leavesPerRun);
+		for (size_t index = run * leavesPerRun; index < end; ++index) {
+			Node& leaf = level[index];
+			const size_t start = index * kNodeCapacity;
+			leaf.first = static_cast<UInt32>(start);
+			leaf.count = static_cast<UInt32>(std::min<size_t>(kNodeCapacity, itemOrder.size() - start));
+			leaf.box = boxes[itemOrder[start]];
+			for (UInt32 i = 1; i < leaf.count; ++i)
+				leaf.box = Union(leaf.box, boxes[itemOrder[start + i]]);
+		}
+	});
+
+	// 逐层向上打包：本层节点按 STR 顺序写入 nodes，父节点的子节点连续
+	while (level.size() > 1) {
+		std::vector<UInt32> order(level.size());
+		for (UInt32 i = 0; i < order.size(); ++i)
+			order[i] = i;
+		SortTileRecursive(order, workers,
+			[&level](UInt32 i) { return level[i].box.xMin + level[i].box.xMax; },
+			[&level](UInt32 i) { return level[i].box.yMin + level[i].box.yMax; });
+
+		const UInt32 base = static_cast<UInt32>(nodes.size());
+		for (UInt32 index : order)
+			nodes.push_back(level[index]);
+
+		std::vector<Node> parents;
+		for (size_t start = 0; start < order.size(); start += kNodeCapacity) {
+			Node parent;
+			parent.leaf = false;
+			parent.first = base + static_cast<UInt32>(start);
+			parent.count = static_cast<UInt32>(std::min<size_t>(kNodeCapacity, order.size() - start));
+			parent.box = nodes[parent.first].box;
+			for (UInt32 i = 1; i < parent.count; ++i)
+				parent.box = Union(parent.box, nodes[parent.first + i].box);
+			parents.push_back(parent);
+		}
+		level.swap(parents);
+	}
+
+	nodes.push_back(level.front());
+	root = static_cast<UInt32>(nodes.size() - 1);
+}
+
+void BoxTree::Nearest(double x, double y, double z, bool ignoreZ, UInt32 k, double maxDistance, std::vector<Hit>& outHits,
+					  const std::vector<bool>* removed) const {
+	outHits.clear();
+	if (nodes.empty() || k == 0)
+		return;
+
+	// 最佳优先搜索：堆中同时放节点和构件，按到点的最小距离出堆。
+	// 堆用线程自己的缓冲，反复查询时不再分配内存
+	struct QueueEntry {
+		double distanceSquared;
+		UInt32 index;
+		bool isItem;
+		bool operator> (const QueueEntry& other) const { return distanceSquared > other.distanceSquared; }
+	};
+	thread_local std::vector<QueueEntry> heap;
+	heap.clear();
+	const std::greater<QueueEntry> later;
+	const double maxDistanceSquared = maxDistance * maxDistance;
+
+	heap.push_back({ DistanceSquared(nodes[root].box, x, y, z, ignoreZ), root, false });
+	while (!heap.empty() && outHits.size() < k) {
+		std::pop_heap(heap.begin(), heap.end(), later);
+		const QueueEntry entry = heap.back();
+		heap.pop_back();
+		if (entry.distanceSquared > maxDistanceSquared)
+			break;
+		if (entry.isItem) {
+			outHits.push_back({ entry.index, std::sqrt(entry.distanceSquared) });
+			continue;
+		}
+		const Node& node = nodes[entry.index];
+		for (UInt32 i = 0; i < node.count; ++i) {
+			QueueEntry child;
+			if (node.leaf) {
+				const UInt32 item = itemOrder[node.first + i];
+				if (IsRemoved(removed, item))
+					continue;
+				child = { DistanceSquared(boxes[item], x, y, z, ignoreZ), item, true };
+			} else {
+				child = { DistanceSquared(nodes[node.first + i].box, x, y, z, ignoreZ), node.first + i, false };
+			}
+			if (child.distanceSquared > maxDistanceSquared)
+				continue;
+			heap.push_back(child);
+			std::push_heap(heap.begin(), heap.end(), later);
+		}
+	}
+}
+
+void BoxTree::Intersecting(const Box& query, std::vector<UInt32>& outItems, const std::vector<bool>* removed) const {
+	outItems.clear();
+	if (nodes.empty())
+		return;
+
+	// 深度优先；栈用线程自己的缓冲，与 Nearest 的堆一样反复查询时不再分配内存
+	thread_local std::vector<UInt32> stack;
+	stack.clear();
+	stack.push_back(root);
+	while (!stack.empty()) {
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+		if (!Overlaps(node.box, query))
+			continue;
+		for (UInt32 i = 0; i < node.count; ++i) {
+			if (node.leaf) {
+				const UInt32 item = itemOrder[node.first + i];
+				if (Overlaps(boxes[item], query) && !IsRemoved(removed, item))
+					outItems.push_back(item);
+			} else {
+				stack.push_back(node.first + i);
+			}
+		}
+	}
+}
+
+bool BoxesOverlap(const Box& a, const Box& b) {
+	return Overlaps(a, b);
+}
+
+double BoxDistance(const Box& box, double x, double y, double z, bool ignoreZ) {
+	return std::sqrt(DistanceSquared(box, x, y, z, ignoreZ));
+}
+
+bool IsIndexedElementType(API_ElemTypeID typeID) {
+	return std::find(std::begin(kIndexedTypes), std::end(kIndexedTypes), typeID) != std::end(kIndexedTypes);
+}
+
+bool GetElementBox(const API_Guid& elemGuid, API_Elem_Head& outHead, Box& outBox) {
+	outHead = {};
+	outHead.guid = elemGuid;
+	if (ACAPI_Element_GetHeader(&outHead) != NoError || !IsIndexedElementType(outHead.type.typeID))
+		return false;
+	API_Box3D bounds = {};
+	if (ACAPI_Element_CalcBounds(&outHead, &bounds) != NoError)
+		return false;
+	outBox.xMin = bounds.xMin;
+	outBox.yMin = bounds.yMin;
+	outBox.zMin = bounds.zMin;
+	outBox.xMax = bounds.xMax;
+	outBox.yMax = bounds.yMax;
+	outBox.zMax = bounds.zMax;
+	return true;
+}
+
+void CollectElementBoxes(std::vector<API_Guid>& outGuids, std::vector<Box>& outBoxes) {
+	outGuids.clear();
+	outBoxes.clear();
+	for (API_ElemTypeID typeID : kIndexedTypes) {
+		GS::Array<API_Guid> elemGuids;
+		if (ACAPI_Element_GetElemList(typeID, &elemGuids) != NoError)
+			continue;
+		for (const API_Guid& elemGuid : elemGuids) {
+			API_Elem_Head elemHead;
+			Box box;
+			if (!GetElementBox(elemGuid, elemHead, box))
+				continue;
+			outGuids.push_back(elemGuid);
+			outBoxes.push_back(box);
+		}
+	}
+}
+
+}
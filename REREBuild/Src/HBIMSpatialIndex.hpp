@@ -0,0 +1,71 @@
+#ifndef HBIMSPATIALINDEX_HPP
+#define HBIMSPATIALINDEX_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+
+#include <vector>
+
+// 包围盒空间索引：一次性按 STR（Sort-Tile-Recursive）打包成静态 R 树，
+// 节点连续存放在数组中；查询只读、不分配内存，可在多个工作线程中同时进行。
+// 项目中全部构件的常驻索引见 HBIMElementIndex。
+namespace HBIMSpatialIndex {
+
+	struct Box {
+		double xMin = 0.0, yMin = 0.0, zMin = 0.0;
+		double xMax = 0.0, yMax = 0.0, zMax = 0.0;
+	};
+
+	struct Hit {
+		UInt32 item = 0;			// Build 时传入的包围盒下标
+		double distance = 0.0;
+	};
+
+	class BoxTree {
+	public:
+		// 重新建立索引；item 编号即 boxes 中的下标。workers > 1 时排序与叶节点由多个线程完成
+		void Build(const std::vector<Box>& boxes, unsigned workers = 1);
+
+		size_t GetSize() const { return boxes.size(); }
+		const Box& GetBox(UInt32 item) const { return boxes[item]; }
+
+		// 距离点最近的至多 k 个包围盒（点在盒内距离为 0），按距离升序；ignoreZ 时只按平面距离。
+		// removed 非空时跳过其中为 true 的 item（已删除或已移到别处的构件，不必重建索引）
+		void Nearest(double x, double y, double z, bool ignoreZ, UInt32 k, double maxDistance, std::vector<Hit>& outHits,
+					 const std::vector<bool>* removed = nullptr) const;
+
+		// 与查询盒相交的所有包围盒
+		void Intersecting(const Box& query, std::vector<UInt32>& outItems, const std::vector<bool>* removed = nullptr) const;
+
+	private:
+		struct Node {
+			Box box;
+			UInt32 first = 0;		// 叶节点：itemOrder 中的起点；内部节点：nodes 中第一个子节点
+			UInt32 count = 0;
+			bool leaf = true;
+		};
+
+		std::vector<Box> boxes;
+		std::vector<UInt32> itemOrder;
+		std::vector<Node> nodes;
+		UInt32 root = 0;
+	};
+
+	// 两个包围盒是否相交（含接触）
+	bool BoxesOverlap(const Box& a, const Box& b);
+
+	// 点到包围盒的距离，点在盒内为 0
+	double BoxDistance(const Box& box, double x, double y, double z, bool ignoreZ);
+
+	// 参与空间查询的三维构件类型（二维图元、标注、区域不参与）
+	bool IsIndexedElementType(API_ElemTypeID typeID);
+
+	// 主线程：读取构件头（含楼层）与三维包围盒；不参与查询的类型返回 false
+	bool GetElementBox(const API_Guid& elemGuid, API_Elem_Head& outHead, Box& outBox);
+
+	// 主线程：取全部参与查询的构件的包围盒，outGuids 与 outBoxes 一一对应
+	void CollectElementBoxes(std::vector<API_Guid>& outGuids, std::vector<Box>& outBoxes);
+
+}
+
+#endif
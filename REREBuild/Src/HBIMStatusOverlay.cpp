@@ -0,0 +1,608 @@
+// *****************************************************************************
+// File:			HBIMStatusOverlay.cpp
+// Description:		HBIM完成度着色：批量计算构件完成状态写入属性，
+//					用专用覆盖组合按属性取值着色，随构件编辑增量更新
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMStatusOverlay.hpp"
+#include "HBIMCommon.hpp"
+#include "HBIMEventLoop.hpp"
+#include "HBIMImageStore.hpp"
+#include "HBIMNotifications.hpp"
+#include "HBIMSpatialIndex.hpp"
+#include "DGModule.hpp"
+#include "HashSet.hpp"
+#include "HashTable.hpp"
+#include "MemoryIChannel32.hpp"
+#include "MemoryOChannel32.hpp"
+
+#include <chrono>
+#include <utility>
+
+namespace {
+
+	static const Int32 kStatusCount = 4;
+	static const GS::UniString kStatusValues[kStatusCount] = { "无编号", "仅编号", "编号与说明", "有图片" };
+	static const API_RGBColor kStatusColors[kStatusCount] = {
+		{ 0.90, 0.20, 0.20 },
+		{ 1.00, 0.60, 0.10 },
+		{ 1.00, 0.90, 0.20 },
+		{ 0.30, 0.80, 0.30 }
+	};
+	static const Int32 kPhotoStatus = 3;
+	static const Int32 kDefaultStatus = 0;		// 属性定义的默认值，取该状态的构件不写值
+
+	static const GS::UniString kRuleGroupName = "HBIM完成度";
+	static const GS::UniString kRuleNamePrefix = "HBIM完成度 - ";
+	static const GS::UniString kCombinationName = "HBIM完成度";
+
+	// 开启着色前处于激活状态的覆盖组合，关闭时恢复
+	static const GS::UniString kPreviousModulName = "HBIMStatusOverlayPrevious";
+	static const Int32 kPreviousModulVersion = 1;
+
+	// 用户在 Archicad 中建立的模板规则：条件为 "HBIM完成状态" 等于 kTemplatePlaceholder，
+	// 四条规则的条件XML由它替换取值得到
+	static const GS::UniString kTemplateRuleName = "HBIM完成状态模板";
+	static const GS::UniString kTemplatePlaceholder = "HBIM_STATUS";
+
+	struct Definitions {
+		API_Guid idGuid = APINULLGuid;
+		API_Guid descGuid = APINULLGuid;
+		API_Guid statusGuid = APINULLGuid;
+	};
+
+	// 一个构件的编号/说明填写程度与属性中已有的状态；图片状态每次从链接表取，不缓存
+	struct ElementStatus {
+		Int32 fieldLevel = 0;		// 0 无编号，1 仅编号，2 编号与说明
+		Int32 status = -1;			// 属性中的状态序号（默认值即 kDefaultStatus），-1 为无法识别
+	};
+
+	using StatusWrite = std::pair<API_Guid, Int32>;
+
+	// 只在主线程访问
+	static GS::HashTable<API_Guid, ElementStatus> s_elements;
+	static GS::HashSet<API_Guid> s_dirtyElements;
+	static bool s_scanned = false;
+	static bool s_writing = false;
+	static Int32 s_activeState = -1;		// -1 未知，0 关闭，1 开启
+	static GS::HashSet<API_Guid> s_pendingElements;		// 着色开启时被编辑、等待改写状态的构件
+	static bool s_updatePosted = false;
+	static UInt32 s_generation = 0;
+
+	// ---- 状态计算 ----------------------------------------------------------------
+
+	static bool HasValue(const API_Property& property) {
+		return property.status == API_Property_HasValue && property.value.variantStatus == API_VariantStatusNormal &&
+			   !property.value.singleVariant.variant.uniStringValue.IsEmpty();
+	}
+
+	static Int32 StatusIndexOf(const API_Property& property) {
+		if (!HasValue(property))
+			return -1;
+		for (Int32 i = 0; i < kStatusCount; ++i) {
+			if (property.value.singleVariant.variant.uniStringValue == kStatusValues[i])
+				return i;
+		}
+		return -1;
+	}
+
+	static Int32 TargetStatus(const ElementStatus& state, bool hasPhotos) {
+		return hasPhotos ? kPhotoStatus : state.fieldLevel;
+	}
+
+	static bool FindDefinitions(Definitions& outDefs) {
+		outDefs = Definitions();
+		API_Guid groupGuid;
+		if (HBIM::FindExistingHBIMPropertyGroupAndDefinitions(groupGuid, outDefs.idGuid, outDefs.descGuid) != NoError) {
+			outDefs.idGuid = APINULLGuid;
+			outDefs.descGuid = APINULLGuid;
+		}
+		return HBIM::FindExistingHBIMStatusPropertyDefinition(outDefs.statusGuid) == NoError;
+	}
+
+	static bool IsStatusElement(const API_Guid& elemGuid) {
+		API_Elem_Head elemHead = {};
+		elemHead.guid = elemGuid;
+		return ACAPI_Element_GetHeader(&elemHead) == NoError && HBIMSpatialIndex::IsIndexedElementType(elemHead.type.typeID);
+	}
+
+	// 一次读取编号、说明与状态三个属性
+	static bool ReadElementStatus(const API_Guid& elemGuid, const Definitions& defs, ElementStatus& outState) {
+		GS::Array<API_Guid> defGuids;
+		if (defs.idGuid != APINULLGuid && defs.descGuid != APINULLGuid) {
+			defGuids.Push(defs.idGuid);
+			defGuids.Push(defs.descGuid);
+		}
+		defGuids.Push(defs.statusGuid);
+
+		GS::Array<API_Property> properties;
+		if (ACAPI_Element_GetPropertyValuesByGuid(elemGuid, defGuids, properties) != NoError)
+			return false;
+
+		bool hasId = false;
+		bool hasDesc = false;
+		outState = ElementStatus();
+		for (const API_Property& property : properties) {
+			if (property.definition.guid == defs.idGuid)
+				hasId = HasValue(property);
+			else if (property.definition.guid == defs.descGuid)
+				hasDesc = HasValue(property);
+			else if (property.definition.guid == defs.statusGuid)
+				outState.status = StatusIndexOf(property);
+		}
+		outState.fieldLevel = hasId ? (hasDesc ? 2 : 1) : 0;
+		return true;
+	}
+
+	static void ScanAll(const Definitions& defs) {
+		s_elements.Clear();
+		s_dirtyElements.Clear();
+		GS::Array<API_Guid> elemGuids;
+		ACAPI_Element_GetElemList(API_ZombieElemID, &elemGuids);
+		for (const API_Guid& elemGuid : elemGuids) {
+			ElementStatus state;
+			if (IsStatusElement(elemGuid) && ReadElementStatus(elemGuid, defs, state)) {
+				s_elements.Put(elemGuid, state);
+				HBIMNotifications::ObserveElement(elemGuid);
+			}
+		}
+		s_scanned = true;
+	}
+
+	static void RefreshDirty(const Definitions& defs) {
+		for (const API_Guid& elemGuid : s_dirtyElements) {
+			ElementStatus state;
+			if (IsStatusElement(elemGuid) && ReadElementStatus(elemGuid, defs, state))
+				s_elements.Put(elemGuid, state);
+			else
+				s_elements.Delete(elemGuid);
+		}
+		s_dirtyElements.Clear();
+	}
+
+	// 比较目标状态与属性中已有的状态，只收集需要改写的构件
+	static void CollectWrites(const HBIMImageStore::LinkTable& links, GS::Array<StatusWrite>& outWrites) {
+		for (auto it = s_elements.EnumeratePairs(); it != nullptr; ++it) {
+			const GS::Array<GS::UniString>* elemLinks = links.GetPtr(it->key);
+			const Int32 target = TargetStatus(it->value, elemLinks != nullptr && !elemLinks->IsEmpty());
+			if (target != it->value.status)
+				outWrites.Push(StatusWrite(it->key, target));
+		}
+	}
+
+	// 需在 ACAPI_CallUndoableCommand 作用域内调用；属性定义只取一次。
+	// 改回默认状态时恢复为默认值而不写入取值；遇到第一个错误即返回，由调用方决定是否放弃整个命令
+	static GSErrCode WriteStatuses(const API_Guid& statusGuid, const GS::Array<StatusWrite>& writes) {
+		if (writes.IsEmpty())
+			return NoError;
+		API_Property property = {};
+		property.definition.guid = statusGuid;
+		GSErrCode err = ACAPI_Property_GetPropertyDefinition(property.definition);
+		if (err != NoError)
+			return err;
+		property.status = API_Property_HasValue;
+		property.value.variantStatus = API_VariantStatusNormal;
+		property.value.singleVariant.variant.type = API_PropertyStringValueType;
+
+		for (const StatusWrite& write : writes) {
+			property.isDefault = (write.second == kDefaultStatus);
+			property.value.singleVariant.variant.uniStringValue = kStatusValues[write.second];
+			err = ACAPI_Element_SetProperty(write.first, property);
+			if (err != NoError) {
+				ACAPI_WriteReport("HBIMStatusOverlay: 写入完成状态失败，错误码=%d", true, err);
+				return err;
+			}
+			ElementStatus* state = s_elements.GetPtr(write.first);
+			if (state != nullptr)
+				state->status = write.second;
+		}
+		return NoError;
+	}
+
+	// ---- 覆盖规则 ----------------------------------------------------------------
+
+	static bool FindTemplateCriterion(GS::UniString& outXML) {
+		GS::Array<API_Guid> ruleGuids;
+		if (ACAPI_GraphicalOverride_GetOverrideRuleList(ruleGuids) != NoError)
+			return false;
+		for (const API_Guid& ruleGuid : ruleGuids) {
+			API_OverrideRule rule {};
+			rule.guid = ruleGuid;
+			if (ACAPI_GraphicalOverride_GetOverrideRuleById(rule) != NoError || rule.name != kTemplateRuleName)
+				continue;
+			if (rule.criterionXML.Contains(kTemplatePlaceholder)) {
+				outXML = rule.criterionXML;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static bool FindStatusRules(GS::Array<API_Guid>& outRules) {
+		API_OverrideRuleGroup group = { APINULLGuid, kRuleGroupName };
+		GS::Array<API_Guid> ruleGuids;
+		outRules.Clear();
+		if (ACAPI_GraphicalOverride_GetOverrideRuleGroup(group, &ruleGuids) != NoError)
+			return false;
+		// 组内可能还有用户放进来的模板规则，按名称前缀只取状态规则
+		for (const API_Guid& ruleGuid : ruleGuids) {
+			API_OverrideRule rule {};
+			rule.guid = ruleGuid;
+			if (ACAPI_GraphicalOverride_GetOverrideRuleById(rule) == NoError && rule.name.BeginsWith(kRuleNamePrefix))
+				outRules.Push(ruleGuid);
+		}
+		return !outRules.IsEmpty();
+	}
+
+	static API_OverrideRuleStyle MakeStyle(const API_RGBColor& color) {
+		API_OverrideRuleStyle style {};
+		style.surfaceOverride = color;
+		style.surfaceType.overrideCutSurface = true;
+		style.surfaceType.overrideUncutSurface = true;
+		style.fillBackgroundPenOverride = color;
+		style.fillTypeBackgroundPen.overrideCutFill = true;
+		style.fillTypeBackgroundPen.overrideCoverFill = true;
+		style.fillTypeBackgroundPen.overrideDraftingFill = false;
+		return style;
+	}
+
+	// 建立或更新规则组中的四条规则（需在 ACAPI_CallUndoableCommand 作用域内调用）
+	static GSErrCode EnsureStatusRules(const GS::UniString& templateXML, GS::Array<API_Guid>& outRules) {
+		API_OverrideRuleGroup group = { APINULLGuid, kRuleGroupName };
+		GSErrCode err = ACAPI_GraphicalOverride_GetOverrideRuleGroup(group);
+		if (err != NoError)
+			err = ACAPI_GraphicalOverride_CreateOverrideRuleGroup(group);
+		if (err != NoError)
+			return err;
+
+		outRules.Clear();
+		for (Int32 i = 0; i < kStatusCount; ++i) {
+			GS::UniString criterionXML = templateXML;
+			criterionXML.ReplaceAll(kTemplatePlaceholder, kStatusValues[i]);
+
+			API_OverrideRule rule {};
+			rule.name = kRuleNamePrefix + kStatusValues[i];
+			const bool exists = ACAPI_GraphicalOverride_GetOverrideRuleByName(rule, group.guid) == NoError;
+			rule.style = MakeStyle(kStatusColors[i]);
+			rule.criterionXML = criterionXML;
+			err = exists ? ACAPI_GraphicalOverride_ChangeOverrideRule(rule)
+						 : ACAPI_GraphicalOverride_CreateOverrideRule(rule, group.guid);
+			if (err != NoError)
+				return err;
+			outRules.Push(rule.guid);
+		}
+		return NoError;
+	}
+
+	// 当前激活的覆盖组合是本插件自己的 "HBIM完成度" 组合即视为已开启
+	static bool IsOverlayApplied() {
+		API_OverrideCombination active {};
+		return ACAPI_GraphicalOverride_GetActiveOverrideCombination(active) == NoError && active.name == kCombinationName;
+	}
+
+	static GSErrCode StorePreviousCombination(const API_Guid& combinationGuid) {
+		GS::MemoryOChannel32 oc(GS::MemoryOChannel32::BMAllocation);
+		GSErrCode err = oc.Write(APIGuid2GSGuid(combinationGuid));
+		if (err != NoError)
+			return err;
+
+		API_ModulData modulData {};
+		modulData.dataVersion = kPreviousModulVersion;
+		modulData.platformSign = GS::Act_Platform_Sign;
+		modulData.dataHdl = BMAllocateHandle(oc.GetDataSize(), ALLOCATE_CLEAR, 0);
+		if (modulData.dataHdl == nullptr)
+			return APIERR_MEMFULL;
+		BNCopyMemory(*modulData.dataHdl, oc.GetDestination(), oc.GetDataSize());
+		err = ACAPI_ModulData_Store(&modulData, kPreviousModulName);
+		BMKillHandle(&modulData.dataHdl);
+		return err;
+	}
+
+	static API_Guid LoadPreviousCombination() {
+		API_ModulData modulData {};
+		if (ACAPI_ModulData_Get(&modulData, kPreviousModulName) != NoError)
+			return APINULLGuid;
+		GS::Guid guid;
+		GSErrCode err = APIERR_BADPARS;
+		if (modulData.dataVersion == kPreviousModulVersion) {
+			GS::MemoryIChannel32 ic(*modulData.dataHdl, BMGetHandleSize(modulData.dataHdl));
+			err = ic.Read(guid);
+		}
+		BMKillHandle(&modulData.dataHdl);
+		return err == NoError ? GSGuid2APIGuid(guid) : APINULLGuid;
+	}
+
+	// 开启：状态规则只放在专用的 "HBIM完成度" 组合中并激活它，用户自己的组合保持不变；
+	// 激活前记下原来的组合（需在 ACAPI_CallUndoableCommand 作用域内调用）
+	static GSErrCode ActivateOwnCombination(const GS::Array<API_Guid>& statusRules) {
+		API_OverrideCombination own = { APINULLGuid, kCombinationName };
+		GSErrCode err = ACAPI_GraphicalOverride_GetOverrideCombination(own) == NoError
+			? ACAPI_GraphicalOverride_ChangeOverrideCombination(own, &statusRules)
+			: ACAPI_GraphicalOverride_CreateOverrideCombination(own, statusRules);
+		if (err != NoError)
+			return err;
+
+		API_OverrideCombination active {};
+		if (ACAPI_GraphicalOverride_GetActiveOverrideCombination(active) == NoError && active.guid != own.guid) {
+			err = StorePreviousCombination(active.guid);
+			if (err != NoError)
+				return err;
+		}
+		return ACAPI_GraphicalOverride_SetActiveOverrideCombination(own);
+	}
+
+	// 关闭：恢复开启前的组合；记录缺失或该组合已被删除时改用列表中第一个其他组合
+	static GSErrCode RestorePreviousCombination() {
+		API_OverrideCombination previous = { LoadPreviousCombination(), "" };
+		if (previous.guid == APINULLGuid || ACAPI_GraphicalOverride_GetOverrideCombination(previous) != NoError ||
+			previous.name == kCombinationName) {
+			GS::Array<API_Guid> combinations;
+			GSErrCode err = ACAPI_GraphicalOverride_GetOverrideCombinationList(combinations);
+			if (err != NoError)
+				return err;
+			previous = { APINULLGuid, "" };
+			for (const API_Guid& combinationGuid : combinations) {
+				API_OverrideCombination combination = { combinationGuid, "" };
+				if (ACAPI_GraphicalOverride_GetOverrideCombination(combination) == NoError && combination.name != kCombinationName) {
+					previous = combination;
+					break;
+				}
+			}
+			if (previous.guid == APINULLGuid)
+				return APIERR_GENERAL;
+		}
+		GSErrCode err = ACAPI_GraphicalOverride_SetActiveOverrideCombination(previous);
+		if (err == NoError && LoadPreviousCombination() != APINULLGuid)
+			err = ACAPI_ModulData_Delete(kPreviousModulName);
+		return err;
+	}
+
+	static bool IsActive() {
+		if (s_activeState < 0) {
+			GS::Array<API_Guid> statusRules;
+			s_activeState = FindStatusRules(statusRules) && IsOverlayApplied() ? 1 : 0;
+		}
+		return s_activeState == 1;
+	}
+
+	// 读出这些构件的当前状态，只收集需要改写的构件；图片状态取自链接存储
+	static void CollectElementWrites(const GS::Array<API_Guid>& elemGuids, const Definitions& defs, GS::Array<StatusWrite>& outWrites) {
+		HBIMImageStore::Storage& storage = HBIMImageStore::GetActiveStorage();
+		for (const API_Guid& elemGuid : elemGuids) {
+			ElementStatus state;
+			if (!IsStatusElement(elemGuid) || !ReadElementStatus(elemGuid, defs, state))
+				continue;
+			// 尚未完整扫描时不缓存，避免开启时把部分构件当成全部
+			if (s_scanned) {
+				s_elements.Put(elemGuid, state);
+				s_dirtyElements.Delete(elemGuid);
+			}
+			GS::Array<GS::UniString> elemLinks;
+			const bool hasPhotos = storage.Read(elemGuid, elemLinks) == NoError && !elemLinks.IsEmpty();
+			const Int32 target = TargetStatus(state, hasPhotos);
+			if (target != state.status)
+				outWrites.Push(StatusWrite(elemGuid, target));
+		}
+	}
+
+	// 状态只是派生数据，写入失败不让调用方的命令失败；未写入的构件在下次开启时改写
+	static void WriteOrMarkDirty(const API_Guid& statusGuid, const GS::Array<StatusWrite>& writes) {
+		s_writing = true;
+		GSErrCode err = WriteStatuses(statusGuid, writes);
+		s_writing = false;
+		if (err != NoError) {
+			for (const StatusWrite& write : writes)
+				s_dirtyElements.Add(write.first);
+		}
+	}
+
+	// ---- 构件通知 ----------------------------------------------------------------
+
+	static void Reset() {
+		s_scanned = false;
+		s_writing = false;
+		s_activeState = -1;
+		s_elements.Clear();
+		s_dirtyElements.Clear();
+		s_pendingElements.Clear();
+		s_updatePosted = false;
+		++s_generation;
+	}
+
+	// 在 Archicad 自身界面中编辑过的构件：通知结束后一并读出，只在状态确有变化时另起一个可撤销命令改写
+	static void ApplyPendingStatuses(UInt32 generation) {
+		if (generation != s_generation)
+			return;
+		s_updatePosted = false;
+		GS::Array<API_Guid> elemGuids;
+		for (const API_Guid& elemGuid : s_pendingElements)
+			elemGuids.Push(elemGuid);
+		s_pendingElements.Clear();
+		Definitions defs;
+		if (elemGuids.IsEmpty() || !IsActive() || !FindDefinitions(defs))
+			return;
+
+		GS::Array<StatusWrite> writes;
+		CollectElementWrites(elemGuids, defs, writes);
+		if (writes.IsEmpty())
+			return;
+		GSErrCode err = ACAPI_CallUndoableCommand("更新HBIM完成状态",
+			[&]() -> GSErrCode {
+				WriteOrMarkDirty(defs.statusGuid, writes);
+				return NoError;
+			}
+		);
+		if (err != NoError) {
+			for (const StatusWrite& write : writes)
+				s_dirtyElements.Add(write.first);
+		}
+	}
+
+	static void SchedulePendingStatuses() {
+		if (s_updatePosted)
+			return;
+		s_updatePosted = true;
+		UInt32 generation = s_generation;
+		HBIMEventLoop::Post([generation]() { ApplyPendingStatuses(generation); });
+	}
+
+	static void OnProjectEvent(API_NotifyEventID notifID) {
+		switch (notifID) {
+			case APINotify_New:
+			case APINotify_NewAndReset:
+			case APINotify_Open:
+			case APINotify_Close:
+			case APINotify_Quit:
+			case APINotify_ReceiveChanges:
+				Reset();
+				break;
+			default:
+				break;
+		}
+	}
+
+	// 通知中从不写入：着色开启时，新建与编辑（含属性值修改）的构件排队，通知结束后再改写其状态；
+	// 撤销/重做只记下需重读的构件，不另起撤销步骤，以免与用户的撤销互相覆盖
+	static void OnElementEvent(const API_NotifyElementType& elemType) {
+		if (s_writing || !HBIMSpatialIndex::IsIndexedElementType(elemType.elemHead.type.typeID))
+			return;
+		const API_Guid& elemGuid = elemType.elemHead.guid;
+		switch (elemType.notifID) {
+			case APINotifyElement_New:
+			case APINotifyElement_Copy:
+			case APINotifyElement_Change:
+			case APINotifyElement_Edit:
+			case APINotifyElement_PropertyValueChange:
+				s_dirtyElements.Add(elemGuid);
+				if (s_activeState == 1) {
+					HBIMNotifications::ObserveElement(elemGuid);
+					s_pendingElements.Add(elemGuid);
+					SchedulePendingStatuses();
+				}
+				break;
+			case APINotifyElement_Undo_Created:
+			case APINotifyElement_Undo_Modified:
+			case APINotifyElement_Undo_Deleted:
+			case APINotifyElement_Redo_Created:
+			case APINotifyElement_Redo_Modified:
+			case APINotifyElement_Redo_Deleted:
+				s_dirtyElements.Add(elemGuid);
+				break;
+			case APINotifyElement_Delete:
+				s_elements.Delete(elemGuid);
+				s_dirtyElements.Delete(elemGuid);
+				s_pendingElements.Delete(elemGuid);
+				break;
+			default:
+				break;
+		}
+	}
+
+}
+
+namespace HBIMStatusOverlay {
+
+void Initialize() {
+	HBIMNotifications::AddProjectListener(OnProjectEvent);
+	HBIMNotifications::AddElementListener(OnElementEvent);
+}
+
+void Shutdown() {
+	Reset();
+}
+
+void UpdateStatuses(const GS::Array<API_Guid>& elemGuids) {
+	if (elemGuids.IsEmpty() || !IsActive())
+		return;
+	Definitions defs;
+	if (!FindDefinitions(defs))
+		return;
+
+	GS::Array<StatusWrite> writes;
+	CollectElementWrites(elemGuids, defs, writes);
+	WriteOrMarkDirty(defs.statusGuid, writes);
+}
+
+void RunToggleCommand() {
+	GS::Array<API_Guid> statusRules;
+	if (FindStatusRules(statusRules) && IsOverlayApplied()) {
+		GSErrCode err = ACAPI_CallUndoableCommand("关闭HBIM完成度着色",
+			[&]() -> GSErrCode {
+				return RestorePreviousCombination();
+			}
+		);
+		if (err != NoError) {
+			DG::InformationAlert("HBIM完成度着色", GS::UniString::Printf("关闭着色失败 (错误码: %d)", err), "确定");
+			return;
+		}
+		s_activeState = 0;
+		s_pendingElements.Clear();
+		ACAPI_WriteReport("HBIMStatusOverlay: 已关闭完成度着色", false);
+		return;
+	}
+	auto start = std::chrono::steady_clock::now();
+	GS::UniString templateXML;
+	const bool hasTemplate = FindTemplateCriterion(templateXML);
+	bool fullScan = false;
+	USize writeCount = 0;
+
+	s_writing = true;
+	GSErrCode err = ACAPI_CallUndoableCommand("开启HBIM完成度着色",
+		[&]() -> GSErrCode {
+			API_Guid statusGuid;
+			GSErrCode cmdErr = HBIM::EnsureHBIMStatusPropertyDefinition(kStatusValues[kDefaultStatus], statusGuid);
+			if (cmdErr != NoError)
+				return cmdErr;
+			Definitions defs;
+			if (!FindDefinitions(defs))
+				return APIERR_GENERAL;
+
+			// 已扫描过时只重读期间修改过的构件，其余用缓存的填写程度和最新的链接表比较
+			fullScan = !s_scanned;
+			if (fullScan)
+				ScanAll(defs);
+			else
+				RefreshDirty(defs);
+
+			HBIMImageStore::LinkTable links;
+			HBIMImageStore::GetActiveStorage().ReadAll(links);
+			GS::Array<StatusWrite> writes;
+			CollectWrites(links, writes);
+			writeCount = writes.GetSize();
+			cmdErr = WriteStatuses(defs.statusGuid, writes);
+			if (cmdErr != NoError || !hasTemplate)
+				return cmdErr;
+
+			GS::Array<API_Guid> rules;
+			cmdErr = EnsureStatusRules(templateXML, rules);
+			if (cmdErr == NoError)
+				cmdErr = ActivateOwnCombination(rules);
+			return cmdErr;
+		}
+	);
+	s_writing = false;
+
+	if (err != NoError) {
+		DG::InformationAlert("HBIM完成度着色", GS::UniString::Printf("开启着色失败 (错误码: %d)", err), "确定");
+		return;
+	}
+	ACAPI_WriteReport("HBIMStatusOverlay: %s %d 个构件，改写状态 %d 个，用时 %.3f 秒", false,
+					  fullScan ? "扫描" : "刷新", static_cast<int>(s_elements.GetSize()), static_cast<int>(writeCount),
+					  std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+	if (!hasTemplate) {
+		GS::UniString msg = GS::UniString::Printf("已为 %u 个构件写入\"HBIM完成状态\"属性，但未找到模板规则，无法建立着色规则。\n\n",
+												  static_cast<unsigned>(s_elements.GetSize()));
+		msg.Append("请在 文档 > 图形覆盖 > 规则 中新建一条名为 \"");
+		msg.Append(kTemplateRuleName);
+		msg.Append("\" 的规则，条件设为 HBIM属性信息 / HBIM完成状态 \"为\" ");
+		msg.Append(kTemplatePlaceholder);
+		msg.Append("，然后再次执行本命令。");
+		DG::InformationAlert("HBIM完成度着色", msg, "确定");
+		return;
+	}
+	s_activeState = 1;
+}
+
+}
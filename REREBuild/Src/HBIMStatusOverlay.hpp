@@ -0,0 +1,31 @@
+#ifndef HBIMSTATUSOVERLAY_HPP
+#define HBIMSTATUSOVERLAY_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+
+// 按HBIM完成状态为模型着色：一次批量扫描把每个三维构件的状态（无编号/仅编号/编号与说明/有图片）
+// 写入"HBIM完成状态"属性，四条图形覆盖规则按该属性取值着色，不对单个构件做覆盖。
+// 规则只放在专用的"HBIM完成度"覆盖组合中，开启时激活该组合，关闭时恢复原来的组合。
+// 规则条件的XML由用户在 Archicad 中保存的模板规则得到（SDK 未给出属性条件的XML格式）。
+// 状态属性默认值为"无编号"，取该状态的构件不写值。开启后本插件的命令修改构件编号、说明或图片链接时，
+// 在同一个可撤销命令中改写这些构件的状态，撤销时一并恢复；在 Archicad 自身界面中编辑的构件
+// 在通知结束后只重读这些构件，状态有变化时另起一个可撤销命令改写。
+namespace HBIMStatusOverlay {
+
+	// 在 Initialize 中调用（需在 HBIMNotifications::Initialize 之后）
+	void Initialize();
+
+	// 在 FreeData 中调用
+	void Shutdown();
+
+	// 需在 ACAPI_CallUndoableCommand 作用域内、写入构件HBIM属性或图片链接之后调用；
+	// 着色开启时改写这些构件中状态发生变化的部分，未开启时不做任何事
+	void UpdateStatuses(const GS::Array<API_Guid>& elemGuids);
+
+	// 菜单入口：开启或关闭完成度着色
+	void RunToggleCommand();
+
+}
+
+#endif
@@ -0,0 +1,327 @@
+// *****************************************************************************
+// File:			HBIMTilePyramid.cpp
+// Description:		大图瓦片金字塔：后台生成、单文件存储、内存映射读取
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMTilePyramid.hpp"
+#include "HBIMEventLoop.hpp"
+#include "HBIMProject.hpp"
+#include "GXImage.hpp"
+#include "NativeContext.hpp"
+#include "NativeImage.hpp"
+#include "MemoryOChannel.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <unordered_set>
+#include <sys/stat.h>
+
+#if defined(GS_MAC)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+	static const char* kCacheFolderName = ".tile_cache";
+	static const char* kCacheExtension = ".hbtiles";
+	static const UInt32 kFileMagic = 0x4C544248;		// 'HBTL'
+	static const UInt32 kFileVersion = 1;
+
+	struct FileHeader {
+		UInt32 magic = kFileMagic;
+		UInt32 version = kFileVersion;
+		UInt64 sourceSize = 0;
+		Int64 sourceModTime = 0;
+		UInt32 width = 0;
+		UInt32 height = 0;
+		UInt32 tileSize = HBIMTilePyramid::kTileSize;
+		UInt32 levelCount = 0;
+		UInt32 tileCount = 0;
+		UInt32 reserved = 0;
+	};
+
+	struct LevelRecord {
+		UInt32 width = 0;
+		UInt32 height = 0;
+		UInt32 columns = 0;
+		UInt32 rows = 0;
+		UInt32 firstTile = 0;
+		UInt32 reserved = 0;
+	};
+
+	struct TileRecord {
+		UInt64 offset = 0;
+		UInt32 size = 0;
+		UInt32 reserved = 0;
+	};
+
+	static std::future<bool> s_worker;
+	static std::string s_buildingPath;
+	static std::unordered_set<std::string> s_failed;		// 瓦片文件路径|原图修改时间
+	static std::atomic<bool> s_stop(false);
+
+	static bool GetSourceStamp(const std::string& fullPath, UInt64& outSize, Int64& outModTime) {
+		struct stat st;
+		if (stat(fullPath.c_str(), &st) != 0)
+			return false;
+		outSize = static_cast<UInt64>(st.st_size);
+		outModTime = static_cast<Int64>(st.st_mtime);
+		return true;
+	}
+
+	// 按相对路径散列命名，图片改名后视为新图片
+	static std::filesystem::path CachePathFor(const std::filesystem::path& imageRoot, const std::string& relativePath) {
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(std::hash<std::string>()(relativePath)));
+		return imageRoot / kCacheFolderName / (std::string(name) + kCacheExtension);
+	}
+
+	static std::vector<LevelRecord> PlanLevels(UInt32 width, UInt32 height, UInt32& outTileCount) {
+		std::vector<LevelRecord> levels;
+		outTileCount = 0;
+		while (true) {
+			LevelRecord level;
+			level.width = width;
+			level.height = height;
+			level.columns = (width + HBIMTilePyramid::kTileSize - 1) / HBIMTilePyramid::kTileSize;
+			level.rows = (height + HBIMTilePyramid::kTileSize - 1) / HBIMTilePyramid::kTileSize;
+			level.firstTile = outTileCount;
+			outTileCount += level.columns * level.rows;
+			levels.push_back(level);
+			if (width <= HBIMTilePyramid::kTileSize && height <= HBIMTilePyramid::kTileSize)
+				break;
+			width = std::max<UInt32>(1, (width + 1) / 2);
+			height = std::max<UInt32>(1, (height + 1) / 2);
+		}
+		return levels;
+	}
+
+	// 从层图中裁出一张瓦片并编码为 JPEG
+	static bool EncodeTile(const NewDisplay::NativeImage& levelImage, UInt32 column, UInt32 row, UInt32 tileWidth, UInt32 tileHeight,
+						   GS::MemoryOChannel& outChannel) {
+		NewDisplay::NativeImage tile(tileWidth, tileHeight, levelImage);
+		NewDisplay::NativeContext context = tile.GetContext();
+		context.DrawImage(levelImage, 1.0f, 1.0f, 0.0f,
+						  -static_cast<float>(column * HBIMTilePyramid::kTileSize), -static_cast<float>(row * HBIMTilePyramid::kTileSize), false);
+		tile.ReleaseContext(context);
+		return tile.Encode(outChannel, NewDisplay::NativeImage::JPEG);
+	}
+
+	// 原图整张解码（GX::Image 不支持按区域解码），生成期间占用整图内存，一亿像素约 400 MB；
+	// 之后每层由上一层缩小一半得到。先写临时文件，完成后替换
+	static bool BuildPyramid(std::string sourcePath, std::filesystem::path cachePath, UInt64 sourceSize, Int64 sourceModTime) {
+		const auto start = std::chrono::steady_clock::now();
+		try {
+			GX::Image image{IO::Location(GS::UniString(sourcePath.c_str(), CC_UTF8))};
+			if (image.IsEmpty() || image.GetWidth() == 0 || image.GetHeight() == 0)
+				return false;
+			NewDisplay::NativeImage levelImage = image.ToNativeImage(1.0, false);
+
+			FileHeader header;
+			header.sourceSize = sourceSize;
+			header.sourceModTime = sourceModTime;
+			header.width = image.GetWidth();
+			header.height = image.GetHeight();
+			std::vector<LevelRecord> levels = PlanLevels(header.width, header.height, header.tileCount);
+			header.levelCount = static_cast<UInt32>(levels.size());
+			std::vector<TileRecord> tiles(header.tileCount);
+
+			std::error_code ec;
+			std::filesystem::create_directories(cachePath.parent_path(), ec);
+			std::filesystem::path tempPath = cachePath;
+			tempPath += ".tmp";
+			std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+			if (!out)
+				return false;
+
+			// 文件头和偏移表的位置先空出，瓦片写完后回填
+			const UInt64 tableOffset = sizeof(FileHeader) + levels.size() * sizeof(LevelRecord);
+			UInt64 offset = tableOffset + tiles.size() * sizeof(TileRecord);
+			out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			out.write(reinterpret_cast<const char*>(levels.data()), static_cast<std::streamsize>(levels.size() * sizeof(LevelRecord)));
+			out.write(reinterpret_cast<const char*>(tiles.data()), static_cast<std::streamsize>(tiles.size() * sizeof(TileRecord)));
+
+			for (size_t levelIndex = 0; levelIndex < levels.size(); ++levelIndex) {
+				const LevelRecord& level = levels[levelIndex];
+				if (levelIndex > 0)
+					levelImage = levelImage.Resize(level.width, level.height);
+				for (UInt32 row = 0; row < level.rows; ++row) {
+					for (UInt32 column = 0; column < level.columns; ++column) {
+						if (s_stop)
+							return false;
+						const UInt32 tileWidth = std::min(HBIMTilePyramid::kTileSize, level.width - column * HBIMTilePyramid::kTileSize);
+						const UInt32 tileHeight = std::min(HBIMTilePyramid::kTileSize, level.height - row * HBIMTilePyramid::kTileSize);
+						GS::MemoryOChannel channel;
+						if (!EncodeTile(levelImage, column, row, tileWidth, tileHeight, channel))
+							return false;
+						TileRecord& record = tiles[level.firstTile + row * level.columns + column];
+						record.offset = offset;
+						record.size = static_cast<UInt32>(channel.GetDataSize());
+						out.write(channel.GetDestination(), static_cast<std::streamsize>(record.size));
+						offset += record.size;
+					}
+				}
+			}
+			out.seekp(static_cast<std::streamoff>(tableOffset));
+			out.write(reinterpret_cast<const char*>(tiles.data()), static_cast<std::streamsize>(tiles.size() * sizeof(TileRecord)));
+			out.close();
+			if (!out)
+				return false;
+			std::filesystem::rename(tempPath, cachePath, ec);
+			if (ec)
+				return false;
+			HBIMEventLoop::PostReport(false, "HBIMTilePyramid: 生成 %u×%u 图片的瓦片 %u 张（%u 层），%.1f MB，耗时 %.1f 秒",
+									  header.width, header.height, header.tileCount, header.levelCount, offset / (1024.0 * 1024.0),
+									  std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+			return true;
+		} catch (...) {
+			HBIMEventLoop::PostReport(false, "HBIMTilePyramid: 生成瓦片时捕获到异常: %s", sourcePath.c_str());
+			return false;
+		}
+	}
+
+}
+
+namespace HBIMTilePyramid {
+
+Reader::~Reader() {
+	Close();
+}
+
+bool Reader::Open(const std::string& cachePath, UInt64 sourceSize, Int64 sourceModTime) {
+	Close();
+#if defined(GS_MAC)
+	int fd = open(cachePath.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(FileHeader)) {
+		close(fd);
+		return false;
+	}
+	void* mapped = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED)
+		return false;
+	data = static_cast<const std::byte*>(mapped);
+	size = static_cast<size_t>(st.st_size);
+#else
+	std::ifstream in(cachePath, std::ios::binary | std::ios::ate);
+	if (!in.is_open())
+		return false;
+	buffer.resize(static_cast<size_t>(in.tellg()));
+	in.seekg(0);
+	if (buffer.size() < sizeof(FileHeader) || !in.read(reinterpret_cast<char*>(buffer.data()), buffer.size())) {
+		Close();
+		return false;
+	}
+	data = buffer.data();
+	size = buffer.size();
+#endif
+
+	FileHeader header;
+	std::memcpy(&header, data, sizeof(header));
+	const size_t tableOffset = sizeof(FileHeader) + header.levelCount * sizeof(LevelRecord);
+	if (header.magic != kFileMagic || header.version != kFileVersion || header.tileSize != kTileSize ||
+		header.sourceSize != sourceSize || header.sourceModTime != sourceModTime ||
+		header.levelCount == 0 || tableOffset + header.tileCount * sizeof(TileRecord) > size) {
+		Close();
+		return false;
+	}
+
+	width = header.width;
+	height = header.height;
+	for (UInt32 i = 0; i < header.levelCount; ++i) {
+		LevelRecord record;
+		std::memcpy(&record, data + sizeof(FileHeader) + i * sizeof(LevelRecord), sizeof(record));
+		Level level;
+		level.width = record.width;
+		level.height = record.height;
+		level.columns = record.columns;
+		level.rows = record.rows;
+		level.firstTile = record.firstTile;
+		if (static_cast<UInt64>(level.firstTile) + level.columns * level.rows > header.tileCount) {
+			Close();
+			return false;
+		}
+		levels.push_back(level);
+	}
+	tileTable = data + tableOffset;
+	return true;
+}
+
+void Reader::Close() {
+#if defined(GS_MAC)
+	if (data != nullptr)
+		munmap(const_cast<std::byte*>(data), size);
+#endif
+	std::vector<std::byte>().swap(buffer);
+	data = nullptr;
+	size = 0;
+	width = 0;
+	height = 0;
+	levels.clear();
+	tileTable = nullptr;
+}
+
+bool Reader::GetTile(UInt32 level, UInt32 column, UInt32 row, const std::byte*& outData, UInt32& outSize) const {
+	if (data == nullptr || level >= levels.size())
+		return false;
+	const Level& info = levels[level];
+	if (column >= info.columns || row >= info.rows)
+		return false;
+	TileRecord record;
+	std::memcpy(&record, tileTable + (info.firstTile + row * info.columns + column) * sizeof(TileRecord), sizeof(record));
+	if (record.size == 0 || record.offset + record.size > size)
+		return false;
+	outData = data + record.offset;
+	outSize = record.size;
+	return true;
+}
+
+void Shutdown() {
+	s_stop = true;
+	if (s_worker.valid())
+		s_worker.wait();
+	s_stop = false;
+}
+
+State Ensure(const GS::UniString& fullPath, const GS::UniString& relativePath, std::string& outCachePath,
+			 UInt64& outSourceSize, Int64& outSourceModTime) {
+	const HBIMProject::Context& context = HBIMProject::GetContext();
+	const std::string sourcePath = fullPath.ToCStr().Get();
+	if (!context.isSaved || !GetSourceStamp(sourcePath, outSourceSize, outSourceModTime))
+		return State::Failed;
+	const std::filesystem::path cachePath = CachePathFor(context.imageRoot, relativePath.ToCStr().Get());
+	outCachePath = cachePath.string();
+	const std::string failedKey = outCachePath + "|" + std::to_string(outSourceModTime);
+
+	// 正在生成的一张完成后收取结果
+	if (s_worker.valid() && s_worker.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+		if (!s_worker.get())
+			s_failed.insert(s_buildingPath);
+		s_buildingPath.clear();
+	}
+	if (s_failed.count(failedKey) != 0)
+		return State::Failed;
+
+	Reader probe;
+	if (probe.Open(outCachePath, outSourceSize, outSourceModTime))
+		return State::Ready;
+	if (s_worker.valid())
+		return State::Building;
+
+	s_buildingPath = failedKey;
+	s_worker = std::async(std::launch::async, BuildPyramid, sourcePath, cachePath, outSourceSize, outSourceModTime);
+	return State::Building;
+}
+
+}
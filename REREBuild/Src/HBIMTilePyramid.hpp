@@ -0,0 +1,74 @@
+#ifndef HBIMTILEPYRAMID_HPP
+#define HBIMTILEPYRAMID_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// 大图的瓦片金字塔（256 像素 JPEG 瓦片，每层边长减半，直到一张瓦片放得下整图）。
+// 每张图片在后台生成一次，存放在图片文件夹下的 .tile_cache 中（一个文件：文件头、各层尺寸、瓦片偏移表、瓦片数据），
+// 记录原图大小与修改时间，原图变化后重新生成。查看时整个文件映射到内存，只解码可见的瓦片。
+// 生成时原图仍需整张解码一次，峰值内存与原图像素数成正比。
+namespace HBIMTilePyramid {
+
+	static const UInt32 kTileSize = 256;
+
+	struct Level {
+		UInt32 width = 0;
+		UInt32 height = 0;
+		UInt32 columns = 0;
+		UInt32 rows = 0;
+		UInt32 firstTile = 0;		// 在瓦片偏移表中的起始下标
+	};
+
+	// 只读映射一个瓦片文件，不支持 mmap 的平台读入内存（任意线程，单个对象不跨线程共享）
+	class Reader {
+	public:
+		Reader() = default;
+		~Reader();
+		Reader(const Reader&) = delete;
+		Reader& operator=(const Reader&) = delete;
+
+		// 文件不存在、格式不符或与原图大小/修改时间不一致时返回 false
+		bool Open(const std::string& cachePath, UInt64 sourceSize, Int64 sourceModTime);
+		void Close();
+
+		bool IsOpen() const { return data != nullptr; }
+		UInt32 GetWidth() const { return width; }
+		UInt32 GetHeight() const { return height; }
+		UInt32 GetLevelCount() const { return static_cast<UInt32>(levels.size()); }
+		const Level& GetLevel(UInt32 level) const { return levels[level]; }
+
+		// 瓦片的 JPEG 数据，直接指向映射（或读入）的内存
+		bool GetTile(UInt32 level, UInt32 column, UInt32 row, const std::byte*& outData, UInt32& outSize) const;
+
+	private:
+		const std::byte* data = nullptr;
+		size_t size = 0;
+		std::vector<std::byte> buffer;
+		UInt32 width = 0;
+		UInt32 height = 0;
+		std::vector<Level> levels;
+		const std::byte* tileTable = nullptr;
+	};
+
+	enum class State {
+		Ready,
+		Building,
+		Failed
+	};
+
+	// 在 FreeData 中调用：中止并等待正在进行的生成
+	void Shutdown();
+
+	// 主线程调用：瓦片文件可用时返回 Ready 与文件路径；否则在后台开始生成（同一时间只生成一张，
+	// 其他图片等待下次调用）并返回 Building；生成失败返回 Failed
+	State Ensure(const GS::UniString& fullPath, const GS::UniString& relativePath, std::string& outCachePath,
+				 UInt64& outSourceSize, Int64& outSourceModTime);
+
+}
+
+#endif
@@ -0,0 +1,451 @@
+// *****************************************************************************
+// File:			HBIMTileViewer.cpp
+// Description:		大图查看窗口：按瓦片金字塔平移缩放，按需解码可见瓦片
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMTileViewer.hpp"
+#include "HBIMTilePyramid.hpp"
+#include "DGModule.hpp"
+#include "DGNativeContexts.hpp"
+#include "NativeImage.hpp"
+#include "ApplicationLauncher.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+	static const short kViewerResId = 32530;
+	// 已解码瓦片数上限（256×256 RGBA 约 256 KB/张）
+	static const size_t kMaxDecodedTiles = 192;
+	static const double kMaxZoom = 4.0;
+	static const double kZoomStep = 1.5;
+
+	class TileViewerDialog : public DG::ModalDialog,
+		public DG::PanelObserver,
+		public DG::ButtonItemObserver,
+		public DG::UserItemObserver
+	{
+	public:
+		enum {
+			ViewId = 1,
+			ZoomInButtonId = 2,
+			ZoomOutButtonId = 3,
+			FitButtonId = 4,
+			StatusTextId = 5,
+			SystemOpenButtonId = 6,
+			CloseButtonId = 7
+		};
+
+		TileViewerDialog (const GS::UniString& fullPath, const GS::UniString& relativePath, const GS::UniString& title);
+		~TileViewerDialog ();
+
+	protected:
+		virtual void PanelOpened (const DG::PanelOpenEvent& ev) override;
+		virtual void PanelIdle (const DG::PanelIdleEvent& ev) override;
+		virtual void PanelResized (const DG::PanelResizeEvent& ev) override;
+		virtual void ButtonClicked (const DG::ButtonClickEvent& ev) override;
+		virtual void UserItemMouseDown (const DG::UserItemMouseDownEvent& ev, bool* processed) override;
+		virtual void UserItemMouseMoved (const DG::UserItemMouseMoveEvent& ev, bool* noDefaultCursor) override;
+		virtual void UserItemMouseUp (const DG::UserItemMouseUpEvent& ev, bool* processed) override;
+		virtual void UserItemDoubleClicked (const DG::UserItemDoubleClickEvent& ev) override;
+		virtual void UserItemUpdate (const DG::UserItemUpdateEvent& ev) override;
+		virtual void ItemWheelTrackEntered (const DG::ItemWheelEvent& ev, bool* processed) override;
+		virtual void ItemWheelTracked (const DG::ItemWheelTrackEvent& ev, bool* processed) override;
+
+	private:
+		struct DecodedTile {
+			UInt64 key = 0;
+			NewDisplay::NativeImage image;
+		};
+
+		void	PollPyramid ();
+		void	FitToView ();
+		void	ZoomAround (double factor, double viewX, double viewY);
+		void	ClampOrigin ();
+		UInt32	ChooseLevel () const;
+		double	LevelScale (UInt32 level) const;
+		void	DrawLevel (NewDisplay::NativeContext& context, UInt32 level);
+		const NewDisplay::NativeImage* GetDecodedTile (UInt32 level, UInt32 column, UInt32 row);
+		void	UpdateStatus ();
+		void	OpenWithSystemViewer ();
+
+		DG::UserItem	view;
+		DG::Button		zoomInButton;
+		DG::Button		zoomOutButton;
+		DG::Button		fitButton;
+		DG::LeftText	statusText;
+		DG::Button		systemOpenButton;
+		DG::Button		closeButton;
+
+		GS::UniString	fullPath;
+		GS::UniString	relativePath;
+		HBIMTilePyramid::State state;
+		HBIMTilePyramid::Reader reader;
+
+		// 视图：zoom 为屏幕像素/原图像素，originX/originY 为视图左上角对应的原图坐标
+		double	zoom;
+		double	fitZoom;
+		double	originX;
+		double	originY;
+
+		bool	dragging;
+		short	lastMouseX;
+		short	lastMouseY;
+
+		// 已解码瓦片的 LRU（最近使用的在前）
+		std::list<DecodedTile> decodedTiles;
+		std::unordered_map<UInt64, std::list<DecodedTile>::iterator> decodedIndex;
+	};
+
+	static UInt64 TileKey(UInt32 level, UInt32 column, UInt32 row) {
+		return (static_cast<UInt64>(level) << 48) | (static_cast<UInt64>(row) << 24) | column;
+	}
+
+	TileViewerDialog::TileViewerDialog (const GS::UniString& fullPath, const GS::UniString& relativePath, const GS::UniString& title)
+		: DG::ModalDialog (ACAPI_GetOwnResModule (), kViewerResId, ACAPI_GetOwnResModule ())
+		, view (GetReference (), ViewId)
+		, zoomInButton (GetReference (), ZoomInButtonId)
+		, zoomOutButton (GetReference (), ZoomOutButtonId)
+		, fitButton (GetReference (), FitButtonId)
+		, statusText (GetReference (), StatusTextId)
+		, systemOpenButton (GetReference (), SystemOpenButtonId)
+		, closeButton (GetReference (), CloseButtonId)
+		, fullPath (fullPath)
+		, relativePath (relativePath)
+		, state (HBIMTilePyramid::State::Building)
+		, zoom (1.0)
+		, fitZoom (1.0)
+		, originX (0.0)
+		, originY (0.0)
+		, dragging (false)
+		, lastMouseX (0)
+		, lastMouseY (0)
+	{
+		if (!title.IsEmpty())
+			SetTitle (title);
+		Attach (*this);
+		view.Attach (*this);
+		view.EnableMouseMoveEvent ();
+		zoomInButton.Attach (*this);
+		zoomOutButton.Attach (*this);
+		fitButton.Attach (*this);
+		systemOpenButton.Attach (*this);
+		closeButton.Attach (*this);
+		EnableIdleEvent ();
+	}
+
+	TileViewerDialog::~TileViewerDialog ()
+	{
+		closeButton.Detach (*this);
+		systemOpenButton.Detach (*this);
+		fitButton.Detach (*this);
+		zoomOutButton.Detach (*this);
+		zoomInButton.Detach (*this);
+		view.Detach (*this);
+		Detach (*this);
+	}
+
+	void TileViewerDialog::PanelOpened (const DG::PanelOpenEvent&)
+	{
+		PollPyramid ();
+	}
+
+	void TileViewerDialog::PanelIdle (const DG::PanelIdleEvent&)
+	{
+		if (state == HBIMTilePyramid::State::Building)
+			PollPyramid ();
+	}
+
+	// 瓦片生成在后台进行，空闲时查询一次，完成后映射文件并适合窗口显示
+	void TileViewerDialog::PollPyramid ()
+	{
+		std::string cachePath;
+		UInt64 sourceSize = 0;
+		Int64 sourceModTime = 0;
+		state = HBIMTilePyramid::Ensure (fullPath, relativePath, cachePath, sourceSize, sourceModTime);
+		if (state == HBIMTilePyramid::State::Ready && !reader.Open (cachePath, sourceSize, sourceModTime))
+			state = HBIMTilePyramid::State::Failed;
+		if (state == HBIMTilePyramid::State::Ready)
+			FitToView ();
+		UpdateStatus ();
+		view.Redraw ();
+	}
+
+	void TileViewerDialog::PanelResized (const DG::PanelResizeEvent& ev)
+	{
+		const short hGrow = ev.GetHorizontalChange ();
+		const short vGrow = ev.GetVerticalChange ();
+		if (hGrow == 0 && vGrow == 0)
+			return;
+		BeginMoveResizeItems ();
+		view.Resize (hGrow, vGrow);
+		zoomInButton.Move (0, vGrow);
+		zoomOutButton.Move (0, vGrow);
+		fitButton.Move (0, vGrow);
+		statusText.MoveAndResize (0, vGrow, hGrow, 0);
+		systemOpenButton.Move (hGrow, vGrow);
+		closeButton.Move (hGrow, vGrow);
+		EndMoveResizeItems ();
+
+		// 仍处于适合窗口状态时跟随窗口大小，否则保持左上角位置
+		if (reader.IsOpen ()) {
+			if (zoom <= fitZoom)
+				FitToView ();
+			else
+				ClampOrigin ();
+			UpdateStatus ();
+		}
+		view.Redraw ();
+	}
+
+	void TileViewerDialog::ButtonClicked (const DG::ButtonClickEvent& ev)
+	{
+		const double centerX = view.GetClientWidth () / 2.0;
+		const double centerY = view.GetClientHeight () / 2.0;
+		if (ev.GetSource () == &zoomInButton) {
+			ZoomAround (kZoomStep, centerX, centerY);
+		} else if (ev.GetSource () == &zoomOutButton) {
+			ZoomAround (1.0 / kZoomStep, centerX, centerY);
+		} else if (ev.GetSource () == &fitButton) {
+			if (reader.IsOpen ()) {
+				FitToView ();
+				UpdateStatus ();
+				view.Redraw ();
+			}
+		} else if (ev.GetSource () == &systemOpenButton) {
+			OpenWithSystemViewer ();
+		} else if (ev.GetSource () == &closeButton) {
+			PostCloseRequest (DG::ModalDialog::Accept);
+		}
+	}
+
+	void TileViewerDialog::UserItemMouseDown (const DG::UserItemMouseDownEvent& ev, bool* processed)
+	{
+		if (!reader.IsOpen () || !ev.IsLeftButton ())
+			return;
+		dragging = true;
+		lastMouseX = ev.GetMouseOffset ().GetX ();
+		lastMouseY = ev.GetMouseOffset ().GetY ();
+		view.EnableCapture ();
+		*processed = true;
+	}
+
+	void TileViewerDialog::UserItemMouseMoved (const DG::UserItemMouseMoveEvent& ev, bool*)
+	{
+		if (!dragging)
+			return;
+		const short x = ev.GetMouseOffset ().GetX ();
+		const short y = ev.GetMouseOffset ().GetY ();
+		originX -= (x - lastMouseX) / zoom;
+		originY -= (y - lastMouseY) / zoom;
+		lastMouseX = x;
+		lastMouseY = y;
+		ClampOrigin ();
+		view.Redraw (false);
+	}
+
+	void TileViewerDialog::UserItemMouseUp (const DG::UserItemMouseUpEvent&, bool* processed)
+	{
+		if (!dragging)
+			return;
+		dragging = false;
+		*processed = true;
+	}
+
+	void TileViewerDialog::UserItemDoubleClicked (const DG::UserItemDoubleClickEvent& ev)
+	{
+		// 双击放大一级，按住 Shift 缩小
+		const double factor = ev.IsShiftPressed () ? 1.0 / kZoomStep : kZoomStep;
+		ZoomAround (factor, ev.GetMouseOffset ().GetX (), ev.GetMouseOffset ().GetY ());
+	}
+
+	void TileViewerDialog::ItemWheelTrackEntered (const DG::ItemWheelEvent& ev, bool* processed)
+	{
+		if (ev.GetSource () == &view)
+			*processed = true;
+	}
+
+	void TileViewerDialog::ItemWheelTracked (const DG::ItemWheelTrackEvent& ev, bool* processed)
+	{
+		if (ev.GetSource () != &view || ev.GetYTrackValue () == 0)
+			return;
+		const double factor = std::pow (1.1, ev.GetYTrackValue () > 0 ? 1.0 : -1.0);
+		ZoomAround (factor, ev.GetMouseOffset ().GetX (), ev.GetMouseOffset ().GetY ());
+		*processed = true;
+	}
+
+	void TileViewerDialog::FitToView ()
+	{
+		const double viewWidth = std::max<short> (1, view.GetClientWidth ());
+		const double viewHeight = std::max<short> (1, view.GetClientHeight ());
+		fitZoom = std::min (1.0, std::min (viewWidth / reader.GetWidth (), viewHeight / reader.GetHeight ()));
+		zoom = fitZoom;
+		ClampOrigin ();
+	}
+
+	// 以视图内一点为中心缩放，该点下的原图位置保持不动
+	void TileViewerDialog::ZoomAround (double factor, double viewX, double viewY)
+	{
+		if (!reader.IsOpen ())
+			return;
+		const double newZoom = std::max (fitZoom, std::min (kMaxZoom, zoom * factor));
+		if (newZoom == zoom)
+			return;
+		const double sourceX = originX + viewX / zoom;
+		const double sourceY = originY + viewY / zoom;
+		zoom = newZoom;
+		originX = sourceX - viewX / zoom;
+		originY = sourceY - viewY / zoom;
+		ClampOrigin ();
+		UpdateStatus ();
+		view.Redraw (false);
+	}
+
+	// 图片小于视图的方向居中，否则不允许拖出图片范围
+	void TileViewerDialog::ClampOrigin ()
+	{
+		const double visibleWidth = view.GetClientWidth () / zoom;
+		const double visibleHeight = view.GetClientHeight () / zoom;
+		if (visibleWidth >= reader.GetWidth ())
+			originX = (reader.GetWidth () - visibleWidth) / 2.0;
+		else
+			originX = std::max (0.0, std::min (originX, reader.GetWidth () - visibleWidth));
+		if (visibleHeight >= reader.GetHeight ())
+			originY = (reader.GetHeight () - visibleHeight) / 2.0;
+		else
+			originY = std::max (0.0, std::min (originY, reader.GetHeight () - visibleHeight));
+	}
+
+	double TileViewerDialog::LevelScale (UInt32 level) const
+	{
+		return static_cast<double> (reader.GetLevel (level).width) / reader.GetWidth ();
+	}
+
+	// 分辨率不低于当前缩放的最小一层
+	UInt32 TileViewerDialog::ChooseLevel () const
+	{
+		UInt32 level = 0;
+		while (level + 1 < reader.GetLevelCount () && LevelScale (level + 1) >= zoom)
+			++level;
+		return level;
+	}
+
+	const NewDisplay::NativeImage* TileViewerDialog::GetDecodedTile (UInt32 level, UInt32 column, UInt32 row)
+	{
+		const UInt64 key = TileKey (level, column, row);
+		auto found = decodedIndex.find (key);
+		if (found != decodedIndex.end ()) {
+			decodedTiles.splice (decodedTiles.begin (), decodedTiles, found->second);
+			return &found->second->image;
+		}
+
+		const std::byte* data = nullptr;
+		UInt32 size = 0;
+		if (!reader.GetTile (level, column, row, data, size))
+			return nullptr;
+		DecodedTile tile;
+		tile.key = key;
+		tile.image = NewDisplay::NativeImage (data, size, NewDisplay::NativeImage::JPEG);
+		if (tile.image == nullptr)
+			return nullptr;
+
+		decodedTiles.push_front (std::move (tile));
+		decodedIndex[key] = decodedTiles.begin ();
+		while (decodedTiles.size () > kMaxDecodedTiles) {
+			decodedIndex.erase (decodedTiles.back ().key);
+			decodedTiles.pop_back ();
+		}
+		return &decodedTiles.front ().image;
+	}
+
+	void TileViewerDialog::DrawLevel (NewDisplay::NativeContext& context, UInt32 level)
+	{
+		const HBIMTilePyramid::Level& info = reader.GetLevel (level);
+		const double levelScale = LevelScale (level);
+		const double tileSpan = HBIMTilePyramid::kTileSize / levelScale;		// 一张瓦片覆盖的原图像素
+		const double drawScale = zoom / levelScale;
+
+		const double right = originX + view.GetClientWidth () / zoom;
+		const double bottom = originY + view.GetClientHeight () / zoom;
+		const UInt32 firstColumn = static_cast<UInt32> (std::max (0.0, std::floor (originX / tileSpan)));
+		const UInt32 firstRow = static_cast<UInt32> (std::max (0.0, std::floor (originY / tileSpan)));
+		const UInt32 lastColumn = std::min<UInt32> (info.columns - 1, static_cast<UInt32> (std::max (0.0, std::floor (right / tileSpan))));
+		const UInt32 lastRow = std::min<UInt32> (info.rows - 1, static_cast<UInt32> (std::max (0.0, std::floor (bottom / tileSpan))));
+
+		for (UInt32 row = firstRow; row <= lastRow; ++row) {
+			for (UInt32 column = firstColumn; column <= lastColumn; ++column) {
+				const NewDisplay::NativeImage* tile = GetDecodedTile (level, column, row);
+				if (tile == nullptr)
+					continue;
+				const float x = static_cast<float> ((column * tileSpan - originX) * zoom);
+				const float y = static_cast<float> ((row * tileSpan - originY) * zoom);
+				context.DrawImage (*tile, static_cast<float> (drawScale), static_cast<float> (drawScale), 0.0f, x, y, false);
+			}
+		}
+	}
+
+	void TileViewerDialog::UserItemUpdate (const DG::UserItemUpdateEvent& ev)
+	{
+		NewDisplay::UserItemUpdateNativeContext context (ev);
+		const float width = view.GetClientWidth ();
+		const float height = view.GetClientHeight ();
+		context.FillRect (0.0f, 0.0f, width, height, 48, 48, 48);
+		if (!reader.IsOpen ())
+			return;
+
+		// 先用最粗的一层（一张瓦片）垫底，精细层的瓦片解码失败时不会露出空洞
+		const UInt32 coarsest = reader.GetLevelCount () - 1;
+		const UInt32 level = ChooseLevel ();
+		if (level != coarsest)
+			DrawLevel (context, coarsest);
+		DrawLevel (context, level);
+	}
+
+	void TileViewerDialog::UpdateStatus ()
+	{
+		GS::UniString status;
+		switch (state) {
+			case HBIMTilePyramid::State::Building:
+				status = "正在生成瓦片，首次打开大图需要一些时间...";
+				break;
+			case HBIMTilePyramid::State::Failed:
+				status = "无法生成瓦片（图片无法解码或项目未保存），可用系统程序打开原图";
+				break;
+			case HBIMTilePyramid::State::Ready:
+				status = GS::UniString::Printf ("缩放 %.0f%%  第 %u/%u 层  原图 %u×%u 像素", zoom * 100.0,
+												ChooseLevel () + 1, reader.GetLevelCount (), reader.GetWidth (), reader.GetHeight ());
+				break;
+		}
+		statusText.SetText (status);
+	}
+
+	void TileViewerDialog::OpenWithSystemViewer ()
+	{
+#if defined (GS_MAC)
+		IO::Location openCmd("/usr/bin/open");
+#elif defined (GS_WIN)
+		IO::Location openCmd("C:\\Windows\\explorer.exe");
+#endif
+		GS::Array<GS::UniString> argv;
+		argv.Push(fullPath);
+		GSErrCode err = IO::Process::ApplicationLauncher::Instance().Launch(openCmd, argv);
+		if (err != NoError) {
+			ACAPI_WriteReport("预览图片失败 (错误码: %d)", true, static_cast<int>(err));
+		}
+	}
+
+}
+
+namespace HBIMTileViewer {
+
+void Show(const GS::UniString& fullPath, const GS::UniString& relativePath, const GS::UniString& title) {
+	TileViewerDialog dialog(fullPath, relativePath, title);
+	dialog.Invoke();
+}
+
+}
@@ -0,0 +1,16 @@
+#ifndef HBIMTILEVIEWER_HPP
+#define HBIMTILEVIEWER_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+
+// 大图查看窗口：基于瓦片金字塔（HBIMTilePyramid）平移缩放，只解码窗口内可见的瓦片。
+// 首次打开某张图片时在后台生成瓦片，期间窗口显示生成进度；也可改用系统程序打开原图。
+namespace HBIMTileViewer {
+
+	// 主线程调用（模态）：fullPath 为图片完整路径，relativePath 相对项目目录，title 显示在窗口标题上
+	void Show(const GS::UniString& fullPath, const GS::UniString& relativePath, const GS::UniString& title);
+
+}
+
+#endif
@@ -0,0 +1,683 @@
+// *****************************************************************************
+// File:			HBIMZoneCoverage.cpp
+// Description:		按区域统计HBIM完成度：区域多边形空间索引、批量点归属、
+//					增量更新、CSV表格与按完成度着色
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "HBIMZoneCoverage.hpp"
+#include "HBIMCommon.hpp"
+#include "HBIMEventLoop.hpp"
+#include "HBIMImageStore.hpp"
+#include "HBIMNotifications.hpp"
+#include "HBIMProject.hpp"
+#include "HBIMSpatialIndex.hpp"
+#include "DGModule.hpp"
+#include "HashSet.hpp"
+#include "HashTable.hpp"
+#include "MemoryIChannel32.hpp"
+#include "MemoryOChannel32.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+	static const unsigned kMaxWorkers = 8;
+	static const USize kMaxReportedZones = 10;
+	static const char* kTableFileName = "HBIM_ZoneCoverage.csv";
+
+	// 着色前的区域填充笔，恢复原色时使用
+	static const GS::UniString kColorsModulName = "HBIMZoneCoverageColors";
+	static const Int32 kColorsModulVersion = 1;
+	static const UInt32 kColorsMagic = 0x48425A43;		// 'HBZC'
+
+	struct ZoneShape {
+		API_Guid guid = APINULLGuid;
+		GS::UniString number;
+		GS::UniString name;
+		short floorInd = 0;
+		double area = 0.0;
+		std::vector<std::vector<API_Coord>> contours;	// 第一个为外轮廓，其余为洞（圆弧按弦处理）
+	};
+
+	// 一个构件的归属与完成情况；保留参考点，区域变化时无需再读构件
+	struct ElementState {
+		double x = 0.0;
+		double y = 0.0;
+		short floorInd = 0;
+		Int32 zone = -1;
+		bool hasFields = false;
+		bool hasPhotos = false;
+	};
+
+	struct OriginalPens {
+		short floorFillPen = 0;
+		short floorFillBGPen = 0;
+	};
+
+	// 只在主线程访问
+	static std::vector<ZoneShape> s_zones;
+	static std::vector<HBIMZoneCoverage::ZoneStats> s_stats;
+	static HBIMSpatialIndex::BoxTree s_zoneTree;
+	static GS::HashTable<API_Guid, ElementState> s_elements;
+	static GS::HashSet<API_Guid> s_dirtyElements;
+	static bool s_built = false;
+	static bool s_zonesDirty = false;
+	static bool s_updatePosted = false;
+	static UInt32 s_generation = 0;
+
+	// ---- 区域几何 ----------------------------------------------------------------
+
+	static double ContourArea(const std::vector<API_Coord>& contour) {
+		double sum = 0.0;
+		for (size_t i = 0, j = contour.size() - 1; i < contour.size(); j = i++)
+			sum += contour[j].x * contour[i].y - contour[i].x * contour[j].y;
+		return 0.5 * sum;
+	}
+
+	// 奇偶规则：同时处理外轮廓与洞
+	static bool ContainsPoint(const ZoneShape& zone, double x, double y) {
+		bool inside = false;
+		for (const std::vector<API_Coord>& contour : zone.contours) {
+			for (size_t i = 0, j = contour.size() - 1; i < contour.size(); j = i++) {
+				const API_Coord& a = contour[i];
+				const API_Coord& b = contour[j];
+				if ((a.y > y) != (b.y > y) && x < (b.x - a.x) * (y - a.y) / (b.y - a.y) + a.x)
+					inside = !inside;
+			}
+		}
+		return inside;
+	}
+
+	static bool LoadZone(const API_Guid& zoneGuid, ZoneShape& outZone) {
+		API_Element element = {};
+		element.header.guid = zoneGuid;
+		if (ACAPI_Element_Get(&element) != NoError)
+			return false;
+
+		API_ElementMemo memo = {};
+		if (ACAPI_Element_GetMemo(zoneGuid, &memo, APIMemoMask_Polygon) != NoError)
+			return false;
+
+		outZone = ZoneShape();
+		outZone.guid = zoneGuid;
+		outZone.number = GS::UniString(element.zone.roomNoStr);
+		outZone.name = GS::UniString(element.zone.roomName);
+		outZone.floorInd = element.header.floorInd;
+		// coords 从 1 开始，pends[k] 为第 k 个轮廓最后一点（与起点重合）
+		if (memo.coords != nullptr && memo.pends != nullptr) {
+			for (Int32 k = 1; k <= element.zone.poly.nSubPolys; ++k) {
+				std::vector<API_Coord> contour;
+				for (Int32 i = (*memo.pends)[k - 1] + 1; i < (*memo.pends)[k]; ++i)
+					contour.push_back((*memo.coords)[i]);
+				if (contour.size() >= 3)
+					outZone.contours.push_back(std::move(contour));
+			}
+		}
+		ACAPI_DisposeElemMemoHdls(&memo);
+
+		if (outZone.contours.empty())
+			return false;
+		outZone.area = std::abs(ContourArea(outZone.contours.front()));
+		for (size_t i = 1; i < outZone.contours.size(); ++i)
+			outZone.area -= std::abs(ContourArea(outZone.contours[i]));
+		return true;
+	}
+
+	// 区域包围盒的 z 用楼层号，查询时按楼层精确匹配
+	static void LoadZones() {
+		s_zones.clear();
+		GS::Array<API_Guid> zoneGuids;
+		ACAPI_Element_GetElemList(API_ZoneID, &zoneGuids);
+		std::vector<HBIMSpatialIndex::Box> boxes;
+		for (const API_Guid& zoneGuid : zoneGuids) {
+			ZoneShape zone;
+			if (!LoadZone(zoneGuid, zone))
+				continue;
+			HBIMSpatialIndex::Box box;
+			box.xMin = box.xMax = zone.contours.front().front().x;
+			box.yMin = box.yMax = zone.contours.front().front().y;
+			for (const API_Coord& c : zone.contours.front()) {
+				box.xMin = std::min(box.xMin, c.x);
+				box.yMin = std::min(box.yMin, c.y);
+				box.xMax = std::max(box.xMax, c.x);
+				box.yMax = std::max(box.yMax, c.y);
+			}
+			box.zMin = box.zMax = zone.floorInd;
+			boxes.push_back(box);
+			s_zones.push_back(std::move(zone));
+		}
+		s_zoneTree.Build(boxes);
+	}
+
+	// 重叠区域中取面积最小的一个（房间内再划分的区域优先）
+	static Int32 LocatePoint(double x, double y, short floorInd, std::vector<UInt32>& scratch) {
+		HBIMSpatialIndex::Box query;
+		query.xMin = query.xMax = x;
+		query.yMin = query.yMax = y;
+		query.zMin = query.zMax = floorInd;
+		s_zoneTree.Intersecting(query, scratch);
+		Int32 best = -1;
+		for (UInt32 candidate : scratch) {
+			if (!ContainsPoint(s_zones[candidate], x, y))
+				continue;
+			if (best < 0 || s_zones[candidate].area < s_zones[best].area)
+				best = static_cast<Int32>(candidate);
+		}
+		return best;
+	}
+
+	// 批量归属：区域索引只读，工作线程按原子计数领取构件
+	static void LocateAll(std::vector<ElementState*>& states) {
+		std::atomic<size_t> next(0);
+		auto work = [&]() {
+			std::vector<UInt32> scratch;
+			for (size_t i = next++; i < states.size(); i = next++)
+				states[i]->zone = LocatePoint(states[i]->x, states[i]->y, states[i]->floorInd, scratch);
+		};
+		const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+		const size_t workers = std::min<size_t>(std::min(hardware, kMaxWorkers), states.size());
+		std::vector<std::thread> threads;
+		for (size_t i = 1; i < workers; ++i)
+			threads.emplace_back(work);
+		work();
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+
+	// ---- 构件状态 ----------------------------------------------------------------
+
+	static bool HasValue(const API_Property& property) {
+		return property.status == API_Property_HasValue && property.value.variantStatus == API_VariantStatusNormal &&
+			   !property.value.singleVariant.variant.uniStringValue.IsEmpty();
+	}
+
+	static bool ReadFieldsComplete(const API_Guid& elemGuid, const GS::Array<API_Guid>& defGuids) {
+		if (defGuids.IsEmpty())
+			return false;
+		GS::Array<API_Property> properties;
+		if (ACAPI_Element_GetPropertyValuesByGuid(elemGuid, defGuids, properties) != NoError || properties.GetSize() != defGuids.GetSize())
+			return false;
+		for (const API_Property& property : properties) {
+			if (!HasValue(property))
+				return false;
+		}
+		return true;
+	}
+
+	static GS::Array<API_Guid> GetFieldDefinitions() {
+		GS::Array<API_Guid> defGuids;
+		API_Guid groupGuid, idGuid, descGuid;
+		if (HBIM::FindExistingHBIMPropertyGroupAndDefinitions(groupGuid, idGuid, descGuid) == NoError) {
+			defGuids.Push(idGuid);
+			defGuids.Push(descGuid);
+		}
+		return defGuids;
+	}
+
+	static bool ReadElementPosition(const API_Guid& elemGuid, ElementState& outState) {
+		API_Elem_Head elemHead;
+		HBIMSpatialIndex::Box box;
+		if (!HBIMSpatialIndex::GetElementBox(elemGuid, elemHead, box))
+			return false;
+		outState.x = 0.5 * (box.xMin + box.xMax);
+		outState.y = 0.5 * (box.yMin + box.yMax);
+		outState.floorInd = elemHead.floorInd;
+		return true;
+	}
+
+	static void ResetStats() {
+		s_stats.assign(s_zones.size(), HBIMZoneCoverage::ZoneStats());
+		for (size_t i = 0; i < s_zones.size(); ++i) {
+			s_stats[i].zoneGuid = s_zones[i].guid;
+			s_stats[i].number = s_zones[i].number;
+			s_stats[i].name = s_zones[i].name;
+			s_stats[i].floorInd = s_zones[i].floorInd;
+		}
+	}
+
+	static void Count(const ElementState& state, bool add) {
+		if (state.zone < 0 || state.zone >= static_cast<Int32>(s_stats.size()))
+			return;
+		HBIMZoneCoverage::ZoneStats& stats = s_stats[state.zone];
+		auto adjust = [add](UInt32& counter) { counter = add ? counter + 1 : counter - 1; };
+		adjust(stats.elementCount);
+		if (state.hasFields)
+			adjust(stats.withFields);
+		if (state.hasPhotos)
+			adjust(stats.withPhotos);
+		if (state.hasFields && state.hasPhotos)
+			adjust(stats.complete);
+	}
+
+	static void RecountAll() {
+		ResetStats();
+		for (auto it = s_elements.EnumeratePairs(); it != nullptr; ++it)
+			Count(it->value, true);
+	}
+
+	// 区域变化：重新读取区域，用保存的参考点重新归属全部构件
+	static void RelocateAll() {
+		LoadZones();
+		std::vector<ElementState*> states;
+		states.reserve(s_elements.GetSize());
+		for (auto it = s_elements.EnumeratePairs(); it != nullptr; ++it)
+			states.push_back(&it->value);
+		LocateAll(states);
+		RecountAll();
+		s_zonesDirty = false;
+	}
+
+	static void BuildAll() {
+		auto start = std::chrono::steady_clock::now();
+		s_elements.Clear();
+		s_dirtyElements.Clear();
+		LoadZones();
+
+		HBIMImageStore::LinkTable links;
+		HBIMImageStore::GetActiveStorage().ReadAll(links);
+		const GS::Array<API_Guid> defGuids = GetFieldDefinitions();
+
+		GS::Array<API_Guid> elemGuids;
+		ACAPI_Element_GetElemList(API_ZombieElemID, &elemGuids);
+		for (const API_Guid& elemGuid : elemGuids) {
+			ElementState state;
+			if (!ReadElementPosition(elemGuid, state))
+				continue;
+			const GS::Array<GS::UniString>* elemLinks = links.GetPtr(elemGuid);
+			state.hasPhotos = elemLinks != nullptr && !elemLinks->IsEmpty();
+			state.hasFields = ReadFieldsComplete(elemGuid, defGuids);
+			s_elements.Put(elemGuid, state);
+		}
+		auto readEnd = std::chrono::steady_clock::now();
+
+		std::vector<ElementState*> states;
+		states.reserve(s_elements.GetSize());
+		for (auto it = s_elements.EnumeratePairs(); it != nullptr; ++it)
+			states.push_back(&it->value);
+		LocateAll(states);
+		RecountAll();
+
+		s_built = true;
+		s_zonesDirty = false;
+		ACAPI_WriteReport("HBIMZoneCoverage: %d 个区域，%d 个构件；读取构件 %.3f 秒，归属 %.3f 秒", false,
+						  static_cast<int>(s_zones.size()), static_cast<int>(s_elements.GetSize()),
+						  std::chrono::duration<double>(readEnd - start).count(),
+						  std::chrono::duration<double>(std::chrono::steady_clock::now() - readEnd).count());
+	}
+
+	// 图片链接可能不经构件事件改变（项目数据后端），统计前从内存中的链接表刷新
+	static void RefreshPhotoFlags() {
+		HBIMImageStore::LinkTable links;
+		if (HBIMImageStore::GetActiveStorage().ReadAll(links) != NoError)
+			return;
+		for (auto it = s_elements.EnumeratePairs(); it != nullptr; ++it) {
+			const GS::Array<GS::UniString>* elemLinks = links.GetPtr(it->key);
+			it->value.hasPhotos = elemLinks != nullptr && !elemLinks->IsEmpty();
+		}
+		RecountAll();
+	}
+
+	static void ApplyPendingUpdates(UInt32 generation) {
+		s_updatePosted = false;
+		if (generation != s_generation || !s_built)
+			return;
+
+		if (s_zonesDirty)
+			RelocateAll();
+		if (s_dirtyElements.IsEmpty())
+			return;
+
+		const GS::Array<API_Guid> defGuids = GetFieldDefinitions();
+		HBIMImageStore::Storage& storage = HBIMImageStore::GetActiveStorage();
+		std::vector<UInt32> scratch;
+		for (const API_Guid& elemGuid : s_dirtyElements) {
+			ElementState* existing = s_elements.GetPtr(elemGuid);
+			if (existing != nullptr)
+				Count(*existing, false);
+
+			ElementState state;
+			if (!ReadElementPosition(elemGuid, state)) {
+				s_elements.Delete(elemGuid);
+				continue;
+			}
+			GS::Array<GS::UniString> elemLinks;
+			state.hasPhotos = storage.Read(elemGuid, elemLinks) == NoError && !elemLinks.IsEmpty();
+			state.hasFields = ReadFieldsComplete(elemGuid, defGuids);
+			state.zone = LocatePoint(state.x, state.y, state.floorInd, scratch);
+			s_elements.Put(elemGuid, state);
+			Count(state, true);
+		}
+		s_dirtyElements.Clear();
+	}
+
+	static void ScheduleUpdate() {
+		if (s_updatePosted)
+			return;
+		s_updatePosted = true;
+		UInt32 generation = s_generation;
+		HBIMEventLoop::Post([generation]() { ApplyPendingUpdates(generation); });
+	}
+
+	static void Reset() {
+		++s_generation;
+		s_built = false;
+		s_zonesDirty = false;
+		s_updatePosted = false;
+		s_zones.clear();
+		s_stats.clear();
+		s_zoneTree.Build({});
+		s_elements.Clear();
+		s_dirtyElements.Clear();
+	}
+
+	static void OnProjectEvent(API_NotifyEventID notifID) {
+		switch (notifID) {
+			case APINotify_New:
+			case APINotify_NewAndReset:
+			case APINotify_Open:
+			case APINotify_Close:
+			case APINotify_Quit:
+				Reset();
+				break;
+			case APINotify_ReceiveChanges:
+				// 团队工作接收的更改不逐个发构件事件，下次统计时重新读取
+				Reset();
+				break;
+			default:
+				break;
+		}
+	}
+
+	static void OnElementEvent(const API_NotifyElementType& elemType) {
+		if (!s_built)
+			return;
+		if (elemType.elemHead.type.typeID == API_ZoneID) {
+			s_zonesDirty = true;
+			ScheduleUpdate();
+		} else if (HBIMSpatialIndex::IsIndexedElementType(elemType.elemHead.type.typeID)) {
+			s_dirtyElements.Add(elemType.elemHead.guid);
+			ScheduleUpdate();
+		}
+	}
+
+	// ---- 表格与着色 ----------------------------------------------------------------
+
+	static double CompletionOf(const HBIMZoneCoverage::ZoneStats& stats) {
+		return stats.elementCount == 0 ? 0.0 : static_cast<double>(stats.complete) / stats.elementCount;
+	}
+
+	static bool WriteTable(const std::filesystem::path& tablePath, const GS::Array<HBIMZoneCoverage::ZoneStats>& stats) {
+		return HBIM::WriteCsvTable(tablePath, "区域编号,区域名称,楼层,构件数,已填HBIM属性,有图片,完整,完成度(%)",
+			[&](std::ostream& out) {
+				for (const HBIMZoneCoverage::ZoneStats& zone : stats) {
+					out << HBIM::CsvField(zone.number) << ',' << HBIM::CsvField(zone.name) << ',' << zone.floorInd << ','
+						<< zone.elementCount << ',' << zone.withFields << ',' << zone.withPhotos << ',' << zone.complete << ','
+						<< GS::UniString::Printf("%.1f", CompletionOf(zone) * 100.0).ToCStr().Get() << '\n';
+				}
+			}
+		);
+	}
+
+	static GS::UniString FormatReport(const GS::Array<HBIMZoneCoverage::ZoneStats>& stats, const std::filesystem::path& tablePath, bool tableWritten) {
+		UInt32 totalElements = 0, totalComplete = 0, emptyZones = 0;
+		std::vector<const HBIMZoneCoverage::ZoneStats*> ranked;
+		for (const HBIMZoneCoverage::ZoneStats& zone : stats) {
+			totalElements += zone.elementCount;
+			totalComplete += zone.complete;
+			if (zone.elementCount == 0)
+				++emptyZones;
+			else
+				ranked.push_back(&zone);
+		}
+		std::sort(ranked.begin(), ranked.end(), [](const HBIMZoneCoverage::ZoneStats* a, const HBIMZoneCoverage::ZoneStats* b) {
+			return CompletionOf(*a) < CompletionOf(*b);
+		});
+
+		GS::UniString msg;
+		msg.Append(GS::UniString::Printf("区域: %u 个（无构件 %u 个）\n", static_cast<unsigned>(stats.GetSize()), emptyZones));
+		msg.Append(GS::UniString::Printf("区域内构件: %u 个，属性与图片齐全: %u 个\n", totalElements, totalComplete));
+		if (tableWritten) {
+			msg.Append("表格: ");
+			msg.Append(GS::UniString(tablePath.string().c_str(), CC_UTF8));
+		} else {
+			msg.Append("表格写入失败");
+		}
+
+		for (size_t i = 0; i < ranked.size() && i < kMaxReportedZones; ++i) {
+			if (i == 0)
+				msg.Append("\n\n完成度最低的区域:");
+			msg.Append("\n  ");
+			msg.Append(ranked[i]->number);
+			msg.Append(" ");
+			msg.Append(ranked[i]->name);
+			msg.Append(GS::UniString::Printf(": %u/%u (%.0f%%)", ranked[i]->complete, ranked[i]->elementCount, CompletionOf(*ranked[i]) * 100.0));
+		}
+		return msg;
+	}
+
+	// 当前笔表中颜色最接近的笔
+	static short FindNearestPen(double r, double g, double b) {
+		UInt32 penCount = 0;
+		if (ACAPI_Attribute_GetPenNum(penCount) != NoError)
+			return 1;
+		short best = 1;
+		double bestDistance = 0.0;
+		bool found = false;
+		for (UInt32 i = 1; i <= penCount; ++i) {
+			API_Pen pen = {};
+			pen.index = static_cast<short>(i);
+			if (ACAPI_Attribute_GetPen(pen) != NoError)
+				continue;
+			const double dr = pen.rgb.f_red - r, dg = pen.rgb.f_green - g, db = pen.rgb.f_blue - b;
+			const double distance = dr * dr + dg * dg + db * db;
+			if (!found || distance < bestDistance) {
+				best = pen.index;
+				bestDistance = distance;
+				found = true;
+			}
+		}
+		return best;
+	}
+
+	static GSErrCode LoadOriginalPens(GS::HashTable<API_Guid, OriginalPens>& outPens) {
+		outPens.Clear();
+		API_ModulData modulData {};
+		GSErrCode err = ACAPI_ModulData_Get(&modulData, kColorsModulName);
+		if (err == APIERR_NOMODULEDATA)
+			return NoError;
+		if (err != NoError)
+			return err;
+		if (modulData.dataVersion != kColorsModulVersion) {
+			BMKillHandle(&modulData.dataHdl);
+			return APIERR_BADPARS;
+		}
+
+		GS::MemoryIChannel32 ic(*modulData.dataHdl, BMGetHandleSize(modulData.dataHdl));
+		UInt32 magic = 0, count = 0;
+		err = ic.Read(magic);
+		if (err == NoError && magic != kColorsMagic)
+			err = APIERR_BADPARS;
+		if (err == NoError)
+			err = ic.Read(count);
+		for (UInt32 i = 0; i < count && err == NoError; ++i) {
+			GS::Guid guid;
+			OriginalPens pens;
+			err = ic.Read(guid);
+			if (err == NoError) err = ic.Read(pens.floorFillPen);
+			if (err == NoError) err = ic.Read(pens.floorFillBGPen);
+			if (err == NoError)
+				outPens.Put(GSGuid2APIGuid(guid), pens);
+		}
+		BMKillHandle(&modulData.dataHdl);
+		return err;
+	}
+
+	static GSErrCode StoreOriginalPens(const GS::HashTable<API_Guid, OriginalPens>& pens) {
+		GS::MemoryOChannel32 oc(GS::MemoryOChannel32::BMAllocation);
+		GSErrCode err = oc.Write(kColorsMagic);
+		if (err == NoError) err = oc.Write(static_cast<UInt32>(pens.GetSize()));
+		for (auto it = pens.EnumeratePairs(); it != nullptr && err == NoError; ++it) {
+			err = oc.Write(APIGuid2GSGuid(it->key));
+			if (err == NoError) err = oc.Write(it->value.floorFillPen);
+			if (err == NoError) err = oc.Write(it->value.floorFillBGPen);
+		}
+		if (err != NoError)
+			return err;
+
+		API_ModulData modulData {};
+		modulData.dataVersion = kColorsModulVersion;
+		modulData.platformSign = GS::Act_Platform_Sign;
+		modulData.dataHdl = BMAllocateHandle(oc.GetDataSize(), ALLOCATE_CLEAR, 0);
+		if (modulData.dataHdl == nullptr)
+			return APIERR_MEMFULL;
+		BNCopyMemory(*modulData.dataHdl, oc.GetDestination(), oc.GetDataSize());
+		err = ACAPI_ModulData_Store(&modulData, kColorsModulName);
+		BMKillHandle(&modulData.dataHdl);
+		return err;
+	}
+
+	static bool HasOriginalPens() {
+		API_ModulData info {};
+		return ACAPI_ModulData_GetInfo(&info, kColorsModulName) == NoError;
+	}
+
+	static GSErrCode SetZonePens(const API_Guid& zoneGuid, short floorFillPen, short floorFillBGPen, OriginalPens* outPrevious) {
+		API_Element element = {};
+		element.header.guid = zoneGuid;
+		GSErrCode err = ACAPI_Element_Get(&element);
+		if (err != NoError)
+			return err;
+		if (outPrevious != nullptr) {
+			outPrevious->floorFillPen = element.zone.floorFillPen;
+			outPrevious->floorFillBGPen = element.zone.floorFillBGPen;
+		}
+
+		API_Element mask;
+		ACAPI_ELEMENT_MASK_CLEAR(mask);
+		ACAPI_ELEMENT_MASK_SET(mask, API_ZoneType, floorFillPen);
+		ACAPI_ELEMENT_MASK_SET(mask, API_ZoneType, floorFillBGPen);
+		element.zone.floorFillPen = floorFillPen;
+		element.zone.floorFillBGPen = floorFillBGPen;
+		return ACAPI_Element_Change(&element, &mask, nullptr, 0, true);
+	}
+
+	// 按完成度四档（<25% 红、<50% 橙、<75% 黄、其余绿）设置区域填充的前景与背景笔；
+	// 第一次着色时记下原来的笔，重复着色不覆盖
+	static GSErrCode ColorZones(const GS::Array<HBIMZoneCoverage::ZoneStats>& stats) {
+		const short bandPens[4] = {
+			FindNearestPen(0.90, 0.20, 0.20),
+			FindNearestPen(1.00, 0.60, 0.10),
+			FindNearestPen(1.00, 0.90, 0.20),
+			FindNearestPen(0.30, 0.80, 0.30)
+		};
+
+		GS::HashTable<API_Guid, OriginalPens> originals;
+		GSErrCode err = LoadOriginalPens(originals);
+		if (err != NoError)
+			return err;
+
+		return ACAPI_CallUndoableCommand("按HBIM完成度为区域着色",
+			[&]() -> GSErrCode {
+				for (const HBIMZoneCoverage::ZoneStats& zone : stats) {
+					if (zone.elementCount == 0)
+						continue;
+					const Int32 band = std::min(3, static_cast<Int32>(CompletionOf(zone) * 4.0));
+					OriginalPens previous;
+					GSErrCode changeErr = SetZonePens(zone.zoneGuid, bandPens[band], bandPens[band], &previous);
+					if (changeErr != NoError) {
+						ACAPI_WriteReport("HBIMZoneCoverage: 区域 %s 着色失败，错误码=%d", true, zone.number.ToCStr().Get(), changeErr);
+						continue;
+					}
+					if (!originals.ContainsKey(zone.zoneGuid))
+						originals.Put(zone.zoneGuid, previous);
+				}
+				return StoreOriginalPens(originals);
+			}
+		);
+	}
+
+	static GSErrCode RestoreZoneColors() {
+		GS::HashTable<API_Guid, OriginalPens> originals;
+		GSErrCode err = LoadOriginalPens(originals);
+		if (err != NoError)
+			return err;
+
+		return ACAPI_CallUndoableCommand("恢复区域原色",
+			[&]() -> GSErrCode {
+				for (auto it = originals.EnumeratePairs(); it != nullptr; ++it)
+					SetZonePens(it->key, it->value.floorFillPen, it->value.floorFillBGPen, nullptr);
+				return ACAPI_ModulData_Delete(kColorsModulName);
+			}
+		);
+	}
+
+}
+
+namespace HBIMZoneCoverage {
+
+void Initialize() {
+	HBIMNotifications::AddProjectListener(OnProjectEvent);
+	HBIMNotifications::AddElementListener(OnElementEvent);
+}
+
+void Shutdown() {
+	Reset();
+}
+
+void GetZoneStats(GS::Array<ZoneStats>& outStats) {
+	if (!s_built) {
+		BuildAll();
+	} else {
+		// 尚在队列中的增量更新先执行
+		ApplyPendingUpdates(s_generation);
+		RefreshPhotoFlags();
+	}
+	outStats.Clear();
+	for (const ZoneStats& stats : s_stats)
+		outStats.Push(stats);
+}
+
+void RunCoverageCommand() {
+	const HBIMProject::Context& context = HBIMProject::GetContext();
+	if (!context.isSaved) {
+		DG::InformationAlert("区域HBIM完成度", "项目未保存，无法写出统计表格。", "确定");
+		return;
+	}
+
+	GS::Array<ZoneStats> stats;
+	GetZoneStats(stats);
+	if (stats.IsEmpty()) {
+		DG::InformationAlert("区域HBIM完成度", "项目中没有区域。", "确定");
+		return;
+	}
+
+	const std::filesystem::path tablePath = context.projectDir / kTableFileName;
+	const bool tableWritten = WriteTable(tablePath, stats);
+	if (!tableWritten)
+		ACAPI_WriteReport("HBIMZoneCoverage: 写入表格失败: %s", true, tablePath.string().c_str());
+
+	GS::UniString summary = FormatReport(stats, tablePath, tableWritten);
+	const bool canRestore = HasOriginalPens();
+	DG::AlertResponse response = canRestore
+		? DG::InformationAlert("区域HBIM完成度", summary, "按完成度着色", "关闭", "恢复区域原色")
+		: DG::InformationAlert("区域HBIM完成度", summary, "按完成度着色", "关闭");
+
+	GSErrCode err = NoError;
+	if (response == DG::Accept)
+		err = ColorZones(stats);
+	else if (response == DG::Third && canRestore)
+		err = RestoreZoneColors();
+	if (err != NoError)
+		DG::InformationAlert("区域HBIM完成度", GS::UniString::Printf("修改区域颜色失败 (错误码: %d)", err), "确定");
+}
+
+}
@@ -0,0 +1,37 @@
+#ifndef HBIMZONECOVERAGE_HPP
+#define HBIMZONECOVERAGE_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+
+// 按区域（房间）统计HBIM完成度：区域平面多边形建立 R 树（HBIMSpatialIndex），
+// 每个三维构件以包围盒中心和所在楼层归入区域，统计已填HBIM属性、已有图片的构件数。
+// 第一次统计后保留每个构件的位置与状态，构件新建/移动/删除、区域修改时在主事件循环中增量更新。
+namespace HBIMZoneCoverage {
+
+	struct ZoneStats {
+		API_Guid zoneGuid = APINULLGuid;
+		GS::UniString number;
+		GS::UniString name;
+		short floorInd = 0;
+		UInt32 elementCount = 0;
+		UInt32 withFields = 0;		// HBIM构件编号与说明都已填写
+		UInt32 withPhotos = 0;		// 至少一张图片
+		UInt32 complete = 0;		// 属性与图片都齐全
+	};
+
+	// 在 Initialize 中调用（需在 HBIMNotifications::Initialize 之后）
+	void Initialize();
+
+	// 在 FreeData 中调用
+	void Shutdown();
+
+	// 当前各区域的统计（主线程）；尚未统计时先完整统计一次
+	void GetZoneStats(GS::Array<ZoneStats>& outStats);
+
+	// 菜单入口：统计 → 写出表格并预览 → 可按完成度为区域着色或恢复原色
+	void RunCoverageCommand();
+
+}
+
+#endif
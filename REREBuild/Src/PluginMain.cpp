@@ -8,6 +8,32 @@
 #include "APIEnvir.h"
 #include "ACAPinc.h"
 #include "PluginPalette.hpp"
+#include "HBIMRegisterImport.hpp"
+#include "HBIMImageReconciler.hpp"
+#include "HBIMEventLoop.hpp"
+#include "HBIMNotifications.hpp"
+#include "HBIMElementIndex.hpp"
+#include "HBIMGeometryCache.hpp"
+#include "HBIMGlobalIdIndex.hpp"
+#include "HBIMGltfExport.hpp"
+#include "HBIMImageTombstones.hpp"
+#include "HBIMImageEditJournal.hpp"
+#include "HBIMImageStore.hpp"
+#include "HBIMIFCExport.hpp"
+#include "HBIMPhotoMetadata.hpp"
+#include "HBIMPhotoPlacement.hpp"
+#include "HBIMZoneCoverage.hpp"
+#include "HBIMStatusOverlay.hpp"
+#include "HBIMAnnotations.hpp"
+#include "HBIMLabelme.hpp"
+#include "HBIMPreviewCache.hpp"
+#include "HBIMTilePyramid.hpp"
+#include "HBIMImageDerivatives.hpp"
+#include "HBIMPointCloudCache.hpp"
+#include "HBIMPointCloudStats.hpp"
+#include "HBIMProject.hpp"
+#include "HBIMScanDeviation.hpp"
+#include "PropertyUtils.hpp"
 #include <stdio.h>
 
 
@@ -31,6 +57,10 @@ API_AddonType CheckEnvironment (API_EnvirParams* envir)
 GSErrCode RegisterInterface (void)
 {
 	GSErrCode err = ACAPI_MenuItem_RegisterMenu (32500, 32600, MenuCode_UserDef, MenuFlag_Default);
+	if (err != NoError) {
+		return err;
+	}
+	err = HBIMEventLoop::RegisterInterface ();
 	return err;
 }
 
@@ -48,6 +78,39 @@ GSErrCode Initialize (void)
 		return err;
 	}
 	err = PluginPalette::RegisterPaletteControlCallBack ();
+	if (err != NoError) {
+		return err;
+	}
+	err = HBIMEventLoop::Initialize ();
+	if (err != NoError) {
+		return err;
+	}
+	err = HBIMNotifications::Initialize ();
+	if (err != NoError) {
+		return err;
+	}
+	HBIMNotifications::AddProjectListener ([] (API_NotifyEventID notifID) {
+		if (notifID == APINotify_Quit)
+			PluginPalette::DestroyInstance ();
+		if (notifID == APINotify_New || notifID == APINotify_NewAndReset || notifID == APINotify_Open || notifID == APINotify_Close)
+			PropertyUtils::ClearIFCPropertyCache ();
+	});
+	HBIMProject::Initialize ();
+	HBIMImageStore::Initialize ();
+	HBIMGlobalIdIndex::Initialize ();
+	HBIMElementIndex::Initialize ();
+	HBIMImageTombstones::Initialize ();
+	HBIMImageEditJournal::Initialize ();
+	HBIMIFCExport::Initialize ();
+	HBIMPhotoMetadata::Initialize ();
+	HBIMZoneCoverage::Initialize ();
+	HBIMStatusOverlay::Initialize ();
+	HBIMAnnotations::Initialize ();
+	HBIMLabelme::Initialize ();
+	HBIMPreviewCache::Initialize ();
+	HBIMImageDerivatives::Initialize ();
+	HBIMPointCloudStats::Initialize ();
+	HBIMGeometryCache::Initialize ();
 	return err;
 }
 
@@ -59,6 +122,25 @@ GSErrCode FreeData (void)
 	ACAPI_Notification_CatchSelectionChange (nullptr);
 	ACAPI_UnregisterModelessWindow (PluginPalette::GetPaletteReferenceId ());
 	PluginPalette::DestroyInstance ();
+	HBIMGeometryCache::Shutdown ();
+	HBIMPointCloudCache::Shutdown ();
+	HBIMScanDeviation::Shutdown ();
+	HBIMPointCloudStats::Shutdown ();
+	HBIMImageDerivatives::Shutdown ();
+	HBIMTilePyramid::Shutdown ();
+	HBIMPreviewCache::Shutdown ();
+	HBIMLabelme::Shutdown ();
+	HBIMAnnotations::Shutdown ();
+	HBIMStatusOverlay::Shutdown ();
+	HBIMZoneCoverage::Shutdown ();
+	HBIMPhotoMetadata::Shutdown ();
+	HBIMIFCExport::Shutdown ();
+	HBIMImageEditJournal::Shutdown ();
+	HBIMImageTombstones::Shutdown ();
+	HBIMElementIndex::Shutdown ();
+	HBIMGlobalIdIndex::Shutdown ();
+	HBIMNotifications::Shutdown ();
+	HBIMEventLoop::Shutdown ();
 	return NoError;
 }
 
@@ -82,6 +164,108 @@ static GSErrCode APIMenuCommandProc_Main (const API_MenuParams* menuParams)
 		}
 		return NoError;
 	}
+
+	if (menuParams->menuItemRef.itemIndex == 2) {
+		// 批量导入HBIM登记表
+		HBIMRegisterImport::RunImportCommand ();
+		if (PluginPalette::HasInstance ()) {
+			PluginPalette::GetInstance ().UpdateFromSelection ();
+		}
+		return NoError;
+	}
+
+	if (menuParams->menuItemRef.itemIndex == 3) {
+		// 核对HBIM图片文件夹与图片链接
+		HBIMImageReconciler::RunReconcileCommand ();
+		if (PluginPalette::HasInstance ()) {
+			PluginPalette::GetInstance ().UpdateFromSelection ();
+		}
+		return NoError;
+	}
+
+	if (menuParams->menuItemRef.itemIndex == 4) {
+		// 在属性与项目数据之间迁移图片链接
+		HBIMImageStore::RunMigrationCommand ();
+		if (PluginPalette::HasInstance ()) {
+			PluginPalette::GetInstance ().UpdateFromSelection ();
+		}
+		return NoError;
+	}
+
+	if (menuParams->menuItemRef.itemIndex == 5) {
+		// 图片链接存储读取性能测试
+		HBIMImageStore::RunBenchmarkCommand ();
+		return NoError;
+	}
+
+	if (menuParams->menuItemRef.itemIndex == 6) {
+		// 重建图片拍摄信息索引（后台扫描，完成后刷新面板）
+		HBIMPhotoMetadata::RunRebuildCommand ();
+		return NoError;
+	}
+
+	if (menuParams->menuItemRef.itemIndex == 7) {
+		// 按拍摄位置为照片推荐构件并批量附着
+		HBIMPhotoPlacement::RunSuggestCommand ();
+		if (PluginPalette::HasInstance ()) {
+			PluginPalette::GetInstance ().UpdateFromSelection ();
+		}
+		return NoError;
+	}
+
+	if (menuParams->menuItemRef.itemIndex == 8) {
+		// 按区域统计HBIM完成度
+		HBIMZoneCoverage::RunCoverageCommand ();
+		return NoError;
+	}
+
+	if (menuParams->menuItemRef.itemIndex == 9) {
+		// 开启/关闭按HBIM完成状态着色
+		HBIMStatusOverlay::RunToggleCommand ();
+		return NoError;
+	}
+
+	if (menuParams->menuItemRef.itemIndex == 10) {
+		// 按labelme标注统计构件病害
+		HBIMAnnotations::RunStatisticsCommand ();
+		return NoError;
+	}
+
+	if (menuParams->menuItemRef.itemIndex == 11) {
+		// 按构件统计扫描点云
+		HBIMPointCloudStats::RunStatisticsCommand ();
+		return NoError;
+	}
+
+	if (menuParams->menuItemRef.itemIndex == 12) {
+		// 扫描点云与构件模型的偏差
+		HBIMScanDeviation::RunDeviationCommand ();
+		return NoError;
+	}
+
+	if (menuParams->menuItemRef.itemIndex == 13) {
+		// 偏差分析性能测试
+		HBIMScanDeviation::RunBenchmarkCommand ();
+		return NoError;
+	}
+
+	if (menuParams->menuItemRef.itemIndex == 14) {
+		// 扫描点云降采样导入项目缓存
+		HBIMPointCloudCache::RunIngestCommand ();
+		return NoError;
+	}
+
+	if (menuParams->menuItemRef.itemIndex == 15) {
+		// 选中构件导出为glTF
+		HBIMGltfExport::RunExportCommand ();
+		return NoError;
+	}
+
+	if (menuParams->menuItemRef.itemIndex == 16) {
+		// 构件空间索引性能测试
+		HBIMElementIndex::RunBenchmarkCommand ();
+		return NoError;
+	}
 	
 	return NoError;
 }
\ No newline at end of file
@@ -3,10 +3,22 @@
 #include "APIdefs.h"
 #include "DGModule.hpp"
 #include "DGImage.hpp"
-#include "ApplicationLauncher.hpp"
 #include "GXImage.hpp"
 #include "Location.hpp"
 #include "FileSystem.hpp"
+#include "HBIMCommon.hpp"
+#include "HBIMGlobalIdIndex.hpp"
+#include "HBIMProject.hpp"
+#include "HBIMImageTombstones.hpp"
+#include "HBIMImageEditJournal.hpp"
+#include "HBIMImageStore.hpp"
+#include "HBIMPhotoMetadata.hpp"
+#include "HBIMLabelme.hpp"
+#include "HBIMAnnotations.hpp"
+#include "HBIMPreviewCache.hpp"
+#include "HBIMTileViewer.hpp"
+#include "HBIMImageDerivatives.hpp"
+#include "HBIMStatusOverlay.hpp"
 #include <mutex>
 #include <stdio.h>
 #include <chrono>
@@ -16,552 +28,53 @@
 #include <random>
 #include <cstring>
 #include <cstdlib>
-#include <thread>
-
-#if defined(GS_MAC)
-#include <spawn.h>
-#include <sys/wait.h>
-#include <unistd.h>
-#include <crt_externs.h>
-#endif
 
 // Property API头文件
 #include "APIdefs_Properties.h"
 
-// IFC API头文件
-#include "ACAPI/IFCObjectAccessor.hpp"
-#include "ACAPI/IFCObjectID.hpp"
-#include "ACAPI/IFCPropertyAccessor.hpp"
-#include "ACAPI/IFCProperty.hpp"
-
 namespace {
-	// HBIM属性常量
-	static const GS::UniString kHBIMGroupName = "HBIM属性信息";
-	static const GS::UniString kHBIMIdName = "HBIM构件编号";
-	static const GS::UniString kHBIMDescName = "HBIM构件说明";
-	
-	// HBIM图片常量
-	static const GS::UniString kHBIMImageGroupName = "HBIM构件图片";
-	static const GS::UniString kHBIMImageLinksName = "HBIM图片链接";
-	
-	static GS::UniString NormalizeUniString(const GS::UniString& str) {
-		GS::UniString result;
-		for (UInt32 i = 0; i < str.GetLength(); ++i) {
-			GS::uchar_t ch = str.GetChar(i);
-			if (ch != ' ' && ch != '\t' && ch != '\n' && ch != '\r' && ch != 0xA0) {
-				result.Append(ch);
-			}
-		}
-		return result;
-	}
-	
-	// 清理字符串用于文件路径（移除非法字符）
-	static GS::UniString SanitizeForFilePath(const GS::UniString& str) {
-		GS::UniString result;
-		for (UInt32 i = 0; i < str.GetLength(); ++i) {
-			GS::uchar_t ch = str.GetChar(i);
-			// 允许：字母、数字、下划线、连字符、点
-			if ((ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z') || 
-				(ch >= '0' && ch <= '9') || ch == '_' || ch == '-' || ch == '.') {
-				result.Append(ch);
-			} else {
-				// 替换其他字符为下划线
-				result.Append('_');
-			}
-		}
-		return result;
-	}
-	
-	// 验证和修复UUID格式
-	static bool IsValidUUIDFormat(const GS::UniString& uuid) {
-		// 标准格式：xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx (36个字符)
-		if (uuid.GetLength() != 36) return false;
-		
-		for (Int32 i = 0; i < 36; i++) {
-			GS::uchar_t ch = uuid.GetChar(i);
-			// 检查连字符位置
-			if (i == 8 || i == 13 || i == 18 || i == 23) {
-				if (ch != '-') return false;
-			} else {
-				// 必须是十六进制字符
-				if (!((ch >= '0' && ch <= '9') || (ch >= 'A' && ch <= 'F') || (ch >= 'a' && ch <= 'f'))) {
-					return false;
-				}
-			}
-		}
-		return true;
+	// 文本未变化时不调用 SetText/Redraw，避免重复通知时闪烁
+	static void SetTextIfChanged(DG::StaticText& item, const GS::UniString& text) {
+		if (item.GetText() == text)
+			return;
+		item.SetText(text);
+		item.Redraw();
 	}
 	
 	// 构建图片的完整路径字符串（仅构造路径，不检查文件存在；用于诊断或解析）
 	static bool BuildImageFullPath(const GS::UniString& relativePath, std::string& outFullPath, GS::UniString* outProjectDir = nullptr) {
-		if (relativePath.IsEmpty()) return false;
-		API_ProjectInfo projectInfo;
-		if (ACAPI_ProjectOperation_Project(&projectInfo) != NoError || projectInfo.untitled || !projectInfo.location)
+		if (!HBIMProject::BuildFullPath(relativePath, outFullPath))
 			return false;
-		GS::UniString projectPath;
-		projectInfo.location->ToPath(&projectPath);
-		std::filesystem::path projectFsPath(projectPath.ToCStr().Get());
-		std::filesystem::path projectDirPath = projectFsPath.parent_path();
-		std::filesystem::path fullPath = projectDirPath / relativePath.ToCStr().Get();
-		outFullPath = fullPath.string();
-		if (outProjectDir) *outProjectDir = GS::UniString(projectDirPath.string().c_str());
+		if (outProjectDir) *outProjectDir = GS::UniString(HBIMProject::GetContext().projectDir.string().c_str());
 		return true;
 	}
 	
-	// 解析图片路径（相对路径转绝对路径）
+	// 解析图片路径（相对路径转绝对路径）：每次刷新面板都会调用，只拼接缓存的图片文件夹并检查一次存在，
+	// 不重试、不列目录、不写报告
 	static IO::Location ResolveImagePath(const GS::UniString& relativePath) {
-		if (relativePath.IsEmpty()) {
-			ACAPI_WriteReport("ResolveImagePath调试: relativePath为空", false);
-			return IO::Location();
-		}
-		
-			// 获取项目信息
-		API_ProjectInfo projectInfo;
-		GSErrCode projectErr = ACAPI_ProjectOperation_Project(&projectInfo);
-		if (projectErr != NoError) {
-			ACAPI_WriteReport("ResolveImagePath调试: 获取项目信息失败，错误码=%d", false, projectErr);
+		const HBIMProject::Context& context = HBIMProject::GetContext();
+		if (relativePath.IsEmpty() || !context.isSaved)
 			return IO::Location();
-		}
-		
-		if (projectInfo.untitled) {
-			ACAPI_WriteReport("ResolveImagePath调试: 项目未保存(untitled)", false);
+
+		// 链接形如 "HBIM_Images_{projectHash}/文件名"，其余按相对项目目录处理
+		const std::string relative = relativePath.ToCStr().Get();
+		const std::string folderPrefix = std::string(context.imageFolderName.ToCStr().Get()) + "/";
+		const std::filesystem::path fullPath = relative.rfind(folderPrefix, 0) == 0
+			? context.imageRoot / relative.substr(folderPrefix.size())
+			: context.projectDir / relative;
+		std::error_code ec;
+		if (!std::filesystem::exists(fullPath, ec))
 			return IO::Location();
-		}
-		
-		// 获取项目文件夹路径
-		IO::Location projectLocation = *projectInfo.location;
-		GS::UniString projectPath;
-		projectLocation.ToPath(&projectPath);
-		
-		// 构建完整路径：项目文件夹/相对路径
-		std::filesystem::path projectFsPath(projectPath.ToCStr().Get());
-		std::filesystem::path projectDirPath = projectFsPath.parent_path();
-		
-		std::filesystem::path fullPath = projectDirPath / relativePath.ToCStr().Get();
-		
-	// 检查文件是否存在 - 添加重试机制
-	bool fileExists = false;
-	int retryCount = 3;
-	
-	for (int retry = 0; retry < retryCount; retry++) {
-		fileExists = std::filesystem::exists(fullPath);
-		if (fileExists) {
-			break;
-		}
-		
-		if (retry < retryCount - 1) {
-			// 等待50ms后重试（文件系统可能延迟）
-			// ACAPI_WriteReport("ResolveImagePath调试: 文件不存在，重试 %d/%d (等待50ms)", 
-			// 	false, retry + 1, retryCount);
-			std::this_thread::sleep_for(std::chrono::milliseconds(50)); // 等待50毫秒
-		}
-	}
-	
-	if (!fileExists) {
-		ACAPI_WriteReport("ResolveImagePath调试: 文件不存在，完整路径='%s'", 
-			false, fullPath.string().c_str());
-		
-		// 尝试列出父目录以调试
-		try {
-			std::filesystem::path parentPath = fullPath.parent_path();
-			if (std::filesystem::exists(parentPath)) {
-				ACAPI_WriteReport("ResolveImagePath调试: 父目录存在，列出内容:", false);
-				for (const auto& entry : std::filesystem::directory_iterator(parentPath)) {
-					ACAPI_WriteReport("  - %s", false, entry.path().filename().string().c_str());
-				}
-			} else {
-				ACAPI_WriteReport("ResolveImagePath调试: 父目录也不存在: %s", 
-					false, parentPath.string().c_str());
-			}
-		} catch (...) {
-			ACAPI_WriteReport("ResolveImagePath调试: 列出目录内容时出错", false);
-		}
-		
-		return IO::Location();
-	}
-		
+
 		IO::Location location;
 		location.Set(fullPath.string().c_str());
-		
-		// 验证位置对象
-		GS::UniString resolvedPath;
-		location.ToPath(&resolvedPath);
-		// ACAPI_WriteReport("ResolveImagePath调试: 解析后的位置='%s'", false, resolvedPath.ToCStr().Get());
-		
 		return location;
 	}
 	
-	// 根据相对路径删除磁盘上的图片文件，保持文件夹与属性同步
-	static bool DeleteImageFileFromDisk(const GS::UniString& relativePath) {
-		if (relativePath.IsEmpty()) return false;
-		IO::Location loc = ResolveImagePath(relativePath);
-		GS::UniString fullPath;
-		loc.ToPath(&fullPath);
-		if (fullPath.IsEmpty()) return false;
-		try {
-			std::filesystem::path p(fullPath.ToCStr().Get());
-			if (std::filesystem::exists(p) && std::filesystem::is_regular_file(p)) {
-				return std::filesystem::remove(p);
-			}
-		} catch (...) {}
-		return false;
-	}
  	
 	// 加载并显示图片到PictureItem控件
 
 	
-	// Forward declaration
-	static void CollectClassificationItemsRecursive(const API_Guid& itemGuid, GS::Array<API_Guid>& outGuids);
-	
-	// Helper function to get IFC type from element
-	static GS::UniString GetIFCTypeForElement(const API_Guid& elementGuid)
-	{
-		GS::UniString ifcType = "未知";
-		
-		try {
-			IFCAPI::ObjectAccessor objectAccessor = IFCAPI::GetObjectAccessor();
-			
-			API_Elem_Head elemHead{};
-			elemHead.guid = elementGuid;
-			
-			GSErrCode err = ACAPI_Element_GetHeader(&elemHead);
-			if (err != NoError)
-				return ifcType;
-			
-			auto objectIDResult = objectAccessor.CreateElementObjectID(elemHead);
-			if (objectIDResult.IsErr())
-				return ifcType;
-			
-			IFCAPI::ObjectID objectID = objectIDResult.Unwrap();
-			auto ifcTypeResult = objectAccessor.GetIFCType(objectID);
-			
-			if (ifcTypeResult.IsOk()) {
-				ifcType = ifcTypeResult.Unwrap();
-			}
-		} catch (...) {
-			// Handle exception
-		}
-		
-		return ifcType;
-	}
-	
-	// Helper function to get GlobalId from element
-	static GS::UniString GetGlobalIdForElement(const API_Guid& elementGuid)
-	{
-		GS::UniString globalId = "未找到";
-		
-		try {
-			IFCAPI::ObjectAccessor objectAccessor = IFCAPI::GetObjectAccessor();
-			
-			API_Elem_Head elemHead{};
-			elemHead.guid = elementGuid;
-			
-			GSErrCode err = ACAPI_Element_GetHeader(&elemHead);
-			if (err != NoError)
-				return globalId;
-			
-			auto objectIDResult = objectAccessor.CreateElementObjectID(elemHead);
-			if (objectIDResult.IsErr())
-				return globalId;
-			
-			IFCAPI::ObjectID objectID = objectIDResult.Unwrap();
-			IFCAPI::PropertyAccessor propertyAccessor(objectID);
-			
-			auto attributesResult = propertyAccessor.GetAttributes();
-			if (attributesResult.IsOk()) {
-				std::vector<IFCAPI::Attribute> attributes = attributesResult.Unwrap();
-				for (const IFCAPI::Attribute& attribute : attributes) {
-					if (attribute.GetName().IsEqual("GlobalId", GS::CaseInsensitive)) {
-						auto value = attribute.GetValue();
-						if (value.has_value()) {
-							globalId = value.value();
-						}
-						break;
-					}
-				}
-			}
-		} catch (...) {
-			// Handle exception
-		}
-		
-		return globalId;
-	}
-	
-	// 收集所有分类项，使属性对所有元素可用
-	static GSErrCode GetAllClassificationItems(GS::Array<API_Guid>& outAllItems)
-	{
-		outAllItems.Clear();
-		GS::Array<API_ClassificationSystem> systems;
-		GSErrCode err = ACAPI_Classification_GetClassificationSystems(systems);
-		if (err != NoError) return err;
-		
-		for (UInt32 i = 0; i < systems.GetSize(); ++i) {
-			GS::Array<API_ClassificationItem> rootItems;
-			if (ACAPI_Classification_GetClassificationSystemRootItems(systems[i].guid, rootItems) == NoError) {
-				for (UInt32 j = 0; j < rootItems.GetSize(); ++j) {
-					CollectClassificationItemsRecursive(rootItems[j].guid, outAllItems);
-				}
-			}
-		}
-		return NoError;
-	}
-	
-	// 递归收集分类项
-	static void CollectClassificationItemsRecursive(const API_Guid& itemGuid, GS::Array<API_Guid>& outGuids)
-	{
-		outGuids.Push(itemGuid);
-		GS::Array<API_ClassificationItem> children;
-		if (ACAPI_Classification_GetClassificationItemChildren(itemGuid, children) == NoError) {
-			for (UInt32 i = 0; i < children.GetSize(); ++i) {
-				CollectClassificationItemsRecursive(children[i].guid, outGuids);
-			}
-		}
-	}
-	
-	// 创建或获取HBIM属性组
-	static GSErrCode FindOrCreateHBIMGroup(API_PropertyGroup& outGroup)
-	{
-		GS::Array<API_PropertyGroup> groups;
-		GSErrCode err = ACAPI_Property_GetPropertyGroups(groups);
-		if (err != NoError) {
-			ACAPI_WriteReport("FindOrCreateHBIMGroup: GetPropertyGroups 失败: %s", true, GS::UniString::Printf("Error %d", err).ToCStr().Get());
-			return err;
-		}
-		
-		// ACAPI_WriteReport("FindOrCreateHBIMGroup: 找到 %d 个属性组", false, (int)groups.GetSize());
-		
-		// 记录所有属性组名称用于调试
-		for (UInt32 i = 0; i < groups.GetSize(); ++i) {
-			// ACAPI_WriteReport("  属性组[%d]: %s", false, (int)i, groups[i].name.ToCStr().Get());
-		}
-		
-		for (UInt32 i = 0; i < groups.GetSize(); ++i) {
-			if (groups[i].name == kHBIMGroupName) {
-				ACAPI_WriteReport("FindOrCreateHBIMGroup: 找到现有属性组: %s", false, kHBIMGroupName.ToCStr().Get());
-				outGroup = groups[i];
-				return NoError;
-			}
-		}
-		
-	ACAPI_WriteReport("FindOrCreateHBIMGroup: 未找到属性组 '%s'，创建新组", false, kHBIMGroupName.ToCStr().Get());
-	outGroup = {};
-	outGroup.guid = APINULLGuid;
-	outGroup.name = kHBIMGroupName;
-	outGroup.description = "HBIM构件编号和说明";
-	err = ACAPI_Property_CreatePropertyGroup(outGroup);
-	if (err != NoError) {
-		ACAPI_WriteReport("FindOrCreateHBIMGroup: CreatePropertyGroup 失败: %s (错误码: %d)", true, GS::UniString::Printf("Error %d", err).ToCStr().Get(), err);
-		ACAPI_WriteReport("  尝试创建属性组: 名称='%s', 描述='%s'", false, kHBIMGroupName.ToCStr().Get(), "HBIM构件编号和说明");
-		
-		// 如果创建失败，可能是组已存在但名称比较失败（例如空格、编码问题）
-		// 重新获取属性组列表，尝试再次查找
-		ACAPI_WriteReport("FindOrCreateHBIMGroup: 创建失败，尝试重新查找现有属性组", false);
-		GS::Array<API_PropertyGroup> groups2;
-		GSErrCode err2 = ACAPI_Property_GetPropertyGroups(groups2);
-		if (err2 == NoError) {
-			ACAPI_WriteReport("FindOrCreateHBIMGroup: 重新找到 %d 个属性组", false, (int)groups2.GetSize());
-			for (UInt32 i = 0; i < groups2.GetSize(); ++i) {
-				ACAPI_WriteReport("  重新检查属性组[%d]: '%s'", false, (int)i, groups2[i].name.ToCStr().Get());
-				// 尝试更宽松的比较：去除空格后比较
-				GS::UniString existingName = groups2[i].name;
-				GS::UniString targetName = kHBIMGroupName;
-				// 简单比较：如果名称包含目标字符串或目标字符串包含现有名称
-				if (existingName == targetName || 
-					existingName.Contains(targetName) || 
-					targetName.Contains(existingName)) {
-					ACAPI_WriteReport("FindOrCreateHBIMGroup: 通过宽松比较找到属性组: '%s' (目标: '%s')", false, existingName.ToCStr().Get(), targetName.ToCStr().Get());
-					outGroup = groups2[i];
-					return NoError;
-				}
-			}
-		} else {
-			ACAPI_WriteReport("FindOrCreateHBIMGroup: 重新获取属性组失败: %s", true, GS::UniString::Printf("Error %d", err2).ToCStr().Get());
-		}
-		
-		// 检查错误类型
-		// 错误码 -2130312307 = APIERR_NEEDSUNDOSCOPE (需要撤销作用域)
-		// 错误码 -2130312988 = APIERR_NAMEALREADYUSED (名称已存在)
-		ACAPI_WriteReport("FindOrCreateHBIMGroup: 注意: 错误码 %d (0x%X)", true, err, err);
-		if (err == -2130312307) {
-			ACAPI_WriteReport("  -> APIERR_NEEDSUNDOSCOPE: 属性组创建需要在ACAPI_CallUndoableCommand作用域内", false);
-		} else if (err == -2130312988) {
-			ACAPI_WriteReport("  -> APIERR_NAMEALREADYUSED: 属性组名称已存在", false);
-		}
-	} else {
-		ACAPI_WriteReport("FindOrCreateHBIMGroup: 成功创建属性组: %s", false, kHBIMGroupName.ToCStr().Get());
-	}
-	return err;
-	}
-	
-	// 创建或获取HBIM属性定义
-	static GSErrCode FindOrCreateHBIMDefinition(const API_PropertyGroup& group, const GS::UniString& name, 
-												API_PropertyDefinition& outDef, GS::Array<API_Guid>& allClassificationItems)
-	{
-		GS::Array<API_PropertyDefinition> defs;
-		GSErrCode err = ACAPI_Property_GetPropertyDefinitions(group.guid, defs);
-		if (err != NoError) {
-			ACAPI_WriteReport("FindOrCreateHBIMDefinition [%s]: GetPropertyDefinitions 失败: %s", true, name.ToCStr().Get(), GS::UniString::Printf("Error %d", err).ToCStr().Get());
-			return err;
-		}
-		for (UInt32 i = 0; i < defs.GetSize(); ++i) {
-			if (defs[i].name == name) {
-				outDef = defs[i];
-				return NoError;
-			}
-		}
-		// 属性不存在，创建新的
-		outDef = {};
-		outDef.guid = APINULLGuid;
-		outDef.groupGuid = group.guid;
-		outDef.name = name;
-		outDef.collectionType = API_PropertySingleCollectionType;
-		outDef.valueType = API_PropertyStringValueType;
-		outDef.measureType = API_PropertyDefaultMeasureType;
-		outDef.canValueBeEditable = true;
-		outDef.definitionType = API_PropertyCustomDefinitionType;
-		outDef.defaultValue.basicValue.variantStatus = API_VariantStatusNormal;
-		outDef.defaultValue.basicValue.singleVariant.variant.type = API_PropertyStringValueType;
-		// 设置 availability 为所有分类项，使属性对所有元素可用
-		outDef.availability = allClassificationItems;
-		err = ACAPI_Property_CreatePropertyDefinition(outDef);
-		if (err != NoError) {
-			ACAPI_WriteReport("FindOrCreateHBIMDefinition [%s]: CreatePropertyDefinition 失败: %s", true, name.ToCStr().Get(), GS::UniString::Printf("Error %d", err).ToCStr().Get());
-		}
-		return err;
-	}
-	
-	// 确保HBIM属性组和定义存在
-	static GSErrCode EnsureHBIMPropertyGroupAndDefinitions(API_Guid& outGroupGuid, API_Guid& outIdGuid, API_Guid& outDescGuid)
-	{
-		API_PropertyGroup group;
-		GSErrCode err = FindOrCreateHBIMGroup(group);
-		if (err != NoError) return err;
-		
-		// 收集所有分类项
-		GS::Array<API_Guid> allClassificationItems;
-		GetAllClassificationItems(allClassificationItems);
-		
-		API_PropertyDefinition defId, defDesc;
-		err = FindOrCreateHBIMDefinition(group, kHBIMIdName, defId, allClassificationItems);
-		if (err != NoError) return err;
-		
-		err = FindOrCreateHBIMDefinition(group, kHBIMDescName, defDesc, allClassificationItems);
-		if (err != NoError) return err;
-		
-		// 所有操作成功，设置输出参数
-		outGroupGuid = group.guid;
-		outIdGuid = defId.guid;
-		outDescGuid = defDesc.guid;
-		return NoError;
-	}
-	
- 	// 查找现有的HBIM属性组和定义（不创建）
- 	static GSErrCode FindExistingHBIMPropertyGroupAndDefinitions(API_Guid& outGroupGuid, API_Guid& outIdGuid, API_Guid& outDescGuid)
- 	{
- 		GS::Array<API_PropertyGroup> groups;
- 		GSErrCode err = ACAPI_Property_GetPropertyGroups(groups);
- 		if (err != NoError) {
- 			ACAPI_WriteReport("FindExistingHBIMPropertyGroupAndDefinitions: GetPropertyGroups 失败: %s", true, GS::UniString::Printf("Error %d", err).ToCStr().Get());
- 			return err;
- 		}
- 		
- 		// 查找属性组
- 		API_PropertyGroup foundGroup;
- 		bool groupFound = false;
- 		for (UInt32 i = 0; i < groups.GetSize(); ++i) {
- 			if (groups[i].name == kHBIMGroupName) {
- 				foundGroup = groups[i];
- 				groupFound = true;
- 				break;
- 			}
- 		}
- 		
- 		if (!groupFound) {
- 			outGroupGuid = APINULLGuid;
- 			outIdGuid = APINULLGuid;
- 			outDescGuid = APINULLGuid;
- 			return APIERR_BADNAME;
- 		}
- 		
- 		outGroupGuid = foundGroup.guid;
- 		
- 		// 查找属性定义
- 		GS::Array<API_PropertyDefinition> defs;
- 		err = ACAPI_Property_GetPropertyDefinitions(foundGroup.guid, defs);
- 		if (err != NoError) {
- 			ACAPI_WriteReport("FindExistingHBIMPropertyGroupAndDefinitions: GetPropertyDefinitions 失败: %s", true, GS::UniString::Printf("Error %d", err).ToCStr().Get());
- 			outGroupGuid = APINULLGuid;
- 			outIdGuid = APINULLGuid;
- 			outDescGuid = APINULLGuid;
- 			return err;
- 		}
- 		
- 		bool idFound = false, descFound = false;
- 		API_PropertyDefinition defId, defDesc;
- 		for (UInt32 i = 0; i < defs.GetSize(); ++i) {
- 			if (defs[i].name == kHBIMIdName) {
- 				defId = defs[i];
- 				idFound = true;
- 			} else if (defs[i].name == kHBIMDescName) {
- 				defDesc = defs[i];
- 				descFound = true;
- 			}
- 		}
- 		
- 		if (!idFound || !descFound) {
- 			outGroupGuid = APINULLGuid;
- 			outIdGuid = APINULLGuid;
- 			outDescGuid = APINULLGuid;
- 			return APIERR_BADNAME;
- 		}
- 		
- 		outIdGuid = defId.guid;
-  		outDescGuid = defDesc.guid;
-  		return NoError;
-  	}
-  	
-  	// 从元素读取HBIM属性值
- 	static GSErrCode GetHBIMPropertyValue(const API_Guid& elemGuid, const API_Guid& defGuid, GS::UniString& outVal)
-	{
-		API_Property p = {};
-		GSErrCode err = ACAPI_Element_GetPropertyValue(elemGuid, defGuid, p);
-		if (err != NoError || p.status != API_Property_HasValue || p.value.variantStatus != API_VariantStatusNormal) return err;
-		outVal = p.value.singleVariant.variant.uniStringValue;
-		return NoError;
-	}
-	
-	// 向元素写入HBIM属性值
-	static GSErrCode SetHBIMPropertyValue(const API_Guid& elemGuid, const API_Guid& defGuid, const GS::UniString& value)
-	{
-		API_PropertyDefinition def = {};
-		def.guid = defGuid;
-		GSErrCode err = ACAPI_Property_GetPropertyDefinition(def);
-		if (err != NoError) return err;
-		
-		API_Property p = {};
-		p.definition = def;
-		p.status = API_Property_HasValue;
-		p.isDefault = false;
-		p.value.variantStatus = API_VariantStatusNormal;
-		p.value.singleVariant.variant.type = API_PropertyStringValueType;
-		p.value.singleVariant.variant.uniStringValue = value;
-		err = ACAPI_Element_SetProperty(elemGuid, p);
-		return err;
-	}
-	
-	// 检查元素是否有HBIM属性
-	static bool HasHBIMProperties(const API_Guid& elemGuid, API_Guid idGuid, API_Guid descGuid)
-	{
-		// 如果GUID无效，说明属性定义不存在，元素不可能有HBIM属性
-		if (idGuid == APINULLGuid || descGuid == APINULLGuid) {
-			return false;
-		}
-		GS::UniString idVal, descVal;
-		bool hasId = (GetHBIMPropertyValue(elemGuid, idGuid, idVal) == NoError);
-		bool hasDesc = (GetHBIMPropertyValue(elemGuid, descGuid, descVal) == NoError);
-		return hasId || hasDesc; // 只要有一个属性有值就认为有HBIM属性
-	}
-	
 	// 获取当前时间戳字符串
 	static GS::UniString GetCurrentTimestamp()
 	{
@@ -662,426 +175,38 @@ namespace {
 			return false;
 		}
 	}
-	
-	// 创建或获取HBIM图片属性组
-	static GSErrCode FindOrCreateHBIMImageGroup(API_PropertyGroup& outGroup)
-	{
-		// 第一步：获取所有属性组并详细记录
-		GS::Array<API_PropertyGroup> groups;
-		GSErrCode err = ACAPI_Property_GetPropertyGroups(groups);
-		if (err != NoError) {
-			ACAPI_WriteReport("FindOrCreateHBIMImageGroup: GetPropertyGroups 失败: %s", true, GS::UniString::Printf("Error %d", err).ToCStr().Get());
-			return err;
-		}
-		
-		ACAPI_WriteReport("FindOrCreateHBIMImageGroup: 系统中共有 %d 个属性组", false, (int)groups.GetSize());
-		
-		// 第二步：详细检查每个属性组，使用多种比较方法
-		GS::UniString targetName = kHBIMImageGroupName;
-		GS::UniString targetNameNormalized = NormalizeUniString(targetName);
-		
-		for (UInt32 i = 0; i < groups.GetSize(); ++i) {
-			GS::UniString existingName = groups[i].name;
-			GS::UniString existingNameNormalized = NormalizeUniString(existingName);
-			
-			// 记录每个属性组的详细信息
-			ACAPI_WriteReport("FindOrCreateHBIMImageGroup: 属性组[%d]: 原始名称='%s', 标准化='%s', guid=%s", 
-				false, (int)i, 
-				existingName.ToCStr().Get(),
-				existingNameNormalized.ToCStr().Get(),
-				APIGuidToString(groups[i].guid).ToCStr().Get());
-			
-			// 方法1：完全匹配原始名称
-			if (existingName == targetName) {
-				ACAPI_WriteReport("FindOrCreateHBIMImageGroup: 通过完全匹配找到属性组！", false);
-				outGroup = groups[i];
-				return NoError;
-			}
-			
-			// 方法2：完全匹配标准化名称
-			if (existingNameNormalized == targetNameNormalized) {
-				ACAPI_WriteReport("FindOrCreateHBIMImageGroup: 通过标准化匹配找到属性组！", false);
-				outGroup = groups[i];
-				return NoError;
-			}
-			
-			// 方法3：互相包含（宽松匹配）
-			if (existingNameNormalized.Contains(targetNameNormalized) || 
-				targetNameNormalized.Contains(existingNameNormalized)) {
-				ACAPI_WriteReport("FindOrCreateHBIMImageGroup: 通过宽松匹配找到属性组！", false);
-				outGroup = groups[i];
-				return NoError;
-			}
-		}
-		
-		// 第三步：属性组不存在，尝试创建
-		ACAPI_WriteReport("FindOrCreateHBIMImageGroup: 属性组不存在，尝试创建...", false);
-		outGroup = {};
-		outGroup.guid = APINULLGuid;
-		outGroup.name = kHBIMImageGroupName;
-		outGroup.description = "HBIM构件图片链接";
-		err = ACAPI_Property_CreatePropertyGroup(outGroup);
-		
-		if (err != NoError) {
-			// 创建失败，分析错误原因
-			ACAPI_WriteReport("FindOrCreateHBIMImageGroup: CreatePropertyGroup 失败: %s (错误码: %d)", true, 
-				GS::UniString::Printf("Error %d", err).ToCStr().Get(), err);
-			
-			// 检查错误类型
-			// 错误码 -2130312307 = APIERR_NEEDSUNDOSCOPE (需要撤销作用域)
-			// 错误码 -2130312988 = APIERR_NAMEALREADYUSED (名称已存在)
-			ACAPI_WriteReport("FindOrCreateHBIMImageGroup: 注意: 错误码 %d (0x%X)", true, err, err);
-			if (err == -2130312307) {
-				ACAPI_WriteReport("  -> APIERR_NEEDSUNDOSCOPE: 属性组创建需要在ACAPI_CallUndoableCommand作用域内", false);
-			} else if (err == -2130312988) {
-				ACAPI_WriteReport("  -> APIERR_NAMEALREADYUSED: 属性组名称已存在", false);
-			}
-			
-			// 重新获取属性组列表，尝试再次查找
-			ACAPI_WriteReport("FindOrCreateHBIMImageGroup: 创建失败，尝试重新查找现有属性组", false);
-			GS::Array<API_PropertyGroup> groups2;
-			GSErrCode err2 = ACAPI_Property_GetPropertyGroups(groups2);
-			if (err2 == NoError) {
-				ACAPI_WriteReport("FindOrCreateHBIMImageGroup: 重新找到 %d 个属性组", false, (int)groups2.GetSize());
-				for (UInt32 i = 0; i < groups2.GetSize(); ++i) {
-					ACAPI_WriteReport("  重新检查属性组[%d]: '%s'", false, (int)i, groups2[i].name.ToCStr().Get());
-					// 尝试更宽松的比较：使用原始名称和标准化名称
-					GS::UniString existingName = groups2[i].name;
-					GS::UniString existingNameNormalized = NormalizeUniString(existingName);
-					
-					// 多种匹配方式：完全匹配、标准化匹配、互相包含
-					if (existingName == targetName || 
-						existingNameNormalized == targetNameNormalized ||
-						existingName.Contains(targetName) || 
-						targetName.Contains(existingName) ||
-						existingNameNormalized.Contains(targetNameNormalized) ||
-						targetNameNormalized.Contains(existingNameNormalized)) {
-						ACAPI_WriteReport("FindOrCreateHBIMImageGroup: 通过宽松比较找到属性组: '%s' (目标: '%s')", false, existingName.ToCStr().Get(), targetName.ToCStr().Get());
-						outGroup = groups2[i];
-						return NoError;
-					}
-				}
-			} else {
-				ACAPI_WriteReport("FindOrCreateHBIMImageGroup: 重新获取属性组失败: %s", true, GS::UniString::Printf("Error %d", err2).ToCStr().Get());
-			}
-			
-			ACAPI_WriteReport("FindOrCreateHBIMImageGroup: 最终未找到属性组 '%s'", true, kHBIMImageGroupName.ToCStr().Get());
-			return err;
-		}
-		
-		// 创建成功
-		ACAPI_WriteReport("FindOrCreateHBIMImageGroup: 属性组创建成功！", false);
-		return NoError;
-	}
-	
-	// 创建或获取HBIM图片链接属性定义
-	static GSErrCode FindOrCreateHBIMImageDefinition(const API_PropertyGroup& group, 
-													 API_PropertyDefinition& outDef, 
-													 GS::Array<API_Guid>& allClassificationItems)
-	{
-		GS::Array<API_PropertyDefinition> defs;
-		GSErrCode err = ACAPI_Property_GetPropertyDefinitions(group.guid, defs);
-		if (err != NoError) {
-			ACAPI_WriteReport("FindOrCreateHBIMImageDefinition: GetPropertyDefinitions 失败: %s", true, GS::UniString::Printf("Error %d", err).ToCStr().Get());
-			return err;
-		}
-		
-		for (UInt32 i = 0; i < defs.GetSize(); ++i) {
-			if (defs[i].name == kHBIMImageLinksName) {
-				outDef = defs[i];
-				return NoError;
-			}
-		}
-		
-		// 属性不存在，创建新的
-		outDef = {};
-		outDef.guid = APINULLGuid;
-		outDef.groupGuid = group.guid;
-		outDef.name = kHBIMImageLinksName;
-		outDef.collectionType = API_PropertySingleCollectionType;
-		outDef.valueType = API_PropertyStringValueType;
-		outDef.measureType = API_PropertyDefaultMeasureType;
-		outDef.canValueBeEditable = true;
-		outDef.definitionType = API_PropertyCustomDefinitionType;
-		outDef.defaultValue.basicValue.variantStatus = API_VariantStatusNormal;
-		outDef.defaultValue.basicValue.singleVariant.variant.type = API_PropertyStringValueType;
-		outDef.availability = allClassificationItems;
-		
-		err = ACAPI_Property_CreatePropertyDefinition(outDef);
-		if (err != NoError) {
-			ACAPI_WriteReport("FindOrCreateHBIMImageDefinition: CreatePropertyDefinition 失败: %s (错误码: %d)", true, GS::UniString::Printf("Error %d", err).ToCStr().Get(), err);
-			
-			// 创建失败，可能是属性已存在，重新查找
-			GS::Array<API_PropertyDefinition> defs2;
-			GSErrCode err2 = ACAPI_Property_GetPropertyDefinitions(group.guid, defs2);
-			if (err2 == NoError) {
-				for (UInt32 i = 0; i < defs2.GetSize(); ++i) {
-					if (defs2[i].name == kHBIMImageLinksName) {
-						outDef = defs2[i];
-						ACAPI_WriteReport("FindOrCreateHBIMImageDefinition: 找到已存在的属性定义", false);
-						return NoError;
-					}
-				}
-			}
-		}
-		return err;
-	}
-	
-	// 确保HBIM图片属性组和定义存在
-	static GSErrCode EnsureHBIMImagePropertyGroupAndDefinitions(API_Guid& outGroupGuid, API_Guid& outImageLinksGuid)
-	{
-		API_PropertyGroup group;
-		GSErrCode err = FindOrCreateHBIMImageGroup(group);
-		if (err != NoError) return err;
-		
-		// 收集所有分类项
-		GS::Array<API_Guid> allClassificationItems;
-		GetAllClassificationItems(allClassificationItems);
-		
-		API_PropertyDefinition defImageLinks;
-		err = FindOrCreateHBIMImageDefinition(group, defImageLinks, allClassificationItems);
-		if (err != NoError) return err;
-		
-		outGroupGuid = group.guid;
-		outImageLinksGuid = defImageLinks.guid;
-		return NoError;
-	}
-	
-	// 从元素读取HBIM图片链接属性值
-	static GSErrCode GetHBIMImageLinksPropertyValue(const API_Guid& elemGuid, const API_Guid& defGuid, GS::UniString& outVal)
-	{
-		API_Property p = {};
-		GSErrCode err = ACAPI_Element_GetPropertyValue(elemGuid, defGuid, p);
-		if (err != NoError || p.status != API_Property_HasValue || p.value.variantStatus != API_VariantStatusNormal) {
-			outVal = "[]"; // 返回空JSON数组
-			return err;
-		}
-		outVal = p.value.singleVariant.variant.uniStringValue;
-		return NoError;
-	}
-	
-	// 向元素写入HBIM图片链接属性值
-	static GSErrCode SetHBIMImageLinksPropertyValue(const API_Guid& elemGuid, const API_Guid& defGuid, const GS::UniString& value)
-	{
-		API_PropertyDefinition def = {};
-		def.guid = defGuid;
-		GSErrCode err = ACAPI_Property_GetPropertyDefinition(def);
-		if (err != NoError) return err;
-		
-		API_Property p = {};
-		p.definition = def;
-		p.status = API_Property_HasValue;
-		p.isDefault = false;
-		p.value.variantStatus = API_VariantStatusNormal;
-		p.value.singleVariant.variant.type = API_PropertyStringValueType;
-		p.value.singleVariant.variant.uniStringValue = value;
-		err = ACAPI_Element_SetProperty(elemGuid, p);
-		return err;
-	}
-
-	// 检测 labelme 是否存在于系统中
-	__attribute__((unused)) static bool CheckLabelmeExists() {
-		// 检查常见安装路径（conda优先）
-		const char* paths[] = {
-			"/opt/miniconda3/bin/labelme",
-			"/usr/local/bin/labelme",
-			"/opt/homebrew/bin/labelme",
-			"/usr/bin/labelme"
-		};
-		for (const auto& path : paths) {
-			if (std::filesystem::exists(path))
-				return true;
-		}
-		return false;
-	}
-
-#if defined(GS_MAC)
-	static GSErrCode LaunchLabelme(const GS::UniString& imagePath) {
-		struct CandidatePath {
-			const char* python;
-			const char* labelme;
-		};
-		const CandidatePath candidates[] = {
-			{"/opt/miniconda3/bin/python",  "/opt/miniconda3/bin/labelme"},
-			{"/opt/miniconda3/bin/python3", "/opt/miniconda3/bin/labelme"},
-			{"/opt/homebrew/bin/python3",   "/opt/homebrew/bin/labelme"},
-			{"/usr/local/bin/python3",      "/usr/local/bin/labelme"},
-			{"/usr/bin/python3",            "/usr/bin/labelme"}
-		};
-
-		std::string imgPathStr(imagePath.ToCStr().Get());
-		char **envp = *_NSGetEnviron();
-
-		for (const auto& cand : candidates) {
-			if (!std::filesystem::exists(cand.labelme)) continue;
-			ACAPI_WriteReport("LaunchLabelme: 找到 %s", false, cand.labelme);
-
-			// 方式1: posix_spawn python -m labelme (Python 是真正的 Mach-O 可执行文件，最可靠)
-			if (std::filesystem::exists(cand.python)) {
-				ACAPI_WriteReport("LaunchLabelme: 尝试 python -m labelme via %s", false, cand.python);
-				pid_t pid;
-				char* const argv[] = {
-					const_cast<char*>(cand.python),
-					const_cast<char*>("-m"),
-					const_cast<char*>("labelme"),
-					const_cast<char*>(imgPathStr.c_str()),
-					nullptr
-				};
-				int ret = posix_spawn(&pid, cand.python, nullptr, nullptr, argv, envp);
-				if (ret == 0) {
-					ACAPI_WriteReport("LaunchLabelme: posix_spawn 成功, PID=%d, 等待检测崩溃...", false, (int)pid);
-					usleep(500000); // 500ms: 等待检测是否立即崩溃
-					int ws;
-					pid_t r = waitpid(pid, &ws, WNOHANG);
-					if (r == pid) {
-						int exitCode = WIFEXITED(ws) ? WEXITSTATUS(ws) : -1;
-						ACAPI_WriteReport("LaunchLabelme: 进程已退出, exit_code=%d", false, exitCode);
-						if (exitCode != 0) continue; // 崩溃了，尝试下一个候选
-					} else {
-						ACAPI_WriteReport("LaunchLabelme: 进程仍在运行 - 启动成功!", false);
-					}
-					return NoError;
-				}
-				ACAPI_WriteReport("LaunchLabelme: posix_spawn(python) 失败, errno=%d (%s)", false, ret, strerror(ret));
-			}
-
-			// 方式2: posix_spawn 直接运行 labelme 脚本 (依赖 shebang)
-			if (access(cand.labelme, X_OK) == 0) {
-				ACAPI_WriteReport("LaunchLabelme: 尝试直接执行 %s", false, cand.labelme);
-				pid_t pid;
-				char* const argv[] = {
-					const_cast<char*>(cand.labelme),
-					const_cast<char*>(imgPathStr.c_str()),
-					nullptr
-				};
-				int ret = posix_spawn(&pid, cand.labelme, nullptr, nullptr, argv, envp);
-				if (ret == 0) {
-					ACAPI_WriteReport("LaunchLabelme: posix_spawn(script) PID=%d", false, (int)pid);
-					usleep(500000);
-					int ws;
-					pid_t r = waitpid(pid, &ws, WNOHANG);
-					if (r == pid) {
-						int exitCode = WIFEXITED(ws) ? WEXITSTATUS(ws) : -1;
-						ACAPI_WriteReport("LaunchLabelme: 脚本退出, exit_code=%d", false, exitCode);
-						if (exitCode != 0) continue;
-					}
-					return NoError;
-				}
-				ACAPI_WriteReport("LaunchLabelme: posix_spawn(script) 失败, errno=%d (%s)", false, ret, strerror(ret));
-			}
-		}
-
-		ACAPI_WriteReport("LaunchLabelme: 所有候选路径均失败", false);
-		return Error;
-	}
-#endif
 
 }
  
 
-// 加载并显示图片到PictureItem控件
-void PluginPalette::LoadAndDisplayImage(const IO::Location& imageLocation, DG::PictureItem& pictureItem) {
-	// 防止重入
-	if (isLoadingImage) {
-		ACAPI_WriteReport("LoadAndDisplayImage: 已在加载中，跳过", false);
+// 加载并显示图片到PictureItem控件：缩略图与标注叠加在后台生成，缓存命中时立即显示
+void PluginPalette::LoadAndDisplayImage(const IO::Location& imageLocation, const GS::UniString& relativePath, DG::PictureItem& pictureItem) {
+	GS::UniString fullPath;
+	if (imageLocation.ToPath(&fullPath) != NoError || fullPath.IsEmpty()) {
+		ACAPI_WriteReport("LoadAndDisplayImage: 图片路径无效", false);
+		HBIMPreviewCache::Cancel();
+		pictureItem.SetPicture(DG::Picture());
+		pictureItem.Redraw();
 		return;
 	}
-	isLoadingImage = true;
 	
-	try {
-		// 清空现有图片，释放可能锁定的资源
-		pictureItem.SetPicture(DG::Picture());
-		pictureItem.Redraw();  // 强制重绘以释放资源
-		
-		// 检查文件是否可访问
-		IO::File file(imageLocation, IO::File::Fail);
-		GSErrCode openErr = file.Open(IO::File::ReadMode);
-		if (openErr == NoError && file.IsOpen()) {
-			UInt64 dataLength = 0;
-			GSErrCode lengthErr = file.GetDataLength(&dataLength);
-			if (lengthErr == NoError) {
-				ACAPI_WriteReport("LoadAndDisplayImage: 文件可打开，大小: %llu", false, dataLength);
-			} else {
-				ACAPI_WriteReport("LoadAndDisplayImage: 无法获取文件大小，错误码: %d", false, lengthErr);
-			}
-			file.Close();
-		} else {
-			ACAPI_WriteReport("LoadAndDisplayImage: 文件无法打开，错误码: %d", false, openErr);
-			pictureItem.SetPicture(DG::Picture());
-			isLoadingImage = false;
-			return;
-		}
-		
-		// 使用GX::Image加载图片
-		GX::Image img{imageLocation};
-		if (img.IsEmpty()) {
-			ACAPI_WriteReport("LoadAndDisplayImage: 图片加载失败: img.IsEmpty()", false);
-			pictureItem.SetPicture(DG::Picture());
-			isLoadingImage = false;
-			return;
-		}
-		
-		UInt32 imgW = img.GetWidth();
-		UInt32 imgH = img.GetHeight();
-		// 使用固定目标尺寸（与.grc中Picture控件 20 380 360 180 一致）
-		// 不依赖 GetWidth/GetHeight，因控件在部分时机可能返回0导致显示异常
-		const short ctrlW = 360;
-		const short ctrlH = 180;
-		
-		if (imgW == 0 || imgH == 0) {
-			ACAPI_WriteReport("LoadAndDisplayImage: 图片尺寸无效", false);
-			pictureItem.SetPicture(DG::Picture());
-			isLoadingImage = false;
-			return;
-		}
-		
-		// 按控件尺寸缩放，保持宽高比
-		double scaleW = (double) ctrlW / (double) imgW;
-		double scaleH = (double) ctrlH / (double) imgH;
-		double scale = (scaleW < scaleH) ? scaleW : scaleH;
-		
-		UInt32 newW = (UInt32) (imgW * scale);
-		UInt32 newH = (UInt32) (imgH * scale);
-		if (newW < 1) newW = 1;
-		if (newH < 1) newH = 1;
-		
-		// 转换为NativeImage并调整大小
-		NewDisplay::NativeImage nativeImg = img.ToNativeImage(1.0, false);
-		NewDisplay::NativeImage resized = nativeImg.Resize(newW, newH);
-		
-		// 创建GX::Image并立即转换为DG图片数据
-		// 关键：确保resized在scaledImg使用期间保持活动
-		GX::Image scaledImg(resized);
-		
-		// 立即转换为DG图片数据并创建DG::Picture
-		void* dgData = scaledImg.ToDGPicture();
-		if (dgData != nullptr) {
-			DG::Picture picture(dgData);
-			pictureItem.SetPicture(picture);
-			pictureItem.Redraw();
-		} else {
-			pictureItem.SetPicture(DG::Picture());
-		}
-		
-		isLoadingImage = false;
-	} catch (...) {
-		ACAPI_WriteReport("LoadAndDisplayImage: 捕获到异常", false);
-		pictureItem.SetPicture(DG::Picture());
-		isLoadingImage = false;  // 异常情况下也重置标志
-	}
+	// 使用固定目标尺寸（与.grc中Picture控件 20 380 360 180 一致）
+	// 不依赖 GetWidth/GetHeight，因控件在部分时机可能返回0导致显示异常
+	const UInt32 ctrlW = 360;
+	const UInt32 ctrlH = 180;
+	
+	// 面板析构时取消未完成的请求，回调中的控件指针始终有效
+	DG::PictureItem* target = &pictureItem;
+	HBIMPreviewCache::Request(fullPath, relativePath, ctrlW, ctrlH, [target](const DG::Picture& picture) {
+		target->SetPicture(picture);
+		target->Redraw();
+	});
 }
 
 static const GS::Guid s_paletteGuid ("{A1B2C3D4-E5F6-4A5B-8C9D-0E1F2A3B4C5D}");
 static GS::Ref<PluginPalette> s_instance;
 static std::recursive_mutex s_instanceMutex;
 
-static GSErrCode NotificationHandler (API_NotifyEventID notifID, Int32)
-{
-	if (notifID == APINotify_Quit)
-		PluginPalette::DestroyInstance ();
-	return NoError;
-}
-
 PluginPalette::PluginPalette ()
 	: DG::Palette (ACAPI_GetOwnResModule (), PaletteResId, ACAPI_GetOwnResModule (), s_paletteGuid)
 	, titleLabel (GetReference (), TitleLabelId)
@@ -1115,6 +240,11 @@ PluginPalette::PluginPalette ()
 	, diagnosisButton (GetReference (), DiagnosisButtonId)
 	, launchLabelmeButton (GetReference (), LaunchLabelmeButtonId)
 	, imagePreview (GetReference (), ImagePreviewId)
+	, imageCaptureInfo (GetReference (), ImageCaptureInfoId)
+	, captureFilterLabel (GetReference (), CaptureFilterLabelId)
+	, captureFilterEdit (GetReference (), CaptureFilterEditId)
+	, ifcPropertyTree (GetReference (), IFCPropertyTreeId)
+	, ifcRefreshButton (GetReference (), IFCRefreshButtonId)
 	, hasHBIMProperties (false)
 	, isHBIMEditMode (false)
 	, hbimGroupGuid (APINULLGuid)
@@ -1125,12 +255,15 @@ PluginPalette::PluginPalette ()
 	, hasHBIMImages (false)
 	, isImageEditMode (false)
  	, isUpdatingImages (false)
-	, isLoadingImage (false)
 	, currentImageIndex (0)
+	, hasLastHBIMView (false)
+	, hasLastImageView (false)
+	, ifcTreeElemGuid (APINULLGuid)
+	, ifcRootItem (0)
+	, ifcTreeLoaded (false)
 {
 
 	
-	ACAPI_ProjectOperation_CatchProjectEvent (APINotify_Quit, NotificationHandler);
 	Attach (*this);
 	
 	GS::UniString titleText;
@@ -1251,6 +384,36 @@ PluginPalette::PluginPalette ()
 	imagePreview.Show();
 	imagePreview.Redraw();
 	
+	// 拍摄信息与按拍摄时间筛选
+	imageCaptureInfo.SetText("");
+	imageCaptureInfo.Show();
+	captureFilterLabel.SetText("拍摄时间筛选:");
+	captureFilterLabel.Show();
+	captureFilterEdit.Attach(*this);
+	captureFilterEdit.Show();
+	
+	// 初始化IFC属性树
+	ifcRefreshButton.SetText("刷新IFC属性");
+	ifcRefreshButton.Show();
+	ifcRefreshButton.Attach(*this);
+	ifcPropertyTree.Attach(*this);
+	ifcPropertyTree.Show();
+	
+	// labelme 在后台启动，失败或异常退出时提示
+	HBIMLabelme::SetStatusListener([](const GS::UniString& message, bool failed) {
+		DG::InformationAlert(failed ? "Labelme 启动失败" : "Labelme", message, "确定");
+	});
+	
+	// labelme 标注索引变化时刷新预览（标注版本未变的图片不会重新绘制）
+	HBIMAnnotations::SetChangeListener([this]() {
+		UpdateHBIMImageUI();
+	});
+	
+	// 派生图生成后刷新预览（只有当前图片的预览键会变化）
+	HBIMImageDerivatives::SetReadyListener([this]() {
+		UpdateHBIMImageUI();
+	});
+	
 	// 调试日志
 	ACAPI_WriteReport("HBIMComponentEntry: 插件面板已创建，按钮观察者已附加", false);
 	
@@ -1261,6 +424,10 @@ PluginPalette::PluginPalette ()
 
 PluginPalette::~PluginPalette ()
 {
+	HBIMLabelme::SetStatusListener(nullptr);
+	HBIMAnnotations::SetChangeListener(nullptr);
+	HBIMImageDerivatives::SetReadyListener(nullptr);
+	HBIMPreviewCache::Cancel();
 	EndEventProcessing ();
 }
 
@@ -1310,10 +477,8 @@ void PluginPalette::UpdateFromSelection ()
 	GSErrCode err = ACAPI_Selection_Get (&selInfo, &selNeigs, false);
 	if (err != NoError || selNeigs.IsEmpty()) {
 		// 没有选中元素，重置显示
-		typeValue.SetText("未选择构件");
-		idValue.SetText("未选择构件");
-		typeValue.Redraw();
-		idValue.Redraw();
+		SetTextIfChanged(typeValue, "未选择构件");
+		SetTextIfChanged(idValue, "未选择构件");
 		
 		// 重置HBIM属性显示
 		hasHBIMProperties = false;
@@ -1327,6 +492,7 @@ void PluginPalette::UpdateFromSelection ()
 		originalImagePaths.Clear();
 		currentImageIndex = 0;
 		UpdateHBIMImageUI();
+		ResetIFCPropertyTree(APINULLGuid);
 		return;
 	}
 	
@@ -1347,67 +513,79 @@ void PluginPalette::UpdateFromSelection ()
 	currentElemGuid = elemGuid;
 	
 	// 更新IFC属性显示
-	GS::UniString ifcType = GetIFCTypeForElement(elemGuid);
-	GS::UniString globalId = GetGlobalIdForElement(elemGuid);
-	typeValue.SetText(ifcType);
-	idValue.SetText(globalId);
-	typeValue.Redraw();
-	idValue.Redraw();
+	GS::UniString ifcType = HBIM::GetIFCTypeForElement(elemGuid);
+	GS::UniString globalId = HBIMGlobalIdIndex::GetGlobalId(elemGuid);
+	SetTextIfChanged(typeValue, ifcType);
+	SetTextIfChanged(idValue, globalId);
 	
 	// 检查并更新HBIM属性
 	CheckHBIMProperties(elemGuid);
 	
 	// 检查并更新HBIM图片
 	CheckHBIMImages();
+	
+	// IFC属性树只重建根节点，展开时才读取
+	ResetIFCPropertyTree(elemGuid);
 }
 
-void PluginPalette::UpdateHBIMUI ()
+template <typename ItemType>
+void PluginPalette::ApplyItemState (ItemType& item, const ItemState& next, const ItemState* prev)
 {
-	ACAPI_WriteReport("HBIMComponentEntry: UpdateHBIMUI 开始，isHBIMEditMode=%d, hasHBIMProperties=%d", false, isHBIMEditMode ? 1 : 0, hasHBIMProperties ? 1 : 0);
-	
+	bool changed = false;
+	if (!next.text.IsEmpty() && (prev == nullptr || prev->text != next.text)) {
+		item.SetText(next.text);
+		changed = true;
+	}
+	if (prev == nullptr || prev->visible != next.visible) {
+		if (next.visible) item.Show(); else item.Hide();
+		changed = true;
+	}
+	if (prev == nullptr || prev->enabled != next.enabled) {
+		if (next.enabled) item.Enable(); else item.Disable();
+		changed = true;
+	}
+	if (changed) {
+		item.Redraw();
+	}
+}
+
+PluginPalette::HBIMViewModel PluginPalette::BuildHBIMViewModel () const
+{
+	HBIMViewModel view;
+	view.cancelButton.text = "取消";
 	if (isHBIMEditMode) {
-		ACAPI_WriteReport("HBIMComponentEntry: 编辑模式 - 显示编辑控件", false);
-		// 编辑模式：显示编辑控件和按钮
-		hbimIdValue.Show();
-		hbimDescValue.Show();
-		hbimActionButton.SetText("保存");
-		hbimActionButton.Show();
-		hbimCancelButton.Show();
-		
-		// 启用编辑控件
-		hbimIdValue.Enable();
-		hbimDescValue.Enable();
+		// 编辑模式：显示并启用编辑控件，按钮为"保存"和"取消"
+		view.actionButton.text = "保存";
+	} else if (hasHBIMProperties) {
+		// 有属性：显示属性值（只读），按钮为"属性编辑"
+		view.idValue.enabled = false;
+		view.descValue.enabled = false;
+		view.actionButton.text = "属性编辑";
+		view.cancelButton.visible = false;
 	} else {
-		ACAPI_WriteReport("HBIMComponentEntry: 查看模式", false);
-		// 查看模式
-		if (hasHBIMProperties) {
-			ACAPI_WriteReport("HBIMComponentEntry: 有属性 - 显示属性值（只读）和编辑按钮", false);
-			// 有属性：显示属性值（只读），按钮为"属性编辑"
-			hbimIdValue.Show();
-			hbimDescValue.Show();
-			hbimActionButton.SetText("属性编辑");
-			hbimActionButton.Show();
-			hbimCancelButton.Hide();
-			
-			// 禁用编辑控件（只读模式）
-			hbimIdValue.Disable();
-			hbimDescValue.Disable();
-		} else {
-			ACAPI_WriteReport("HBIMComponentEntry: 无属性 - 显示添加按钮", false);
-			// 无属性：显示"添加"按钮
-			hbimIdValue.Hide();
-			hbimDescValue.Hide();
-			hbimActionButton.SetText("添加");
-			hbimActionButton.Show();
-			hbimCancelButton.Hide();
-		}
+		// 无属性：只显示"添加"按钮
+		view.idValue.visible = false;
+		view.descValue.visible = false;
+		view.actionButton.text = "添加";
+		view.cancelButton.visible = false;
 	}
+	return view;
+}
+
+void PluginPalette::UpdateHBIMUI ()
+{
+	ACAPI_WriteReport("HBIMComponentEntry: UpdateHBIMUI 开始，isHBIMEditMode=%d, hasHBIMProperties=%d", false, isHBIMEditMode ? 1 : 0, hasHBIMProperties ? 1 : 0);
 	
-	// 重绘控件
-	hbimIdValue.Redraw();
-	hbimDescValue.Redraw();
-	hbimActionButton.Redraw();
-	hbimCancelButton.Redraw();
+	const HBIMViewModel view = BuildHBIMViewModel();
+	const HBIMViewModel* prev = hasLastHBIMView ? &lastHBIMView : nullptr;
+	
+	ApplyItemState(hbimIdValue, view.idValue, prev ? &prev->idValue : nullptr);
+	ApplyItemState(hbimDescValue, view.descValue, prev ? &prev->descValue : nullptr);
+	ApplyItemState(hbimActionButton, view.actionButton, prev ? &prev->actionButton : nullptr);
+	ApplyItemState(hbimCancelButton, view.cancelButton, prev ? &prev->cancelButton : nullptr);
+	
+	lastHBIMView = view;
+	hasLastHBIMView = true;
 	
 	ACAPI_WriteReport("HBIMComponentEntry: UpdateHBIMUI 完成", false);
 }
@@ -1468,7 +646,7 @@ void PluginPalette::ExitHBIMEditMode (bool save)
 bool PluginPalette::TryFindExistingHBIMPropertyGroupAndDefinitions ()
 {
 	API_Guid groupGuid, idGuid, descGuid;
-	GSErrCode err = FindExistingHBIMPropertyGroupAndDefinitions(groupGuid, idGuid, descGuid);
+	GSErrCode err = HBIM::FindExistingHBIMPropertyGroupAndDefinitions(groupGuid, idGuid, descGuid);
 	if (err == NoError) {
 		hbimGroupGuid = groupGuid;
 		hbimIdGuid = idGuid;
@@ -1495,7 +673,7 @@ GSErrCode PluginPalette::EnsureHBIMPropertiesInitialized ()
 	API_Guid groupGuid, idGuid, descGuid;
 	GSErrCode err = ACAPI_CallUndoableCommand("创建HBIM属性定义",
 		[&]() -> GSErrCode {
-			return EnsureHBIMPropertyGroupAndDefinitions(groupGuid, idGuid, descGuid);
+			return HBIM::EnsureHBIMPropertyGroupAndDefinitions(groupGuid, idGuid, descGuid);
 		}
 	);
 	if (err == NoError) {
@@ -1524,7 +702,7 @@ void PluginPalette::CheckHBIMProperties (const API_Guid& elementGuid)
 		return;
 	}
 	
-	hasHBIMProperties = HasHBIMProperties(elementGuid, hbimIdGuid, hbimDescGuid);
+	hasHBIMProperties = HBIM::HasHBIMProperties(elementGuid, hbimIdGuid, hbimDescGuid);
 	if (hasHBIMProperties) {
 		ReadHBIMProperties(elementGuid);
 	}
@@ -1534,13 +712,13 @@ void PluginPalette::CheckHBIMProperties (const API_Guid& elementGuid)
 void PluginPalette::ReadHBIMProperties (const API_Guid& elementGuid)
 {
 	GS::UniString idVal, descVal;
-	if (GetHBIMPropertyValue(elementGuid, hbimIdGuid, idVal) == NoError) {
+	if (HBIM::GetHBIMPropertyValue(elementGuid, hbimIdGuid, idVal) == NoError) {
 		hbimIdValue.SetText(idVal);
 	} else {
 		hbimIdValue.SetText("");
 	}
 	
-	if (GetHBIMPropertyValue(elementGuid, hbimDescGuid, descVal) == NoError) {
+	if (HBIM::GetHBIMPropertyValue(elementGuid, hbimDescGuid, descVal) == NoError) {
 		hbimDescValue.SetText(descVal);
 	} else {
 		hbimDescValue.SetText("");
@@ -1564,18 +742,19 @@ void PluginPalette::WriteHBIMProperties (const API_Guid& elementGuid)
 	// 在可撤销命令中写入属性值（遵循ComponentInfo模式）
 	GSErrCode saveErr = ACAPI_CallUndoableCommand("保存HBIM属性信息",
 		[&]() -> GSErrCode {
-			GSErrCode err1 = SetHBIMPropertyValue(elementGuid, hbimIdGuid, idVal);
+			GSErrCode err1 = HBIM::SetHBIMPropertyValue(elementGuid, hbimIdGuid, idVal);
 			if (err1 != NoError) {
 				ACAPI_WriteReport("写入HBIM构件编号失败: %s", true, GS::UniString::Printf("Error %d", err1).ToCStr().Get());
 				return err1;
 			}
 			
-			GSErrCode err2 = SetHBIMPropertyValue(elementGuid, hbimDescGuid, descVal);
+			GSErrCode err2 = HBIM::SetHBIMPropertyValue(elementGuid, hbimDescGuid, descVal);
 			if (err2 != NoError) {
 				ACAPI_WriteReport("写入HBIM构件说明失败: %s", true, GS::UniString::Printf("Error %d", err2).ToCStr().Get());
 				return err2;
 			}
 			
+			HBIMStatusOverlay::UpdateStatuses({ elementGuid });
 			return NoError;
 		}
 	);
@@ -1594,6 +773,12 @@ bool PluginPalette::IsInEditMode ()
 	return GetInstance().isHBIMEditMode;
 }
 
+bool PluginPalette::IsInImageEditMode ()
+{
+	if (!HasInstance()) return false;
+	return GetInstance().isImageEditMode;
+}
+
 void PluginPalette::SetEditMode (bool editMode)
 {
 	if (!HasInstance()) return;
@@ -1679,10 +864,8 @@ GSErrCode PluginPalette::SelectionChangeHandler (const API_Neig* selElemNeig)
 		// 没有选中元素，显示默认文本
 		if (HasInstance()) {
 			PluginPalette& instance = GetInstance();
-			instance.typeValue.SetText("未选择构件");
-			instance.idValue.SetText("未选择构件");
-			instance.typeValue.Redraw();
-			instance.idValue.Redraw();
+			SetTextIfChanged(instance.typeValue, "未选择构件");
+			SetTextIfChanged(instance.idValue, "未选择构件");
 			
 			instance.currentElemGuid = APINULLGuid;
 			
@@ -1698,6 +881,7 @@ GSErrCode PluginPalette::SelectionChangeHandler (const API_Neig* selElemNeig)
 			instance.originalImagePaths.Clear();
 			instance.currentImageIndex = 0;
 			instance.UpdateHBIMImageUI();
+			instance.ResetIFCPropertyTree(APINULLGuid);
 		}
 		return NoError;
 	}
@@ -1712,19 +896,20 @@ GSErrCode PluginPalette::SelectionChangeHandler (const API_Neig* selElemNeig)
 		}
 		instance.currentElemGuid = selElemNeig->guid;
 		
-		GS::UniString ifcType = GetIFCTypeForElement(selElemNeig->guid);
-		GS::UniString globalId = GetGlobalIdForElement(selElemNeig->guid);
+		GS::UniString ifcType = HBIM::GetIFCTypeForElement(selElemNeig->guid);
+		GS::UniString globalId = HBIMGlobalIdIndex::GetGlobalId(selElemNeig->guid);
 		
-		instance.typeValue.SetText(ifcType);
-		instance.idValue.SetText(globalId);
-		instance.typeValue.Redraw();
-		instance.idValue.Redraw();
+		SetTextIfChanged(instance.typeValue, ifcType);
+		SetTextIfChanged(instance.idValue, globalId);
 		
 		// 检查HBIM属性
 		instance.CheckHBIMProperties(selElemNeig->guid);
 		
 		// 检查HBIM图片
 		instance.CheckHBIMImages();
+		
+		// IFC属性树
+		instance.ResetIFCPropertyTree(selElemNeig->guid);
 	}
 
 	return NoError;
@@ -1757,153 +942,145 @@ void PluginPalette::PanelCloseRequested (const DG::PanelCloseRequestEvent& ev, b
 	*accepted = true;
 }
 
-void PluginPalette::UpdateHBIMImageUI ()
+PluginPalette::ImageViewModel PluginPalette::BuildImageViewModel () const
 {
-	// 防止在CheckHBIMImages中重复调用
-	if (isUpdatingImages) {
-		// ACAPI_WriteReport("UpdateHBIMImageUI: 已在CheckHBIMImages中更新，跳过", false);
-		return;
+	ImageViewModel view;
+	const bool hasImages = hasHBIMImages && imagePaths.GetSize() > 0;
+	
+	// 有拍摄时间筛选时只在匹配的图片之间切换
+	UInt32 matchCount = 0;
+	bool canGoPrev = false;
+	bool canGoNext = false;
+	if (hasImages) {
+		for (UInt32 i = 0; i < imagePaths.GetSize(); ++i) {
+			if (!ImageMatchesCaptureFilter(i))
+				continue;
+			++matchCount;
+			canGoPrev = canGoPrev || i < currentImageIndex;
+			canGoNext = canGoNext || i > currentImageIndex;
+		}
 	}
 	
-	// 更新图片计数和当前图片显示（使用 Append 避免 Printf 中文编码问题）
-	if (hasHBIMImages && imagePaths.GetSize() > 0) {
-		// 先清空预览，避免残留上一张图片导致“删除后偶尔显示”的错觉
-		imagePreview.SetPicture(DG::Picture());
-		imagePreview.Redraw();
-		
-		GS::UniString countLabelText;
-		countLabelText.Append("图片数量: ");
-		countLabelText.Append(GS::ValueToUniString(static_cast<Int32>(imagePaths.GetSize())));
-		imageCountLabel.SetText(countLabelText);
-		imageCountLabel.Redraw();
+	// 图片计数和当前图片（使用 Append 避免 Printf 中文编码问题）
+	if (hasImages) {
+		view.countText.Append("图片数量: ");
+		view.countText.Append(GS::ValueToUniString(static_cast<Int32>(imagePaths.GetSize())));
+		if (!captureFilter.IsEmpty()) {
+			view.countText.Append("（筛选 ");
+			view.countText.Append(GS::ValueToUniString(static_cast<Int32>(matchCount)));
+			view.countText.Append("）");
+		}
 		
 		if (currentImageIndex < imagePaths.GetSize()) {
-			GS::UniString currentLabelText;
-			currentLabelText.Append("当前图片: ");
-			currentLabelText.Append(GS::ValueToUniString(static_cast<Int32>(currentImageIndex + 1)));
-			currentLabelText.Append("/");
-			currentLabelText.Append(GS::ValueToUniString(static_cast<Int32>(imagePaths.GetSize())));
-			imageCurrentLabel.SetText(currentLabelText);
-			imageCurrentLabel.Redraw();
-			
-			// 显示当前图片
-			GS::UniString currentImagePath = imagePaths[currentImageIndex];
-			// ACAPI_WriteReport("UpdateHBIMImageUI: 当前图片路径: %s", false, currentImagePath.ToCStr().Get());
-			IO::Location imageLocation = ResolveImagePath(currentImagePath);
+			view.currentText.Append("当前图片: ");
+			view.currentText.Append(GS::ValueToUniString(static_cast<Int32>(currentImageIndex + 1)));
+			view.currentText.Append("/");
+			view.currentText.Append(GS::ValueToUniString(static_cast<Int32>(imagePaths.GetSize())));
+			
+			// 拍摄信息只查索引，不打开图片文件
+			HBIMPhotoMetadata::PhotoInfo photoInfo;
+			if (HBIMPhotoMetadata::Lookup(imagePaths[currentImageIndex], photoInfo)) {
+				view.captureText.Append("拍摄: ");
+				view.captureText.Append(photoInfo.captureTime != 0 ? HBIMPhotoMetadata::FormatCaptureTime(photoInfo.captureTime) : GS::UniString("时间未知"));
+				if (!photoInfo.camera.IsEmpty()) {
+					view.captureText.Append("  ");
+					view.captureText.Append(photoInfo.camera);
+				}
+				if (photoInfo.hasGPS)
+					view.captureText.Append(GS::UniString::Printf("  GPS %.5f, %.5f", photoInfo.latitude, photoInfo.longitude));
+			} else {
+				view.captureText = "拍摄: 无记录";
+			}
 			
-			// 调试：检查解析后的路径
+			IO::Location imageLocation = ResolveImagePath(imagePaths[currentImageIndex]);
 			GS::UniString resolvedPath;
 			imageLocation.ToPath(&resolvedPath);
-			// ACAPI_WriteReport("UpdateHBIMImageUI: 解析后的完整路径: %s (长度=%d)", false, resolvedPath.ToCStr().Get(), resolvedPath.GetLength());
-			
-			// 检查路径是否有效
-			if (resolvedPath.IsEmpty()) {
-				ACAPI_WriteReport("UpdateHBIMImageUI: 错误: ResolveImagePath返回空路径，无法加载图片", false);
-				imagePreview.SetPicture(DG::Picture());
-				imagePreview.Redraw();
-			} else {
-				// 检查文件是否存在
-				bool fileExists = std::filesystem::exists(std::filesystem::path(resolvedPath.ToCStr().Get()));
-				// ACAPI_WriteReport("UpdateHBIMImageUI: 文件存在检查: %s", false, fileExists ? "存在" : "不存在");
-				
-				if (!fileExists) {
-					ACAPI_WriteReport("UpdateHBIMImageUI: 警告: 图片文件不存在: %s", false, resolvedPath.ToCStr().Get());
-					imagePreview.SetPicture(DG::Picture());
-					imagePreview.Redraw();
-				} else {
-					LoadAndDisplayImage(imageLocation, imagePreview);
-					// ACAPI_WriteReport("UpdateHBIMImageUI: LoadAndDisplayImage调用完成", false);
-				}
+			if (!resolvedPath.IsEmpty()) {
+				// 同名文件被替换时修改时间或大小会变化，需重新加载
+				std::error_code ec;
+				const std::filesystem::path fsPath(resolvedPath.ToCStr().Get());
+				const auto writeTime = std::filesystem::last_write_time(fsPath, ec).time_since_epoch().count();
+				const auto fileSize = ec ? 0 : std::filesystem::file_size(fsPath, ec);
+				view.previewKey = resolvedPath;
+				view.previewKey.Append(GS::UniString::Printf("|%lld|%llu", static_cast<long long>(writeTime), static_cast<unsigned long long>(fileSize)));
+				// labelme 标注重新读取后版本变化，需重新绘制叠加
+				view.previewKey.Append(GS::UniString::Printf("|%llu", static_cast<unsigned long long>(HBIMAnnotations::GetRevision(imagePaths[currentImageIndex]))));
+				// HEIC/DNG/TIFF 的派生缩略图生成后改用缩略图
+				GS::UniString derivedPath;
+				if (HBIMImageDerivatives::GetPath(imagePaths[currentImageIndex], HBIMImageDerivatives::Kind::Thumbnail, derivedPath))
+					view.previewKey.Append("|" + derivedPath);
+				view.previewLocation = imageLocation;
+				view.previewRelativePath = imagePaths[currentImageIndex];
 			}
 		} else {
-			ACAPI_WriteReport("UpdateHBIMImageUI: currentImageIndex超出范围", false);
-			imagePreview.SetPicture(DG::Picture());
-			imagePreview.Redraw();
+			view.currentText = "当前图片: 无";
 		}
 	} else {
-		imageCountLabel.SetText("图片数量: 0");
-		imageCurrentLabel.SetText("当前图片: 无");
-		imageCountLabel.Redraw();
-		imageCurrentLabel.Redraw();
-		
-		// 没有图片时显示空图片
-		imagePreview.SetPicture(DG::Picture());
-		imagePreview.Redraw();
+		view.countText = "图片数量: 0";
+		view.currentText = "当前图片: 无";
 	}
 	
-	// 根据编辑模式更新按钮状态
+	view.deleteButton.enabled = false;
+	view.prevButton.enabled = canGoPrev;
+	view.nextButton.enabled = canGoNext;
+	view.okButton.text = "确定";
+	view.cancelButton.text = "取消";
+	view.labelmeButton.text = "启动labelme";
+	
 	if (isImageEditMode) {
-		// 编辑模式：显示确定、取消、添加图片按钮
-		imageSelectButton.SetText("添加图片");
-		imageSelectButton.Show();
-		imageOKButton.Show();
-		imageCancelButton.Show();
-		
-		// 在编辑模式下启用删除、导航、添加按钮
-		if (hasHBIMImages && imagePaths.GetSize() > 0) {
-			imageDeleteButton.Enable();
-			imagePrevButton.Enable();
-			imageNextButton.Enable();
-			launchLabelmeButton.SetText("启动labelme");
-			launchLabelmeButton.Show();
-			launchLabelmeButton.Enable();
-			
-			if (currentImageIndex == 0) {
-				imagePrevButton.Disable();
-			}
-			if (currentImageIndex >= imagePaths.GetSize() - 1) {
-				imageNextButton.Disable();
-			}
-		} else {
-			imageDeleteButton.Disable();
-			imagePrevButton.Disable();
-			imageNextButton.Disable();
-			launchLabelmeButton.Hide();
-		}
+		// 编辑模式：显示确定、取消、添加图片按钮；有图片时可删除和启动labelme
+		view.selectButton.text = "添加图片";
+		view.deleteButton.enabled = hasImages;
+		view.labelmeButton.visible = hasImages;
 	} else {
-		// 非编辑模式：显示选择/编辑按钮，隐藏确定、取消和启动labelme按钮
-		imageSelectButton.Show();
-		imageOKButton.Hide();
-		imageCancelButton.Hide();
-		launchLabelmeButton.Hide();
-		
-		// 根据是否有图片更新选择按钮文本
-		if (hasHBIMImages && imagePaths.GetSize() > 0) {
-			imageSelectButton.SetText("编辑");
-			
-			// 非编辑模式：允许上一张/下一张浏览，但禁止删除
-			imageDeleteButton.Disable();
-			imagePrevButton.Enable();
-			imageNextButton.Enable();
-			if (currentImageIndex == 0) {
-				imagePrevButton.Disable();
-			}
-			if (currentImageIndex >= imagePaths.GetSize() - 1) {
-				imageNextButton.Disable();
-			}
+		// 非编辑模式：允许上一张/下一张浏览，但禁止删除；隐藏确定、取消和启动labelme按钮
+		view.selectButton.text = hasImages ? "编辑" : "附着图片";
+		view.okButton.visible = false;
+		view.cancelButton.visible = false;
+		view.labelmeButton.visible = false;
+	}
+	return view;
+}
+
+void PluginPalette::UpdateHBIMImageUI ()
+{
+	// 防止在CheckHBIMImages中重复调用
+	if (isUpdatingImages) {
+		// ACAPI_WriteReport("UpdateHBIMImageUI: 已在CheckHBIMImages中更新，跳过", false);
+		return;
+	}
+	
+	const ImageViewModel view = BuildImageViewModel();
+	const ImageViewModel* prev = hasLastImageView ? &lastImageView : nullptr;
+	
+	if (prev == nullptr || prev->countText != view.countText)
+		SetTextIfChanged(imageCountLabel, view.countText);
+	if (prev == nullptr || prev->currentText != view.currentText)
+		SetTextIfChanged(imageCurrentLabel, view.currentText);
+	if (prev == nullptr || prev->captureText != view.captureText)
+		SetTextIfChanged(imageCaptureInfo, view.captureText);
+	
+	ApplyItemState(imageSelectButton, view.selectButton, prev ? &prev->selectButton : nullptr);
+	ApplyItemState(imageDeleteButton, view.deleteButton, prev ? &prev->deleteButton : nullptr);
+	ApplyItemState(imagePrevButton, view.prevButton, prev ? &prev->prevButton : nullptr);
+	ApplyItemState(imageNextButton, view.nextButton, prev ? &prev->nextButton : nullptr);
+	ApplyItemState(imageOKButton, view.okButton, prev ? &prev->okButton : nullptr);
+	ApplyItemState(imageCancelButton, view.cancelButton, prev ? &prev->cancelButton : nullptr);
+	ApplyItemState(launchLabelmeButton, view.labelmeButton, prev ? &prev->labelmeButton : nullptr);
+	
+	// 预览：同一文件且标注未变时不重新解码和重绘
+	if (prev == nullptr || prev->previewKey != view.previewKey) {
+		if (view.previewKey.IsEmpty()) {
+			HBIMPreviewCache::Cancel();
+			imagePreview.SetPicture(DG::Picture());
+			imagePreview.Redraw();
 		} else {
-			imageSelectButton.SetText("附着图片");
-			
-			imageDeleteButton.Disable();
-			imagePrevButton.Disable();
-			imageNextButton.Disable();
+			LoadAndDisplayImage(view.previewLocation, view.previewRelativePath, imagePreview);
 		}
 	}
 	
-	// 重绘所有控件
-	imageCountLabel.Redraw();
-	imageCurrentLabel.Redraw();
-	imageSelectButton.Redraw();
-	imageDeleteButton.Redraw();
-	imagePrevButton.Redraw();
-	imageNextButton.Redraw();
-	imageOKButton.Redraw();
-	imageCancelButton.Redraw();
-	launchLabelmeButton.Redraw();
-	imagePreview.Redraw();
-	
-	// 强制重绘整个面板以确保UI更新
-	Redraw();
+	lastImageView = view;
+	hasLastImageView = true;
 }
 
 void PluginPalette::EnterImageEditMode ()
@@ -1915,6 +1092,7 @@ void PluginPalette::EnterImageEditMode ()
 	
 	// 保存原始图片路径用于取消编辑时恢复
 	originalImagePaths = imagePaths;
+	HBIMImageEditJournal::BeginSession(currentElemGuid, originalImagePaths);
 	
 	// 进入编辑模式
 	isImageEditMode = true;
@@ -1936,42 +1114,20 @@ void PluginPalette::ExitImageEditMode (bool save)
 	if (save) {
 		// 保存更改：将当前图片路径保存到属性
 		if (currentElemGuid != APINULLGuid) {
-			// 确保HBIM图片属性组和定义存在
-			API_Guid imageGroupGuid, imageLinksGuid;
-			GSErrCode err = ACAPI_CallUndoableCommand("创建HBIM图片属性定义",
+			// 在撤销命令中写入当前存储后端（属性或项目数据）；没有图片时写入空列表
+			GSErrCode err = ACAPI_CallUndoableCommand("保存HBIM图片链接属性",
 				[&]() -> GSErrCode {
-					return EnsureHBIMImagePropertyGroupAndDefinitions(imageGroupGuid, imageLinksGuid);
+					GSErrCode writeErr = HBIMImageStore::GetActiveStorage().Write(currentElemGuid, imagePaths);
+					if (writeErr == NoError)
+						HBIMStatusOverlay::UpdateStatuses({ currentElemGuid });
+					return writeErr;
 				}
 			);
-			if (err == NoError) {
-				// 构建JSON数组保存到属性
-				if (imagePaths.GetSize() > 0) {
-					GS::UniString jsonArray = "[";
-					for (UInt32 i = 0; i < imagePaths.GetSize(); i++) {
-						if (i > 0) jsonArray.Append(",");
-						jsonArray.Append("\"");
-						jsonArray.Append(imagePaths[i]);
-						jsonArray.Append("\"");
-					}
-					jsonArray.Append("]");
-					
-					// 保存到属性（在撤销命令中）
-					err = ACAPI_CallUndoableCommand("保存HBIM图片链接属性",
-						[&]() -> GSErrCode {
-							return SetHBIMImageLinksPropertyValue(currentElemGuid, imageLinksGuid, jsonArray);
-						}
-					);
-					if (err != NoError) {
-						DG::InformationAlert("警告", "无法保存图片链接到属性", "确定");
-					}
-				} else {
-					// 如果没有图片，保存空数组（在撤销命令中）
-					ACAPI_CallUndoableCommand("保存HBIM图片链接属性",
-						[&]() -> GSErrCode {
-							return SetHBIMImageLinksPropertyValue(currentElemGuid, imageLinksGuid, "[]");
-						}
-					);
-				}
+			if (err != NoError) {
+				DG::InformationAlert("警告", "无法保存图片链接到属性", "确定");
+			} else {
+				// 保存失败时不提交，日志留待下次会话开始或打开项目时按属性恢复
+				HBIMImageEditJournal::Commit();
 				
 				// 更新状态
 				hasHBIMImages = (imagePaths.GetSize() > 0);
@@ -1987,9 +1143,10 @@ void PluginPalette::ExitImageEditMode (bool save)
 				if (imagePaths[i] == originalImagePaths[j]) { wasOriginal = true; break; }
 			}
 			if (!wasOriginal) {
-				DeleteImageFileFromDisk(imagePaths[i]);
+				HBIMImageTombstones::Add(currentElemGuid, imagePaths[i], false);
 			}
 		}
+		HBIMImageEditJournal::Abort();
 		imagePaths = originalImagePaths;
 		hasHBIMImages = (imagePaths.GetSize() > 0);
 		currentImageIndex = 0;
@@ -2031,62 +1188,15 @@ void PluginPalette::CheckHBIMImages ()
 		return;
 	}
 	
-	API_Guid imageGroupGuid, imageLinksGuid;
-	// 新建项目时属性组可能不存在，需在撤销作用域内创建（APIERR_NEEDSUNDOSCOPE）
-	GSErrCode err = ACAPI_CallUndoableCommand("初始化HBIM构件图片属性",
-		[&imageGroupGuid, &imageLinksGuid]() -> GSErrCode {
-			return EnsureHBIMImagePropertyGroupAndDefinitions(imageGroupGuid, imageLinksGuid);
-		}
-	);
-	
-	if (err != NoError) {
-		ACAPI_WriteReport("CheckHBIMImages: 获取/创建属性组失败，错误码=%d", false, err);
-		isUpdatingImages = false;
-		UpdateHBIMImageUI();
-		return;
-	}
-	
-	GS::UniString imageLinksJson;
-	err = GetHBIMImageLinksPropertyValue(currentElemGuid, imageLinksGuid, imageLinksJson);
-	
-	if (err != NoError || imageLinksJson == "[]" || imageLinksJson.GetLength() <= 2) {
-		ACAPI_WriteReport("CheckHBIMImages: 读取属性失败或为空，错误码=%d，内容='%s'", 
-			false, err, imageLinksJson.ToCStr().Get());
+	GSErrCode err = HBIMImageStore::GetActiveStorage().Read(currentElemGuid, imagePaths);
+	if (err != NoError || imagePaths.IsEmpty()) {
+		ACAPI_WriteReport("CheckHBIMImages: 读取图片链接失败或为空，错误码=%d", false, err);
+		imagePaths.Clear();
 		isUpdatingImages = false;
 		UpdateHBIMImageUI();
 		return;
 	}
 	
-	// 解析 JSON 数组 - 简单手动解析
-	GS::UniString trimmed = imageLinksJson;
-	trimmed.DeleteFirst();
-	trimmed.DeleteLast();
-	
-	// 手动解析逗号分隔的带引号的字符串
-	UInt32 startPos = 0;
-	int parsedCount = 0;
-	while (startPos < trimmed.GetLength()) {
-		// 查找引号开始位置
-		UIndex quoteStart = trimmed.FindFirst('"', startPos);
-		if (quoteStart == MaxUIndex) break;
-		
-		// 查找引号结束位置
-		UIndex quoteEnd = trimmed.FindFirst('"', quoteStart + 1);
-		if (quoteEnd == MaxUIndex) break;
-		
-		// 提取引号内的内容（GetSubstring第二参数是长度length，不是end索引）
-		USize pathLen = (quoteEnd > quoteStart + 1) ? (quoteEnd - quoteStart - 1) : 0;
-		GS::UniString path = trimmed.GetSubstring(quoteStart + 1, pathLen);
-		if (!path.IsEmpty()) {
-			imagePaths.Push(path);
-			parsedCount++;
-		}
-		
-		startPos = quoteEnd + 1;
-	}
-	
-	(void)parsedCount;
-	
 	// 更新状态
 	hasHBIMImages = (imagePaths.GetSize() > 0);
 	// 仅在无图片时重置索引；有图片时保持 currentImageIndex（避免点击预览触发刷新后跳回第一张），超界时夹紧
@@ -2113,10 +1223,21 @@ void PluginPalette::SelectHBIMImages ()
 	FTM::FileTypeManager mgr("HBIMComponentEntryImages");
 	FTM::FileType typeJpg("JPEG", "jpg", 0, 0, 0);
 	FTM::FileType typePng("PNG", "png", 0, 0, 0);
+	// 手机与相机的原始格式：原样保存，另在后台生成 JPEG 派生图供预览
+	FTM::FileType typeHeic("HEIC", "heic", 0, 0, 0);
+	FTM::FileType typeHeif("HEIF", "heif", 0, 0, 0);
+	FTM::FileType typeDng("DNG", "dng", 0, 0, 0);
+	FTM::FileType typeTiff("TIFF", "tiff", 0, 0, 0);
+	FTM::FileType typeTif("TIFF", "tif", 0, 0, 0);
 	FTM::TypeID idJpg = mgr.AddType(typeJpg);
 	FTM::TypeID idPng = mgr.AddType(typePng);
 	dlg.AddFilter(idJpg);
 	dlg.AddFilter(idPng);
+	dlg.AddFilter(mgr.AddType(typeHeic));
+	dlg.AddFilter(mgr.AddType(typeHeif));
+	dlg.AddFilter(mgr.AddType(typeDng));
+	dlg.AddFilter(mgr.AddType(typeTiff));
+	dlg.AddFilter(mgr.AddType(typeTif));
 	dlg.SetTitle("选择HBIM构件图片");
 	
 	ACAPI_WriteReport("SelectHBIMImages: 调用文件对话框", false);
@@ -2138,8 +1259,8 @@ void PluginPalette::SelectHBIMImages ()
 		ACAPI_WriteReport("SelectHBIMImages: 进度: 图片文件夹检查通过，正在获取构件信息...", false);
 		
 		// 获取构件GlobalId
-		ACAPI_WriteReport("SelectHBIMImages: 调用GetGlobalIdForElement", false);
-		GS::UniString globalId = GetGlobalIdForElement(currentElemGuid);
+		ACAPI_WriteReport("SelectHBIMImages: 查询GlobalId索引", false);
+		GS::UniString globalId = HBIMGlobalIdIndex::GetGlobalId(currentElemGuid);
 		ACAPI_WriteReport("SelectHBIMImages: globalId='%s'(长度=%d), projectHash='%s'(长度=%d)", false, 
 						globalId.ToCStr().Get(), globalId.GetLength(), 
 						projectHash.ToCStr().Get(), projectHash.GetLength());
@@ -2151,49 +1272,25 @@ void PluginPalette::SelectHBIMImages ()
 		ACAPI_WriteReport("SelectHBIMImages: GlobalId获取成功", false);
 		ACAPI_WriteReport("SelectHBIMImages: 进度: 构件GlobalId获取成功: %s", false, globalId.ToCStr().Get());
 		
-		// 确保HBIM图片属性组和定义存在
-		API_Guid imageGroupGuid, imageLinksGuid;
-		err = ACAPI_CallUndoableCommand("创建HBIM图片属性定义",
-			[&]() -> GSErrCode {
-				return EnsureHBIMImagePropertyGroupAndDefinitions(imageGroupGuid, imageLinksGuid);
-			}
-		);
-		if (err != NoError) {
-			DG::InformationAlert("错误", GS::UniString::Printf("无法创建图片属性定义 (错误码: %d)", err).ToCStr().Get(), "确定");
-			return;
-		}
-		ACAPI_WriteReport("SelectHBIMImages: 进度: 图片属性定义创建成功", false);
-		
-		// 确定现有图片路径的基准：编辑模式下用当前imagePaths，否则从属性读取
+		// 确定现有图片路径的基准：编辑模式下用当前imagePaths，否则从存储读取
 		GS::Array<GS::UniString> existingImagePaths;
 		if (isImageEditMode) {
 			existingImagePaths = imagePaths;  // 编辑模式：保留当前状态（含本回合删除等）
 		} else {
-			GS::UniString existingImageLinksJson;
-			GetHBIMImageLinksPropertyValue(currentElemGuid, imageLinksGuid, existingImageLinksJson);
-			if (existingImageLinksJson != "[]" && existingImageLinksJson.GetLength() > 2) {
-				GS::UniString trimmed = existingImageLinksJson;
-				trimmed.DeleteFirst();
-				trimmed.DeleteLast();
-				UInt32 startPos = 0;
-				while (startPos < trimmed.GetLength()) {
-					UIndex quoteStart = trimmed.FindFirst('"', startPos);
-					if (quoteStart == MaxUIndex) break;
-					UIndex quoteEnd = trimmed.FindFirst('"', quoteStart + 1);
-					if (quoteEnd == MaxUIndex) break;
-					USize pathLen = (quoteEnd > quoteStart + 1) ? (quoteEnd - quoteStart - 1) : 0;
-					GS::UniString path = trimmed.GetSubstring(quoteStart + 1, pathLen);
-					if (!path.IsEmpty()) {
-						existingImagePaths.Push(path);
-					}
-					startPos = quoteEnd + 1;
-				}
-			}
+			HBIMImageStore::GetActiveStorage().Read(currentElemGuid, existingImagePaths);
 		}
 		
 		imagePaths = existingImagePaths;
 		
+		// 复制前进入编辑模式，使原始路径不含本次新增的文件，并开始写入编辑日志
+		bool enteredEditMode = false;
+		if (!isImageEditMode) {
+			EnterImageEditMode();
+			enteredEditMode = true;
+		}
+		
 		// 获取选中的文件并复制到项目文件夹
+		GS::Array<GS::UniString> importedPaths;
 		ACAPI_WriteReport("SelectHBIMImages: 获取文件选择数量", false);
 		USize n = dlg.GetSelectionCount();
 		ACAPI_WriteReport("SelectHBIMImages: 选择了 %d 个文件", false, n);
@@ -2238,7 +1335,7 @@ void PluginPalette::SelectHBIMImages ()
 			
 			// 构建目标文件夹路径：HBIM_Images_{projectHash}/{elementGlobalId}/
 			// 清理globalId用于文件路径
-			GS::UniString cleanGlobalId = SanitizeForFilePath(globalId);
+			GS::UniString cleanGlobalId = HBIM::SanitizeForFilePath(globalId);
 			
 			// 调试：显示清理后的globalId
 			ACAPI_WriteReport("SelectHBIMImages: 调试: globalId清理后: cleanGlobalId='%s' (长度=%d)", false, 
@@ -2250,7 +1347,7 @@ void PluginPalette::SelectHBIMImages ()
 			}
 			
 			// 验证projectHash格式
-			if (!IsValidUUIDFormat(projectHash) && projectHash != "unsaved_project" && projectHash != "unknown") {
+			if (!HBIMProject::IsValidUUIDFormat(projectHash) && projectHash != "unsaved_project" && projectHash != "unknown") {
 				ACAPI_WriteReport("SelectHBIMImages: 警告: projectHash格式异常: %s", true, projectHash.ToCStr().Get());
 			}
 			
@@ -2259,7 +1356,7 @@ void PluginPalette::SelectHBIMImages ()
 			ACAPI_WriteReport("SelectHBIMImages: 调试: projectHash清理前: 原始='%s' (长度=%d)", false, 
 					projectHash.ToCStr().Get(), projectHash.GetLength());
 			
-			GS::UniString cleanProjectHash = SanitizeForFilePath(projectHash);
+			GS::UniString cleanProjectHash = HBIM::SanitizeForFilePath(projectHash);
 			
 			// 调试：显示清理后的projectHash
 			ACAPI_WriteReport("SelectHBIMImages: 调试: projectHash清理后: cleanProjectHash='%s' (长度=%d)", false, 
@@ -2319,44 +1416,18 @@ void PluginPalette::SelectHBIMImages ()
 			ACAPI_WriteReport("SelectHBIMImages: destFolderName='%s' (长度=%d)", false, 
 							destFolderName.ToCStr().Get(), destFolderName.GetLength());
 			
-			// 构建项目文件夹路径
-			// 调试：开始检查项目保存状态
-			// DG::InformationAlert("调试", "正在检查项目保存状态...", "确定");
-			
-			API_ProjectInfo projectInfo;
-			GSErrCode projectErr = ACAPI_ProjectOperation_Project(&projectInfo);
-			
-			// 调试：显示项目检查结果
-			// DG::InformationAlert("调试", 
-			// 	GS::UniString::Printf("项目检查结果: 错误码=%d, untitled=%d", 
-			// 		projectErr, projectInfo.untitled ? 1 : 0).ToCStr().Get(), "确定");
-			
-			if (projectErr != NoError || projectInfo.untitled) {
+			// 项目目录来自缓存的项目上下文
+			const HBIMProject::Context& context = HBIMProject::GetContext();
+			if (!context.isSaved) {
 				DG::InformationAlert("错误", "项目未保存，无法复制图片", "确定");
 				return;
 			}
-
-			// 调试：在获取项目路径前检查location是否为空
-			// DG::InformationAlert("调试", 
-			// 	GS::UniString::Printf("projectInfo.location指针检查: %s", 
-			// 		projectInfo.location ? "非空" : "为空NULL!").ToCStr().Get(), "确定");
-			
-			IO::Location projectLocation = *projectInfo.location;
-			GS::UniString projectFilePath;
-			projectLocation.ToPath(&projectFilePath);
-			
-			// DG::InformationAlert("调试", 
-			// 	GS::UniString::Printf("项目文件路径获取成功: '%s' (长度=%d)", 
-			// 		projectFilePath.ToCStr().Get(), projectFilePath.GetLength()).ToCStr().Get(), "确定");
 			
-			ACAPI_WriteReport("SelectHBIMImages: 项目文件路径='%s'", false, projectFilePath.ToCStr().Get());
+			ACAPI_WriteReport("SelectHBIMImages: 项目文件路径='%s'", false, context.projectPath.ToCStr().Get());
 			ACAPI_WriteReport("SelectHBIMImages: destFolderName='%s', projectHash='%s', globalId='%s'", false, 
 							destFolderName.ToCStr().Get(), projectHash.ToCStr().Get(), globalId.ToCStr().Get());
 			
-			// 使用与EnsureHBIMImageFolder相同的逻辑构建目标文件夹路径
-			// 获取项目文件所在目录（父目录）
-			std::filesystem::path projectFsPath(projectFilePath.ToCStr().Get());
-			std::filesystem::path projectDirPath = projectFsPath.parent_path();
+			const std::filesystem::path& projectDirPath = context.projectDir;
 			ACAPI_WriteReport("SelectHBIMImages: 项目目录='%s'", false, projectDirPath.string().c_str());
 			// 改用 std::string 解析路径，避免 GS::UniString API 问题
 			std::string destFolderNameStr(destFolderName.ToCStr().Get());
@@ -2383,6 +1454,8 @@ void PluginPalette::SelectHBIMImages ()
 			// 复制文件到目标文件夹
 			GS::UniString destPath;
 			GS::UniString copyError;
+			GS::UniString plannedRelativePath = destFolderName + "/" + newFileName;
+			HBIMImageEditJournal::LogAdd(plannedRelativePath);
 			bool copyResult = CopyFileToDestination(sourcePath, destFolderLocation, newFileName, destPath, &copyError);
 			ACAPI_WriteReport("SelectHBIMImages: CopyFileToDestination返回: %s", false, copyResult ? "成功" : "失败");
 			if (copyResult) {
@@ -2393,6 +1466,7 @@ void PluginPalette::SelectHBIMImages ()
 				relativePath.Append(newFileName);
 				ACAPI_WriteReport("SelectHBIMImages: relativePath='%s'", false, relativePath.ToCStr().Get());
 				imagePaths.Push(relativePath);
+				importedPaths.Push(relativePath);
 				ACAPI_WriteReport("SelectHBIMImages: 已添加到imagePaths，当前数量: %d", false, imagePaths.GetSize());
 			} else {
 				ACAPI_WriteReport("SelectHBIMImages: 文件复制失败", true);
@@ -2401,8 +1475,17 @@ void PluginPalette::SelectHBIMImages ()
 		}
 		
 		// 选择完成后：若未在编辑模式则进入编辑模式（流程1：选择→复制→进入编辑→确定才保存）
-		if (!isImageEditMode && imagePaths.GetSize() > 0) {
-			EnterImageEditMode();
+		// 整批导入只 fsync 一次
+		HBIMImageEditJournal::Sync();
+		
+		// 读取新图片的拍摄信息写入索引（只读文件头，并行）
+		HBIMPhotoMetadata::IndexFiles(importedPaths);
+		
+		// HEIC/DNG/TIFF 在后台转码出 JPEG 派生图，不等待
+		HBIMImageDerivatives::Enqueue(importedPaths);
+		
+		if (enteredEditMode && imagePaths.GetSize() == 0) {
+			ExitImageEditMode(false);
 		}
 		// 不在此处保存到属性，统一在用户点击「确定」时由 ExitImageEditMode 保存
 		
@@ -2428,39 +1511,26 @@ void PluginPalette::DeleteCurrentHBIMImage ()
 		return;
 	}
 	
-	// 先删除磁盘上的文件，再移除链接
+	// 文件先记入墓碑日志，保存后确认无引用再删除（撤销删除或取消编辑后链接仍有效）
 	GS::UniString pathToDelete = imagePaths[currentImageIndex];
-	DeleteImageFileFromDisk(pathToDelete);
+	HBIMImageTombstones::Add(currentElemGuid, pathToDelete, true);
+	if (isImageEditMode) {
+		HBIMImageEditJournal::LogRemove(pathToDelete);
+	}
 	
 	imagePaths.Delete(currentImageIndex);
 	
 	// 根据是否在编辑模式决定是否保存到属性
 	if (!isImageEditMode) {
-		// 不在编辑模式：直接保存到属性
-		API_Guid imageGroupGuid, imageLinksGuid;
-		GSErrCode err = ACAPI_CallUndoableCommand("创建HBIM图片属性定义",
+		// 不在编辑模式：直接保存（在撤销命令中）
+		ACAPI_CallUndoableCommand("保存HBIM图片链接属性",
 			[&]() -> GSErrCode {
-				return EnsureHBIMImagePropertyGroupAndDefinitions(imageGroupGuid, imageLinksGuid);
+				GSErrCode writeErr = HBIMImageStore::GetActiveStorage().Write(currentElemGuid, imagePaths);
+				if (writeErr == NoError)
+					HBIMStatusOverlay::UpdateStatuses({ currentElemGuid });
+				return writeErr;
 			}
 		);
-		if (err == NoError) {
-			// 构建更新后的JSON数组
-			GS::UniString jsonArray = "[";
-			for (UInt32 i = 0; i < imagePaths.GetSize(); i++) {
-				if (i > 0) jsonArray.Append(",");
-				jsonArray.Append("\"");
-				jsonArray.Append(imagePaths[i]);
-				jsonArray.Append("\"");
-			}
-			jsonArray.Append("]");
-			
-			// 保存到属性（在撤销命令中）
-			ACAPI_CallUndoableCommand("保存HBIM图片链接属性",
-				[&]() -> GSErrCode {
-					return SetHBIMImageLinksPropertyValue(currentElemGuid, imageLinksGuid, jsonArray);
-				}
-			);
-		}
 	}
 	// 在编辑模式下，不保存到属性，等待用户点击确定
 	
@@ -2484,54 +1554,73 @@ void PluginPalette::NavigateHBIMImage (bool forward)
 		return;
 	}
 	
+	// 跳过不符合拍摄时间筛选的图片
 	if (forward) {
-		if (currentImageIndex < imagePaths.GetSize() - 1) {
-			currentImageIndex++;
+		for (UInt32 i = currentImageIndex + 1; i < imagePaths.GetSize(); ++i) {
+			if (ImageMatchesCaptureFilter(i)) {
+				currentImageIndex = i;
+				break;
+			}
 		}
 	} else {
-		if (currentImageIndex > 0) {
-			currentImageIndex--;
+		for (UInt32 i = currentImageIndex; i > 0; --i) {
+			if (ImageMatchesCaptureFilter(i - 1)) {
+				currentImageIndex = i - 1;
+				break;
+			}
 		}
 	}
 	
 	UpdateHBIMImageUI();
 }
 
-GSErrCode PluginPalette::EnsureHBIMImageFolder ()
+bool PluginPalette::ImageMatchesCaptureFilter (UInt32 index) const
 {
-	// 获取项目信息
-	API_ProjectInfo projectInfo;
-	GSErrCode err = ACAPI_ProjectOperation_Project(&projectInfo);
-	if (err != NoError) {
-		ACAPI_WriteReport("EnsureHBIMImageFolder: 获取项目信息失败", true);
-		return err;
+	if (captureFilter.IsEmpty())
+		return true;
+	if (index >= imagePaths.GetSize())
+		return false;
+	HBIMPhotoMetadata::PhotoInfo photoInfo;
+	if (!HBIMPhotoMetadata::Lookup(imagePaths[index], photoInfo))
+		return false;
+	return HBIMPhotoMetadata::MatchesCaptureFilter(photoInfo.captureTime, captureFilter);
+}
+
+void PluginPalette::TextEditChanged (const DG::TextEditChangeEvent& ev)
+{
+	if (ev.GetSource() != &captureFilterEdit)
+		return;
+	captureFilter = captureFilterEdit.GetText();
+	captureFilter.Trim();
+	
+	// 当前图片不符合新筛选时跳到第一张符合的
+	if (!ImageMatchesCaptureFilter(currentImageIndex)) {
+		for (UInt32 i = 0; i < imagePaths.GetSize(); ++i) {
+			if (ImageMatchesCaptureFilter(i)) {
+				currentImageIndex = i;
+				break;
+			}
+		}
 	}
+	UpdateHBIMImageUI();
+}
+
+GSErrCode PluginPalette::EnsureHBIMImageFolder ()
+{
+	const HBIMProject::Context& context = HBIMProject::GetContext();
 	
-	// 计算项目哈希（用于唯一标识项目）
-	projectHash = CalculateProjectHash();
+	// 项目哈希（用于唯一标识项目）
+	projectHash = context.projectHash;
 	ACAPI_WriteReport("EnsureHBIMImageFolder: projectHash='%s'", false, projectHash.ToCStr().Get());
 	
 	// 检查项目是否已保存
-	if (projectInfo.untitled) {
+	if (!context.isSaved) {
 		ACAPI_WriteReport("EnsureHBIMImageFolder: 项目未保存，无法创建图片文件夹", false);
 		return APIERR_GENERAL;
 	}
 	
-	// 获取项目文件夹路径
-	IO::Location projectLocation = *projectInfo.location;
-	GS::UniString projectPath;
-	projectLocation.ToPath(&projectPath);
-	
-	ACAPI_WriteReport("EnsureHBIMImageFolder: 项目文件路径='%s'", false, projectPath.ToCStr().Get());
-	
-	// 使用std::filesystem获取项目文件所在目录
-	std::filesystem::path projectFilePath(projectPath.ToCStr().Get());
-	std::filesystem::path projectDirPath = projectFilePath.parent_path();
-	
-	// 创建HBIM_Images_{projectHash}文件夹
-	GS::UniString hbimImagesPath = GS::UniString(projectDirPath.string().c_str());
-	hbimImagesPath.Append("/HBIM_Images_");
-	hbimImagesPath.Append(projectHash);
+	// HBIM_Images_{projectHash}文件夹
+	GS::UniString hbimImagesPath = GS::UniString(context.imageRoot.string().c_str());
 	
 	ACAPI_WriteReport("EnsureHBIMImageFolder: 目标文件夹路径='%s'", false, hbimImagesPath.ToCStr().Get());
 	
@@ -2555,312 +1644,14 @@ GSErrCode PluginPalette::EnsureHBIMImageFolder ()
 	return NoError;
 }
 
-namespace {
-	// 生成随机UUID字符串 (格式: xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx)
-	static GS::UniString GenerateUUID()
-	{
-		std::random_device rd;
-		std::mt19937 gen(rd());
-		std::uniform_int_distribution<> dis(0, 15);
-		
-		const char* hexChars = "0123456789ABCDEF";
-		char uuid[37];
-		
-		// 生成32个十六进制字符
-		for (int i = 0; i < 32; i++) {
-			uuid[i] = hexChars[dis(gen)];
-		}
-		
-		// 直接构建格式化字符串：xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx
-		char formatted[37];
-		// 第一部分：8个字符
-		std::memcpy(formatted, uuid, 8);
-		formatted[8] = '-';
-		// 第二部分：4个字符
-		std::memcpy(formatted + 9, uuid + 8, 4);
-		formatted[13] = '-';
-		// 第三部分：4个字符
-		std::memcpy(formatted + 14, uuid + 12, 4);
-		formatted[18] = '-';
-		// 第四部分：4个字符
-		std::memcpy(formatted + 19, uuid + 16, 4);
-		formatted[23] = '-';
-		// 第五部分：12个字符
-		std::memcpy(formatted + 24, uuid + 20, 12);
-		formatted[36] = '\0';
-		
-		return GS::UniString(formatted);
-	}
-	
-	// 获取当前项目文件完整路径（用于区分不同项目）
-	static GS::UniString GetCurrentProjectPath()
-	{
-		API_ProjectInfo projectInfo;
-		if (ACAPI_ProjectOperation_Project(&projectInfo) != NoError || projectInfo.untitled || !projectInfo.location)
-			return GS::UniString();
-		GS::UniString path;
-		projectInfo.location->ToPath(&path);
-		return path;
-	}
-	
-	// Preferences 版本2：存储 uuid + path，用于检测"另存为"副本
-	// 数据格式: [version=2][uuidLen][uuid][pathLen][path]
-	const Int32 kPreferencesVersionV2 = 2;
-	static const size_t kMaxPrefDataSize = 600;
-	
-	static bool ReadProjectMappingFromPreferences(GS::UniString& outUuid, GS::UniString& outPath)
-	{
-		Int32 version = 0;
-		GSSize bytes = 0;
-		GSErrCode err = ACAPI_GetPreferences(&version, &bytes, nullptr);
-		if (err != NoError || version != kPreferencesVersionV2 || bytes < 8 || bytes > kMaxPrefDataSize)
-			return false;
-		char* data = new char[bytes];
-		err = ACAPI_GetPreferences(&version, &bytes, data);
-		if (err != NoError) {
-			delete[] data;
-			return false;
-		}
-		Int32 uuidLen = *reinterpret_cast<Int32*>(data);
-		if (uuidLen <= 0 || uuidLen > 40 || bytes < 8 + uuidLen) {
-			delete[] data;
-			return false;
-		}
-		outUuid = GS::UniString(data + 4, uuidLen);
-		Int32 pathLen = *reinterpret_cast<Int32*>(data + 4 + uuidLen);
-		if (pathLen < 0 || pathLen > 400 || bytes < 8 + uuidLen + pathLen) {
-			delete[] data;
-			return false;
-		}
-		if (pathLen > 0)
-			outPath = GS::UniString(data + 8 + uuidLen, pathLen);
-		delete[] data;
-		return true;
-	}
-	
-	static GSErrCode SaveProjectMappingToPreferences(const GS::UniString& uuid, const GS::UniString& path)
-	{
-		Int32 uuidLen = static_cast<Int32>(uuid.GetLength());
-		Int32 pathLen = static_cast<Int32>(path.GetLength());
-		if (8 + uuidLen + pathLen > static_cast<GSSize>(kMaxPrefDataSize))
-			return APIERR_GENERAL;
-		char data[kMaxPrefDataSize];
-		*reinterpret_cast<Int32*>(data) = uuidLen;
-		std::memcpy(data + 4, uuid.ToCStr().Get(), uuidLen);
-		*reinterpret_cast<Int32*>(data + 4 + uuidLen) = pathLen;
-		if (pathLen > 0)
-			std::memcpy(data + 8 + uuidLen, path.ToCStr().Get(), pathLen);
-		return ACAPI_SetPreferences(kPreferencesVersionV2, 8 + uuidLen + pathLen, data);
-	}
-	
-	// 从项目信息读取项目UUID (使用keywords字段)
-	static GS::UniString ReadProjectUUIDFromProjectNotes()
-	{
-		API_ProjectNoteInfo projectNotes;
-		std::memset(&projectNotes, 0, sizeof(API_ProjectNoteInfo));
-		
-		GSErrCode err = ACAPI_ProjectSetting_GetProjectNotes(&projectNotes);
-		if (err != NoError) {
-			return GS::UniString();
-		}
-		
-		// 在keywords字段中查找UUID (格式: "HBIM_UUID=xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx")
-		const char* keywords = projectNotes.keywords;
-		const char* uuidPrefix = "HBIM_UUID=";
-		size_t prefixLen = std::strlen(uuidPrefix);
-		
-		if (std::strncmp(keywords, uuidPrefix, prefixLen) == 0) {
-			return GS::UniString(keywords + prefixLen);
-		}
-		
-		return GS::UniString();
-	}
-	
-	// 保存项目UUID到项目信息 (使用keywords字段)
-	static GSErrCode SaveProjectUUIDToProjectNotes(const GS::UniString& uuid)
-	{
-		API_ProjectNoteInfo projectNotes;
-		std::memset(&projectNotes, 0, sizeof(API_ProjectNoteInfo));
-		
-		// 先读取现有项目信息
-		GSErrCode err = ACAPI_ProjectSetting_GetProjectNotes(&projectNotes);
-		if (err != NoError) {
-			return err;
-		}
-		
-		// 准备keywords字符串: 保留原有内容，添加HBIM_UUID
-		char newKeywords[256];
-		std::string uuidStr = std::string(uuid.ToCStr().Get());
-		std::snprintf(newKeywords, sizeof(newKeywords), "HBIM_UUID=%s", uuidStr.c_str());
-		
-		// 复制回结构体
-		std::strncpy(projectNotes.keywords, newKeywords, sizeof(projectNotes.keywords) - 1);
-		projectNotes.keywords[sizeof(projectNotes.keywords) - 1] = '\0';
-		
-		// 保存修改
-		return ACAPI_ProjectSetting_ChangeProjectNotes(&projectNotes);
-	}
-	
-	// 修复UUID格式（如果格式不正确）
-	static GS::UniString FixUUIDFormat(const GS::UniString& uuid)
-	{
-		GS::UniString result = uuid;
-		
-		// 如果已经是标准格式，直接返回
-		if (IsValidUUIDFormat(result)) {
-			return result;
-		}
-		
-		// 移除所有非十六进制字符（保留连字符）
-		GS::UniString clean;
-		for (UInt32 i = 0; i < result.GetLength(); ++i) {
-			GS::uchar_t ch = result.GetChar(i);
-			if ((ch >= '0' && ch <= '9') || (ch >= 'A' && ch <= 'F') || (ch >= 'a' && ch <= 'f') || ch == '-') {
-				clean.Append(ch);
-			}
-		}
-		
-		// 如果长度正确且有正确的连字符位置，尝试修复
-		if (clean.GetLength() == 32) {
-			// 32个十六进制字符，添加连字符
-			char fixed[37];
-			std::memcpy(fixed, clean.ToCStr().Get(), 8);
-			fixed[8] = '-';
-			std::memcpy(fixed + 9, clean.ToCStr().Get() + 8, 4);
-			fixed[13] = '-';
-			std::memcpy(fixed + 14, clean.ToCStr().Get() + 12, 4);
-			fixed[18] = '-';
-			std::memcpy(fixed + 19, clean.ToCStr().Get() + 16, 4);
-			fixed[23] = '-';
-			std::memcpy(fixed + 24, clean.ToCStr().Get() + 20, 12);
-			fixed[36] = '\0';
-			
-			GS::UniString fixedUuid(fixed);
-			if (IsValidUUIDFormat(fixedUuid)) {
-				ACAPI_WriteReport("FixUUIDFormat: 已修复UUID格式: %s → %s", false, 
-								uuid.ToCStr().Get(), fixedUuid.ToCStr().Get());
-				return fixedUuid;
-			}
-		}
-		
-		// 无法修复，生成新的UUID
-		ACAPI_WriteReport("FixUUIDFormat: 无法修复UUID格式，生成新的: %s", true, uuid.ToCStr().Get());
-		return GenerateUUID();
-	}
-	
-	// 获取或创建项目UUID (主要函数)
-	// 策略：项目文件(project notes)为唯一权威来源；preferences仅用于检测"另存为"副本
-	// - 同一项目重命名/移动：UUID 不变，照片仍可读（相对路径解析到新目录）
-	// - 多项目同目录：每个项目有独立 UUID，照片文件夹分开
-	// - 另存为副本：检测到同一 UUID 对应不同路径且原路径仍存在，则为副本，生成新 UUID
-	static GS::UniString GetOrCreateProjectUUID()
-	{
-		GS::UniString currentPath = GetCurrentProjectPath();
-		GS::UniString uuid = ReadProjectUUIDFromProjectNotes();
-		if (!uuid.IsEmpty())
-			uuid = FixUUIDFormat(uuid);
-		
-		if (!uuid.IsEmpty()) {
-			// 项目已有 UUID，检查是否为"另存为"副本
-			GS::UniString lastUuid, lastPath;
-			if (ReadProjectMappingFromPreferences(lastUuid, lastPath)) {
-				if (currentPath == lastPath) {
-					// 同一项目
-					ACAPI_WriteReport("GetOrCreateProjectUUID: 同一项目，使用UUID: %s", false, uuid.ToCStr().Get());
-					return uuid;
-				}
-				if (uuid == lastUuid && !lastPath.IsEmpty()) {
-					// 同一 UUID、不同路径：判断是副本还是重命名
-					bool oldPathExists = false;
-					try {
-						oldPathExists = std::filesystem::exists(std::filesystem::path(lastPath.ToCStr().Get()));
-					} catch (...) {}
-					if (oldPathExists) {
-						// 原文件仍存在 → 当前为副本（另存为）
-						uuid = GenerateUUID();
-						GSErrCode err = SaveProjectUUIDToProjectNotes(uuid);
-						if (err == NoError) {
-							ACAPI_WriteReport("GetOrCreateProjectUUID: 检测到另存为副本，生成新UUID: %s", false, uuid.ToCStr().Get());
-						}
-						SaveProjectMappingToPreferences(uuid, currentPath);
-						return uuid;
-					}
-					// 原路径不存在 → 视为重命名/移动，保持 UUID
-					ACAPI_WriteReport("GetOrCreateProjectUUID: 视为重命名/移动，保持UUID: %s", false, uuid.ToCStr().Get());
-				}
-			}
-			SaveProjectMappingToPreferences(uuid, currentPath);
-			ACAPI_WriteReport("GetOrCreateProjectUUID: 从项目信息读取UUID: %s", false, uuid.ToCStr().Get());
-			return uuid;
-		}
-		
-		// 项目无 UUID，生成并保存
-		uuid = GenerateUUID();
-		ACAPI_WriteReport("GetOrCreateProjectUUID: 生成新UUID: %s", false, uuid.ToCStr().Get());
-		GSErrCode notesErr = SaveProjectUUIDToProjectNotes(uuid);
-		if (notesErr == NoError) {
-			ACAPI_WriteReport("GetOrCreateProjectUUID: UUID已保存到项目信息", false);
-		} else {
-			ACAPI_WriteReport("GetOrCreateProjectUUID: 保存到项目信息失败: %d (可接受)", true, notesErr);
-		}
-		SaveProjectMappingToPreferences(uuid, currentPath);
-		return uuid;
-	}
-}
-
 GS::UniString PluginPalette::CalculateProjectHash ()
 {
-	// 使用新的UUID方案替代路径哈希
-	// 该方法生成的项目标识符在文件重命名/移动时保持稳定
-	
-	try {
-		GS::UniString projectUuid = GetOrCreateProjectUUID();
-		if (!projectUuid.IsEmpty()) {
-			// 使用UUID作为项目标识符
-			ACAPI_WriteReport("CalculateProjectHash: 使用项目UUID: %s", false, projectUuid.ToCStr().Get());
-			return projectUuid;
-		}
-	} catch (...) {
-		ACAPI_WriteReport("CalculateProjectHash: UUID方案失败，回退到路径哈希", true);
-	}
-	
-	// 回退到原始的路径哈希方案
-	API_ProjectInfo projectInfo;
-	GSErrCode err = ACAPI_ProjectOperation_Project(&projectInfo);
-	if (err != NoError) {
-		ACAPI_WriteReport("CalculateProjectHash: 获取项目信息失败: %d", true, err);
-		return "unknown";
-	}
-	
-	// 检查项目是否已保存
-	if (projectInfo.untitled) {
-		ACAPI_WriteReport("CalculateProjectHash: 项目未保存，使用临时标识符", false);
-		return "unsaved_project";
-	}
-	
-	// 使用项目路径计算哈希
-	IO::Location projectLocation = *projectInfo.location;
-	GS::UniString projectPath;
-	projectLocation.ToPath(&projectPath);
-	
-	ACAPI_WriteReport("CalculateProjectHash: 回退到路径哈希，项目路径='%s'", false, projectPath.ToCStr().Get());
-	
-	UInt32 hashValue = GS::CalculateHashValue(projectPath);
-	GS::UniString hashStr;
-	hashStr.Printf("%08X", hashValue);
-	ACAPI_WriteReport("CalculateProjectHash: 哈希值=0x%08X", false, hashValue);
-	return hashStr;
+	return HBIMProject::CalculateProjectHash();
 }
 
 bool PluginPalette::IsProjectSaved ()
 {
-	API_ProjectInfo projectInfo;
-	GSErrCode err = ACAPI_ProjectOperation_Project(&projectInfo);
-	if (err != NoError) {
-		return false;
-	}
-	
-	return !projectInfo.untitled;
+	return HBIMProject::GetContext().isSaved;
 }
 
 void PluginPalette::ShowDiagnostics ()
@@ -2960,28 +1751,16 @@ void PluginPalette::ButtonClicked (const DG::ButtonClickEvent& ev)
 			return;
 		}
 		ACAPI_WriteReport("launchLabelmeButton: 图片路径=%s", false, fullPath.ToCStr().Get());
-#if defined (GS_MAC)
-		GSErrCode err = LaunchLabelme(fullPath);
-		if (err != NoError) {
-			GS::UniString msg;
-			msg.Append("未找到可用的 labelme 或启动失败。\n\n");
-			msg.Append("请在终端中确认 labelme 已正确安装:\n");
-			msg.Append("  which labelme\n");
-			msg.Append("  labelme --version\n\n");
-			msg.Append("如未安装，请执行:\n");
-			msg.Append("  pip install labelme\n\n");
-			msg.Append("已搜索路径:\n");
-			msg.Append("  /opt/miniconda3/bin/labelme\n");
-			msg.Append("  /opt/homebrew/bin/labelme\n");
-			msg.Append("  /usr/local/bin/labelme\n");
-			msg.Append("  /usr/bin/labelme");
-			DG::InformationAlert("Labelme 启动失败", msg.ToCStr().Get(), "确定");
-		}
-#elif defined (GS_WIN)
-		DG::InformationAlert("Labelme", "Windows 暂不支持直接启动 labelme", "确定");
-#endif
+		// 后台启动，不等待进程；失败或异常退出经状态回调提示
+		HBIMLabelme::Open(fullPath);
 	} else if (ev.GetSource() == &diagnosisButton) {
 		ShowDiagnostics();
+	} else if (ev.GetSource() == &ifcRefreshButton) {
+		if (currentElemGuid == APINULLGuid)
+			return;
+		ResetIFCPropertyTree(currentElemGuid);
+		LoadIFCPropertySets(true);
+		ifcPropertyTree.ExpandItem(ifcRootItem);
 	}
 }
 
@@ -2996,22 +1775,167 @@ void PluginPalette::ImageClicked (const DG::ImageClickEvent& ev)
 	if (imageLoc.ToPath(&fullPath) != NoError || fullPath.IsEmpty())
 		return;
 	
-	// 点击图片始终用系统默认程序打开
-#if defined (GS_MAC)
-	IO::Location openCmd("/usr/bin/open");
-	GS::Array<GS::UniString> argv;
-	argv.Push(fullPath);
-	GSErrCode err = IO::Process::ApplicationLauncher::Instance().Launch(openCmd, argv);
-	if (err != NoError) {
-		ACAPI_WriteReport("预览图片失败 (错误码: %d)", true, static_cast<int>(err));
-	}
-#elif defined (GS_WIN)
-	IO::Location openCmd("C:\\Windows\\explorer.exe");
-	GS::Array<GS::UniString> argv;
-	argv.Push(fullPath);
-	GSErrCode err = IO::Process::ApplicationLauncher::Instance().Launch(openCmd, argv);
-	if (err != NoError) {
-		ACAPI_WriteReport("预览图片失败 (错误码: %d)", true, static_cast<int>(err));
-	}
-#endif
-}
\ No newline at end of file
+	// 在插件内的大图窗口中查看（瓦片平移缩放），标题带上文件名与所属构件
+	GS::UniString title = GetFileNameFromPath(fullPath);
+	GS::UniString globalId = HBIMGlobalIdIndex::GetGlobalId(currentElemGuid);
+	if (!globalId.IsEmpty())
+		title += " - " + globalId;
+	HBIMTileViewer::Show(fullPath, imagePaths[currentImageIndex], title);
+}
+
+// -----------------------------------------------------------------------------
+// IFC属性树
+// -----------------------------------------------------------------------------
+
+namespace {
+	// 每次展开/点击“更多...”加载的属性条数
+	static const UInt32 kIFCPropertyPageSize = 50;
+
+	// 节点值：属性集节点为 组下标+1，“更多...”节点为 -(组下标+1)，占位和属性节点为 0
+	static DGUserData IFCSetNodeValue(UInt32 setIndex) { return static_cast<DGUserData>(setIndex) + 1; }
+	static DGUserData IFCMoreNodeValue(UInt32 setIndex) { return -(static_cast<DGUserData>(setIndex) + 1); }
+}
+
+void PluginPalette::ResetIFCPropertyTree (const API_Guid& elemGuid)
+{
+	// 同一构件保留已展开的内容（重新读取用“刷新IFC属性”按钮）
+	if (elemGuid == ifcTreeElemGuid && ifcRootItem != 0 && elemGuid != APINULLGuid)
+		return;
+
+	ifcTreeElemGuid = elemGuid;
+	ifcTreeLoaded = false;
+	ifcProperties.Clear();
+	ifcPropertySets.Clear();
+
+	ifcPropertyTree.DisableDraw();
+	ifcPropertyTree.DeleteItem(DG::TreeView::AllItems);
+	ifcRootItem = ifcPropertyTree.AppendItem(DG::TreeView::RootItem);
+	if (elemGuid == APINULLGuid) {
+		ifcPropertyTree.SetItemText(ifcRootItem, "IFC属性（未选择构件）");
+	} else {
+		// 占位子节点使根节点显示展开箭头
+		ifcPropertyTree.SetItemText(ifcRootItem, "IFC属性（展开读取）");
+		Int32 placeholder = ifcPropertyTree.AppendItem(ifcRootItem);
+		ifcPropertyTree.SetItemText(placeholder, "读取中...");
+		ifcPropertyTree.CollapseItem(ifcRootItem);
+	}
+	ifcPropertyTree.EnableDraw();
+	ifcPropertyTree.Redraw();
+}
+
+void PluginPalette::LoadIFCPropertySets (bool forceRefresh)
+{
+	if (ifcTreeElemGuid == APINULLGuid || ifcRootItem == 0)
+		return;
+
+	ifcTreeLoaded = true;
+	ifcProperties = PropertyUtils::GetIFCPropertiesForElement(ifcTreeElemGuid, forceRefresh);
+	ifcPropertySets.Clear();
+
+	// 按属性集分组，保持读取顺序
+	GS::HashTable<GS::UniString, UInt32> setIndexByName;
+	for (UInt32 i = 0; i < ifcProperties.GetSize(); ++i) {
+		const GS::UniString& setName = ifcProperties[i].propertySetName;
+		UInt32* setIndex = setIndexByName.GetPtr(setName);
+		if (setIndex == nullptr) {
+			IFCPropertySetNode node;
+			node.name = setName;
+			setIndexByName.Add(setName, ifcPropertySets.GetSize());
+			ifcPropertySets.Push(node);
+			setIndex = setIndexByName.GetPtr(setName);
+		}
+		ifcPropertySets[*setIndex].propertyIndices.Push(i);
+	}
+
+	ifcPropertyTree.DisableDraw();
+	for (Int32 child = ifcPropertyTree.GetItem(ifcRootItem, DG::TreeView::Child); child != DG::TreeView::NoItem; child = ifcPropertyTree.GetItem(ifcRootItem, DG::TreeView::Child))
+		ifcPropertyTree.DeleteItem(child);
+
+	if (ifcPropertySets.IsEmpty()) {
+		ifcPropertyTree.SetItemText(ifcRootItem, "IFC属性（无）");
+	} else {
+		ifcPropertyTree.SetItemText(ifcRootItem, GS::UniString::Printf("IFC属性（%u 组，%u 项）",
+			static_cast<unsigned>(ifcPropertySets.GetSize()), static_cast<unsigned>(ifcProperties.GetSize())));
+		for (UInt32 i = 0; i < ifcPropertySets.GetSize(); ++i) {
+			IFCPropertySetNode& node = ifcPropertySets[i];
+			node.treeItem = ifcPropertyTree.AppendItem(ifcRootItem);
+			ifcPropertyTree.SetItemText(node.treeItem, GS::UniString::Printf("%T (%u)", node.name.ToPrintf(), static_cast<unsigned>(node.propertyIndices.GetSize())));
+			ifcPropertyTree.SetItemValue(node.treeItem, IFCSetNodeValue(i));
+			Int32 placeholder = ifcPropertyTree.AppendItem(node.treeItem);
+			ifcPropertyTree.SetItemText(placeholder, "读取中...");
+			ifcPropertyTree.CollapseItem(node.treeItem);
+		}
+	}
+	ifcPropertyTree.EnableDraw();
+	ifcPropertyTree.Redraw();
+}
+
+void PluginPalette::LoadIFCPropertyPage (UInt32 setIndex)
+{
+	if (setIndex >= ifcPropertySets.GetSize())
+		return;
+	IFCPropertySetNode& node = ifcPropertySets[setIndex];
+	const UInt32 total = node.propertyIndices.GetSize();
+	if (node.loadedCount >= total)
+		return;
+
+	ifcPropertyTree.DisableDraw();
+	// 第一页替换占位节点，之后替换“更多...”节点
+	if (node.loadedCount == 0) {
+		Int32 placeholder = ifcPropertyTree.GetItem(node.treeItem, DG::TreeView::Child);
+		if (placeholder != DG::TreeView::NoItem)
+			ifcPropertyTree.DeleteItem(placeholder);
+	} else if (node.moreItem != 0) {
+		ifcPropertyTree.DeleteItem(node.moreItem);
+	}
+	node.moreItem = 0;
+
+	const UInt32 end = (total - node.loadedCount > kIFCPropertyPageSize) ? node.loadedCount + kIFCPropertyPageSize : total;
+	for (UInt32 i = node.loadedCount; i < end; ++i) {
+		const PropertyUtils::PropertyInfo& info = ifcProperties[node.propertyIndices[i]];
+		GS::UniString text = info.propertyName;
+		text.Append(": ");
+		text.Append(info.isValid ? info.propertyValue : GS::UniString("(无值)"));
+		Int32 item = ifcPropertyTree.AppendItem(node.treeItem);
+		ifcPropertyTree.SetItemText(item, text);
+	}
+	node.loadedCount = end;
+
+	if (node.loadedCount < total) {
+		node.moreItem = ifcPropertyTree.AppendItem(node.treeItem);
+		ifcPropertyTree.SetItemText(node.moreItem, GS::UniString::Printf("更多...（剩余 %u 项）", static_cast<unsigned>(total - node.loadedCount)));
+		ifcPropertyTree.SetItemValue(node.moreItem, IFCMoreNodeValue(setIndex));
+	}
+	ifcPropertyTree.EnableDraw();
+	ifcPropertyTree.Redraw();
+}
+
+void PluginPalette::TreeViewItemExpanded (const DG::TreeViewExpandEvent& ev)
+{
+	if (ev.GetSource() != &ifcPropertyTree)
+		return;
+	const Int32 item = ev.GetTreeItem();
+	if (item == ifcRootItem) {
+		if (!ifcTreeLoaded)
+			LoadIFCPropertySets(false);
+		return;
+	}
+	const DGUserData value = ifcPropertyTree.GetItemValue(item);
+	if (value <= 0 || static_cast<UInt32>(value - 1) >= ifcPropertySets.GetSize())
+		return;
+	if (ifcPropertySets[static_cast<UInt32>(value - 1)].loadedCount == 0)
+		LoadIFCPropertyPage(static_cast<UInt32>(value - 1));
+}
+
+void PluginPalette::TreeViewSelectionChanged (const DG::TreeViewSelectionEvent& ev)
+{
+	if (ev.GetSource() != &ifcPropertyTree)
+		return;
+	const Int32 item = ifcPropertyTree.GetSelectedItem();
+	if (item == DG::TreeView::NoItem)
+		return;
+	// 选中“更多...”时加载下一页
+	const DGUserData value = ifcPropertyTree.GetItemValue(item);
+	if (value < 0)
+		LoadIFCPropertyPage(static_cast<UInt32>(-value - 1));
+}
@@ -4,12 +4,15 @@
 #include "APIEnvir.h"
 #include "ACAPinc.h"
 #include "DGModule.hpp"
+#include "PropertyUtils.hpp"
 
 class PluginPalette : public DG::Palette,
 	public DG::PanelObserver,
 	public DG::CompoundItemObserver,
 	public DG::ButtonItemObserver,
-	public DG::ImageObserver
+	public DG::ImageObserver,
+	public DG::TreeViewObserver,
+	public DG::TextEditBaseObserver
 {
 public:
 	static const short PaletteResId = 32520;
@@ -45,7 +48,12 @@ public:
 		ImageOKButtonId = 28,
 		ImageCancelButtonId = 29,
 		DiagnosisButtonId = 30,  // 诊断按钮：点击显示当前状态，便于调试（ArchiCAD无报告窗口）
-		LaunchLabelmeButtonId = 31   // 启动labelme（仅在图片编辑模式显示）
+		LaunchLabelmeButtonId = 31,  // 启动labelme（仅在图片编辑模式显示）
+		IFCPropertyTreeId = 32,      // IFC属性树：展开时才读取、按组分页加载
+		IFCRefreshButtonId = 33,
+		ImageCaptureInfoId = 34,     // 当前图片的拍摄时间/相机/GPS（来自拍摄信息索引）
+		CaptureFilterLabelId = 35,
+		CaptureFilterEditId = 36     // 按拍摄时间筛选浏览的图片
 	};
 
 	static GSErrCode PaletteControlCallBack (Int32 paletteId, API_PaletteMessageID messageID, GS::IntPtr param);
@@ -62,11 +70,47 @@ public:
 	void Hide ();
 	void UpdateFromSelection ();
 	static bool IsInEditMode ();
+	static bool IsInImageEditMode ();
 	static void SetEditMode (bool editMode);
 
 	virtual ~PluginPalette ();
 
 private:
+	// 单个控件的显示状态（文本为空表示文本不由视图模型管理，如编辑框内容）
+	struct ItemState {
+		bool visible = true;
+		bool enabled = true;
+		GS::UniString text;
+
+		bool operator== (const ItemState& other) const { return visible == other.visible && enabled == other.enabled && text == other.text; }
+		bool operator!= (const ItemState& other) const { return !(*this == other); }
+	};
+
+	// HBIM属性区的视图模型：由当前状态一次性计算，刷新时与上一次比较，只改动变化的控件
+	struct HBIMViewModel {
+		ItemState idValue;
+		ItemState descValue;
+		ItemState actionButton;
+		ItemState cancelButton;
+	};
+
+	// HBIM图片区的视图模型；previewKey 为当前图片的完整路径+修改时间+大小+标注版本，不变时不重新加载预览
+	struct ImageViewModel {
+		GS::UniString countText;
+		GS::UniString currentText;
+		ItemState selectButton;
+		ItemState deleteButton;
+		ItemState prevButton;
+		ItemState nextButton;
+		ItemState okButton;
+		ItemState cancelButton;
+		ItemState labelmeButton;
+		GS::UniString captureText;
+		GS::UniString previewKey;
+		IO::Location previewLocation;
+		GS::UniString previewRelativePath;
+	};
+
 	DG::CenterText titleLabel;
 	DG::LeftText underlineLabel;
 	DG::LeftText typeLabel;
@@ -102,6 +146,13 @@ private:
 	DG::Button diagnosisButton;
 	DG::Button launchLabelmeButton;
 	DG::PictureItem imagePreview;
+	DG::LeftText imageCaptureInfo;
+	DG::LeftText captureFilterLabel;
+	DG::TextEdit captureFilterEdit;
+
+	// IFC属性控件
+	DG::SingleSelTreeView ifcPropertyTree;
+	DG::Button ifcRefreshButton;
 	
 	// HBIM属性状态
 	bool hasHBIMProperties;
@@ -118,13 +169,36 @@ private:
 	bool hasHBIMImages;
 	bool isImageEditMode;
 	bool isUpdatingImages; // 防止CheckHBIMImages和UpdateHBIMImageUI之间的循环调用
-	bool isLoadingImage;   // 防止LoadAndDisplayImage重入
 	GS::Array<GS::UniString> imagePaths;
 	GS::Array<GS::UniString> originalImagePaths; // 用于取消编辑时恢复
 	UInt32 currentImageIndex;
 	GS::UniString projectHash;
+	GS::UniString captureFilter;   // 拍摄时间筛选（空为不筛选），上一张/下一张只在匹配的图片间切换
+
+	// IFC属性树：一个属性集一个节点，展开后每次加载一页属性
+	struct IFCPropertySetNode {
+		GS::UniString name;
+		GS::Array<UInt32> propertyIndices;  // ifcProperties 中的下标
+		UInt32 loadedCount = 0;
+		Int32 treeItem = 0;
+		Int32 moreItem = 0;                 // “更多...”节点，全部加载后为 0
+	};
+
+	// 上一次应用到控件的视图模型（首次刷新时为空，全部应用）
+	HBIMViewModel lastHBIMView;
+	ImageViewModel lastImageView;
+	bool hasLastHBIMView;
+	bool hasLastImageView;
+
+	// IFC属性树状态（ifcTreeElemGuid 为树当前对应的构件）
+	API_Guid ifcTreeElemGuid;
+	Int32 ifcRootItem;
+	bool ifcTreeLoaded;
+	GS::Array<PropertyUtils::PropertyInfo> ifcProperties;
+	GS::Array<IFCPropertySetNode> ifcPropertySets;
 
 	// HBIM属性管理函数
+	HBIMViewModel BuildHBIMViewModel () const;
 	void UpdateHBIMUI ();
 	void EnterHBIMEditMode ();
 	void ExitHBIMEditMode (bool save);
@@ -137,14 +211,16 @@ private:
  	bool TryFindExistingHBIMPropertyGroupAndDefinitions ();
  	
   	// HBIM图片管理函数
+  	ImageViewModel BuildImageViewModel () const;
   	void UpdateHBIMImageUI ();
   	void CheckHBIMImages ();
   	void SelectHBIMImages ();
   	void DeleteCurrentHBIMImage ();
   	void NavigateHBIMImage (bool forward);
+  	bool ImageMatchesCaptureFilter (UInt32 index) const;
    	void EnterImageEditMode ();
    	void ExitImageEditMode (bool save);
-   	void LoadAndDisplayImage (const IO::Location& imageLocation, DG::PictureItem& pictureItem);
+   	void LoadAndDisplayImage (const IO::Location& imageLocation, const GS::UniString& relativePath, DG::PictureItem& pictureItem);
    	GSErrCode EnsureHBIMImageFolder ();
    	GS::UniString CalculateProjectHash ();
    	bool IsProjectSaved ();
@@ -152,11 +228,23 @@ private:
 	
 	void SetMenuItemCheckedState (bool checked);
 
+	// IFC属性树：切换构件时只重建未展开的根节点，展开时才读取属性
+	void ResetIFCPropertyTree (const API_Guid& elemGuid);
+	void LoadIFCPropertySets (bool forceRefresh);
+	void LoadIFCPropertyPage (UInt32 setIndex);
+
+	// prev 为空时无条件应用
+	template <typename ItemType>
+	static void ApplyItemState (ItemType& item, const ItemState& next, const ItemState* prev);
+
 	PluginPalette ();
 
 	virtual void PanelCloseRequested (const DG::PanelCloseRequestEvent& ev, bool* accepted) override;
 	virtual void ButtonClicked (const DG::ButtonClickEvent& ev) override;
 	virtual void ImageClicked (const DG::ImageClickEvent& ev) override;
+	virtual void TreeViewItemExpanded (const DG::TreeViewExpandEvent& ev) override;
+	virtual void TreeViewSelectionChanged (const DG::TreeViewSelectionEvent& ev) override;
+	virtual void TextEditChanged (const DG::TextEditChangeEvent& ev) override;
 };
 
 #endif
\ No newline at end of file
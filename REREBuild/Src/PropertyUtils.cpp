@@ -0,0 +1,182 @@
+// *****************************************************************************
+// File:			PropertyUtils.cpp
+// Description:		IFC属性读取与按构件修改戳的LRU缓存
+// Project:			HBIM构件信息录入插件
+// *****************************************************************************
+
+#include "PropertyUtils.hpp"
+#include "HashTable.hpp"
+
+#include "ACAPI/IFCObjectAccessor.hpp"
+#include "ACAPI/IFCPropertyAccessor.hpp"
+
+#include <chrono>
+#include <variant>
+#include <vector>
+
+namespace {
+
+	// 缓存的构件数；IFC属性多的构件一次可达数百条，缓存只需覆盖最近来回切换的构件
+	static const UInt32 kIFCCacheCapacity = 32;
+
+	struct IFCCacheEntry {
+		UInt64 modiStamp = 0;
+		UInt64 lastUse = 0;
+		GS::Array<PropertyUtils::PropertyInfo> properties;
+	};
+
+	// 只在主线程访问
+	static GS::HashTable<API_Guid, IFCCacheEntry> s_ifcCache;
+	static UInt64 s_ifcCacheClock = 0;
+
+	static GS::UniString IFCValueToString (const IFCAPI::Value& value)
+	{
+		const IFCAPI::AnyValue anyValue = value.GetAnyValue ();
+		if (!anyValue.has_value ())
+			return GS::UniString ();
+
+		if (std::holds_alternative<GS::UniString> (*anyValue))
+			return std::get<GS::UniString> (*anyValue);
+		if (std::holds_alternative<Int64> (*anyValue))
+			return GS::UniString::Printf ("%lld", static_cast<long long> (std::get<Int64> (*anyValue)));
+		if (std::holds_alternative<double> (*anyValue))
+			return GS::UniString::Printf ("%.6g", std::get<double> (*anyValue));
+		if (std::holds_alternative<bool> (*anyValue))
+			return std::get<bool> (*anyValue) ? "TRUE" : "FALSE";
+		if (std::holds_alternative<IFCAPI::IfcLogical> (*anyValue)) {
+			switch (std::get<IFCAPI::IfcLogical> (*anyValue)) {
+				case IFCAPI::IfcLogical::True:		return "TRUE";
+				case IFCAPI::IfcLogical::False:		return "FALSE";
+				case IFCAPI::IfcLogical::Unknown:	return "UNKNOWN";
+			}
+		}
+		return GS::UniString ();
+	}
+
+	static GS::UniString JoinIFCValues (const std::vector<IFCAPI::Value>& values)
+	{
+		GS::UniString result;
+		for (const IFCAPI::Value& value : values) {
+			if (!result.IsEmpty ())
+				result.Append ("; ");
+			result.Append (IFCValueToString (value));
+		}
+		return result;
+	}
+
+	static PropertyUtils::PropertyInfo ToPropertyInfo (const IFCAPI::Property& property)
+	{
+		PropertyUtils::PropertyInfo info;
+		info.propertySetName = property.GetPropertySetName ();
+		info.propertyName = property.GetName ();
+		info.isValid = true;
+
+		const IFCAPI::PropertyByType typed = property.GetTyped ();
+		if (std::holds_alternative<IFCAPI::PropertySingleValue> (typed)) {
+			const IFCAPI::Value value = std::get<IFCAPI::PropertySingleValue> (typed).GetNominalValue ();
+			info.propertyType = value.GetType ();
+			info.propertyValue = IFCValueToString (value);
+			info.isValid = value.GetAnyValue ().has_value ();
+		} else if (std::holds_alternative<IFCAPI::PropertyListValue> (typed)) {
+			info.propertyType = "IfcPropertyListValue";
+			info.propertyValue = JoinIFCValues (std::get<IFCAPI::PropertyListValue> (typed).GetListValues ());
+		} else if (std::holds_alternative<IFCAPI::PropertyBoundedValue> (typed)) {
+			const IFCAPI::PropertyBoundedValue& bounded = std::get<IFCAPI::PropertyBoundedValue> (typed);
+			info.propertyType = "IfcPropertyBoundedValue";
+			info.propertyValue = IFCValueToString (bounded.GetLowerBoundValue ());
+			info.propertyValue.Append (" ~ ");
+			info.propertyValue.Append (IFCValueToString (bounded.GetUpperBoundValue ()));
+		} else if (std::holds_alternative<IFCAPI::PropertyEnumeratedValue> (typed)) {
+			info.propertyType = "IfcPropertyEnumeratedValue";
+			info.propertyValue = JoinIFCValues (std::get<IFCAPI::PropertyEnumeratedValue> (typed).GetEnumerationValues ());
+		} else if (std::holds_alternative<IFCAPI::PropertyTableValue> (typed)) {
+			info.propertyType = "IfcPropertyTableValue";
+			info.propertyValue = GS::UniString::Printf ("%u 行", static_cast<unsigned> (std::get<IFCAPI::PropertyTableValue> (typed).GetDefiningValues ().size ()));
+		}
+		return info;
+	}
+
+	static GS::Array<PropertyUtils::PropertyInfo> ReadIFCProperties (const API_Elem_Head& elemHead)
+	{
+		GS::Array<PropertyUtils::PropertyInfo> result;
+
+		auto objectID = IFCAPI::GetObjectAccessor ().CreateElementObjectID (elemHead);
+		if (objectID.IsErr ())
+			return result;
+
+		auto properties = IFCAPI::PropertyAccessor (*objectID).GetPreviewProperties ();
+		if (properties.IsErr ())
+			return result;
+
+		for (const IFCAPI::Property& property : *properties)
+			result.Push (ToPropertyInfo (property));
+		return result;
+	}
+
+	// 超出容量时淘汰最久未使用的一项（容量很小，线性查找即可）
+	static void EvictLeastRecentlyUsed ()
+	{
+		while (s_ifcCache.GetSize () > kIFCCacheCapacity) {
+			API_Guid oldestGuid = APINULLGuid;
+			UInt64 oldestUse = 0;
+			bool found = false;
+			for (auto it = s_ifcCache.EnumeratePairs (); it != nullptr; ++it) {
+				if (!found || it->value.lastUse < oldestUse) {
+					oldestGuid = it->key;
+					oldestUse = it->value.lastUse;
+					found = true;
+				}
+			}
+			if (!found)
+				return;
+			s_ifcCache.Delete (oldestGuid);
+		}
+	}
+
+}
+
+namespace PropertyUtils {
+
+GS::Array<PropertyInfo> GetAllIFCPropertiesForElement (const API_Guid& elementGuid)
+{
+	API_Elem_Head elemHead = {};
+	elemHead.guid = elementGuid;
+	if (ACAPI_Element_GetHeader (&elemHead) != NoError)
+		return GS::Array<PropertyInfo> ();
+	return ReadIFCProperties (elemHead);
+}
+
+GS::Array<PropertyInfo> GetIFCPropertiesForElement (const API_Guid& elementGuid, bool forceRefresh)
+{
+	API_Elem_Head elemHead = {};
+	elemHead.guid = elementGuid;
+	if (ACAPI_Element_GetHeader (&elemHead) != NoError)
+		return GS::Array<PropertyInfo> ();
+
+	// 修改戳不变说明构件未被修改，缓存仍然有效
+	IFCCacheEntry* cached = s_ifcCache.GetPtr (elementGuid);
+	if (!forceRefresh && cached != nullptr && cached->modiStamp == elemHead.modiStamp) {
+		cached->lastUse = ++s_ifcCacheClock;
+		return cached->properties;
+	}
+
+	auto start = std::chrono::steady_clock::now ();
+	IFCCacheEntry entry;
+	entry.modiStamp = elemHead.modiStamp;
+	entry.lastUse = ++s_ifcCacheClock;
+	entry.properties = ReadIFCProperties (elemHead);
+	ACAPI_WriteReport ("PropertyUtils: 读取IFC属性 %u 项，耗时 %.3f 秒", false, static_cast<unsigned> (entry.properties.GetSize ()),
+					   std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ());
+
+	s_ifcCache.Put (elementGuid, entry);
+	EvictLeastRecentlyUsed ();
+	return entry.properties;
+}
+
+void ClearIFCPropertyCache ()
+{
+	s_ifcCache.Clear ();
+	s_ifcCacheClock = 0;
+}
+
+}
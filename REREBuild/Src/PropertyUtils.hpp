@@ -25,9 +25,15 @@ struct PropertyInfo {
 	int GetAddOnVersionPatch ();
 	int GetAddOnVersionBuild ();
 
+	// 读取构件的全部IFC属性（按预览导出转换器计算，与IFC项目管理器中所见一致），不经过缓存
 	GS::Array<PropertyInfo> GetAllIFCPropertiesForElement (const API_Guid& elementGuid);
+
+	// 同上，结果按 构件GUID+修改戳 缓存（LRU，最近使用的若干个构件）；forceRefresh 时跳过缓存重新读取
 	GS::Array<PropertyInfo> GetIFCPropertiesForElement (const API_Guid& elementGuid, bool forceRefresh = false);
 
+	// 清空IFC属性缓存（切换项目时调用）
+	void ClearIFCPropertyCache ();
+
 
 }
 